@@ -0,0 +1,154 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include <zlib.h>
+
+#include <fmt/minipng/minipng.h>
+
+/* decoder benchmark (Linux host).
+ * decodes each PNG over and over with the row decoder (unfilter + deinterlace), reading the compressed
+ * data through a 1KB buffer, the default buffer and the memory mapped file, then with the one-shot
+ * minipng_decode_to_buffer(), and reports rows and megabytes per second. also prints the adler32 of the
+ * decoded image so the output can be checked against another decoder, and fails if the modes disagree. */
+
+enum {
+    MODE_ROWS=0,
+    MODE_ONESHOT
+};
+
+struct bench_mode {
+    const char*         name;
+    unsigned char       how;
+    unsigned char       map;
+    size_t              buffer_size;    /* 0 = default */
+};
+
+static const struct bench_mode modes[] = {
+    { "rows, 1KB reads",        MODE_ROWS,      0,  1024 },
+    { "rows, default reads",    MODE_ROWS,      0,  0 },
+    { "rows, mmap",             MODE_ROWS,      1,  0 },
+    { "decode_to_buffer",       MODE_ONESHOT,   0,  0 },
+    { "decode_to_buffer, mmap", MODE_ONESHOT,   1,  0 }
+};
+
+#define NUM_MODES (sizeof(modes) / sizeof(modes[0]))
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1000000000.0);
+}
+
+static struct minipng_reader *open_png(const char *path,const struct bench_mode *m) {
+    struct minipng_reader *rdr;
+
+    if ((rdr=minipng_reader_open(path)) == NULL)
+        return NULL;
+
+    if (m != NULL) {
+        minipng_reader_set_buffer_size(rdr,m->buffer_size);
+        if (m->map) minipng_reader_map(rdr);
+    }
+
+    if (minipng_reader_parse_head(rdr)) {
+        minipng_reader_close(&rdr);
+        return NULL;
+    }
+
+    return rdr;
+}
+
+/* full decode into image. returns rows read (all passes), 0 on failure */
+static unsigned long decode(const char *path,const struct bench_mode *m,unsigned char *image,size_t stride,unsigned int bits_per_pixel) {
+    struct minipng_reader *rdr;
+    struct minipng_row_info info;
+    unsigned long rows = 0;
+    unsigned char *row;
+
+    if ((rdr=open_png(path,m)) == NULL) return 0;
+
+    if (m->how == MODE_ONESHOT) {
+        if (minipng_decode_to_buffer(rdr,image,stride) == 0)
+            rows = rdr->ihdr.height;
+    }
+    else {
+        while ((row=minipng_reader_read_row(rdr,&info)) != NULL) {
+            minipng_deinterlace_row(image + ((size_t)info.y * stride),row,&info,bits_per_pixel);
+            rows++;
+        }
+    }
+
+    minipng_reader_close(&rdr);
+    return rows;
+}
+
+int main(int argc,char **argv) {
+    static const char *def_files[] = { "sml.png", "med.png", "lrg.png" };
+    const char **files = def_files;
+    unsigned int count = 3,i,mi,loops;
+    unsigned long rows,bytes,sum,first_sum = 0;
+    struct minipng_reader *rdr;
+    unsigned int bits_per_pixel;
+    unsigned char *image;
+    size_t stride;
+    double t0,t;
+    int fail = 0;
+
+    if (argc > 1) {
+        files = (const char**)(argv + 1);
+        count = (unsigned int)(argc - 1);
+    }
+
+    for (i=0;i < count;i++) {
+        if ((rdr=open_png(files[i],NULL)) == NULL) {
+            fprintf(stderr,"%s: failed to open\n",files[i]);
+            fail = 1;
+            continue;
+        }
+
+        bits_per_pixel = minipng_bits_per_pixel(&rdr->ihdr);
+        stride = minipng_image_stride(rdr);
+        bytes = (unsigned long)stride * (unsigned long)rdr->ihdr.height;
+        printf("%s: %lu x %lu, %u bits/pixel, %s\n",files[i],
+            (unsigned long)rdr->ihdr.width,(unsigned long)rdr->ihdr.height,bits_per_pixel,
+            rdr->ihdr.interlace_method ? "interlaced" : "not interlaced");
+        minipng_reader_close(&rdr);
+
+        image = malloc(bytes ? bytes : 1);
+        if (image == NULL) {
+            fprintf(stderr,"Out of memory\n");
+            return 1;
+        }
+
+        for (mi=0;mi < NUM_MODES;mi++) {
+            memset(image,0,bytes);
+
+            loops = 0;
+            rows = 0;
+            t0 = now();
+            do {
+                rows = decode(files[i],&modes[mi],image,stride,bits_per_pixel);
+                loops++;
+                t = now() - t0;
+            } while (t < 0.25 || loops < 4);
+
+            sum = (unsigned long)adler32(adler32(0L,Z_NULL,0),image,(uInt)bytes);
+            if (mi == 0) first_sum = sum;
+            if (rows == 0 || sum != first_sum) fail = 1;
+
+            printf("  %-24s %8.2f MB/s, %10.0f rows/s, adler32 %08lx%s\n",modes[mi].name,
+                ((double)bytes * loops) / t / 1000000.0,((double)rows * loops) / t,sum,
+                (rows == 0 || sum != first_sum) ? " MISMATCH" : "");
+        }
+
+        free(image);
+    }
+
+    return fail;
+}
@@ -0,0 +1,74 @@
+
+#include <stdio.h>
+#if defined(TARGET_MSDOS)
+#include <conio.h> /* this is where Open Watcom hides the outp() etc. functions */
+#include <ctype.h>
+#endif
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <math.h>
+#if defined(TARGET_MSDOS)
+#include <dos.h>
+#endif
+
+#if defined(TARGET_MSDOS)
+#include <hw/cpu/cpu.h>
+#include <hw/dos/dos.h>
+#include <hw/vga/vga.h>
+#endif
+
+#if defined(TARGET_MSDOS)
+#include <ext/zlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#include <fmt/minipng/minipng.h>
+
+size_t minipng_image_stride(const struct minipng_reader *rdr) {
+    if (rdr == NULL) return 0;
+
+    return (size_t)((((unsigned long)rdr->ihdr.width * (unsigned long)minipng_bits_per_pixel(&rdr->ihdr)) + 7ul) / 8ul);
+}
+
+int minipng_decode_to_buffer(struct minipng_reader *rdr,unsigned char *dst,size_t stride) {
+    const unsigned int bits_per_pixel = (rdr != NULL) ? minipng_bits_per_pixel(&rdr->ihdr) : 0;
+    const size_t row_bytes = minipng_image_stride(rdr);
+    struct minipng_row_info info;
+    unsigned char *prev = NULL;
+    unsigned char *row;
+    unsigned char filter;
+    uint32_t y;
+
+    if (rdr == NULL || dst == NULL) return -1;
+    if (rdr->fd < 0) return -1;
+    if (bits_per_pixel == 0 || rdr->ihdr.filter_method != 0 || rdr->ihdr.interlace_method > 1) return -1;
+    if (stride == 0) stride = row_bytes;
+    if (stride < row_bytes) return -1;
+
+    if (rdr->ihdr.interlace_method == 1) {
+        /* pixels of a pass are spread across the image, go through the row decoder */
+        for (y=0;(row=minipng_reader_read_row(rdr,&info)) != NULL;y++)
+            minipng_deinterlace_row(dst + ((size_t)info.y * stride),row,&info,bits_per_pixel);
+
+        /* read_row() returns NULL on error too, so only every row of every pass is success */
+        return (y == minipng_reader_row_count(rdr)) ? 0 : -1;
+    }
+
+    /* not interlaced: inflate straight into the destination and unfilter in place,
+     * using the row above in dst as the previous row. no intermediate copy. */
+    for (y=0;y < rdr->ihdr.height;y++) {
+        row = dst + ((size_t)y * stride);
+
+        if (minipng_reader_read_idat(rdr,&filter,1) != 1) return -1;
+        if ((size_t)minipng_reader_read_idat(rdr,row,row_bytes) != row_bytes) return -1;
+        if (minipng_unfilter_row(row,prev,row_bytes,(bits_per_pixel + 7u) / 8u,filter) < 0) return -1;
+
+        prev = row;
+    }
+
+    return 0;
+}
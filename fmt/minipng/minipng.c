@@ -93,10 +93,12 @@ int minipng_reader_next_chunk(struct minipng_reader *rdr) {
 
 void minipng_reader_close(struct minipng_reader **rdr) {
     if (*rdr != NULL) {
-        if ((*rdr)->compr_zlib.next_in != NULL) inflateEnd(&((*rdr)->compr_zlib));
+        minipng_reader_unmap(*rdr); /* first, it resets the IDAT reader */
+        if ((*rdr)->compr_init) inflateEnd(&((*rdr)->compr_zlib));
         if ((*rdr)->compr != NULL) free((*rdr)->compr);
         if ((*rdr)->trns != NULL) free((*rdr)->trns);
         if ((*rdr)->plte != NULL) free((*rdr)->plte);
+        if ((*rdr)->row_buf != NULL) free((*rdr)->row_buf);
         if ((*rdr)->fd >= 0) close((*rdr)->fd);
         free(*rdr);
         *rdr = NULL;
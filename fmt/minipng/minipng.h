@@ -47,6 +47,19 @@ struct minipng_chunk {
     uint32_t                type;           /* compare against minipng_chunk_fourcc() */
 };
 
+/* one decoded row, from minipng_reader_read_row(). For non-interlaced images pass == 0 and
+ * x0 == 0, dx == 1, dy == 1. For Adam7 interlaced images pass is 1-7 and the row holds every dx'th
+ * pixel of image row y starting at x0, width pixels total. */
+struct minipng_row_info {
+    uint32_t                    y;              /* image row this belongs to */
+    uint32_t                    width;          /* pixels in this row */
+    uint32_t                    x0;             /* first image column */
+    uint8_t                     dx;             /* image columns between pixels */
+    uint8_t                     dy;             /* image rows between rows of this pass */
+    uint8_t                     pass;           /* Adam7 pass (1-7) or 0 */
+    uint8_t                     filter;         /* PNG filter type the row had */
+};
+
 struct minipng_reader {
     char*                       err_msg;
     off_t                       chunk_data_offset;
@@ -65,11 +78,37 @@ struct minipng_reader {
     uint32_t                    idat_rem;
     unsigned char*              compr;
     size_t                      compr_size;
+    size_t                      compr_size_req; /* minipng_reader_set_buffer_size(), 0 = MINIPNG_COMPR_SIZE_DEFAULT */
+    unsigned char               compr_init;     /* compr_zlib was set up with inflateInit2() */
     z_stream                    compr_zlib;
 
+#if defined(LINUX)
+    /* whole file mapped in by minipng_reader_map(). IDAT chunks are then given to zlib whole, straight from the mapping */
+    unsigned char*              map;
+    size_t                      map_size;
+#endif
+
     unsigned int                ungetch;
+
+    /* row decoder (minipng_reader_read_row). two rows, each with the filter byte in front */
+    unsigned char*              row_buf;
+    size_t                      row_buf_size;   /* size of one of the two rows, full image width */
+    size_t                      row_bytes;      /* bytes in a row of the current pass, not counting the filter byte */
+    unsigned char               row_cur;        /* which of the two rows is the current one */
+    unsigned char               row_bpp;        /* bytes per complete pixel, at least 1 (filter distance) */
+    unsigned char               row_pass;       /* current Adam7 pass (1-7), 0 if not interlaced */
+    uint32_t                    row_y;          /* next row within the pass */
+    uint32_t                    row_pass_width;
+    uint32_t                    row_pass_height;
 };
 
+/* compressed data read buffer. DOS builds keep it small, there is not much memory to go around */
+#if defined(TARGET_MSDOS)
+# define MINIPNG_COMPR_SIZE_DEFAULT         1024u
+#else
+# define MINIPNG_COMPR_SIZE_DEFAULT         65536u
+#endif
+
 extern const uint8_t minipng_sig[8];
 
 /* WARNING: This function will expand bytes to a multiple of 8 pixels rounded up. Allocate your buffer accordingly. */
@@ -86,3 +125,43 @@ int minipng_reader_read_idat(struct minipng_reader *rdr,unsigned char FAR *dst,s
 size_t minipng_rowsize_bytes(struct minipng_reader *rdr);
 void minipng_reader_reset_idat(struct minipng_reader *rdr);
 
+/* PNG filter types [https://www.w3.org/TR/PNG/#9Filter-types] */
+enum {
+    MINIPNG_FILTER_NONE=0,
+    MINIPNG_FILTER_SUB=1,
+    MINIPNG_FILTER_UP=2,
+    MINIPNG_FILTER_AVERAGE=3,
+    MINIPNG_FILTER_PAETH=4
+};
+
+/* undo the filter on row in place. prev is the unfiltered previous row, or NULL if this is the first row of the image/pass.
+ * bpp is bytes per complete pixel (1 for anything less than 8 bits). returns -1 if the filter type is not valid. */
+int minipng_unfilter_row(unsigned char *row,const unsigned char *prev,size_t bytes,unsigned int bpp,unsigned char filter);
+
+unsigned int minipng_bits_per_pixel(const struct minipng_IHDR *ihdr);
+
+/* row decoder: after minipng_reader_parse_head(), returns each row unfiltered, in file order. Adam7 interlaced images come back
+ * one pass at a time, use info to place the pixels or minipng_deinterlace_row() to scatter them into a full image row.
+ * The pointer is valid until the next call. Only two rows are held in memory. Returns NULL at the end of the image or on error. */
+unsigned char *minipng_reader_read_row(struct minipng_reader *rdr,struct minipng_row_info *info);
+void minipng_reader_free_rows(struct minipng_reader *rdr);
+/* rows minipng_reader_read_row() returns for the whole image, all passes. Fewer than that before NULL means the image was cut short */
+uint32_t minipng_reader_row_count(const struct minipng_reader *rdr);
+void minipng_deinterlace_row(unsigned char *dst,const unsigned char *row,const struct minipng_row_info *info,unsigned int bits_per_pixel);
+
+/* size of the buffer minipng_reader_read_idat() reads compressed data into. Takes effect the next time IDAT reading starts
+ * (first read or after minipng_reader_reset_idat()). 0 means MINIPNG_COMPR_SIZE_DEFAULT. */
+void minipng_reader_set_buffer_size(struct minipng_reader *rdr,size_t sz);
+
+/* map the whole file into memory so that IDAT chunks need no read() calls or copying. Returns -1 if the
+ * platform can't (anything but the Linux host build) or the mapping failed, in which case reading continues as normal. */
+int minipng_reader_map(struct minipng_reader *rdr);
+void minipng_reader_unmap(struct minipng_reader *rdr);
+
+/* bytes per row of the unfiltered image, without the filter byte */
+size_t minipng_image_stride(const struct minipng_reader *rdr);
+
+/* decode the whole image (unfiltered, deinterlaced) into dst, stride bytes apart (0 = minipng_image_stride()).
+ * call after minipng_reader_parse_head(). dst must hold stride * height bytes. Returns 0 on success, -1 on error. */
+int minipng_decode_to_buffer(struct minipng_reader *rdr,unsigned char *dst,size_t stride);
+
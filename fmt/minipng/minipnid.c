@@ -35,10 +35,16 @@ int minipng_reader_read_idat(struct minipng_reader *rdr,unsigned char FAR *dst,s
     if (rdr == NULL) return -1;
     if (rdr->fd < 0) return -1;
 
-    if (rdr->compr == NULL) {
-        rdr->compr_size = 1024;
-        rdr->compr = malloc(rdr->compr_size);
-        if (rdr->compr == NULL) return -1;
+    if (!rdr->compr_init) {
+#if defined(LINUX)
+        /* mapped: zlib reads straight from the mapping, no buffer needed */
+        if (rdr->map == NULL)
+#endif
+        {
+            rdr->compr_size = (rdr->compr_size_req != 0) ? rdr->compr_size_req : MINIPNG_COMPR_SIZE_DEFAULT;
+            rdr->compr = malloc(rdr->compr_size);
+            if (rdr->compr == NULL) return -1;
+        }
 
         memset(&(rdr->compr_zlib),0,sizeof(rdr->compr_zlib));
         rdr->compr_zlib.next_in = rdr->compr;
@@ -49,10 +55,12 @@ int minipng_reader_read_idat(struct minipng_reader *rdr,unsigned char FAR *dst,s
 
         if (inflateInit2(&(rdr->compr_zlib),15/*max window size 32KB*/) != Z_OK) {
             memset(&(rdr->compr_zlib),0,sizeof(rdr->compr_zlib));
-            free(rdr->compr);
+            if (rdr->compr != NULL) free(rdr->compr);
             rdr->compr = NULL;
             return -1;
         }
+
+        rdr->compr_init = 1;
     }
 
     rdr->compr_zlib.next_out = dst;
@@ -69,29 +77,37 @@ int minipng_reader_read_idat(struct minipng_reader *rdr,unsigned char FAR *dst,s
                     rdr->ungetch++;
                     break;
                 }
+
+#if defined(LINUX)
+                /* the whole chunk in one go */
+                if (rdr->map != NULL) {
+                    if ((unsigned long)rdr->chunk_data_offset + (unsigned long)rdr->idat_rem > (unsigned long)rdr->map_size) break;
+                    rdr->compr_zlib.next_in = rdr->map + (size_t)rdr->chunk_data_offset;
+                    rdr->compr_zlib.avail_in = rdr->idat_rem;
+                    rdr->idat_rem = 0;
+                }
+#endif
             }
 
-            /* assume idat_rem != 0 */
-            {
+            /* assume idat_rem != 0, unless the chunk was taken from the mapping above */
+            if (rdr->compr_zlib.avail_in == 0) {
                 size_t icount = (rdr->idat_rem < rdr->compr_size) ? rdr->idat_rem : rdr->compr_size; /* lesser of the two */
+                int rd = read(rdr->fd,rdr->compr,icount);
 
-                read(rdr->fd,rdr->compr,icount);
-                rdr->idat_rem -= icount;
+                if (rd <= 0) break;
+                rdr->idat_rem -= (uint32_t)rd;
                 rdr->compr_zlib.next_in = rdr->compr;
-                rdr->compr_zlib.avail_in = icount;
+                rdr->compr_zlib.avail_in = (unsigned int)rd;
             }
         }
 
+        /* inflate() only fails to make progress when it is out of input, which the top of the loop takes care of.
+         * no need to call it again with Z_SYNC_FLUSH. */
         if ((err=inflate(&(rdr->compr_zlib),Z_NO_FLUSH)) != Z_OK) {
+            if (err == Z_BUF_ERROR && rdr->compr_zlib.avail_in == 0) continue;
             break;
         }
-        if (rdr->compr_zlib.avail_out == count) {
-            if ((err=inflate(&(rdr->compr_zlib),Z_SYNC_FLUSH)) != Z_OK) {
-                break;
-            }
-        }
     }
 
     return (count - rdr->compr_zlib.avail_out);
 }
-
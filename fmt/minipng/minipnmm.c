@@ -0,0 +1,79 @@
+
+#include <stdio.h>
+#if defined(TARGET_MSDOS)
+#include <conio.h> /* this is where Open Watcom hides the outp() etc. functions */
+#include <ctype.h>
+#endif
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <math.h>
+#if defined(TARGET_MSDOS)
+#include <dos.h>
+#endif
+
+#if defined(TARGET_MSDOS)
+#include <hw/cpu/cpu.h>
+#include <hw/dos/dos.h>
+#include <hw/vga/vga.h>
+#endif
+
+#if defined(TARGET_MSDOS)
+#include <ext/zlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#if defined(LINUX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <fmt/minipng/minipng.h>
+
+int minipng_reader_map(struct minipng_reader *rdr) {
+#if defined(LINUX)
+    struct stat st;
+    void *p;
+
+    if (rdr == NULL) return -1;
+    if (rdr->fd < 0) return -1;
+    if (rdr->map != NULL) return 0;
+
+    /* the IDAT read path picks the mapping up the next time it starts */
+    if (rdr->compr_init) return -1;
+
+    if (fstat(rdr->fd,&st) < 0 || st.st_size <= 0) return -1;
+    if ((unsigned long)st.st_size > (unsigned long)((size_t)(~0UL))) return -1;
+
+    p = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,rdr->fd,0);
+    if (p == MAP_FAILED) return -1;
+
+    /* zlib will go through it front to back */
+    madvise(p,(size_t)st.st_size,MADV_SEQUENTIAL);
+
+    rdr->map = (unsigned char*)p;
+    rdr->map_size = (size_t)st.st_size;
+    return 0;
+#else
+    (void)rdr;
+    return -1;
+#endif
+}
+
+void minipng_reader_unmap(struct minipng_reader *rdr) {
+    if (rdr == NULL) return;
+
+#if defined(LINUX)
+    if (rdr->map != NULL) {
+        /* zlib may still point into it */
+        minipng_reader_reset_idat(rdr);
+
+        munmap(rdr->map,rdr->map_size);
+        rdr->map = NULL;
+        rdr->map_size = 0;
+    }
+#endif
+}
@@ -0,0 +1,212 @@
+
+#include <stdio.h>
+#if defined(TARGET_MSDOS)
+#include <conio.h> /* this is where Open Watcom hides the outp() etc. functions */
+#include <ctype.h>
+#endif
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <math.h>
+#if defined(TARGET_MSDOS)
+#include <dos.h>
+#endif
+
+#if defined(TARGET_MSDOS)
+#include <hw/cpu/cpu.h>
+#include <hw/dos/dos.h>
+#include <hw/vga/vga.h>
+#endif
+
+#if defined(TARGET_MSDOS)
+#include <ext/zlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#include <fmt/minipng/minipng.h>
+
+/* Adam7 passes [https://www.w3.org/TR/PNG/#8Interlace]: x0, y0, dx, dy */
+static const uint8_t minipng_adam7[7][4] = {
+    { 0, 0, 8, 8 },
+    { 4, 0, 8, 8 },
+    { 0, 4, 4, 8 },
+    { 2, 0, 4, 4 },
+    { 0, 2, 2, 4 },
+    { 1, 0, 2, 2 },
+    { 0, 1, 1, 2 }
+};
+
+unsigned int minipng_bits_per_pixel(const struct minipng_IHDR *ihdr) {
+    unsigned int channels;
+
+    switch (ihdr->color_type) {
+        case 0: channels = 1; break; /* gray */
+        case 2: channels = 3; break; /* RGB */
+        case 3: channels = 1; break; /* indexed */
+        case 4: channels = 2; break; /* gray + alpha */
+        case 6: channels = 4; break; /* RGBA */
+        default: return 0;
+    }
+
+    return channels * (unsigned int)ihdr->bit_depth;
+}
+
+static size_t minipng_row_bytes(const uint32_t width,const unsigned int bits_per_pixel) {
+    return (size_t)((((unsigned long)width * (unsigned long)bits_per_pixel) + 7ul) / 8ul);
+}
+
+/* set up the current pass. returns 0 if it has rows, 1 if it is empty and should be skipped */
+static int minipng_reader_row_pass(struct minipng_reader *rdr,const unsigned int bits_per_pixel) {
+    if (rdr->row_pass == 0) {
+        rdr->row_pass_width = rdr->ihdr.width;
+        rdr->row_pass_height = rdr->ihdr.height;
+    }
+    else {
+        const uint8_t *a = minipng_adam7[rdr->row_pass - 1];
+
+        rdr->row_pass_width = (rdr->ihdr.width > a[0]) ? ((rdr->ihdr.width - a[0] + a[2] - 1u) / a[2]) : 0;
+        rdr->row_pass_height = (rdr->ihdr.height > a[1]) ? ((rdr->ihdr.height - a[1] + a[3] - 1u) / a[3]) : 0;
+    }
+
+    /* a pass with no columns has no rows either, not even the filter byte */
+    if (rdr->row_pass_width == 0) rdr->row_pass_height = 0;
+
+    rdr->row_y = 0;
+    rdr->row_bytes = minipng_row_bytes(rdr->row_pass_width,bits_per_pixel);
+
+    /* each pass starts fresh, there is no previous row */
+    return (rdr->row_pass_height == 0) ? 1 : 0;
+}
+
+void minipng_reader_free_rows(struct minipng_reader *rdr) {
+    if (rdr == NULL) return;
+
+    if (rdr->row_buf != NULL) {
+        free(rdr->row_buf);
+        rdr->row_buf = NULL;
+    }
+
+    rdr->row_buf_size = 0;
+    rdr->row_bytes = 0;
+}
+
+uint32_t minipng_reader_row_count(const struct minipng_reader *rdr) {
+    uint32_t rows = 0,w,h;
+    unsigned int p;
+
+    if (rdr == NULL) return 0;
+    if (rdr->ihdr.interlace_method != 1) return rdr->ihdr.height;
+
+    for (p=0;p < 7;p++) {
+        const uint8_t *a = minipng_adam7[p];
+
+        /* same as minipng_reader_row_pass(): a pass with no columns has no rows */
+        w = (rdr->ihdr.width > a[0]) ? ((rdr->ihdr.width - a[0] + a[2] - 1u) / a[2]) : 0;
+        h = (rdr->ihdr.height > a[1]) ? ((rdr->ihdr.height - a[1] + a[3] - 1u) / a[3]) : 0;
+        if (w != 0) rows += h;
+    }
+
+    return rows;
+}
+
+unsigned char *minipng_reader_read_row(struct minipng_reader *rdr,struct minipng_row_info *info) {
+    unsigned int bits_per_pixel;
+    unsigned char *cur,*prev;
+
+    if (rdr == NULL) return NULL;
+    if (rdr->fd < 0) return NULL;
+
+    bits_per_pixel = minipng_bits_per_pixel(&rdr->ihdr);
+    if (bits_per_pixel == 0 || rdr->ihdr.filter_method != 0 || rdr->ihdr.interlace_method > 1) return NULL;
+
+    if (rdr->row_buf == NULL) {
+        rdr->row_buf_size = minipng_row_bytes(rdr->ihdr.width,bits_per_pixel) + 1u/*filter byte*/;
+        rdr->row_buf = malloc(rdr->row_buf_size * 2u);
+        if (rdr->row_buf == NULL) return NULL;
+
+        rdr->row_bpp = (unsigned char)((bits_per_pixel + 7u) / 8u);
+        rdr->row_pass = (rdr->ihdr.interlace_method == 1) ? 1 : 0;
+        rdr->row_cur = 0;
+
+        while (minipng_reader_row_pass(rdr,bits_per_pixel)) {
+            if (rdr->row_pass == 0 || rdr->row_pass >= 7) return NULL;
+            rdr->row_pass++;
+        }
+    }
+
+    while (rdr->row_y >= rdr->row_pass_height) {
+        if (rdr->row_pass == 0 || rdr->row_pass >= 7) return NULL; /* end of image */
+        rdr->row_pass++;
+        minipng_reader_row_pass(rdr,bits_per_pixel);
+    }
+
+    rdr->row_cur ^= 1u;
+    cur = rdr->row_buf + (rdr->row_cur ? rdr->row_buf_size : 0);
+    prev = rdr->row_buf + (rdr->row_cur ? 0 : rdr->row_buf_size);
+
+    if ((size_t)minipng_reader_read_idat(rdr,cur,rdr->row_bytes + 1u) != (rdr->row_bytes + 1u))
+        return NULL;
+    if (minipng_unfilter_row(cur + 1,rdr->row_y != 0 ? prev + 1 : NULL,rdr->row_bytes,rdr->row_bpp,cur[0]) < 0)
+        return NULL;
+
+    if (info != NULL) {
+        info->pass = rdr->row_pass;
+        info->filter = cur[0];
+        info->width = rdr->row_pass_width;
+
+        if (rdr->row_pass == 0) {
+            info->y = rdr->row_y;
+            info->x0 = 0;
+            info->dx = 1;
+            info->dy = 1;
+        }
+        else {
+            const uint8_t *a = minipng_adam7[rdr->row_pass - 1];
+
+            info->y = a[1] + (rdr->row_y * a[3]);
+            info->x0 = a[0];
+            info->dx = a[2];
+            info->dy = a[3];
+        }
+    }
+
+    rdr->row_y++;
+    return cur + 1;
+}
+
+/* scatter the pixels of a pass row into a full image row (dst). pixels not in this pass are left alone. */
+void minipng_deinterlace_row(unsigned char *dst,const unsigned char *row,const struct minipng_row_info *info,unsigned int bits_per_pixel) {
+    uint32_t i,x;
+
+    if (info->dx == 1) {
+        memcpy(dst,row,minipng_row_bytes(info->width,bits_per_pixel));
+    }
+    else if (bits_per_pixel >= 8u) {
+        const unsigned int bpp = bits_per_pixel / 8u;
+        unsigned char *d = dst + ((size_t)info->x0 * bpp);
+        const size_t step = (size_t)info->dx * bpp;
+
+        if (bpp == 1) {
+            for (i=0;i < info->width;i++,d += step) *d = row[i];
+        }
+        else {
+            for (i=0;i < info->width;i++,d += step,row += bpp) memcpy(d,row,bpp);
+        }
+    }
+    else {
+        /* 1, 2 or 4 bits per pixel, packed MSB first */
+        const unsigned int ppb = 8u / bits_per_pixel;
+        const unsigned int mask = (1u << bits_per_pixel) - 1u;
+        unsigned int v,sh;
+
+        for (i=0,x=info->x0;i < info->width;i++,x += info->dx) {
+            v = (row[i / ppb] >> ((ppb - 1u - (i % ppb)) * bits_per_pixel)) & mask;
+            sh = (ppb - 1u - (x % ppb)) * bits_per_pixel;
+            dst[x / ppb] = (unsigned char)((dst[x / ppb] & ~(mask << sh)) | (v << sh));
+        }
+    }
+}
+
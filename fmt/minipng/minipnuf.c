@@ -0,0 +1,145 @@
+
+#include <stdio.h>
+#if defined(TARGET_MSDOS)
+#include <conio.h> /* this is where Open Watcom hides the outp() etc. functions */
+#include <ctype.h>
+#endif
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <math.h>
+#if defined(TARGET_MSDOS)
+#include <dos.h>
+#endif
+
+#if defined(TARGET_MSDOS)
+#include <hw/cpu/cpu.h>
+#include <hw/dos/dos.h>
+#include <hw/vga/vga.h>
+#endif
+
+#if defined(TARGET_MSDOS)
+#include <ext/zlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#include <fmt/minipng/minipng.h>
+
+/* Paeth predictor [https://www.w3.org/TR/PNG/#9Filter-type-4-Paeth].
+ * p = a + b - c, so |p-a| = |b-c|, |p-b| = |a-c| and |p-c| = |(b-c) + (a-c)|. No need to form p. */
+static inline unsigned char minipng_paeth(const int a,const int b,const int c) {
+    int pa = b - c;
+    int pb = a - c;
+    int pc = pa + pb;
+
+    if (pa < 0) pa = -pa;
+    if (pb < 0) pb = -pb;
+    if (pc < 0) pc = -pc;
+
+    if (pa <= pb && pa <= pc) return (unsigned char)a;
+    if (pb <= pc) return (unsigned char)b;
+    return (unsigned char)c;
+}
+
+static void minipng_unfilter_sub(unsigned char *row,size_t bytes,const unsigned int bpp) {
+    size_t i;
+
+    if (bpp == 1) {
+        unsigned char a = row[0];
+
+        for (i=1;i < bytes;i++) row[i] = a = (unsigned char)(row[i] + a);
+    }
+    else {
+        for (i=bpp;i < bytes;i++) row[i] = (unsigned char)(row[i] + row[i-bpp]);
+    }
+}
+
+static void minipng_unfilter_up(unsigned char *row,const unsigned char *prev,size_t bytes) {
+    size_t i;
+
+    for (i=0;i < bytes;i++) row[i] = (unsigned char)(row[i] + prev[i]);
+}
+
+static void minipng_unfilter_average(unsigned char *row,const unsigned char *prev,size_t bytes,const unsigned int bpp) {
+    size_t i;
+
+    if (prev == NULL) {
+        /* first row: b == 0 */
+        if (bpp == 1) {
+            unsigned char a = row[0];
+
+            for (i=1;i < bytes;i++) row[i] = a = (unsigned char)(row[i] + (a >> 1u));
+        }
+        else {
+            for (i=bpp;i < bytes;i++) row[i] = (unsigned char)(row[i] + (row[i-bpp] >> 1u));
+        }
+    }
+    else {
+        for (i=0;i < bpp && i < bytes;i++) row[i] = (unsigned char)(row[i] + (prev[i] >> 1u));
+
+        /* keep the left neighbor in a register for the common 8-bit paletted/gray case */
+        if (bpp == 1) {
+            unsigned int a = row[0];
+
+            for (i=1;i < bytes;i++) row[i] = (unsigned char)(a = (unsigned char)(row[i] + ((a + prev[i]) >> 1u)));
+        }
+        else {
+            for (i=bpp;i < bytes;i++) row[i] = (unsigned char)(row[i] + (((unsigned int)row[i-bpp] + prev[i]) >> 1u));
+        }
+    }
+}
+
+static void minipng_unfilter_paeth(unsigned char *row,const unsigned char *prev,size_t bytes,const unsigned int bpp) {
+    size_t i;
+
+    if (prev == NULL) {
+        /* first row: b == c == 0, the predictor is always a, same as Sub */
+        minipng_unfilter_sub(row,bytes,bpp);
+        return;
+    }
+
+    /* first pixel: a == c == 0, the predictor is always b, same as Up */
+    for (i=0;i < bpp && i < bytes;i++) row[i] = (unsigned char)(row[i] + prev[i]);
+
+    if (bpp == 1) {
+        int a = row[0],c = prev[0],b;
+
+        for (i=1;i < bytes;i++) {
+            b = prev[i];
+            row[i] = (unsigned char)(a = (unsigned char)(row[i] + minipng_paeth(a,b,c)));
+            c = b;
+        }
+    }
+    else {
+        for (i=bpp;i < bytes;i++) row[i] = (unsigned char)(row[i] + minipng_paeth(row[i-bpp],prev[i],prev[i-bpp]));
+    }
+}
+
+int minipng_unfilter_row(unsigned char *row,const unsigned char *prev,size_t bytes,unsigned int bpp,unsigned char filter) {
+    if (bpp == 0) bpp = 1;
+
+    switch (filter) {
+        case MINIPNG_FILTER_NONE:
+            break;
+        case MINIPNG_FILTER_SUB:
+            minipng_unfilter_sub(row,bytes,bpp);
+            break;
+        case MINIPNG_FILTER_UP:
+            if (prev != NULL) minipng_unfilter_up(row,prev,bytes); /* first row: same as none */
+            break;
+        case MINIPNG_FILTER_AVERAGE:
+            minipng_unfilter_average(row,prev,bytes,bpp);
+            break;
+        case MINIPNG_FILTER_PAETH:
+            minipng_unfilter_paeth(row,prev,bytes,bpp);
+            break;
+        default:
+            return -1;
+    }
+
+    return 0;
+}
+
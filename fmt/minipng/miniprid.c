@@ -37,9 +37,15 @@ void minipng_reader_reset_idat(struct minipng_reader *rdr) {
         rdr->compr = NULL;
     }
 
-    if (rdr->compr_zlib.next_in != NULL) {
+    if (rdr->compr_init) {
         inflateEnd(&(rdr->compr_zlib));
         memset(&(rdr->compr_zlib),0,sizeof(rdr->compr_zlib));
+        rdr->compr_init = 0;
     }
+
+    rdr->idat_rem = 0;
+
+    /* the row decoder starts over too */
+    minipng_reader_free_rows(rdr);
 }
 
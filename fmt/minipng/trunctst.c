@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <zlib.h>
+
+#include <fmt/minipng/minipng.h>
+
+/* truncated image test (Linux host).
+ * writes a 16x16 8-bit gray PNG, interlaced and not, once whole and once with the IDAT data cut short,
+ * and checks that minipng_decode_to_buffer() and the row decoder get the whole one right and fail on
+ * the cut ones instead of returning a partly decoded image. An Adam7 image has more rows in its 7 passes
+ * than the image has (30 for 16x16), so a cut in the later passes still leaves "height" rows read. */
+
+#define TW                              16u
+#define TH                              16u
+
+/* Adam7 passes: x0, y0, dx, dy */
+static const unsigned char adam7[7][4] = {
+    { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+};
+
+static unsigned char pixel(unsigned int x,unsigned int y) {
+    return (unsigned char)((x * 17u) ^ (y * 29u) ^ 0x5Au);
+}
+
+static void put32(unsigned char *p,uint32_t v) {
+    p[0] = (unsigned char)(v >> 24u);
+    p[1] = (unsigned char)(v >> 16u);
+    p[2] = (unsigned char)(v >>  8u);
+    p[3] = (unsigned char)v;
+}
+
+static int write_chunk(int fd,const char *type,const unsigned char *data,uint32_t len) {
+    unsigned char hdr[8],crc[4];
+    uLong c;
+
+    put32(hdr,len);
+    memcpy(hdr+4,type,4);
+    c = crc32(crc32(0L,Z_NULL,0),hdr+4,4);
+    if (len != 0) c = crc32(c,data,(uInt)len);
+    put32(crc,(uint32_t)c);
+
+    if (write(fd,hdr,8) != 8) return -1;
+    if (len != 0 && write(fd,data,len) != (ssize_t)len) return -1;
+    if (write(fd,crc,4) != 4) return -1;
+    return 0;
+}
+
+/* the filtered (filter type 0) image data, in file order. returns its length */
+static size_t raw_image(unsigned char *raw,int interlace) {
+    unsigned int p,x,y;
+    size_t o = 0;
+
+    if (!interlace) {
+        for (y=0;y < TH;y++) {
+            raw[o++] = 0;
+            for (x=0;x < TW;x++) raw[o++] = pixel(x,y);
+        }
+        return o;
+    }
+
+    for (p=0;p < 7;p++) {
+        for (y=adam7[p][1];y < TH;y += adam7[p][3]) {
+            raw[o++] = 0;
+            for (x=adam7[p][0];x < TW;x += adam7[p][2]) raw[o++] = pixel(x,y);
+        }
+    }
+
+    return o;
+}
+
+/* write the PNG with only the first keep bytes of the image data (0 = all of it) */
+static int write_png(const char *path,int interlace,size_t keep) {
+    static const unsigned char sig[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    unsigned char raw[1024],z[2048],ihdr[13];
+    uLongf zlen = sizeof(z);
+    size_t len;
+    int fd,r;
+
+    len = raw_image(raw,interlace);
+    if (keep != 0 && keep < len) len = keep;
+    if (compress2(z,&zlen,raw,(uLong)len,9) != Z_OK) return -1;
+
+    put32(ihdr+0,TW);
+    put32(ihdr+4,TH);
+    ihdr[8] = 8;  /* bit depth */
+    ihdr[9] = 0;  /* gray */
+    ihdr[10] = 0; /* deflate */
+    ihdr[11] = 0; /* filter method */
+    ihdr[12] = interlace ? 1 : 0;
+
+    if ((fd=open(path,O_WRONLY|O_CREAT|O_TRUNC,0644)) < 0) return -1;
+    r = 0;
+    if (write(fd,sig,8) != 8) r = -1;
+    if (r == 0) r = write_chunk(fd,"IHDR",ihdr,13);
+    if (r == 0) r = write_chunk(fd,"IDAT",z,(uint32_t)zlen);
+    if (r == 0) r = write_chunk(fd,"IEND",NULL,0);
+    close(fd);
+    return r;
+}
+
+static int image_ok(const unsigned char *image) {
+    unsigned int x,y;
+
+    for (y=0;y < TH;y++) {
+        for (x=0;x < TW;x++) {
+            if (image[(y*TW)+x] != pixel(x,y)) return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* decode path with both decoders. returns 0 if the whole image decoded correctly, -1 if the decoders said it failed,
+ * and -2 if a decoder claimed success with the wrong pixels */
+static int decode(const char *path,int oneshot) {
+    struct minipng_row_info info;
+    struct minipng_reader *rdr;
+    unsigned char image[TW*TH];
+    unsigned long rows = 0;
+    unsigned char *row;
+    int r;
+
+    if ((rdr=minipng_reader_open(path)) == NULL) return -1;
+    if (minipng_reader_parse_head(rdr)) {
+        minipng_reader_close(&rdr);
+        return -1;
+    }
+
+    memset(image,0,sizeof(image));
+    if (oneshot) {
+        r = minipng_decode_to_buffer(rdr,image,TW);
+    }
+    else {
+        while ((row=minipng_reader_read_row(rdr,&info)) != NULL) {
+            minipng_deinterlace_row(image + ((size_t)info.y * TW),row,&info,8);
+            rows++;
+        }
+        r = (rows == (unsigned long)minipng_reader_row_count(rdr)) ? 0 : -1;
+    }
+
+    minipng_reader_close(&rdr);
+    if (r != 0) return -1;
+    return image_ok(image) ? 0 : -2;
+}
+
+int main(void) {
+    static const size_t cuts[] = { 0, 150, 285, 30, 1 }; /* 0 = not cut */
+    char path[] = "/tmp/pngtruncXXXXXX";
+    unsigned int il,ci,os;
+    int fd,fail = 0,r,expect;
+
+    if ((fd=mkstemp(path)) < 0) {
+        fprintf(stderr,"Cannot create test file\n");
+        return 1;
+    }
+    close(fd);
+
+    for (il=0;il < 2;il++) {
+        for (ci=0;ci < (sizeof(cuts)/sizeof(cuts[0]));ci++) {
+            /* 272 bytes of image data not interlaced, 286 interlaced */
+            if (!il && cuts[ci] >= 272) continue;
+
+            if (write_png(path,il,cuts[ci]) < 0) {
+                fprintf(stderr,"Cannot write test file\n");
+                fail = 1;
+                break;
+            }
+
+            expect = (cuts[ci] == 0) ? 0 : -1;
+            for (os=0;os < 2;os++) {
+                r = decode(path,os);
+                printf("%s, %s, image data cut to %lu bytes: %s\n",il ? "interlaced" : "not interlaced",os ? "decode_to_buffer" : "rows",
+                    (unsigned long)cuts[ci],r == 0 ? "decoded" : (r == -1 ? "failed" : "WRONG PIXELS"));
+                if (r != expect) {
+                    printf("FAIL: expected %s\n",expect == 0 ? "the image" : "an error");
+                    fail = 1;
+                }
+            }
+        }
+    }
+
+    unlink(path);
+    return fail;
+}
@@ -112,7 +112,8 @@ enum {
 #define OMF_RECTYPE_LPUBDEF     (0xB6)
 #define OMF_RECTYPE_LPUBDEF32   (0xB7)
 
-extern char                             omf_temp_str[255+1/*NUL*/];
+#define OMF_RECTYPE_LIBHEAD     (0xF0)
+#define OMF_RECTYPE_LIBEND      (0xF1)
 
 struct omf_record_t {
     unsigned char           rectype;
@@ -120,6 +121,7 @@ struct omf_record_t {
     unsigned short          recpos;             // read/write position
     unsigned char*          data;               // data if != NULL. checksum is at data[reclen]
     size_t                  data_alloc;         // amount of data allocated if data != NULL or amount TO alloc if data == NULL
+    unsigned char           data_extern;        // data points into the caller's buffer (omf_context_read_mem), is not ours to free or modify
 
     unsigned long           rec_file_offset;    // file offset of record (~0UL if undefined)
 };
@@ -265,6 +267,27 @@ struct omf_lnames_context_t {
     unsigned int        omf_LNAMES_alloc;
 };
 
+// .LIB dictionary.
+//
+// The LIBHEAD record gives the file offset and number of 512-byte dictionary blocks
+// that follow LIBEND. Each block has 37 buckets (byte offset / 2 of an entry within
+// the block), a "next free" byte (offset / 2, 0xFF if the block is full), and entries
+// made of a length-prefixed public name followed by the 16-bit page number of the
+// module that defines it. The page number times the library block size is the file
+// offset of the module.
+#define OMF_LIBDICT_BLOCK_SIZE              (512)
+#define OMF_LIBDICT_BUCKETS                 (37)
+
+#define OMF_LIBHEAD_FLAG_CASE_SENSITIVE     (0x01)
+
+struct omf_libdict_t {
+    unsigned char*                      blocks;             // dictionary blocks if != NULL (block_count * 512 bytes)
+    unsigned long                       offset;             // file offset of dictionary
+    unsigned short                      block_count;        // number of dictionary blocks
+    unsigned short                      library_block_size; // module alignment from LIBHEAD (length of LIBHEAD record)
+    unsigned char                       flags;              // LIBHEAD flags
+};
+
 struct omf_context_t {
     const char*                         last_error;
     struct omf_lnames_context_t         LNAMEs;
@@ -280,6 +303,7 @@ struct omf_context_t {
     unsigned long                       last_LEDATA_eno;
     unsigned char                       last_LEDATA_hdr;
     char*                               THEADR;
+    char                                temp_str[255+1/*NUL*/];// names, while parsing records
     struct {
         unsigned int                    verbose:1;
     } flags;
@@ -401,6 +425,34 @@ static inline unsigned int omf_lnames_context_get_next_add_index(const struct om
 
 int omf_context_read_fd(struct omf_context_t * const ctx,int fd);
 int omf_context_next_lib_module_fd(struct omf_context_t * const ctx,int fd);
+int omf_context_read_mem(struct omf_context_t * const ctx,const unsigned char *buf,const unsigned long length,unsigned long * const offset);
+int omf_context_next_lib_module_mem(struct omf_context_t * const ctx,unsigned long * const offset);
+
+// whole file in memory, for omf_context_read_mem(). memory mapped where possible.
+struct omf_mem_image_t {
+    const unsigned char*                data;
+    unsigned long                       length;
+    unsigned char*                      buffer;             // if read into memory
+#if defined(LINUX)
+    void*                               mapped;             // if memory mapped
+#endif
+};
+
+void omf_mem_image_init(struct omf_mem_image_t * const m);
+int omf_mem_image_load(struct omf_mem_image_t * const m,const char *path);
+void omf_mem_image_free(struct omf_mem_image_t * const m);
+
+void omf_libdict_init(struct omf_libdict_t * const d);
+void omf_libdict_free(struct omf_libdict_t * const d);
+int omf_libdict_parse_LIBHEAD(struct omf_libdict_t * const d,const unsigned char *rec,const size_t len);
+int omf_libdict_read_fd(struct omf_libdict_t * const d,int fd);
+int omf_libdict_read_mem(struct omf_libdict_t * const d,const unsigned char *data,const size_t length);
+long omf_libdict_lookup(const struct omf_libdict_t * const d,const char *name,const size_t namelen);
+
+// file offset of the module at page number (as returned by omf_libdict_lookup)
+static inline unsigned long omf_libdict_page_to_offset(const struct omf_libdict_t * const d,const unsigned short page) {
+    return (unsigned long)page * (unsigned long)d->library_block_size;
+}
 
 const char *omf_context_get_grpdef_name(const struct omf_context_t * const ctx,unsigned int i);
 const char *omf_context_get_grpdef_name_safe(const struct omf_context_t * const ctx,unsigned int i);
@@ -425,6 +477,7 @@ unsigned int omf_record_get_index(struct omf_record_t * const rec);
 int omf_record_read_data(unsigned char *dst,unsigned int len,struct omf_record_t *rec);
 int omf_record_get_lenstr(char *dst,const size_t dstmax,struct omf_record_t *rec);
 void omf_record_free(struct omf_record_t * const rec);
+int omf_record_verify_checksum(const struct omf_record_t * const rec);
 const char *omf_rectype_to_str_long(unsigned char rt);
 const char *omf_rectype_to_str(unsigned char rt);
 
@@ -20,8 +20,8 @@ int omf_context_next_lib_module_fd(struct omf_context_t * const ctx,int fd) {
     if (ctx->library_block_size == 0UL)
         return 0;
 
-    // where does the next block size start?
-    ofs = ctx->record.rec_file_offset + 3 + ctx->record.reclen;
+    // where does the next block size start? (reclen does not count the checksum byte)
+    ofs = ctx->record.rec_file_offset + 3 + ctx->record.reclen + 1;
     ofs += ctx->library_block_size - 1UL;
     ofs -= ofs % ctx->library_block_size;
     if (lseek(fd,(off_t)ofs,SEEK_SET) != (off_t)ofs)
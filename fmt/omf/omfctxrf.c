@@ -19,7 +19,7 @@ int omf_context_read_fd(struct omf_context_t * const ctx,int fd) {
 
     ctx->last_error = NULL;
     omf_record_clear(&ctx->record);
-    if (ctx->record.data == NULL && omf_record_data_alloc(&ctx->record,0) < 0)
+    if ((ctx->record.data == NULL || ctx->record.data_extern) && omf_record_data_alloc(&ctx->record,0) < 0)
         return -1; // sets errno
     if (ctx->record.data_alloc < 16) {
         ctx->last_error = "Record buffer too small";
@@ -0,0 +1,97 @@
+
+#include <fmt/omf/omf.h>
+#include <fmt/omf/omfcstr.h>
+
+// read the next record from a file held entirely in memory (buf, length), at file offset *offset.
+// nothing is copied: ctx->record.data points into buf, which must stay valid while the record is used.
+// the checksum is not verified, call omf_record_verify_checksum() if that matters.
+// on success *offset is advanced to the next record. returns as omf_context_read_fd().
+int omf_context_read_mem(struct omf_context_t * const ctx,const unsigned char *buf,const unsigned long length,unsigned long * const offset) {
+    unsigned long ofs = *offset;
+    unsigned int reclen;
+
+    // if the last record was a LIBEND, then stop reading.
+    // non-OMF junk usually follows.
+    if (ctx->record.rectype == 0xF1)
+        return 0;
+
+    // if the last record was a MODEND, then stop reading, make caller move to next module with another function
+    if ((ctx->record.rectype&0xFE) == 0x8A) // 0x8A or 0x8B
+        return 0;
+
+    ctx->last_error = NULL;
+    omf_record_clear(&ctx->record);
+
+    // give up our own buffer, if any. the record will point into buf.
+    if (ctx->record.data != NULL && !ctx->record.data_extern)
+        omf_record_data_free(&ctx->record);
+
+    ctx->record.rec_file_offset = ofs;
+
+    if (ofs > length || (length - ofs) < 3UL)
+        return 0; // EOF
+
+    reclen = le16toh(*((uint16_t*)(buf+ofs+1))); // length (including checksum)
+    if (buf[ofs] == 0 || reclen == 0)
+        return 0;
+    if ((unsigned long)reclen > (length - ofs - 3UL)) {
+        ctx->last_error = "Reading OMF record contents failed";
+        errno = EIO;
+        return -1;
+    }
+
+    ctx->record.rectype = buf[ofs];
+    ctx->record.reclen = reclen;
+    ctx->record.data = (unsigned char*)(buf+ofs+3);
+    ctx->record.data_extern = 1;
+    ctx->record.data_alloc = 0; // nothing can be written to it
+
+    /* remember LIBHEAD block size */
+    if (ctx->record.rectype == 0xF0/*LIBHEAD*/) {
+        if (ctx->library_block_size == 0) {
+            // and the length of the record defines the block size that modules within are aligned by
+            ctx->library_block_size = ctx->record.reclen + 3;
+        }
+        else {
+            ctx->last_error = "LIBHEAD defined again";
+            errno = EIO;
+            return -1;
+        }
+    }
+
+    ctx->record.reclen--; // omit checksum from reclen
+    *offset = ofs + 3UL + (unsigned long)reclen;
+    return 1;
+}
+
+// the in-memory counterpart to omf_context_next_lib_module_fd(). *offset is set to the next module.
+int omf_context_next_lib_module_mem(struct omf_context_t * const ctx,unsigned long * const offset) {
+    unsigned long ofs;
+
+    // if the last record was a LIBEND, then stop reading.
+    // non-OMF junk usually follows.
+    if (ctx->record.rectype == 0xF1)
+        return 0;
+
+    // if the last record was not a MODEND, then stop reading.
+    if ((ctx->record.rectype&0xFE) != 0x8A) { // Not 0x8A or 0x8B
+        errno = EIO;
+        return -1;
+    }
+
+    // if we don't have a block size, then we cannot advance
+    if (ctx->library_block_size == 0UL)
+        return 0;
+
+    // where does the next block size start? (reclen does not count the checksum byte)
+    ofs = ctx->record.rec_file_offset + 3 + ctx->record.reclen + 1;
+    ofs += ctx->library_block_size - 1UL;
+    ofs -= ofs % ctx->library_block_size;
+    *offset = ofs;
+
+    ctx->record.rec_file_offset = ofs;
+    ctx->record.rectype = 0;
+    ctx->record.reclen = 0;
+    return 1;
+}
+
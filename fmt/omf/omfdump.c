@@ -24,6 +24,32 @@ static char*                            in_file = NULL;
 
 struct omf_context_t*                   omf_state = NULL;
 
+static struct omf_mem_image_t           in_image;           // whole file, if it could be loaded into memory
+static unsigned long                    in_image_offset = 0;
+
+// read from memory if the file is there, else from the file
+static int read_record(int fd) {
+    int ret;
+
+    if (in_image.data == NULL)
+        return omf_context_read_fd(omf_state,fd);
+
+    ret = omf_context_read_mem(omf_state,in_image.data,in_image.length,&in_image_offset);
+    if (ret > 0 && omf_record_verify_checksum(&omf_state->record) < 0) {
+        omf_state->last_error = "Reading OMF record checksum failed";
+        return -1;
+    }
+
+    return ret;
+}
+
+static int next_lib_module(int fd) {
+    if (in_image.data == NULL)
+        return omf_context_next_lib_module_fd(omf_state,fd);
+
+    return omf_context_next_lib_module_mem(omf_state,&in_image_offset);
+}
+
 static void help(void) {
     fprintf(stderr,"omfdump [options]\n");
     fprintf(stderr,"  -i <file>    OMF file to dump\n");
@@ -162,10 +188,13 @@ int main(int argc,char **argv) {
         return 1;
     }
 
+    omf_mem_image_init(&in_image);
+    omf_mem_image_load(&in_image,in_file); /* if it fails, read the file instead */
+
     omf_context_begin_file(omf_state);
 
     do {
-        ret = omf_context_read_fd(omf_state,fd);
+        ret = read_record(fd);
         if (ret == 0) {
             if (omf_record_is_modend(&omf_state->record)) {
                 if (dumpstate && !diddump) {
@@ -175,7 +204,7 @@ int main(int argc,char **argv) {
 
                 printf("----- next module -----\n");
 
-                ret = omf_context_next_lib_module_fd(omf_state,fd);
+                ret = next_lib_module(fd);
                 if (ret < 0) {
                     printf("Unable to advance to next .LIB module, %s\n",strerror(errno));
                     if (omf_state->last_error != NULL) fprintf(stderr,"Details: %s\n",omf_state->last_error);
@@ -372,6 +401,7 @@ int main(int argc,char **argv) {
 
     omf_context_clear(omf_state);
     omf_state = omf_context_destroy(omf_state);
+    omf_mem_image_free(&in_image);
     close(fd);
     return 0;
 }
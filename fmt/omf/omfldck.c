@@ -0,0 +1,142 @@
+/* omfldck: check a .LIB dictionary against the modules in the library (Linux host).
+ *
+ * Walks every module of each .LIB named on the command line, and looks up every public symbol
+ * (PUBDEF, not LPUBDEF) through the dictionary with omf_libdict_lookup(). Every one of them must be
+ * found, and must lead to the module that defines it. Exits 1 if any symbol is missing or points
+ * elsewhere, which is how the dictionary hash is checked against libraries built by other tools. */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+
+#include <fmt/omf/omf.h>
+
+static int check_lib(const char *path,const int verbose) {
+    unsigned long ofs = 0,module_ofs = 0,modules = 0,publics = 0,bad = 0;
+    struct omf_context_t *ctx;
+    struct omf_mem_image_t img;
+    struct omf_libdict_t dict;
+    struct omf_pubdef_t *pd;
+    unsigned int first,i;
+    size_t len;
+    long page;
+    int ret;
+
+    omf_mem_image_init(&img);
+    omf_libdict_init(&dict);
+
+    if (omf_mem_image_load(&img,path) < 0) {
+        fprintf(stderr,"%s: cannot load, %s\n",path,strerror(errno));
+        return 1;
+    }
+    if (omf_libdict_read_mem(&dict,img.data,(size_t)img.length) <= 0) {
+        fprintf(stderr,"%s: not a .LIB with a dictionary\n",path);
+        omf_mem_image_free(&img);
+        return 1;
+    }
+    if ((ctx=omf_context_create()) == NULL) {
+        omf_libdict_free(&dict);
+        omf_mem_image_free(&img);
+        return 1;
+    }
+
+    omf_context_begin_file(ctx);
+
+    do {
+        ret = omf_context_read_mem(ctx,img.data,img.length,&ofs);
+        if (ret == 0) {
+            if (omf_record_is_modend(&ctx->record)) {
+                modules++;
+                if ((ret=omf_context_next_lib_module_mem(ctx,&ofs)) > 0) {
+                    omf_context_begin_module(ctx);
+                    continue;
+                }
+                else if (ret < 0) {
+                    fprintf(stderr,"%s: cannot advance to the next module\n",path);
+                    bad++;
+                }
+            }
+
+            break;
+        }
+        else if (ret < 0) {
+            fprintf(stderr,"%s: %s\n",path,ctx->last_error != NULL ? ctx->last_error : strerror(errno));
+            bad++;
+            break;
+        }
+
+        switch (ctx->record.rectype) {
+            case OMF_RECTYPE_THEADR:/*0x80*/
+                module_ofs = ctx->record.rec_file_offset;
+                break;
+            case OMF_RECTYPE_PUBDEF:/*0x90*/
+            case OMF_RECTYPE_PUBDEF32:/*0x91*/
+                if ((ret=omf_context_parse_PUBDEF(ctx,&ctx->record)) < 0) {
+                    fprintf(stderr,"%s: error parsing PUBDEF at %lu\n",path,ctx->record.rec_file_offset);
+                    bad++;
+                    break;
+                }
+
+                first = (unsigned int)ret;
+                for (i=first;i <= ctx->PUBDEFs.omf_PUBDEFS_count;i++) {
+                    pd = &ctx->PUBDEFs.omf_PUBDEFS[i-1];
+                    if (pd->name_string == NULL) continue;
+
+                    len = strlen(pd->name_string);
+                    page = omf_libdict_lookup(&dict,pd->name_string,len);
+                    publics++;
+
+                    if (page < 0L) {
+                        printf("%s: %s (module at %lu) is not in the dictionary\n",path,pd->name_string,module_ofs);
+                        bad++;
+                    }
+                    else if (omf_libdict_page_to_offset(&dict,(unsigned short)page) != module_ofs) {
+                        printf("%s: %s (module at %lu) leads to page %ld (offset %lu)\n",path,pd->name_string,module_ofs,
+                            page,omf_libdict_page_to_offset(&dict,(unsigned short)page));
+                        bad++;
+                    }
+                    else if (verbose) {
+                        printf("%s: %s -> page %ld\n",path,pd->name_string,page);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    } while (1);
+
+    printf("%s: %lu modules, %lu public symbols, %u dictionary blocks, block size %u: %s\n",path,
+        modules,publics,dict.block_count,dict.library_block_size,bad ? "FAILED" : "OK");
+
+    omf_context_destroy(ctx);
+    omf_libdict_free(&dict);
+    omf_mem_image_free(&img);
+    return (bad != 0UL || publics == 0UL) ? 1 : 0;
+}
+
+int main(int argc,char **argv) {
+    int i,verbose = 0,fail = 0,files = 0;
+
+    for (i=1;i < argc;i++) {
+        if (!strcmp(argv[i],"-v")) {
+            verbose = 1;
+            continue;
+        }
+
+        files++;
+        if (check_lib(argv[i],verbose)) fail = 1;
+    }
+
+    if (files == 0) {
+        fprintf(stderr,"omfldck [-v] <file.lib> ...\n");
+        return 1;
+    }
+
+    return fail;
+}
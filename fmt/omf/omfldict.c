@@ -0,0 +1,227 @@
+
+#include <fmt/omf/omf.h>
+
+#include <ctype.h>
+
+void omf_libdict_init(struct omf_libdict_t * const d) {
+    d->blocks = NULL;
+    d->offset = 0;
+    d->block_count = 0;
+    d->library_block_size = 0;
+    d->flags = 0;
+}
+
+void omf_libdict_free(struct omf_libdict_t * const d) {
+    if (d->blocks != NULL) {
+        free(d->blocks);
+        d->blocks = NULL;
+    }
+    d->block_count = 0;
+}
+
+// parse the LIBHEAD record at rec (starting with the record type byte).
+// returns 1 if LIBHEAD, 0 if not a LIBHEAD record (not a .LIB file), -1 if truncated.
+int omf_libdict_parse_LIBHEAD(struct omf_libdict_t * const d,const unsigned char *rec,const size_t len) {
+    unsigned int reclen;
+
+    if (len < 3 || rec[0] != OMF_RECTYPE_LIBHEAD)
+        return 0;
+
+    // record length (including checksum) + 3 is the block size that modules are aligned by.
+    // contents are dictionary offset (dword), dictionary block count (word), flags (byte).
+    reclen = le16toh(*((uint16_t*)(rec+1)));
+    if (reclen < (7+1) || len < (3+7)) {
+        errno = EIO;
+        return -1;
+    }
+
+    d->library_block_size = (unsigned short)(reclen + 3);
+    d->offset = le32toh(*((uint32_t*)(rec+3)));
+    d->block_count = le16toh(*((uint16_t*)(rec+7)));
+    d->flags = rec[9];
+    return 1;
+}
+
+static int omf_libdict_alloc(struct omf_libdict_t * const d) {
+    const unsigned long sz = (unsigned long)d->block_count * (unsigned long)OMF_LIBDICT_BLOCK_SIZE;
+
+    if (d->blocks != NULL) {
+        free(d->blocks);
+        d->blocks = NULL;
+    }
+
+    if (sz > (unsigned long)((size_t)(~0UL))) {
+        errno = ERANGE;
+        return -1;
+    }
+
+    d->blocks = malloc((size_t)sz);
+    if (d->blocks == NULL)
+        return -1;
+
+    return 0;
+}
+
+// read LIBHEAD and the dictionary from a .LIB file. the file pointer is left at an undefined position.
+// returns 1 if the dictionary was loaded, 0 if the file is not a .LIB or has no dictionary, -1 on error.
+int omf_libdict_read_fd(struct omf_libdict_t * const d,int fd) {
+    unsigned char tmp[3+7];
+    unsigned int i;
+    int ret;
+
+    omf_libdict_free(d);
+
+    if (lseek(fd,0,SEEK_SET) != 0)
+        return -1;
+    if ((ret=read(fd,tmp,sizeof(tmp))) < 0)
+        return -1;
+    if ((ret=omf_libdict_parse_LIBHEAD(d,tmp,(size_t)ret)) <= 0)
+        return ret;
+    if (d->offset == 0UL || d->block_count == 0)
+        return 0;
+
+    if (omf_libdict_alloc(d) < 0)
+        return -1;
+    if (lseek(fd,(off_t)d->offset,SEEK_SET) != (off_t)d->offset) {
+        omf_libdict_free(d);
+        errno = EIO;
+        return -1;
+    }
+
+    // one block at a time, so that 16-bit builds never ask read() for more than 64KB
+    for (i=0;i < d->block_count;i++) {
+        unsigned char *blk = d->blocks + ((size_t)i * (size_t)OMF_LIBDICT_BLOCK_SIZE);
+
+        if (read(fd,blk,OMF_LIBDICT_BLOCK_SIZE) != OMF_LIBDICT_BLOCK_SIZE) {
+            omf_libdict_free(d);
+            errno = EIO;
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+// same as omf_libdict_read_fd() for a .LIB file already in memory. the dictionary is copied.
+int omf_libdict_read_mem(struct omf_libdict_t * const d,const unsigned char *data,const size_t length) {
+    unsigned long sz;
+    int ret;
+
+    omf_libdict_free(d);
+
+    if ((ret=omf_libdict_parse_LIBHEAD(d,data,length)) <= 0)
+        return ret;
+    if (d->offset == 0UL || d->block_count == 0)
+        return 0;
+
+    sz = (unsigned long)d->block_count * (unsigned long)OMF_LIBDICT_BLOCK_SIZE;
+    if (d->offset > (unsigned long)length || sz > ((unsigned long)length - d->offset)) {
+        errno = EIO;
+        return -1;
+    }
+
+    if (omf_libdict_alloc(d) < 0)
+        return -1;
+
+    memcpy(d->blocks,data + (size_t)d->offset,(size_t)sz);
+    return 1;
+}
+
+static inline unsigned short omf_libdict_rol2(const unsigned short v) {
+    return (unsigned short)((v << 2u) | (v >> 14u));
+}
+
+static inline unsigned short omf_libdict_ror2(const unsigned short v) {
+    return (unsigned short)((v >> 2u) | (v << 14u));
+}
+
+// the dictionary hash, case insensitive. the name is hashed as a length-prefixed string,
+// walking from the front and from the back at the same time, to produce a starting block and bucket
+// and the amount to step by for each when probing.
+static void omf_libdict_hash(const unsigned char *name,const unsigned int namelen,const unsigned int block_count,
+    unsigned int *block_x,unsigned int *block_d,unsigned int *bucket_x,unsigned int *bucket_d) {
+    unsigned int front = 0,back = namelen,len = namelen;
+    unsigned short bx,bd,ux,ud;
+    unsigned char c;
+
+    bx = (unsigned short)(namelen | 0x20);
+    ud = bx;
+    bd = 0;
+    ux = 0;
+
+    do {
+        c = name[--back] | 0x20;
+        ux = omf_libdict_ror2(ux) ^ c;
+        bd = omf_libdict_rol2(bd) ^ c;
+        if (--len == 0) break;
+
+        c = name[front++] | 0x20;
+        bx = omf_libdict_rol2(bx) ^ c;
+        ud = omf_libdict_ror2(ud) ^ c;
+    } while (1);
+
+    *block_x = bx % block_count;
+    *block_d = bd % block_count;
+    if (*block_d == 0) *block_d = 1;
+    *bucket_x = ux % OMF_LIBDICT_BUCKETS;
+    *bucket_d = ud % OMF_LIBDICT_BUCKETS;
+    if (*bucket_d == 0) *bucket_d = 1;
+}
+
+static int omf_libdict_name_match(const unsigned char *a,const unsigned char *b,unsigned int len,const unsigned char case_sensitive) {
+    if (case_sensitive)
+        return memcmp(a,b,len) == 0;
+
+    while (len-- > 0) {
+        if (tolower(*a++) != tolower(*b++))
+            return 0;
+    }
+
+    return 1;
+}
+
+// look up a public symbol in the dictionary.
+// returns the page number of the module that defines it, or -1 if not listed.
+long omf_libdict_lookup(const struct omf_libdict_t * const d,const char *name,const size_t namelen) {
+    unsigned int block_x,block_d,bucket_x,bucket_d;
+    unsigned int btry,utry,bucket,eofs,elen;
+    const unsigned char *blk;
+
+    if (d->blocks == NULL || d->block_count == 0 || namelen == 0 || namelen > 255)
+        return -1L;
+
+    omf_libdict_hash((const unsigned char*)name,(unsigned int)namelen,d->block_count,&block_x,&block_d,&bucket_x,&bucket_d);
+
+    for (btry=0;btry < d->block_count;btry++) {
+        blk = d->blocks + ((size_t)block_x * (size_t)OMF_LIBDICT_BLOCK_SIZE);
+        bucket = bucket_x;
+
+        for (utry=0;utry < OMF_LIBDICT_BUCKETS;utry++) {
+            eofs = (unsigned int)blk[bucket] * 2u;
+            if (eofs == 0) {
+                // empty bucket. if the block is not full, the name is not in the dictionary.
+                // if it is full, the name would have been placed in another block.
+                if (blk[OMF_LIBDICT_BUCKETS] != 0xFF)
+                    return -1L;
+
+                break;
+            }
+
+            if (eofs < (OMF_LIBDICT_BLOCK_SIZE - 1)) {
+                elen = blk[eofs];
+                if (elen == (unsigned int)namelen && (eofs+1u+elen+2u) <= OMF_LIBDICT_BLOCK_SIZE &&
+                    omf_libdict_name_match(blk+eofs+1u,(const unsigned char*)name,elen,d->flags & OMF_LIBHEAD_FLAG_CASE_SENSITIVE))
+                    return (long)le16toh(*((uint16_t*)(blk+eofs+1u+elen)));
+            }
+
+            bucket += bucket_d;
+            if (bucket >= OMF_LIBDICT_BUCKETS) bucket -= OMF_LIBDICT_BUCKETS;
+        }
+
+        block_x += block_d;
+        if (block_x >= d->block_count) block_x -= d->block_count;
+    }
+
+    return -1L;
+}
+
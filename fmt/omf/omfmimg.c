@@ -0,0 +1,108 @@
+
+#include <fmt/omf/omf.h>
+
+#if defined(LINUX)
+# include <sys/mman.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY (0)
+#endif
+
+void omf_mem_image_init(struct omf_mem_image_t * const m) {
+    m->data = NULL;
+    m->length = 0;
+    m->buffer = NULL;
+#if defined(LINUX)
+    m->mapped = NULL;
+#endif
+}
+
+void omf_mem_image_free(struct omf_mem_image_t * const m) {
+#if defined(LINUX)
+    if (m->mapped != NULL) {
+        munmap(m->mapped,(size_t)m->length);
+        m->mapped = NULL;
+    }
+#endif
+    if (m->buffer != NULL) {
+        free(m->buffer);
+        m->buffer = NULL;
+    }
+
+    m->data = NULL;
+    m->length = 0;
+}
+
+// load the whole file into memory, memory mapped where possible.
+// returns 0 on success, -1 on failure (including a file too large to hold in memory,
+// as on 16-bit targets, in which case the caller should read with omf_context_read_fd()).
+int omf_mem_image_load(struct omf_mem_image_t * const m,const char *path) {
+    unsigned long done = 0;
+    struct stat st;
+    int fd,rd;
+
+    omf_mem_image_free(m);
+
+    fd = open(path,O_RDONLY|O_BINARY);
+    if (fd < 0)
+        return -1;
+
+    if (fstat(fd,&st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    if ((unsigned long)st.st_size > (unsigned long)((size_t)(~0UL) - 16UL)) {
+        close(fd);
+        errno = ERANGE;
+        return -1;
+    }
+
+    m->length = (unsigned long)st.st_size;
+    if (m->length == 0UL) {
+        close(fd);
+        m->data = (const unsigned char*)"";
+        return 0;
+    }
+
+#if defined(LINUX)
+    {
+        void *p = mmap(NULL,(size_t)m->length,PROT_READ,MAP_PRIVATE,fd,0);
+        if (p != MAP_FAILED) {
+            close(fd);
+            m->mapped = p;
+            m->data = (const unsigned char*)p;
+            return 0;
+        }
+    }
+#endif
+
+    m->buffer = malloc((size_t)m->length);
+    if (m->buffer == NULL) {
+        close(fd);
+        m->length = 0;
+        return -1;
+    }
+
+    // in pieces, so that 16-bit builds never ask read() for more than they can
+    while (done < m->length) {
+        unsigned long todo = m->length - done;
+        if (todo > 0x4000UL) todo = 0x4000UL;
+
+        rd = read(fd,m->buffer+(size_t)done,(unsigned int)todo);
+        if (rd <= 0) {
+            if (rd == 0) errno = EIO;
+            close(fd);
+            omf_mem_image_free(m);
+            return -1;
+        }
+
+        done += (unsigned long)rd;
+    }
+
+    close(fd);
+    m->data = m->buffer;
+    return 0;
+}
+
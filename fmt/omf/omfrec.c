@@ -10,12 +10,14 @@ void omf_record_init(struct omf_record_t * const rec) {
     rec->reclen = 0;
     rec->data = NULL;
     rec->data_alloc = 4096; // OMF spec says 1024
+    rec->data_extern = 0;
     rec->rec_file_offset = (~0UL);
 }
 
 void omf_record_data_free(struct omf_record_t * const rec) {
     if (rec->data != NULL) {
-        free(rec->data);
+        if (!rec->data_extern) free(rec->data);
+        rec->data_extern = 0;
         rec->data = NULL;
     }
     rec->reclen = 0;
@@ -28,6 +30,13 @@ int omf_record_data_alloc(struct omf_record_t * const rec,size_t sz) {
         return -1;
     }
 
+    if (rec->data != NULL && rec->data_extern) {
+        // stop pointing at the caller's buffer, allocate our own
+        rec->data = NULL;
+        rec->data_extern = 0;
+        rec->data_alloc = 4096;
+    }
+
     if (rec->data != NULL) {
         if (sz == 0 || sz == rec->data_alloc)
             return 0;
@@ -66,7 +75,7 @@ unsigned short omf_record_lseek(struct omf_record_t * const rec,unsigned short p
 }
 
 size_t omf_record_can_write(const struct omf_record_t * const rec) {
-    if (rec->data == NULL)
+    if (rec->data == NULL || rec->data_extern)
         return 0;
     if (rec->recpos >= rec->data_alloc)
         return 0;
@@ -190,3 +199,28 @@ void omf_record_free(struct omf_record_t * const rec) {
     omf_record_data_free(rec);
 }
 
+// verify the checksum of a record read by omf_context_read_mem(), which does not check it.
+// returns 0 if valid (or if the record has no checksum), -1 if not.
+int omf_record_verify_checksum(const struct omf_record_t * const rec) {
+    unsigned char sum;
+    unsigned int i;
+
+    if (rec->data == NULL)
+        return 0;
+    if (rec->data[rec->reclen] == 0/*optional*/)
+        return 0;
+
+    // header: type, and length which includes the checksum byte
+    sum  = rec->rectype;
+    sum += (unsigned char)((rec->reclen + 1U) & 0xFFU);
+    sum += (unsigned char)((rec->reclen + 1U) >> 8U);
+    for (i=0;i <= rec->reclen;i++)
+        sum += rec->data[i];
+
+    if (sum != 0) {
+        errno = EIO;
+        return -1;
+    }
+
+    return 0;
+}
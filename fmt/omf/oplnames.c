@@ -7,10 +7,10 @@ int omf_context_parse_LNAMES(struct omf_context_t * const ctx,struct omf_record_
     int len;
 
     while (!omf_record_eof(rec)) {
-        len = omf_record_get_lenstr(omf_temp_str,sizeof(omf_temp_str),rec);
+        len = omf_record_get_lenstr(ctx->temp_str,sizeof(ctx->temp_str),rec);
         if (len < 0) return -1;
 
-        if (omf_lnames_context_add_name(&ctx->LNAMEs,omf_temp_str,len) < 0)
+        if (omf_lnames_context_add_name(&ctx->LNAMEs,ctx->temp_str,len) < 0)
             return -1;
     }
 
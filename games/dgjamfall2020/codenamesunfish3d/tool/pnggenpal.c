@@ -1,12 +1,18 @@
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
+#include <time.h>
+#include <math.h>
 
 #include <png.h>    /* libpng */
 
-static char*            in_png = NULL;
+#define MAX_IN_PNG      256
+
+static char*            in_png[MAX_IN_PNG];
+static unsigned int     in_png_count = 0;
 static char*            out_png = NULL;
 
 static unsigned int	want_colors = 256;
@@ -29,6 +35,8 @@ static png_color        gen_png_pal[256] = {0};
 static int              gen_png_pal_count = 0;
 
 static char             pal_vga = 0;
+static char             pal_box_average = 0;
+static unsigned int     hist_bits = 6;
 
 static void free_src_png(void) {
     if (src_png_image) {
@@ -53,11 +61,14 @@ static void free_gen_png(void) {
 }
 
 static void help(void) {
-    fprintf(stderr,"pnggenpal -i <input PNG> -o <output PNG>\n");
-    fprintf(stderr,"Read a non-paletted PNG, generate a palette as PNG,\n");
+    fprintf(stderr,"pnggenpal -i <input PNG> [-i <input PNG> ...] -o <output PNG>\n");
+    fprintf(stderr,"Read non-paletted PNGs, generate a palette as PNG,\n");
+    fprintf(stderr,"one palette shared by all input PNGs.\n");
     fprintf(stderr," -vga        Palettize for VGA (6 bits per RGB)\n");
     fprintf(stderr," -nc <n>     Number of colors (default 256)\n");
     fprintf(stderr," -b0 / -nb0  Color #0 is fixed black (default) / not fixed\n");
+    fprintf(stderr," -hb <n>     Histogram bits per channel, 5 or 6 (default 6)\n");
+    fprintf(stderr," -avg        Use the average of each color box, not its most common color\n");
 }
 
 static int parse_argv(int argc,char **argv) {
@@ -75,7 +86,9 @@ static int parse_argv(int argc,char **argv) {
                 return 1;
             }
 	    else if (!strcmp(a,"i")) {
-		    if ((in_png = argv[i++]) == NULL)
+		    if (in_png_count >= MAX_IN_PNG)
+			    return 1;
+		    if ((in_png[in_png_count++] = argv[i++]) == NULL)
 			    return 1;
             }
             else if (!strcmp(a,"o")) {
@@ -99,6 +112,17 @@ static int parse_argv(int argc,char **argv) {
             else if (!strcmp(a,"nb0")) {
                 color0_black = 0;
             }
+            else if (!strcmp(a,"hb")) {
+                if ((a=argv[i++]) == NULL)
+                    return 1;
+
+                hist_bits = atoi(a);
+                if (hist_bits < 5 || hist_bits > 6)
+                    return 1;
+            }
+            else if (!strcmp(a,"avg")) {
+                pal_box_average = 1;
+            }
             else {
                 fprintf(stderr,"Unknown switch %s\n",a);
                 return 1;
@@ -110,7 +134,7 @@ static int parse_argv(int argc,char **argv) {
         }
     }
 
-    if (in_png == NULL) {
+    if (in_png_count == 0) {
         fprintf(stderr,"Input -i png required\n");
         return 1;
     }
@@ -123,7 +147,7 @@ static int parse_argv(int argc,char **argv) {
     return 0;
 }
 
-static int load_in_png(void) {
+static int load_in_png(const char *in_png) {
     png_structp png_context = NULL;
     png_infop png_context_info = NULL;
     png_infop png_context_end = NULL;
@@ -182,20 +206,6 @@ static int load_in_png(void) {
             src_png_image_rows[y] = src_png_image + (y * png_width * src_png_bypp);
     }
 
-    gen_png_image = malloc((png_width * src_png_bypp * png_height) + 4096);
-    if (gen_png_image == NULL)
-        goto fail;
-
-    gen_png_image_rows = (png_bytep*)malloc(sizeof(png_bytep) * png_height);
-    if (gen_png_image_rows == NULL)
-        goto fail;
-
-    {
-        unsigned int y;
-        for (y=0;y < png_height;y++)
-            gen_png_image_rows[y] = gen_png_image + (y * png_width * src_png_bypp);
-    }
-
     png_read_rows(png_context, src_png_image_rows, NULL, png_height);
 
     gen_png_width = png_width;
@@ -219,407 +229,364 @@ fail:
     return ret;
 }
 
-static inline unsigned char clamp255(int x) {
-	return (x > 255) ? 255 : ((x < 0) ? 0 : x);
-}
+/* Color histogram.
+ *
+ * Each cell holds the pixel count and the per channel sums and sums of squares of the pixels
+ * that fall into it, so that the exact mean of a cell and the exact error of mapping a whole cell
+ * to one palette color are known without going back to the pixels. Cells are 6 bits per channel
+ * (18-bit, which is all VGA can show anyway) or 5 bits per channel (15-bit, -hb 5). Images are
+ * added to the histogram one at a time, so several images can share one palette. */
+struct hist_cell {
+	uint32_t			count;
+	uint64_t			sum[3];
+	uint64_t			sumsq[3];
+};
 
-void rgb2yuv(unsigned char *Y,unsigned char *U,unsigned char *V,unsigned char r,unsigned char g,unsigned char b) {
-	*Y = clamp255((((r *  66) + (g * 129) + (b *  25) + 128) >> 8) + 16);
-	*U = clamp255((((r * -38) + (g * -74) + (b * 112) + 128) >> 8) + 128);
-	*V = clamp255((((r * 112) + (g * -94) + (b * -18) + 128) >> 8) + 128);
-}
+static struct hist_cell*	hist = NULL;
+static unsigned long		hist_pixels = 0;
+static unsigned int		hist_images = 0;
 
-struct color_bucket {
-	unsigned int			count;
-	unsigned char			R,G,B,A;
-	struct color_bucket*		next;
-};
+static inline unsigned int hist_index(const unsigned char r,const unsigned char g,const unsigned char b) {
+	const unsigned int s = 8u - hist_bits;
+	return ((unsigned int)(r >> s) << (hist_bits * 2u)) + ((unsigned int)(g >> s) << hist_bits) + (unsigned int)(b >> s);
+}
 
-void color_buckets_init(struct color_bucket **buckets,unsigned int num) {
-	unsigned int x;
+static int hist_init(void) {
+	hist = (struct hist_cell*)calloc(1u << (hist_bits * 3u),sizeof(struct hist_cell));
+	if (hist == NULL) {
+		fprintf(stderr,"Cannot allocate histogram\n");
+		return 1;
+	}
 
-	for (x=0;x < num;x++) buckets[x] = NULL;
+	hist_pixels = 0;
+	hist_images = 0;
+	return 0;
 }
 
-void color_bucket_free(struct color_bucket **b) {
-	while (*b != NULL) {
-		struct color_bucket *n = (*b)->next;
-		free(*b);
-		*b = n;
+static void hist_free(void) {
+	if (hist) {
+		free(hist);
+		hist = NULL;
 	}
 }
 
-void color_buckets_free(struct color_bucket **buckets,unsigned int num) {
-	unsigned int x;
+static void hist_add_image(void) {
+	unsigned char c[3];
+	unsigned int x,y,i,j;
+	png_bytep row;
 
-	for (x=0;x < num;x++) color_bucket_free(&buckets[x]);
-}
+	for (y=0;y < gen_png_height;y++) {
+		row = src_png_image_rows[y];
+		for (x=0;x < gen_png_width;x++,row += src_png_bypp) {
+			/* transparent pixels are never seen, do not spend colors on them */
+			if (src_png_bypp >= 4 && !(row[3] & 0x80))
+				continue;
+
+			for (j=0;j < 3;j++) {
+				c[j] = row[j];
+				if (pal_vga) c[j] &= 0xFC; // strip to 6 bits
+			}
 
-/* NTS: It turns out taking the time to check for existing duplicates HERE is faster than sorting through all the
- *      duplicates later. */
-void color_bucket_add(struct color_bucket **buckets,unsigned int num,unsigned int idx,struct color_bucket *nb) {
-	if (idx < num && nb->next == NULL) {
-		if (buckets[idx] != NULL) {
-			struct color_bucket *s = buckets[idx];
-			while (s != NULL) {
-				if (s->R == nb->R && s->G == nb->G && s->B == nb->B && s->A == nb->A) {
-					/* we're expected to insert it, if we do not, then we must free it, else a memory leak occurs */
-					s->count++;
-					free(nb);
-					return;
-				}
-
-				if (s->next != NULL) {
-					s = s->next;
-				}
-				else {
-					/* end of chain, add the new entry to the end */
-					nb->count = 1;
-					s->next = nb;
-					break;
-				}
+			i = hist_index(c[0],c[1],c[2]);
+			hist[i].count++;
+			hist_pixels++;
+			for (j=0;j < 3;j++) {
+				hist[i].sum[j] += c[j];
+				hist[i].sumsq[j] += (uint64_t)c[j] * c[j];
 			}
 		}
-		else {
-			buckets[idx] = nb;
-			nb->count = 1;
-		}
 	}
+
+	hist_images++;
 }
 
-unsigned int color_bucket_count(struct color_bucket *b) {
-	unsigned int c = 0;
+/* Median cut over the non-empty histogram cells, gathered into one array.
+ *
+ * A box is a contiguous run of that array. The box with the largest total squared error
+ * (over all of its pixels) is split next. Rather than at the median, it is split at the point
+ * along R, G or B that leaves the least squared error in the two halves, which does much better
+ * on smooth gradients where no one color is common. */
+struct mc_cell {
+	uint32_t			count;
+	unsigned char			c[3];		/* cell mean */
+	uint32_t			cell;		/* histogram index */
+};
 
-	while (b != NULL) {
-		b = b->next;
-		c++;
-	}
+struct mc_box {
+	unsigned int			first,last;	/* [first,last) in mc_cells */
+	uint64_t			count;
+	double				error;
+};
 
-	return c;
-}
+static struct mc_cell*		mc_cells = NULL;
+static unsigned int		mc_cell_count = 0;
+static unsigned char		mc_sort_axis = 0;
 
-static inline unsigned int color_bucket_channel_po(unsigned int channel) {
-	switch (channel) {
-		case 0:		return (unsigned char)offsetof(struct color_bucket,R);
-		case 1:		return (unsigned char)offsetof(struct color_bucket,G);
-		case 2:		return (unsigned char)offsetof(struct color_bucket,B);
-		case 3:		return (unsigned char)offsetof(struct color_bucket,A);
-	};
+static int mc_cell_cmp(const void *a,const void *b) {
+	const struct mc_cell *as = (const struct mc_cell*)a;
+	const struct mc_cell *bs = (const struct mc_cell*)b;
 
-	return 0;
-}
+	if (as->c[mc_sort_axis] != bs->c[mc_sort_axis])
+		return (int)as->c[mc_sort_axis] - (int)bs->c[mc_sort_axis];
 
-static inline unsigned char color_bucket_channel(struct color_bucket *b,unsigned int co) {
-	return *((unsigned char*)b + co);
+	/* ties in cell order, so that the result does not depend on qsort() */
+	return (as->cell < bs->cell) ? -1 : ((as->cell > bs->cell) ? 1 : 0);
 }
 
-static unsigned int color_bucket_lt(struct color_bucket *a,struct color_bucket *b,const unsigned int co[4]) {
-	unsigned char ca,cb;
-	unsigned int i;
+/* fill in count and error */
+static void mc_box_stat(struct mc_box *b) {
+	double sum[3] = {0,0,0},sumsq[3] = {0,0,0};
+	unsigned int i,j;
+
+	b->count = 0;
+	for (i=b->first;i < b->last;i++) {
+		const struct hist_cell *h = &hist[mc_cells[i].cell];
 
-	for (i=0;i < 4;i++) {
-		ca = color_bucket_channel(a,co[i]);
-		cb = color_bucket_channel(b,co[i]);
-		if (ca < cb) return 1;
-		if (ca > cb) return 0;
+		b->count += h->count;
+		for (j=0;j < 3;j++) {
+			sum[j] += (double)h->sum[j];
+			sumsq[j] += (double)h->sumsq[j];
+		}
 	}
 
-	return 0;
+	b->error = 0;
+	for (j=0;j < 3;j++) {
+		if (b->count != 0)
+			b->error += sumsq[j] - ((sum[j] * sum[j]) / (double)b->count);
+	}
+
+	/* a single cell cannot be split */
+	if ((b->last - b->first) < 2u)
+		b->error = -1;
 }
 
-// code assumes *d and *s have already been sorted by count
-void color_bucket_merge_channel(struct color_bucket **d,struct color_bucket **s,unsigned int channel) {
-	const unsigned int co[4] = {
-		color_bucket_channel_po( channel       ),
-		color_bucket_channel_po((channel+1u)&3u),
-		color_bucket_channel_po((channel+2u)&3u),
-		color_bucket_channel_po((channel+3u)&3u)
-	};
-
-	if (*d == NULL) {
-		*d = *s;
-		*s = NULL;
-	}
-	else if (*s != NULL) {
-		struct color_bucket **sd = d,*n;
-
-		while (*sd != NULL && *s != NULL) {
-			if (color_bucket_lt(*s,*sd,co)) {
-				/* remove first from *s */
-				n = (*s); *s = (*s)->next;
-				/* insert to first in *d */
-				n->next = *sd;
-				*sd = n;
-			}
-			else {
-				/* advance *sd, or at the end of the list, copy the rest of *s */
-				if ((*sd)->next != NULL) {
-					sd = &((*sd)->next);
-				}
-				else {
-					(*sd)->next = *s;
-					*s = NULL;
-					break;
-				}
-			}
-		}
+/* sort the box on axis, return the split point (first cell of the second half) that leaves the least
+ * squared error, and in *score how good it is. the squared error of a set of pixels is sumsq - |sum|^2/n,
+ * and sumsq does not depend on the split, so the best split is the one with the largest |sum|^2/n summed
+ * over both halves. */
+static unsigned int mc_box_best_split(const struct mc_box *b,unsigned char axis,double *score) {
+	double suml[3] = {0,0,0},sumt[3] = {0,0,0},sc,d;
+	unsigned int i,j,split = b->first + 1u;
+	double nl = 0,nt = 0;
+
+	mc_sort_axis = axis;
+	qsort(mc_cells + b->first,b->last - b->first,sizeof(struct mc_cell),mc_cell_cmp);
+
+	for (i=b->first;i < b->last;i++) {
+		const struct hist_cell *h = &hist[mc_cells[i].cell];
+
+		nt += (double)h->count;
+		for (j=0;j < 3;j++) sumt[j] += (double)h->sum[j];
 	}
-}
 
-void color_bucket_sort_by_channel(struct color_bucket **c,unsigned int channel) {
-	const unsigned int co[4] = {
-		color_bucket_channel_po( channel       ),
-		color_bucket_channel_po((channel+1u)&3u),
-		color_bucket_channel_po((channel+2u)&3u),
-		color_bucket_channel_po((channel+3u)&3u)
-	};
-	struct color_bucket *n,*pn;
-
-	while (*c != NULL) {
-		pn = *c;
-		n = (*c)->next;
-		if (n != NULL) {
-			while (n != NULL) {
-				if (color_bucket_lt(n,*c,co)) {
-					/* remove "n" from list */
-					pn->next = n->next;
-					/* then insert "n" before node *c */
-					n->next = *c;
-					*c = n;
-					break;
-				}
-				pn = n;
-				n = n->next;
-				if (n == NULL)
-					c = &((*c)->next);
-			}
+	*score = -1;
+	for (i=b->first;i < (b->last - 1u);i++) {
+		const struct hist_cell *h = &hist[mc_cells[i].cell];
+
+		nl += (double)h->count;
+		for (j=0;j < 3;j++) suml[j] += (double)h->sum[j];
+
+		/* only split between different values on this axis */
+		if (mc_cells[i].c[axis] == mc_cells[i+1u].c[axis])
+			continue;
+
+		sc = 0;
+		for (j=0;j < 3;j++) {
+			d = sumt[j] - suml[j];
+			sc += ((suml[j] * suml[j]) / nl) + ((d * d) / (nt - nl));
 		}
-		else {
-			c = &((*c)->next);
+
+		if (*score < sc) {
+			*score = sc;
+			split = i + 1u;
 		}
 	}
+
+	return split;
 }
 
-void color_bucket_sort_by_count(struct color_bucket **c) {
-	struct color_bucket *n,*pn;
-
-	while (*c != NULL) {
-		pn = *c;
-		n = (*c)->next;
-		if (n != NULL) {
-			while (n != NULL) {
-				if (n->count > (*c)->count) {
-					/* remove "n" from list */
-					pn->next = n->next;
-					/* then insert "n" before node *c */
-					n->next = *c;
-					*c = n;
-					break;
-				}
-				pn = n;
-				n = n->next;
-				if (n == NULL)
-					c = &((*c)->next);
+static unsigned int median_cut(struct mc_box *box,unsigned int want) {
+	unsigned int boxes = 1,i,best,split,s;
+	unsigned char axis,best_axis;
+	double score,best_score;
+
+	box[0].first = 0;
+	box[0].last = mc_cell_count;
+	mc_box_stat(&box[0]);
+
+	while (boxes < want) {
+		best = 0;
+		for (i=1;i < boxes;i++) {
+			if (box[i].error > box[best].error)
+				best = i;
+		}
+		if (box[best].error <= 0)
+			break; /* nothing left worth splitting */
+
+		best_axis = 0;
+		best_score = -1;
+		split = box[best].first + 1u;
+		for (axis=0;axis < 3;axis++) {
+			s = mc_box_best_split(&box[best],axis,&score);
+			if (best_score < score) {
+				best_score = score;
+				best_axis = axis;
+				split = s;
 			}
 		}
-		else {
-			c = &((*c)->next);
+
+		/* cells of identical mean on every axis cannot be told apart, stop splitting this box */
+		if (best_score < 0) {
+			box[best].error = -1;
+			continue;
+		}
+
+		/* leave the box sorted on the axis it is split on */
+		if (best_axis != 2) {
+			mc_sort_axis = best_axis;
+			qsort(mc_cells + box[best].first,box[best].last - box[best].first,sizeof(struct mc_cell),mc_cell_cmp);
 		}
+
+		box[boxes].first = split;
+		box[boxes].last = box[best].last;
+		box[best].last = split;
+		mc_box_stat(&box[best]);
+		mc_box_stat(&box[boxes]);
+		boxes++;
 	}
+
+	return boxes;
 }
 
-static int make_palette() {
-#define COLOR_BUCKETS (256u * 8u * 8u)
-	unsigned int target_colors = 256;
-	struct color_bucket** color_buckets;
-	struct color_bucket* nbucket;
-	unsigned char minr=0xFF,ming=0xFF,minb=0xFF,mina=0xFF;
-	unsigned char maxr=0,maxg=0,maxb=0,maxa=0;
-	unsigned int x,y,ci,colors;
-	unsigned char selchannel;
-	png_bytep row;
+static inline unsigned char pal_channel(double v) {
+	int i = (int)(v + 0.5);
 
-	target_colors = want_colors;
-	if (color0_black) {
-		if (target_colors == 0) return 1;
-		target_colors--;
+	if (i < 0) i = 0;
+	if (i > 255) i = 255;
+	if (pal_vga) {
+		i = (i + 2) & 0xFC;
+		if (i > 0xFC) i = 0xFC;
 	}
 
-	if (gen_png_color_type == PNG_COLOR_TYPE_PALETTE)
-		return 1;
-	if (target_colors > 256)
-		return 1;
-
-	color_buckets = (struct color_bucket**)malloc(sizeof(struct color_bucket*) * COLOR_BUCKETS);
-	if (color_buckets == NULL) return 1;
+	return (unsigned char)i;
+}
 
-	color_buckets_init(color_buckets,COLOR_BUCKETS);
+/* The color for a box. By default this is the mean of the most common cell in the box, not the
+ * mean of the whole box: the average of a box is often desaturated and dull compared to the original
+ * image. -avg uses the mean of the whole box instead, which gives a lower MSE. */
+static void mc_box_color(const struct mc_box *b,png_color *p) {
+	double sum[3] = {0,0,0};
+	unsigned int i,j,most = b->first;
+	uint64_t count = 0;
 
-	for (y=0;y < gen_png_height;y++) {
-		unsigned char Y,U,V;
+	for (i=b->first;i < b->last;i++) {
+		const struct hist_cell *h = &hist[mc_cells[i].cell];
 
-		memcpy(gen_png_image_rows[y], src_png_image_rows[y], gen_png_width * src_png_bypp);
-		row = gen_png_image_rows[y];
+		if (mc_cells[i].count > mc_cells[most].count)
+			most = i;
 
-		if (pal_vga) {
-			for (x=0;x < (gen_png_width * src_png_bypp);x++)
-				row[x] &= 0xFC; // strip to 6 bits
+		if (pal_box_average) {
+			count += h->count;
+			for (j=0;j < 3;j++) sum[j] += (double)h->sum[j];
 		}
+	}
 
-		for (x=0;x < (gen_png_width * src_png_bypp);x += src_png_bypp) {
-			nbucket = (struct color_bucket*)malloc(sizeof(struct color_bucket));
-			nbucket->next = NULL;
-			nbucket->count = 0;
-			if (src_png_bypp >= 4) {
-				nbucket->R = row[x+0];
-				nbucket->G = row[x+1];
-				nbucket->B = row[x+2];
-				nbucket->A = row[x+3];
-				rgb2yuv(&Y,&U,&V,nbucket->R,nbucket->G,nbucket->B);
-			}
-			else { // assume 3
-				nbucket->R = row[x+0];
-				nbucket->G = row[x+1];
-				nbucket->B = row[x+2];
-				nbucket->A = 0xFF;
-				rgb2yuv(&Y,&U,&V,nbucket->R,nbucket->G,nbucket->B);
-			}
+	if (!pal_box_average) {
+		const struct hist_cell *h = &hist[mc_cells[most].cell];
 
-			if (minr > nbucket->R) minr = nbucket->R;
-			if (ming > nbucket->G) ming = nbucket->G;
-			if (minb > nbucket->B) minb = nbucket->B;
-			if (mina > nbucket->A) mina = nbucket->A;
-			if (maxr < nbucket->R) maxr = nbucket->R;
-			if (maxg < nbucket->G) maxg = nbucket->G;
-			if (maxb < nbucket->B) maxb = nbucket->B;
-			if (maxa < nbucket->A) maxa = nbucket->A;
-
-			ci = (Y * 8u * 8u) + ((U / (256u / 8u)) * 8u) + (V / (256u / 8u));
-			color_bucket_add(color_buckets,COLOR_BUCKETS,ci,nbucket); // bucket index by Y (grayscale)
-		}
+		count = h->count;
+		for (j=0;j < 3;j++) sum[j] = (double)h->sum[j];
 	}
 
-	{
-		unsigned char mr = maxr-minr;
-		selchannel = 0;
+	if (count == 0) count = 1;
+	p->red   = pal_channel(sum[0] / (double)count);
+	p->green = pal_channel(sum[1] / (double)count);
+	p->blue  = pal_channel(sum[2] / (double)count);
+}
 
-		if (mr < (maxg-ming)) {
-			mr = maxg-ming;
-			selchannel=1;
+/* mean squared error per channel of mapping each pixel to the nearest palette color.
+ * the nearest color is chosen per cell from the cell mean. */
+static double palette_mse(void) {
+	double total = 0,e,best;
+	unsigned int i,j,k;
+
+	for (i=0;i < mc_cell_count;i++) {
+		const struct hist_cell *h = &hist[mc_cells[i].cell];
+		const struct mc_cell *m = &mc_cells[i];
+		unsigned int bk = 0,bd = ~0u,d;
+
+		for (k=0;k < (unsigned int)gen_png_pal_count;k++) {
+			const int dr = (int)m->c[0] - gen_png_pal[k].red;
+			const int dg = (int)m->c[1] - gen_png_pal[k].green;
+			const int db = (int)m->c[2] - gen_png_pal[k].blue;
+
+			d = (unsigned int)((dr*dr) + (dg*dg) + (db*db));
+			if (bd > d) {
+				bd = d;
+				bk = k;
+			}
 		}
 
-		if (mr < (maxb-minb)) {
-			mr = maxb-minb;
-			selchannel=2;
-		}
+		/* sum over the cell's pixels of (x - p)^2 = sumsq - 2*p*sum + n*p^2 */
+		best = 0;
+		for (j=0;j < 3;j++) {
+			const double p = (j == 0) ? gen_png_pal[bk].red : ((j == 1) ? gen_png_pal[bk].green : gen_png_pal[bk].blue);
 
-		if (mr < (maxa-mina)) {
-			mr = maxa-mina;
-			selchannel=3;
+			e = (double)h->sumsq[j] - (2.0 * p * (double)h->sum[j]) + ((double)h->count * p * p);
+			best += e;
 		}
-	}
 
-	printf("Min/Max R=%u-%u G=%u-%u B=%u-%u A=%u-%u selchannel=%u\n",minr,maxr,ming,maxg,minb,maxb,mina,maxa,selchannel);
+		total += best;
+	}
 
-	/* sort from highest to lowest count (occurrence) */
-	for (x=0;x < COLOR_BUCKETS;x++)
-		color_bucket_sort_by_channel(&color_buckets[x],selchannel);
+	if (hist_pixels == 0) return 0;
+	return total / ((double)hist_pixels * 3.0);
+}
 
-	for (x=1;x < COLOR_BUCKETS;x++)
-		color_bucket_merge_channel(&color_buckets[0],&color_buckets[x],selchannel);
+static int make_palette() {
+	unsigned int target_colors = 256;
+	struct mc_box box[256];
+	unsigned int x,y,i,colors;
+	clock_t t_start = clock();
+	png_bytep row;
+	double mse;
 
-	/* eliminate any color that occurs less than 1 out of (N*N) times of the total picture -- all colors in bucket 0 */
-	{
-		struct color_bucket **scan;
-		unsigned int thr;
-
-		scan = &color_buckets[0];
-		colors = color_bucket_count(*scan);
-		thr = colors / (target_colors * target_colors);
-		while (colors > target_colors) {
-			if (thr >= 2) {
-				printf("Dropping entries that occurs less than %u times (colors=%u)\n",thr,colors);
-				while (*scan != NULL) {
-					if ((*scan)->count < thr) {
-						/* drop the node */
-						struct color_bucket *n = *scan;
-						*scan = n->next;
-						if (*scan != NULL) (*scan)->count += n->count;
-						free(n);
-
-						colors--;
-						if (colors <= target_colors) break;
-					}
-					else {
-						scan = &((*scan)->next);
-					}
-				}
-			}
+	target_colors = want_colors;
+	if (color0_black) {
+		if (target_colors == 0) return 1;
+		target_colors--;
+	}
 
-			if (thr < 2)
-				thr = 2;
-			else
-				thr += (thr + 1u) / 2u;
+	if (target_colors > 256)
+		return 1;
 
-			scan = &color_buckets[0];
-		}
+	/* gather the non-empty cells */
+	mc_cell_count = 0;
+	for (i=0;i < (1u << (hist_bits * 3u));i++) {
+		if (hist[i].count != 0)
+			mc_cell_count++;
 	}
 
-	/* median cut, except just cut into N colors in one pass */
-	{
-		struct color_bucket *scan = color_buckets[0];
-		unsigned int c,i,o,ci;
-
-		color_buckets[0] = NULL;
-
-		colors = color_bucket_count(scan);
-		for (i=0,o=0,ci=0;i < target_colors && o < target_colors;i++) {
-			if (scan == NULL) abort();
-			c = (colors * (i+1u)) / target_colors;
-			if (ci < c) {
-				if (o >= target_colors) abort();
-				color_buckets[o++] = scan;
-				while (ci < c) {
-					if (scan == NULL) abort();
-					if ((++ci) == c) {
-						struct color_bucket *n = scan->next;
-						scan->next = NULL;
-						scan = n;
-					}
-					else {
-						scan = scan->next;
-					}
-				}
-			}
-		}
-		fflush(stdout);
-		colors = o;
-	}
+	mc_cells = (struct mc_cell*)malloc(sizeof(struct mc_cell) * (mc_cell_count + 1u));
+	if (mc_cells == NULL) return 1;
 
-	/* Median cut, but instead of using an average of the buckets, use the color that's most common in the bucket (highest count).
-	 * Using the average produces a picture that is often desaturated and dull compared to the original image. */
-	for (x=0;x < colors;x++)
-		color_bucket_sort_by_count(&color_buckets[x]);
+	mc_cell_count = 0;
+	for (i=0;i < (1u << (hist_bits * 3u));i++) {
+		if (hist[i].count != 0) {
+			struct mc_cell *m = &mc_cells[mc_cell_count++];
 
-#if 1//DEBUG
-	printf("%u Colors:\n",colors);
-	for (y=0;y < COLOR_BUCKETS;y++) {
-		nbucket = color_buckets[y];
-		if (nbucket != NULL) {
-			printf("  Bucket %u\n",y);
-			while (nbucket != NULL) {
-				printf("    RGB=%03u/%03u/%03u/%03u count=%u\n",
-					nbucket->R,
-					nbucket->G,
-					nbucket->B,
-					nbucket->A,
-					nbucket->count);
-
-				nbucket = nbucket->next;
-			}
+			m->count = hist[i].count;
+			m->cell = i;
+			for (x=0;x < 3;x++)
+				m->c[x] = (unsigned char)((hist[i].sum[x] + (hist[i].count / 2u)) / hist[i].count);
 		}
 	}
-#endif
+
+	printf("%u images, %lu pixels, %u colors in %u-bit histogram\n",hist_images,hist_pixels,mc_cell_count,hist_bits * 3u);
+
+	colors = 0;
+	if (mc_cell_count != 0 && target_colors != 0)
+		colors = median_cut(box,target_colors);
 
 	if (gen_png_image != NULL) {
 		free(gen_png_image);
@@ -648,45 +615,28 @@ static int make_palette() {
 			gen_png_image_rows[y] = gen_png_image + (y * gen_png_width);
 	}
 
-	{
-		unsigned int endcolor = target_colors;
-		unsigned int bucket=0;
-
-		gen_png_pal_count = 0;
-
-		if (color0_black) {
-			endcolor++;
-			if (endcolor > want_colors)
-				return 1;
-
-			gen_png_pal[gen_png_pal_count].red = 0;
-			gen_png_pal[gen_png_pal_count].green = 0;
-			gen_png_pal[gen_png_pal_count].blue = 0;
-			gen_png_pal_count++;
-		}
-
-		if (endcolor > want_colors || endcolor > 256)
-			abort();
+	gen_png_pal_count = 0;
 
-		while (gen_png_pal_count < endcolor && bucket < colors) {
-			struct color_bucket *s = color_buckets[bucket++];
+	if (color0_black) {
+		gen_png_pal[gen_png_pal_count].red = 0;
+		gen_png_pal[gen_png_pal_count].green = 0;
+		gen_png_pal[gen_png_pal_count].blue = 0;
+		gen_png_pal_count++;
+	}
 
-			if (s != NULL) {
-				gen_png_pal[gen_png_pal_count].red = s->R;
-				gen_png_pal[gen_png_pal_count].green = s->G;
-				gen_png_pal[gen_png_pal_count].blue = s->B;
+	for (i=0;i < colors;i++) {
+		mc_box_color(&box[i],&gen_png_pal[gen_png_pal_count]);
 
 #if 1//DEBUG
-				printf("Palette[%u]: R=%03u G=%03u B=%03u\n",
-					gen_png_pal_count,
-					gen_png_pal[gen_png_pal_count].red,
-					gen_png_pal[gen_png_pal_count].green,
-					gen_png_pal[gen_png_pal_count].blue);
+		printf("Palette[%u]: R=%03u G=%03u B=%03u (%llu pixels)\n",
+			gen_png_pal_count,
+			gen_png_pal[gen_png_pal_count].red,
+			gen_png_pal[gen_png_pal_count].green,
+			gen_png_pal[gen_png_pal_count].blue,
+			(unsigned long long)box[i].count);
 #endif
 
-				gen_png_pal_count++;
-			}
-		}
+		gen_png_pal_count++;
 	}
 
 	for (y=0;y < gen_png_height;y++) {
@@ -698,10 +648,14 @@ static int make_palette() {
 		}
 	}
 
-	color_buckets_free(color_buckets,COLOR_BUCKETS);
-	free(color_buckets);
+	mse = palette_mse();
+	printf("%u palette colors, MSE %.3f (PSNR %.2f dB), quantize %.3f sec\n",
+		gen_png_pal_count,mse,(mse > 0) ? (10.0 * log10((255.0 * 255.0) / mse)) : 99.99,
+		(double)(clock() - t_start) / CLOCKS_PER_SEC);
+
+	free(mc_cells);
+	mc_cells = NULL;
 	return 0;
-#undef COLOR_BUCKETS
 }
 
 static int save_out_png(void) {
@@ -757,13 +711,30 @@ int main(int argc,char **argv) {
     if (parse_argv(argc,argv))
         return 1;
 
-    if (load_in_png())
+    if (hist_init())
         return 1;
+
+    {
+        clock_t t_start = clock();
+        unsigned int i;
+
+        for (i=0;i < in_png_count;i++) {
+            if (load_in_png(in_png[i]))
+                return 1;
+
+            hist_add_image();
+            free_src_png();
+        }
+
+        printf("Histogram %.3f sec\n",(double)(clock() - t_start) / CLOCKS_PER_SEC);
+    }
+
     if (make_palette())
         return 1;
     if (save_out_png())
         return 1;
 
+    hist_free();
     free_src_png();
     free_gen_png();
     return 0;
@@ -1,11 +1,27 @@
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sched.h>
+#include <math.h>
+
+#include <pthread.h>
 
 #include <png.h>    /* libpng */
 
-static unsigned char	enable_dither = 0;
+enum {
+    DITHER_NONE=0,
+    DITHER_FS,              /* Floyd-Steinberg error diffusion */
+    DITHER_ORDERED          /* 8x8 Bayer */
+};
+
+#define QUANT_MAX_THREADS   64
+
+static unsigned char    dither_mode = DITHER_NONE;
+static unsigned int     num_threads = 0; /* 0 = one per CPU */
 
 static char*            pal_png = NULL;
 static char*            in_png = NULL;
@@ -64,8 +80,10 @@ static void help(void) {
     fprintf(stderr,"pngmatchpal -i <input PNG> -o <output PNG> -p <palette PNG>\n");
     fprintf(stderr,"Convert a paletted PNG to another paletted PNG,\n");
     fprintf(stderr,"rearranging the palette to match palette PNG.\n");
-    fprintf(stderr," -dither         Dither to palette\n");
+    fprintf(stderr," -dither         Dither to palette (Floyd-Steinberg)\n");
+    fprintf(stderr," -dither-ordered Dither to palette (ordered, 8x8 Bayer)\n");
     fprintf(stderr," -no-dither      Do not dither\n");
+    fprintf(stderr," -threads <n>    Threads to use (default one per CPU)\n");
     fprintf(stderr," -tc <n>         Force transparency for color n\n");
 }
 
@@ -84,10 +102,18 @@ static int parse_argv(int argc,char **argv) {
                 return 1;
             }
 	    else if (!strcmp(a,"dither")) {
-		    enable_dither = 1;
+		    dither_mode = DITHER_FS;
+	    }
+	    else if (!strcmp(a,"dither-ordered")) {
+		    dither_mode = DITHER_ORDERED;
 	    }
 	    else if (!strcmp(a,"no-dither")) {
-		    enable_dither = 0;
+		    dither_mode = DITHER_NONE;
+	    }
+	    else if (!strcmp(a,"threads")) {
+		    if (argv[i] == NULL)
+			    return 1;
+		    num_threads = (unsigned int)atoi(argv[i++]);
 	    }
 	    else if (!strcmp(a,"tc")) {
 		    force_color_transparent = atoi(argv[i++]);
@@ -330,53 +356,269 @@ static unsigned char grayscale(const unsigned char r,const unsigned char g,const
 	return (unsigned char)(((r * 29u) + (g * 60u) + (b * 11u) + 50u) / 100u);
 }
 
-static unsigned char find_palette_index(const unsigned char r,const unsigned char g,const unsigned char b) {
-	unsigned char gray = grayscale(r,g,b);
-	unsigned int dist = INT_MAX;
-	unsigned char pret = 0;
-	unsigned char ret = 0;
+/* Palette search.
+ *
+ * The distance from a color to a palette entry is |gray difference| + |R| + |G| + |B|, which is
+ * never less than the red difference alone. The usable (non-transparent) entries are kept sorted
+ * by red, so the search starts at the input red and works outward in both directions, stopping each
+ * way once the red difference alone exceeds the best distance so far. Ties go to the lowest palette
+ * index, the same answer as scanning the whole palette in order.
+ *
+ * Results are kept in a 256x256x256 cube (index + 1, 0 = not searched yet) so each distinct color
+ * is searched only once. Threads may fill in the same entry at the same time, with the same value. */
+struct pal_ent {
+	unsigned char		r,g,b,gray;
+	unsigned char		index;
+};
+
+static struct pal_ent		pal_sorted[256];
+static unsigned int		pal_sorted_count = 0;
+static unsigned char		pal_fallback = 0;
+static uint16_t*		pal_cube = NULL;
+
+static int pal_ent_cmp(const void *a,const void *b) {
+	const struct pal_ent *as = (const struct pal_ent*)a;
+	const struct pal_ent *bs = (const struct pal_ent*)b;
+
+	if (as->r != bs->r)
+		return (int)as->r - (int)bs->r;
+
+	return (int)as->index - (int)bs->index;
+}
+
+static int build_palette_search(void) {
 	unsigned int i;
 
-	/* do not map to transparent color */
-	while (ret < gen_png_trns_count) {
-		if (!(gen_png_trns[ret] & 0x80))
-			ret++;
+	/* if nothing is usable, map to the first color that is not transparent */
+	pal_fallback = 0;
+	while (pal_fallback < gen_png_trns_count) {
+		if (!(gen_png_trns[pal_fallback] & 0x80))
+			pal_fallback++;
 		else
 			break;
 	}
 
-	pret = ret;
+	pal_sorted_count = 0;
 	for (i=0;i < gen_png_pal_count;i++) {
-		if (i < gen_png_trns_count) {
-			/* do not map to transparent color */
-			if (!(gen_png_trns[i] & 0x80))
-				continue;
-		}
+		/* do not map to transparent color */
+		if (i < gen_png_trns_count && !(gen_png_trns[i] & 0x80))
+			continue;
+
+		pal_sorted[pal_sorted_count].r = gen_png_pal[i].red;
+		pal_sorted[pal_sorted_count].g = gen_png_pal[i].green;
+		pal_sorted[pal_sorted_count].b = gen_png_pal[i].blue;
+		pal_sorted[pal_sorted_count].gray = grayscale(gen_png_pal[i].red,gen_png_pal[i].green,gen_png_pal[i].blue);
+		pal_sorted[pal_sorted_count].index = (unsigned char)i;
+		pal_sorted_count++;
+	}
 
-		unsigned char cgray = grayscale(gen_png_pal[i].red,gen_png_pal[i].green,gen_png_pal[i].blue);
-		unsigned int cdist = abs((int)gray - cgray) + abs((int)r - gen_png_pal[i].red) + abs((int)g - gen_png_pal[i].green) + abs((int)b - gen_png_pal[i].blue);
+	qsort(pal_sorted,pal_sorted_count,sizeof(struct pal_ent),pal_ent_cmp);
 
-		if (dist > cdist) {
-			dist = cdist;
-			pret = ret;
-			ret = (unsigned int)i;
-		}
+	if (pal_cube == NULL)
+		pal_cube = (uint16_t*)calloc(256u * 256u * 256u,sizeof(uint16_t));
+	else
+		memset(pal_cube,0,256u * 256u * 256u * sizeof(uint16_t));
+
+	if (pal_cube == NULL) {
+		fprintf(stderr,"Cannot allocate palette lookup\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+static void free_palette_search(void) {
+	if (pal_cube) {
+		free(pal_cube);
+		pal_cube = NULL;
+	}
+}
+
+static inline void pal_ent_check(const struct pal_ent *p,const unsigned char r,const unsigned char g,const unsigned char b,const unsigned char gray,unsigned int *dist,unsigned char *ret) {
+	const unsigned int cdist = abs((int)gray - p->gray) + abs((int)r - p->r) + abs((int)g - p->g) + abs((int)b - p->b);
+
+	if (*dist > cdist || (*dist == cdist && *ret > p->index)) {
+		*dist = cdist;
+		*ret = p->index;
 	}
+}
+
+static unsigned char search_palette(const unsigned char r,const unsigned char g,const unsigned char b) {
+	const unsigned char gray = grayscale(r,g,b);
+	unsigned int dist = UINT_MAX;
+	unsigned char ret = pal_fallback;
+	int lo,hi,lom,him;
 
-	if (ret != pret && enable_dither) {
-		if (((unsigned)rand()) & 1)
-			return pret;
+	/* first entry with red >= r */
+	lo = 0;
+	hi = (int)pal_sorted_count;
+	while (lo < hi) {
+		const int mid = (lo + hi) >> 1;
+
+		if (pal_sorted[mid].r < r)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	lom = lo - 1;
+	him = lo;
+	while (lom >= 0 || him < (int)pal_sorted_count) {
+		if (him < (int)pal_sorted_count) {
+			if ((unsigned int)(pal_sorted[him].r - r) > dist)
+				him = (int)pal_sorted_count;
+			else
+				pal_ent_check(&pal_sorted[him++],r,g,b,gray,&dist,&ret);
+		}
+		if (lom >= 0) {
+			if ((unsigned int)(r - pal_sorted[lom].r) > dist)
+				lom = -1;
+			else
+				pal_ent_check(&pal_sorted[lom--],r,g,b,gray,&dist,&ret);
+		}
 	}
 
 	return ret;
 }
 
+static unsigned char find_palette_index(const unsigned char r,const unsigned char g,const unsigned char b) {
+	uint16_t * const c = pal_cube + (((uint32_t)r << 16u) + ((uint32_t)g << 8u) + (uint32_t)b);
+	uint16_t v = __atomic_load_n(c,__ATOMIC_RELAXED);
+
+	if (v == 0) {
+		v = (uint16_t)search_palette(r,g,b) + 1u;
+		__atomic_store_n(c,v,__ATOMIC_RELAXED);
+	}
+
+	return (unsigned char)(v - 1u);
+}
+
+/* 8x8 Bayer matrix for ordered dither */
+static const unsigned char bayer8[8][8] = {
+	{  0,32, 8,40, 2,34,10,42 },
+	{ 48,16,56,24,50,18,58,26 },
+	{ 12,44, 4,36,14,46, 6,38 },
+	{ 60,28,52,20,62,30,54,22 },
+	{  3,35,11,43, 1,33, 9,41 },
+	{ 51,19,59,27,49,17,57,25 },
+	{ 15,47, 7,39,13,45, 5,37 },
+	{ 63,31,55,23,61,29,53,21 }
+};
+
+static int			transparent_color = -1;
+static int			ordered_spread = 0;
+
+/* Floyd-Steinberg error, in 1/16ths, for (quant_threads + 1) rows of (width + 2) pixels x RGB.
+ * Row y adds its error into the buffer of row y+1 and row y+1 follows 2 pixels behind, so rows
+ * are handed out to threads round robin and each row waits on row_done[] of the row above.
+ * Row y clears the buffer of row y+1 before it publishes any progress. The last row to use that
+ * buffer was y-quant_threads, which the same thread finished already. */
+static unsigned int		quant_threads = 1;
+static int*			fs_err = NULL;
+static unsigned int*		row_done = NULL;
+
+static inline unsigned char clamp_color(int c) {
+	if (c < 0) return 0;
+	if (c > 255) return 255;
+	return (unsigned char)c;
+}
+
+static inline int fs_round(const int e) {
+	return (e >= 0) ? ((e + 8) >> 4) : -((8 - e) >> 4);
+}
+
+static void quant_row(const unsigned int y) {
+	const unsigned int ew = (gen_png_width + 2u) * 3u;
+	unsigned char *s = src_png_image_rows[y];
+	unsigned char *d = gen_png_image_rows[y];
+	unsigned int x,avail = 0;
+	int *cur = NULL,*nxt = NULL;
+	int er = 0,eg = 0,eb = 0;
+
+	if (dither_mode == DITHER_FS) {
+		cur = fs_err + ((y % (quant_threads + 1u)) * ew) + 3;
+		nxt = fs_err + (((y + 1u) % (quant_threads + 1u)) * ew) + 3;
+		memset(nxt - 3,0,ew * sizeof(int));
+	}
+
+	for (x=0;x < gen_png_width;x++) {
+		if (src_png_bypp > 3 && !(s[3] & 0x80) && transparent_color >= 0) {
+			d[0] = (unsigned char)transparent_color;
+			er = eg = eb = 0;
+		}
+		else if (dither_mode == DITHER_FS) {
+			const int xi = (int)x * 3;
+			unsigned char r,g,b,i;
+
+			/* wait for the row above to finish with this pixel's error */
+			if (y > 0 && avail < gen_png_width && avail < (x + 2u)) {
+				do {
+					avail = __atomic_load_n(&row_done[y - 1u],__ATOMIC_ACQUIRE);
+					if (avail < gen_png_width && avail < (x + 2u)) sched_yield();
+					else break;
+				} while (1);
+			}
+
+			r = clamp_color((int)s[0] + fs_round(cur[xi+0] + er));
+			g = clamp_color((int)s[1] + fs_round(cur[xi+1] + eg));
+			b = clamp_color((int)s[2] + fs_round(cur[xi+2] + eb));
+			d[0] = i = find_palette_index(r,g,b);
+
+			er = (int)r - (int)gen_png_pal[i].red;
+			eg = (int)g - (int)gen_png_pal[i].green;
+			eb = (int)b - (int)gen_png_pal[i].blue;
+
+			nxt[xi-3] += er * 3;  nxt[xi+0] += er * 5;  nxt[xi+3] += er;
+			nxt[xi-2] += eg * 3;  nxt[xi+1] += eg * 5;  nxt[xi+4] += eg;
+			nxt[xi-1] += eb * 3;  nxt[xi+2] += eb * 5;  nxt[xi+5] += eb;
+			er *= 7;
+			eg *= 7;
+			eb *= 7;
+		}
+		else if (dither_mode == DITHER_ORDERED) {
+			const int o = ((((int)bayer8[y&7u][x&7u] * 2) + 1 - 64) * ordered_spread) / 128;
+
+			d[0] = find_palette_index(clamp_color((int)s[0] + o),clamp_color((int)s[1] + o),clamp_color((int)s[2] + o));
+		}
+		else {
+			d[0] = find_palette_index(s[0],s[1],s[2]);
+		}
+
+		if (dither_mode == DITHER_FS && (x & 15u) == 15u)
+			__atomic_store_n(&row_done[y],x + 1u,__ATOMIC_RELEASE);
+
+		s += src_png_bypp;
+		d++;
+	}
+
+	if (dither_mode == DITHER_FS)
+		__atomic_store_n(&row_done[y],gen_png_width,__ATOMIC_RELEASE);
+}
+
+/* 0 = wait, 1 = go, -1 = stop (a thread could not be started) */
+static int			quant_go = 0;
+
+static void *quant_thread_proc(void *p) {
+	unsigned int y;
+	int go;
+
+	while ((go=__atomic_load_n(&quant_go,__ATOMIC_ACQUIRE)) == 0)
+		sched_yield();
+	if (go < 0)
+		return NULL;
+
+	for (y=(unsigned int)((uintptr_t)p);y < gen_png_height;y += quant_threads)
+		quant_row(y);
+
+	return NULL;
+}
+
 static int quant_rgb_to_png(void) {
-	int transparent_color = -1;
+	pthread_t threads[QUANT_MAX_THREADS];
 	unsigned int x,y;
-	unsigned char *s;
-	unsigned char *d;
+	int ret = 0;
 
+	transparent_color = -1;
 	for (x=0;x < gen_png_trns_count;x++) {
 		if (!(gen_png_trns[x] & 0x80)) {
 			transparent_color = x;
@@ -384,22 +626,76 @@ static int quant_rgb_to_png(void) {
 		}
 	}
 
-	for (y=0;y < gen_png_height;y++) {
-		s = src_png_image_rows[y];
-		d = gen_png_image_rows[y];
+	if (build_palette_search())
+		return 1;
 
-		for (x=0;x < gen_png_width;x++) {
-			if (src_png_bypp > 3 && !(s[3] & 0x80) && transparent_color >= 0)
-				d[0] = (unsigned char)transparent_color;
-			else
-				d[0] = find_palette_index(s[0],s[1],s[2]);
+	/* ordered dither spreads each channel by about the step between palette colors */
+	if (pal_sorted_count > 1)
+		ordered_spread = (int)(255.0 / cbrt((double)pal_sorted_count));
+	else
+		ordered_spread = 0;
 
-			s += src_png_bypp;
-			d++;
+	/* rows are cheap, threads are not worth it for small images */
+	quant_threads = num_threads;
+	if (quant_threads == 0) {
+		const long n = sysconf(_SC_NPROCESSORS_ONLN);
+		quant_threads = (n > 0) ? (unsigned int)n : 1u;
+	}
+	if (quant_threads > QUANT_MAX_THREADS)
+		quant_threads = QUANT_MAX_THREADS;
+	if (((unsigned long)gen_png_width * (unsigned long)gen_png_height) < 65536ul)
+		quant_threads = 1;
+	if (quant_threads > gen_png_height)
+		quant_threads = gen_png_height;
+	if (quant_threads == 0)
+		quant_threads = 1;
+
+	if (dither_mode == DITHER_FS) {
+		fs_err = (int*)calloc((size_t)(quant_threads + 1u) * (gen_png_width + 2u) * 3u,sizeof(int));
+		row_done = (unsigned int*)calloc(gen_png_height,sizeof(unsigned int));
+		if (fs_err == NULL || row_done == NULL) {
+			ret = 1;
+			goto done;
 		}
 	}
 
-	return 0;
+	/* every thread has to be running before any starts, or Floyd-Steinberg rows would wait forever
+	 * on the rows of a thread that never started. if one fails, stop the others and go it alone */
+	quant_go = 0;
+	for (x=1;x < quant_threads;x++) {
+		if (pthread_create(&threads[x],NULL,quant_thread_proc,(void*)((uintptr_t)x)) != 0)
+			break;
+	}
+
+	if (x < quant_threads) {
+		__atomic_store_n(&quant_go,-1,__ATOMIC_RELEASE);
+		for (y=1;y < x;y++)
+			pthread_join(threads[y],NULL);
+
+		quant_threads = 1;
+		if (fs_err) memset(fs_err,0,2u * (gen_png_width + 2u) * 3u * sizeof(int));
+		quant_go = 1;
+		quant_thread_proc((void*)((uintptr_t)0));
+	}
+	else {
+		__atomic_store_n(&quant_go,1,__ATOMIC_RELEASE);
+		quant_thread_proc((void*)((uintptr_t)0));
+
+		for (y=1;y < quant_threads;y++)
+			pthread_join(threads[y],NULL);
+	}
+
+done:
+	if (fs_err) {
+		free(fs_err);
+		fs_err = NULL;
+	}
+	if (row_done) {
+		free(row_done);
+		row_done = NULL;
+	}
+
+	return ret;
 }
 
 static int save_out_png(void) {
@@ -470,6 +766,7 @@ int main(int argc,char **argv) {
     if (save_out_png())
         return 1;
 
+    free_palette_search();
     free_src_png();
     free_gen_png();
     return 0;
@@ -0,0 +1,687 @@
+
+#if defined(USE_WIN32)
+# include <windows.h>
+#endif
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(USE_SDL2)
+# if defined(__APPLE__) /* Brew got the headers wrong here */
+#  include <SDL.h>
+# else
+#  include <SDL2/SDL.h>
+# endif
+#endif
+
+#include "ifict.h"
+#include "utils.h"
+#include "debug.h"
+#include "fatal.h"
+#include "bitmap.h"
+
+#if defined(TARGET_MSDOS)
+#include <ext/zlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+extern "C" {
+#include <fmt/minipng/minipng.h>
+}
+
+/* how much decoded bitmap data the cache may hold before it throws out what was least recently used */
+#if defined(USE_DOSLIB)
+# define IFEAssetBudget			(2ul << 20ul)
+#elif defined(USE_WIN32)
+# define IFEAssetBudget			(8ul << 20ul)
+#else
+# define IFEAssetBudget			(32ul << 20ul)
+#endif
+
+/* idle time decoding: rows per step, and for how long IFEAssetIdle() keeps at it */
+#define IFEAssetIdleRows		16u
+#define IFEAssetIdleMs			8u
+
+enum {
+	ASSET_FREE=0,
+	ASSET_QUEUED,		/* waiting for the worker thread or idle time */
+	ASSET_LOADING,		/* being decoded, only the decoder touches the bitmap */
+	ASSET_READY
+};
+
+/* PNG decoding in steps, so that idle time can do a few rows at a time */
+struct IFEPNGLoad {
+	struct minipng_reader*	rdr;
+	IFEBitmap*		bmp;
+	unsigned int		y;
+	bool			transparency;
+};
+
+struct IFEAsset {
+	char*			path;
+	IFEBitmap		bmp;
+	unsigned int		state;
+	unsigned int		refs;		/* IFEGetPNG() without IFEReleasePNG() */
+	unsigned long		last_used;	/* LRU */
+	unsigned long		queued;		/* order queued in */
+};
+
+static IFEAsset			asset[IFEAssetMax];
+static unsigned long		asset_tick = 0;
+static unsigned long		asset_queue_tick = 0;
+static unsigned long		asset_bytes = 0;
+
+static unsigned long		asset_hits = 0;		/* ready when asked for */
+static unsigned long		asset_waits = 0;	/* still decoding when asked for */
+static unsigned long		asset_misses = 0;	/* not decoded yet, decoded on the spot */
+static unsigned long		asset_uncached = 0;	/* IFELoadPNG() with no room in the cache */
+static unsigned long		asset_evicted = 0;
+
+/* idle time decoding, if there is no worker thread */
+static IFEAsset*		asset_idle = NULL;
+static IFEPNGLoad		asset_idle_load;
+
+/* NTS: Open Watcom's Win32 build is not compiled multithreaded (-bm), and its C runtime (the heap that minipng,
+ *      zlib and IFEBitmap allocate from) is not safe to use from a second thread. It decodes in idle time instead,
+ *      the same as Win32s and MS-DOS. */
+#if defined(USE_SDL2) || (defined(USE_WIN32) && !defined(__WATCOMC__))
+# define IFEAssetWorker			1
+#endif
+
+static bool			asset_threaded = false;
+static volatile bool		asset_quit = false;
+
+#if defined(USE_SDL2)
+static SDL_mutex*		asset_mutex = NULL;
+static SDL_cond*		asset_work = NULL;	/* to the worker: something was queued, or quit */
+static SDL_cond*		asset_done = NULL;	/* from the worker: something finished decoding */
+static SDL_Thread*		asset_thread = NULL;
+#elif defined(USE_WIN32)
+static CRITICAL_SECTION		asset_cs;
+static HANDLE			asset_work = NULL;	/* auto-reset events, same meaning as above */
+static HANDLE			asset_done = NULL;
+static HANDLE			asset_thread = NULL;
+#endif
+
+static void asset_lock(void) {
+	if (!asset_threaded) return;
+#if defined(USE_SDL2)
+	SDL_LockMutex(asset_mutex);
+#elif defined(USE_WIN32)
+	EnterCriticalSection(&asset_cs);
+#endif
+}
+
+static void asset_unlock(void) {
+	if (!asset_threaded) return;
+#if defined(USE_SDL2)
+	SDL_UnlockMutex(asset_mutex);
+#elif defined(USE_WIN32)
+	LeaveCriticalSection(&asset_cs);
+#endif
+}
+
+/* wait with the lock held, and the lock is held again on return. the caller checks again for what it waits for */
+#if defined(USE_SDL2)
+static void asset_wait(SDL_cond *c) {
+	SDL_CondWait(c,asset_mutex);
+}
+
+static void asset_signal(SDL_cond *c) {
+	SDL_CondBroadcast(c);
+}
+#elif defined(USE_WIN32)
+static void asset_wait(HANDLE ev) {
+	LeaveCriticalSection(&asset_cs);
+	WaitForSingleObject(ev,INFINITE);
+	EnterCriticalSection(&asset_cs);
+}
+
+static void asset_signal(HANDLE ev) {
+	SetEvent(ev);
+}
+#endif
+
+static bool png_begin(IFEPNGLoad &ld,IFEBitmap &bmp,const char *path) {
+	struct minipng_reader *rdr;
+	unsigned int alloc_w;
+	unsigned int i;
+
+	ld.rdr = NULL;
+	ld.bmp = &bmp;
+	ld.y = 0;
+	ld.transparency = false;
+
+	if ((rdr=ld.rdr=minipng_reader_open(path)) == NULL)
+		goto fail;
+	if (minipng_reader_parse_head(rdr))
+		goto fail;
+	if (rdr->ihdr.width > 2048 || rdr->ihdr.width < 1 || rdr->ihdr.height > 2048 || rdr->ihdr.height < 1)
+		goto fail;
+	if (rdr->ihdr.color_type != 3) /* PNG_COLOR_TYPE_PALETTE = PNG_COLOR_MASK_COLOR | PNG_COLOR_MASK_PALETTE */
+		goto fail;
+	if (rdr->plte == NULL)
+		goto fail;
+
+	if (rdr->trns != NULL && rdr->trns_size != 0) {
+		for (i=0;i < rdr->trns_size;i++) {
+			if (!(rdr->trns[i] & 0x80)) {
+				ld.transparency = true;
+			}
+		}
+	}
+
+	switch (rdr->ihdr.bit_depth) {
+		case 8:
+			alloc_w = rdr->ihdr.width;
+			break;
+		case 4:
+			alloc_w = (rdr->ihdr.width + 1u) & (~1u); /* round up to multiple of 2 */
+			break;
+		case 1:
+			alloc_w = (rdr->ihdr.width + 7u) & (~7u); /* round up to multiple of 8 */
+			break;
+		default:
+			goto fail;
+	};
+
+	/* transparency is accomplished by allocating twice the width,
+	 * making the right hand side the mask and the left hand the image */
+
+	if (!bmp.alloc_subrects(1))
+		goto fail;
+	if (!bmp.alloc_storage(alloc_w, rdr->ihdr.height, ld.transparency ? IFEBitmap::IMT_TRANSPARENT_MASK : IFEBitmap::IMT_OPAQUE))
+		goto fail;
+
+	/* reset bitmap width to what we intended */
+	if (bmp.width < rdr->ihdr.width)
+		goto fail;
+
+	bmp.width = rdr->ihdr.width;
+	bmp.reset_scissor_rect();
+
+	if (!bmp.alloc_palette(1u << rdr->ihdr.bit_depth))
+		goto fail;
+
+	i=0;
+	while (i < bmp.palette_alloc && i < rdr->plte_count) {
+		bmp.palette[i].r = rdr->plte[i].red;
+		bmp.palette[i].g = rdr->plte[i].green;
+		bmp.palette[i].b = rdr->plte[i].blue;
+		i++;
+	}
+	while (i < bmp.palette_alloc) {
+		bmp.palette[i].r = 0;
+		bmp.palette[i].g = 0;
+		bmp.palette[i].b = 0;
+		i++;
+	}
+
+	bmp.palette_size = rdr->plte_count;
+
+	{
+		IFEBitmap::subrect &sr = bmp.get_subrect(0);
+		sr.reset();
+		sr.r.w = rdr->ihdr.width;
+		sr.r.h = rdr->ihdr.height;
+		sr.r.x = 0;
+		sr.r.y = 0;
+	}
+
+	return true;
+fail:
+	minipng_reader_close(&ld.rdr);
+	return false;
+}
+
+/* decode up to count rows. returns true when the whole image is done */
+static bool png_rows(IFEPNGLoad &ld,unsigned int count) {
+	struct minipng_reader *rdr = ld.rdr;
+	IFEBitmap &bmp = *ld.bmp;
+	unsigned char *ptr,*msk;
+	unsigned int x;
+
+	while (count > 0u && ld.y < bmp.height) {
+		ptr = bmp.bitmap + (ld.y * bmp.stride);
+
+		minipng_reader_read_idat(rdr,ptr,1); /* pad byte */
+		if (rdr->ihdr.bit_depth == 8) {
+			minipng_reader_read_idat(rdr,ptr,rdr->ihdr.width); /* row */
+		}
+		else if (rdr->ihdr.bit_depth == 4) {
+			minipng_reader_read_idat(rdr,ptr,(rdr->ihdr.width+1u)/2u); /* row */
+			minipng_expand4to8(ptr,rdr->ihdr.width);
+		}
+		else if (rdr->ihdr.bit_depth == 1) {
+			minipng_reader_read_idat(rdr,ptr,(rdr->ihdr.width+7u)/8u); /* row */
+			minipng_expand1to8(ptr,rdr->ihdr.width);
+		}
+
+		if (ld.transparency) {
+			/* NTS: Remember the bitmap allocated is twice the width of the PNG, mask starts on right hand side */
+			msk = ptr + bmp.get_transparent_mask_offset();
+
+			assert((bmp.get_transparent_mask_offset() + bmp.width) <= (unsigned int)abs(bmp.stride));
+
+			for (x=0;x < rdr->ihdr.width;x++) {
+				if (ptr[x] < rdr->trns_size && !(rdr->trns[ptr[x]] & 0x80)) {
+					msk[x] = 0xFF; /* transparent ((dst AND msk) + src) == dst */
+					ptr[x] = 0x00; /* for this to work, make sure src == 0 */
+				}
+				else {
+					msk[x] = 0x00; /* opaque ((dst AND msk) + src) == src */
+				}
+			}
+		}
+
+		ld.y++;
+		count--;
+	}
+
+	if (ld.y < bmp.height)
+		return false;
+
+	minipng_reader_close(&ld.rdr);
+	return true;
+}
+
+static bool png_load(IFEBitmap &bmp,const char *path) {
+	IFEPNGLoad ld;
+
+	if (!png_begin(ld,bmp,path))
+		return false;
+
+	png_rows(ld,~0u);
+	return true;
+}
+
+static bool png_decode(IFEAsset *a) {
+	return png_load(a->bmp,a->path);
+}
+
+static IFEAsset *asset_find(const char *path) {
+	unsigned int i;
+
+	for (i=0;i < IFEAssetMax;i++) {
+		if (asset[i].state != ASSET_FREE && !strcmp(asset[i].path,path))
+			return &asset[i];
+	}
+
+	return NULL;
+}
+
+static IFEAsset *asset_next_queued(void) {
+	IFEAsset *r = NULL;
+	unsigned int i;
+
+	for (i=0;i < IFEAssetMax;i++) {
+		if (asset[i].state == ASSET_QUEUED && (r == NULL || r->queued > asset[i].queued))
+			r = &asset[i];
+	}
+
+	return r;
+}
+
+static void asset_free(IFEAsset *a) {
+	if (a->state == ASSET_READY)
+		asset_bytes -= (unsigned long)a->bmp.alloc;
+
+	a->bmp.free_subrects();
+	a->bmp.free_storage();
+	a->bmp.free_palette();
+	if (a->path != NULL) {
+		free(a->path);
+		a->path = NULL;
+	}
+	a->state = ASSET_FREE;
+	a->refs = 0;
+}
+
+/* least recently used bitmap that nobody holds, other than keep */
+static IFEAsset *asset_lru(const IFEAsset *keep) {
+	IFEAsset *r = NULL;
+	unsigned int i;
+
+	for (i=0;i < IFEAssetMax;i++) {
+		if (&asset[i] != keep && asset[i].state == ASSET_READY && asset[i].refs == 0 && (r == NULL || r->last_used > asset[i].last_used))
+			r = &asset[i];
+	}
+
+	return r;
+}
+
+static void asset_trim(const IFEAsset *keep) {
+	IFEAsset *a;
+
+	while (asset_bytes > IFEAssetBudget && (a=asset_lru(keep)) != NULL) {
+		asset_free(a);
+		asset_evicted++;
+	}
+}
+
+static IFEAsset *asset_alloc(const char *path) {
+	IFEAsset *a = NULL;
+	unsigned int i;
+
+	for (i=0;i < IFEAssetMax && a == NULL;i++) {
+		if (asset[i].state == ASSET_FREE)
+			a = &asset[i];
+	}
+
+	if (a == NULL && (a=asset_lru(NULL)) != NULL) {
+		asset_free(a);
+		asset_evicted++;
+	}
+
+	if (a == NULL)
+		return NULL;
+
+	if ((a->path=(char*)malloc(strlen(path)+1)) == NULL)
+		return NULL;
+
+	strcpy(a->path,path);
+	a->refs = 0;
+	a->last_used = 0;
+	a->queued = 0;
+	return a;
+}
+
+/* decoding a finished, with the lock held. a is never the one thrown out to make room, even if it
+ * alone is over budget, since somebody is about to ask for it. */
+static void asset_finish(IFEAsset *a,const bool ok) {
+	if (ok) {
+		a->state = ASSET_READY;
+		a->last_used = ++asset_tick;
+		asset_bytes += (unsigned long)a->bmp.alloc;
+		asset_trim(a);
+	}
+	else {
+		IFEDBG("Asset: Failed to load %s",a->path);
+		asset_free(a);
+	}
+}
+
+#if defined(IFEAssetWorker)
+static void asset_worker(void) {
+	IFEAsset *a;
+	bool ok;
+
+	asset_lock();
+	while (!asset_quit) {
+		if ((a=asset_next_queued()) == NULL) {
+			asset_wait(asset_work);
+			continue;
+		}
+
+		a->state = ASSET_LOADING;
+		asset_unlock();
+
+		ok = png_decode(a);
+
+		asset_lock();
+		asset_finish(a,ok);
+		asset_signal(asset_done);
+	}
+	asset_unlock();
+}
+#endif
+
+#if defined(IFEAssetWorker) && defined(USE_SDL2)
+static int SDLCALL asset_worker_thread(void *p) {
+	(void)p;
+	asset_worker();
+	return 0;
+}
+#elif defined(IFEAssetWorker) && defined(USE_WIN32)
+static DWORD WINAPI asset_worker_thread(LPVOID p) {
+	(void)p;
+	asset_worker();
+	return 0;
+}
+#endif
+
+bool IFEAssetInit(void) {
+	asset_quit = false;
+	asset_threaded = false;
+
+#if defined(USE_SDL2)
+	if ((asset_mutex=SDL_CreateMutex()) != NULL && (asset_work=SDL_CreateCond()) != NULL && (asset_done=SDL_CreateCond()) != NULL) {
+		asset_threaded = true;
+		if ((asset_thread=SDL_CreateThread(asset_worker_thread,"IFEAsset",NULL)) == NULL)
+			asset_threaded = false;
+	}
+#elif defined(USE_WIN32)
+	InitializeCriticalSection(&asset_cs);
+# if defined(IFEAssetWorker)
+	/* NTS: Win32s cannot create threads, and will decode in idle time like MS-DOS */
+	if ((asset_work=CreateEvent(NULL,FALSE,FALSE,NULL)) != NULL && (asset_done=CreateEvent(NULL,FALSE,FALSE,NULL)) != NULL) {
+		DWORD tid;
+
+		asset_threaded = true;
+		if ((asset_thread=CreateThread(NULL,0,asset_worker_thread,NULL,0,&tid)) == NULL)
+			asset_threaded = false;
+	}
+# endif
+#endif
+
+	IFEDBG("Asset: %s, cache budget %luKB",asset_threaded ? "worker thread" : "idle time decoding",IFEAssetBudget >> 10ul);
+	return true;
+}
+
+void IFEAssetShutdown(void) {
+	unsigned int i;
+
+#if defined(USE_SDL2) || defined(USE_WIN32)
+	if (asset_threaded) {
+		asset_lock();
+		asset_quit = true;
+		asset_signal(asset_work);
+		asset_unlock();
+# if defined(USE_SDL2)
+		SDL_WaitThread(asset_thread,NULL);
+		asset_thread = NULL;
+# elif defined(USE_WIN32)
+		WaitForSingleObject(asset_thread,INFINITE);
+		CloseHandle(asset_thread);
+		asset_thread = NULL;
+# endif
+		asset_threaded = false;
+	}
+#endif
+
+#if defined(USE_SDL2)
+	if (asset_done != NULL) { SDL_DestroyCond(asset_done); asset_done = NULL; }
+	if (asset_work != NULL) { SDL_DestroyCond(asset_work); asset_work = NULL; }
+	if (asset_mutex != NULL) { SDL_DestroyMutex(asset_mutex); asset_mutex = NULL; }
+#elif defined(USE_WIN32)
+	if (asset_done != NULL) { CloseHandle(asset_done); asset_done = NULL; }
+	if (asset_work != NULL) { CloseHandle(asset_work); asset_work = NULL; }
+	DeleteCriticalSection(&asset_cs);
+#endif
+
+	if (asset_idle != NULL) {
+		minipng_reader_close(&asset_idle_load.rdr);
+		asset_idle = NULL;
+	}
+
+	IFEAssetPrintStats();
+
+	for (i=0;i < IFEAssetMax;i++)
+		asset_free(&asset[i]);
+}
+
+void IFEAssetIdle(void) {
+	uint32_t t0;
+
+	if (asset_threaded)
+		return;
+
+	t0 = ifeapi->GetTicks();
+	do {
+		if (asset_idle == NULL) {
+			if ((asset_idle=asset_next_queued()) == NULL)
+				return;
+
+			asset_idle->state = ASSET_LOADING;
+			if (!png_begin(asset_idle_load,asset_idle->bmp,asset_idle->path)) {
+				asset_finish(asset_idle,false);
+				asset_idle = NULL;
+				continue;
+			}
+		}
+
+		if (png_rows(asset_idle_load,IFEAssetIdleRows)) {
+			asset_finish(asset_idle,true);
+			asset_idle = NULL;
+		}
+	} while ((ifeapi->GetTicks() - t0) < IFEAssetIdleMs);
+}
+
+void IFEAssetPrintStats(void) {
+	IFEDBG("Asset: %lu ready when asked for, %lu still decoding, %lu decoded on the spot, %lu not cached, %lu thrown out, %luKB cached",
+		asset_hits,asset_waits,asset_misses,asset_uncached,asset_evicted,asset_bytes >> 10ul);
+}
+
+bool IFEPreloadPNG(const char *path) {
+	IFEAsset *a;
+
+	asset_lock();
+	if ((a=asset_find(path)) == NULL) {
+		if ((a=asset_alloc(path)) == NULL) {
+			asset_unlock();
+			return false;
+		}
+
+		a->state = ASSET_QUEUED;
+		a->queued = ++asset_queue_tick;
+#if defined(USE_SDL2) || defined(USE_WIN32)
+		if (asset_threaded) asset_signal(asset_work);
+#endif
+	}
+	else if (a->state == ASSET_READY) {
+		a->last_used = ++asset_tick; /* wanted again soon, keep it */
+	}
+	asset_unlock();
+	return true;
+}
+
+bool IFEPNGReady(const char *path) {
+	IFEAsset *a;
+	bool r;
+
+	asset_lock();
+	a = asset_find(path);
+	r = (a != NULL && a->state == ASSET_READY);
+	asset_unlock();
+	return r;
+}
+
+/* cached bitmap for path. *full is set if it is not in the cache and there is no room to put it there,
+ * every entry being held or still queued or decoding */
+static IFEBitmap *asset_get(const char *path,bool *full) {
+	IFEAsset *a;
+	bool ok;
+
+	*full = false;
+
+	asset_lock();
+	if ((a=asset_find(path)) == NULL) {
+		if ((a=asset_alloc(path)) == NULL) {
+			asset_unlock();
+			*full = true;
+			return NULL;
+		}
+
+		a->state = ASSET_QUEUED;
+	}
+
+	if (a->state == ASSET_READY) {
+		asset_hits++;
+	}
+	else if (a->state == ASSET_QUEUED) {
+		/* do it now rather than wait behind the rest of the queue */
+		asset_misses++;
+		a->state = ASSET_LOADING;
+		asset_unlock();
+		ok = png_decode(a);
+		asset_lock();
+		asset_finish(a,ok);
+	}
+	else if (a == asset_idle) {
+		/* idle time got partway, finish it */
+		asset_waits++;
+		png_rows(asset_idle_load,~0u);
+		asset_finish(a,true);
+		asset_idle = NULL;
+	}
+	else {
+		asset_waits++;
+#if defined(USE_SDL2) || defined(USE_WIN32)
+		while (a->state == ASSET_LOADING)
+			asset_wait(asset_done);
+#endif
+	}
+
+	/* NTS: If the worker failed to load it, the entry was freed and may already be for something else */
+	if (a->state == ASSET_READY && a->path != NULL && !strcmp(a->path,path)) {
+		a->refs++;
+		a->last_used = ++asset_tick;
+		asset_unlock();
+		return &a->bmp;
+	}
+
+	asset_unlock();
+	return NULL;
+}
+
+IFEBitmap *IFEGetPNG(const char *path) {
+	IFEBitmap *r;
+	bool full;
+
+	if ((r=asset_get(path,&full)) == NULL && full)
+		IFEDBG("Asset: No room in cache for %s",path);
+
+	return r;
+}
+
+void IFEReleasePNG(IFEBitmap *bmp) {
+	unsigned int i;
+
+	asset_lock();
+	for (i=0;i < IFEAssetMax;i++) {
+		if (&asset[i].bmp == bmp) {
+			if (asset[i].refs > 0) asset[i].refs--;
+			break;
+		}
+	}
+	asset_trim(NULL);
+	asset_unlock();
+}
+
+/* load one PNG into ONE bitmap, that's it */
+bool IFELoadPNG(IFEBitmap &bmp,const char *path) {
+	IFEBitmap *c;
+	bool full;
+	bool r;
+
+	if ((c=asset_get(path,&full)) == NULL) {
+		if (!full)
+			return false;
+
+		/* too much preloaded or held to cache it, decode it straight into bmp instead */
+		IFEDBG("Asset: No room in cache for %s, loading it uncached",path);
+		asset_uncached++;
+		return png_load(bmp,path);
+	}
+
+	r = bmp.copy_from(*c);
+	IFEReleasePNG(c);
+	return r;
+}
+
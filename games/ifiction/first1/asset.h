@@ -0,0 +1,28 @@
+
+/* PNG asset cache and preloading.
+ *
+ * Decoded PNGs are kept in a cache keyed by path, up to IFEAssetMax bitmaps and a memory budget,
+ * least recently used first out. A bitmap a caller holds (IFEGetPNG without IFEReleasePNG) is
+ * never thrown out.
+ *
+ * IFEPreloadPNG() queues a PNG to decode ahead of time, so that code can ask for the next scene's
+ * images while the current one is running and have them on hand when it gets there. The SDL2 build
+ * decodes the queue in a worker thread. MS-DOS and Win32 (Open Watcom's Win32 runtime is not built
+ * multithreaded, and Win32s cannot create threads anyway) decode it a few rows at a time from
+ * IFEWaitEvent() and IFECheckEvent(). Asking for a PNG still in the queue decodes it (or finishes
+ * decoding it) right away. If the cache has no room, IFELoadPNG() decodes into the caller's bitmap
+ * without caching it. */
+
+#define IFEAssetMax			32
+
+bool IFEAssetInit(void);
+void IFEAssetShutdown(void);
+void IFEAssetIdle(void); /* MS-DOS: decode queued PNGs for a short while. called from IFEWaitEvent() and IFECheckEvent() */
+void IFEAssetPrintStats(void);
+
+bool IFEPreloadPNG(const char *path);
+bool IFEPNGReady(const char *path); /* decoded and in the cache */
+IFEBitmap *IFEGetPNG(const char *path); /* cached bitmap, NULL if it cannot be loaded. call IFEReleasePNG() when done */
+void IFEReleasePNG(IFEBitmap *bmp);
+bool IFELoadPNG(IFEBitmap &bmp,const char *path); /* copy of the cached bitmap into bmp, or decoded into bmp if the cache is full */
+
@@ -324,6 +324,44 @@ void IFEBitmap::reset_scissor_rect(void) {
 	scissor.h = height;
 }
 
+/* the storage is allocated for s.width, which may be less than s was allocated for (see IFELoadPNG),
+ * so the strides can differ. the mask offset depends only on the width and is the same. */
+bool IFEBitmap::copy_from(const IFEBitmap &s) {
+	unsigned int y,rowcopy;
+
+	if (!ctrl_storage || !ctrl_subrect || !ctrl_palette) return false;
+	if (s.bitmap_first_row == NULL || s.width == 0 || s.height == 0) return false;
+
+	if (!alloc_storage(s.width,s.height,s.image_type)) return false;
+
+	if (image_type == IMT_TRANSPARENT_MASK)
+		rowcopy = get_transparent_mask_offset() + width;
+	else
+		rowcopy = width;
+
+	for (y=0;y < height;y++)
+		memcpy(row(y),s.row(y),rowcopy);
+
+	if (s.subrects != NULL && s.subrects_alloc != 0) {
+		if (!alloc_subrects(s.subrects_alloc)) return false;
+		memcpy((void*)subrects,(const void*)s.subrects,sizeof(subrect) * s.subrects_alloc);
+	}
+	else {
+		free_subrects();
+	}
+
+	if (s.palette != NULL && s.palette_alloc != 0) {
+		if (!alloc_palette(s.palette_alloc)) return false;
+		memcpy((void*)palette,(const void*)s.palette,sizeof(IFEPaletteEntry) * s.palette_alloc);
+		palette_size = s.palette_size;
+	}
+	else {
+		free_palette();
+	}
+
+	return true;
+}
+
 /* screen bitmap, you cannot allocate/free palette, storage, subrects, or bias anything
  * because the screen driver manages it. */
 IFEScreenBitmap::IFEScreenBitmap(enum subclass_t _subclass) : IFEBitmap(_subclass) {
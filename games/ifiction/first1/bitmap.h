@@ -73,6 +73,7 @@ public:
 	virtual bool bias_subrect(subrect &s,uint8_t new_bias); /* bias (add to pixel values) for simple palette remapping */
 	void set_scissor_rect(int x1,int y1,int x2,int y2);
 	void reset_scissor_rect(void);
+	bool copy_from(const IFEBitmap &s); /* copy image, mask, subrects and palette of another bitmap */
 
 	inline unsigned int get_transparent_mask_offset(void) const { /* assume IMT_TRANSPARENT_MASK */
 		return (width + 3u) & (~3u); /* at width rounded up to DWORD boundary */
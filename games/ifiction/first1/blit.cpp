@@ -0,0 +1,374 @@
+
+#include <stdint.h>
+#include <string.h>
+
+#include "blit.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define IFE_BLIT_X86_SIMD
+# include <immintrin.h>
+#endif
+
+/* rows at least this wide go to the C library, which has its own tuned memcpy()/memset() */
+#define IFEBlitLibcMin			512u
+
+/* plain C, 32 bits at a time. this is also the tail end of the SIMD versions. */
+static inline void c_copy_tail(unsigned char *dst,const unsigned char *src,unsigned int w) {
+	while (w >= 4) {
+		*((uint32_t*)dst) = *((const uint32_t*)src);
+		dst += 4;
+		src += 4;
+		w -= 4;
+	}
+	while (w > 0) {
+		*dst++ = *src++;
+		w--;
+	}
+}
+
+static inline void c_and_tail(unsigned char *dst,const unsigned char *src,unsigned int w) {
+	while (w >= 4) {
+		*((uint32_t*)dst) &= *((const uint32_t*)src);
+		dst += 4;
+		src += 4;
+		w -= 4;
+	}
+	while (w > 0) {
+		*dst &= *src;
+		dst++;
+		src++;
+		w--;
+	}
+}
+
+/* NTS: A 32-bit add can carry from one pixel into the next, but not with masks as IFELoadPNG()
+ *      makes them: where the mask is 0xFF the source is 0x00, and where the mask is 0x00 the
+ *      destination is cleared. The SIMD versions add bytewise and give the same result. */
+static inline void c_mask_tail(unsigned char *dst,const unsigned char *src,const unsigned char *msk,unsigned int w) {
+	while (w >= 4) {
+		*((uint32_t*)dst) = (*((uint32_t*)dst) & *((const uint32_t*)msk)) + *((const uint32_t*)src);
+		dst += 4;
+		msk += 4;
+		src += 4;
+		w -= 4;
+	}
+	while (w > 0) {
+		*dst = (unsigned char)((*dst & *msk) + *src);
+		dst++;
+		msk++;
+		src++;
+		w--;
+	}
+}
+
+static inline void c_fill_tail(unsigned char *dst,const uint8_t c,unsigned int w) {
+	const uint32_t c4 = (uint32_t)c * 0x01010101ul;
+
+	while (w >= 4) {
+		*((uint32_t*)dst) = c4;
+		dst += 4;
+		w -= 4;
+	}
+	while (w > 0) {
+		*dst++ = c;
+		w--;
+	}
+}
+
+/* NTS: Font glyphs and mouse cursors are mostly 8, 16 or 32 pixels wide. Those widths get a call
+ *      of their own with the width a constant, which the compiler unrolls without a tail. */
+static void c_copy(unsigned char *dst,const unsigned char *src,unsigned int w) {
+	switch (w) {
+		case 8:		c_copy_tail(dst,src,8); break;
+		case 16:	c_copy_tail(dst,src,16); break;
+		case 32:	c_copy_tail(dst,src,32); break;
+		default:
+			if (w >= IFEBlitLibcMin)
+				memcpy(dst,src,w);
+			else
+				c_copy_tail(dst,src,w);
+			break;
+	}
+}
+
+static void c_mask(unsigned char *dst,const unsigned char *src,const unsigned char *msk,unsigned int w) {
+	switch (w) {
+		case 8:		c_mask_tail(dst,src,msk,8); break;
+		case 16:	c_mask_tail(dst,src,msk,16); break;
+		case 32:	c_mask_tail(dst,src,msk,32); break;
+		default:	c_mask_tail(dst,src,msk,w); break;
+	}
+}
+
+static void c_and(unsigned char *dst,const unsigned char *src,unsigned int w) {
+	switch (w) {
+		case 8:		c_and_tail(dst,src,8); break;
+		case 16:	c_and_tail(dst,src,16); break;
+		case 32:	c_and_tail(dst,src,32); break;
+		default:	c_and_tail(dst,src,w); break;
+	}
+}
+
+static void c_fill(unsigned char *dst,const uint8_t c,unsigned int w) {
+	switch (w) {
+		case 8:		c_fill_tail(dst,c,8); break;
+		case 16:	c_fill_tail(dst,c,16); break;
+		case 32:	c_fill_tail(dst,c,32); break;
+		default:
+			if (w >= IFEBlitLibcMin)
+				memset(dst,c,w);
+			else
+				c_fill_tail(dst,c,w);
+			break;
+	}
+}
+
+static bool c_supported(void) {
+	return true;
+}
+
+#if defined(IFE_BLIT_X86_SIMD)
+/* SSE2, 16 bytes at a time. 8 wide copies and fills are one 64-bit load/store, 16 and 32 wide have no loop. */
+__attribute__((target("sse2"),always_inline)) static inline void sse2_copy8(unsigned char *dst,const unsigned char *src) {
+	_mm_storel_epi64((__m128i*)dst,_mm_loadl_epi64((const __m128i*)src));
+}
+
+__attribute__((target("sse2"),always_inline)) static inline void sse2_copy16(unsigned char *dst,const unsigned char *src) {
+	_mm_storeu_si128((__m128i*)dst,_mm_loadu_si128((const __m128i*)src));
+}
+
+__attribute__((target("sse2"),always_inline)) static inline void sse2_mask16(unsigned char *dst,const unsigned char *src,const unsigned char *msk) {
+	const __m128i d = _mm_loadu_si128((const __m128i*)dst);
+	const __m128i m = _mm_loadu_si128((const __m128i*)msk);
+	const __m128i s = _mm_loadu_si128((const __m128i*)src);
+
+	_mm_storeu_si128((__m128i*)dst,_mm_add_epi8(_mm_and_si128(d,m),s));
+}
+
+__attribute__((target("sse2"),always_inline)) static inline void sse2_and16(unsigned char *dst,const unsigned char *src) {
+	const __m128i d = _mm_loadu_si128((const __m128i*)dst);
+
+	_mm_storeu_si128((__m128i*)dst,_mm_and_si128(d,_mm_loadu_si128((const __m128i*)src)));
+}
+
+__attribute__((target("sse2"))) static void sse2_copy(unsigned char *dst,const unsigned char *src,unsigned int w) {
+	switch (w) {
+		case 8:		sse2_copy8(dst,src); return;
+		case 16:	sse2_copy16(dst,src); return;
+		case 32:	sse2_copy16(dst,src); sse2_copy16(dst+16,src+16); return;
+	}
+	if (w >= IFEBlitLibcMin) {
+		memcpy(dst,src,w);
+		return;
+	}
+	while (w >= 16) {
+		sse2_copy16(dst,src);
+		dst += 16;
+		src += 16;
+		w -= 16;
+	}
+	c_copy_tail(dst,src,w);
+}
+
+__attribute__((target("sse2"))) static void sse2_mask(unsigned char *dst,const unsigned char *src,const unsigned char *msk,unsigned int w) {
+	switch (w) {
+		case 8:		c_mask_tail(dst,src,msk,8); return;
+		case 16:	sse2_mask16(dst,src,msk); return;
+		case 32:	sse2_mask16(dst,src,msk); sse2_mask16(dst+16,src+16,msk+16); return;
+	}
+	while (w >= 16) {
+		sse2_mask16(dst,src,msk);
+		dst += 16;
+		msk += 16;
+		src += 16;
+		w -= 16;
+	}
+	c_mask_tail(dst,src,msk,w);
+}
+
+__attribute__((target("sse2"))) static void sse2_and(unsigned char *dst,const unsigned char *src,unsigned int w) {
+	switch (w) {
+		case 8:		c_and_tail(dst,src,8); return;
+		case 16:	sse2_and16(dst,src); return;
+		case 32:	sse2_and16(dst,src); sse2_and16(dst+16,src+16); return;
+	}
+	while (w >= 16) {
+		sse2_and16(dst,src);
+		dst += 16;
+		src += 16;
+		w -= 16;
+	}
+	c_and_tail(dst,src,w);
+}
+
+__attribute__((target("sse2"))) static void sse2_fill(unsigned char *dst,const uint8_t c,unsigned int w) {
+	/* NTS: _mm_set1_epi8() builds the vector a byte at a time unless the optimizer is on, which costs more than
+	 *      filling a glyph. Spread the byte with a multiply and a shuffle instead. */
+	const __m128i c16 = _mm_shuffle_epi32(_mm_cvtsi32_si128((int)((uint32_t)c * 0x01010101ul)),0);
+
+	switch (w) {
+		case 8:		_mm_storel_epi64((__m128i*)dst,c16); return;
+		case 16:	_mm_storeu_si128((__m128i*)dst,c16); return;
+		case 32:	_mm_storeu_si128((__m128i*)dst,c16); _mm_storeu_si128((__m128i*)(dst+16),c16); return;
+	}
+	if (w >= IFEBlitLibcMin) {
+		memset(dst,c,w);
+		return;
+	}
+	while (w >= 16) {
+		_mm_storeu_si128((__m128i*)dst,c16);
+		dst += 16;
+		w -= 16;
+	}
+	c_fill_tail(dst,c,w);
+}
+
+static bool sse2_supported(void) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+}
+
+/* AVX2, 32 bytes at a time, the rest 16 bytes at a time. 8 and 16 wide are the same as SSE2. */
+__attribute__((target("avx2"))) static void avx2_copy(unsigned char *dst,const unsigned char *src,unsigned int w) {
+	switch (w) {
+		case 8:		sse2_copy8(dst,src); return;
+		case 16:	sse2_copy16(dst,src); return;
+	}
+	if (w >= IFEBlitLibcMin) {
+		memcpy(dst,src,w);
+		return;
+	}
+	while (w >= 32) {
+		_mm256_storeu_si256((__m256i*)dst,_mm256_loadu_si256((const __m256i*)src));
+		dst += 32;
+		src += 32;
+		w -= 32;
+	}
+	if (w >= 16) {
+		_mm_storeu_si128((__m128i*)dst,_mm_loadu_si128((const __m128i*)src));
+		dst += 16;
+		src += 16;
+		w -= 16;
+	}
+	c_copy_tail(dst,src,w);
+}
+
+__attribute__((target("avx2"))) static void avx2_mask(unsigned char *dst,const unsigned char *src,const unsigned char *msk,unsigned int w) {
+	switch (w) {
+		case 8:		c_mask_tail(dst,src,msk,8); return;
+		case 16:	sse2_mask16(dst,src,msk); return;
+	}
+	while (w >= 32) {
+		const __m256i d = _mm256_loadu_si256((const __m256i*)dst);
+		const __m256i m = _mm256_loadu_si256((const __m256i*)msk);
+		const __m256i s = _mm256_loadu_si256((const __m256i*)src);
+
+		_mm256_storeu_si256((__m256i*)dst,_mm256_add_epi8(_mm256_and_si256(d,m),s));
+		dst += 32;
+		msk += 32;
+		src += 32;
+		w -= 32;
+	}
+	if (w >= 16) {
+		const __m128i d = _mm_loadu_si128((const __m128i*)dst);
+		const __m128i m = _mm_loadu_si128((const __m128i*)msk);
+		const __m128i s = _mm_loadu_si128((const __m128i*)src);
+
+		_mm_storeu_si128((__m128i*)dst,_mm_add_epi8(_mm_and_si128(d,m),s));
+		dst += 16;
+		msk += 16;
+		src += 16;
+		w -= 16;
+	}
+	c_mask_tail(dst,src,msk,w);
+}
+
+__attribute__((target("avx2"))) static void avx2_and(unsigned char *dst,const unsigned char *src,unsigned int w) {
+	switch (w) {
+		case 8:		c_and_tail(dst,src,8); return;
+		case 16:	sse2_and16(dst,src); return;
+	}
+	while (w >= 32) {
+		const __m256i d = _mm256_loadu_si256((const __m256i*)dst);
+
+		_mm256_storeu_si256((__m256i*)dst,_mm256_and_si256(d,_mm256_loadu_si256((const __m256i*)src)));
+		dst += 32;
+		src += 32;
+		w -= 32;
+	}
+	if (w >= 16) {
+		const __m128i d = _mm_loadu_si128((const __m128i*)dst);
+
+		_mm_storeu_si128((__m128i*)dst,_mm_and_si128(d,_mm_loadu_si128((const __m128i*)src)));
+		dst += 16;
+		src += 16;
+		w -= 16;
+	}
+	c_and_tail(dst,src,w);
+}
+
+__attribute__((target("avx2"))) static void avx2_fill(unsigned char *dst,const uint8_t c,unsigned int w) {
+	const __m256i c32 = _mm256_broadcastd_epi32(_mm_cvtsi32_si128((int)((uint32_t)c * 0x01010101ul)));
+
+	switch (w) {
+		case 8:		_mm_storel_epi64((__m128i*)dst,_mm256_castsi256_si128(c32)); return;
+		case 16:	_mm_storeu_si128((__m128i*)dst,_mm256_castsi256_si128(c32)); return;
+		case 32:	_mm256_storeu_si256((__m256i*)dst,c32); return;
+	}
+	if (w >= IFEBlitLibcMin) {
+		memset(dst,c,w);
+		return;
+	}
+	while (w >= 32) {
+		_mm256_storeu_si256((__m256i*)dst,c32);
+		dst += 32;
+		w -= 32;
+	}
+	if (w >= 16) {
+		_mm_storeu_si128((__m128i*)dst,_mm256_castsi256_si128(c32));
+		dst += 16;
+		w -= 16;
+	}
+	c_fill_tail(dst,c,w);
+}
+
+static bool avx2_supported(void) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+const IFEBlitFuncs IFEblit_impl[] = {
+	{ "c",		c_copy,		c_mask,		c_and,		c_fill,		c_supported },
+#if defined(IFE_BLIT_X86_SIMD)
+	{ "sse2",	sse2_copy,	sse2_mask,	sse2_and,	sse2_fill,	sse2_supported },
+	{ "avx2",	avx2_copy,	avx2_mask,	avx2_and,	avx2_fill,	avx2_supported },
+#endif
+	{ NULL,		NULL,		NULL,		NULL,		NULL,		NULL }
+};
+
+IFEBlitFuncs IFEblit = { "c", c_copy, c_mask, c_and, c_fill, c_supported };
+
+/* the last one the CPU supports is the fastest */
+void IFEBlitInit(void) {
+	size_t i;
+
+	for (i=0;IFEblit_impl[i].name != NULL;i++) {
+		if (IFEblit_impl[i].supported())
+			IFEblit = IFEblit_impl[i];
+	}
+}
+
+bool IFEBlitSelect(const char *name) {
+	size_t i;
+
+	for (i=0;IFEblit_impl[i].name != NULL;i++) {
+		if (!strcmp(IFEblit_impl[i].name,name) && IFEblit_impl[i].supported()) {
+			IFEblit = IFEblit_impl[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
@@ -0,0 +1,30 @@
+
+/* row kernels for IFEBitBlt(), IFETBitBlt(), IFEFillRect() and IFETFillRect().
+ *
+ * IFEBlitInit() picks the fastest set the CPU can run, once at startup. The plain C set works
+ * 32 bits at a time and is what the DOS and Windows builds (Open Watcom, 386 or higher) use.
+ * GCC builds for x86 also have SSE2 and AVX2 sets. Every set gives the same result.
+ *
+ * Transparency: mask 0xFF where transparent (and the pixel 0x00), 0x00 where opaque,
+ * so that a pixel is drawn as (dst AND msk) + src. */
+
+typedef void IFEBlitCopy_t(unsigned char *dst,const unsigned char *src,unsigned int w);
+typedef void IFEBlitMask_t(unsigned char *dst,const unsigned char *src,const unsigned char *msk,unsigned int w);
+typedef void IFEBlitAnd_t(unsigned char *dst,const unsigned char *src,unsigned int w);
+typedef void IFEBlitFill_t(unsigned char *dst,const uint8_t c,unsigned int w);
+
+struct IFEBlitFuncs {
+	const char*			name;
+	IFEBlitCopy_t*			copy;		/* dst = src */
+	IFEBlitMask_t*			mask;		/* dst = (dst AND msk) + src */
+	IFEBlitAnd_t*			and_;		/* dst = dst AND src (combine masks) */
+	IFEBlitFill_t*			fill;		/* dst = c */
+	bool				(*supported)(void);
+};
+
+extern IFEBlitFuncs			IFEblit;
+extern const IFEBlitFuncs		IFEblit_impl[];	/* slowest first, terminated by name == NULL */
+
+void IFEBlitInit(void);
+bool IFEBlitSelect(const char *name);
+
@@ -0,0 +1,277 @@
+
+/* blit microbenchmark (Linux host).
+ *
+ *   blitbnch [file.png ...]
+ *
+ * Loads each PNG the way IFELoadPNG() does (color 0 where transparent, mask 0xFF) and blits it
+ * all over a 640x480 screen, opaque and transparent, and fills rectangles of the same size, with
+ * every row kernel set the CPU supports. The result of every set is checked against the plain C
+ * set. With no arguments, uses the PNGs that come with the game. Then does the same with glyph
+ * and cursor sized images 8, 16 and 32 pixels wide, which have row kernels of their own. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "ifict.h"
+
+extern "C" {
+#include <fmt/minipng/minipng.h>
+}
+
+struct bbimage {
+	const char*		path;
+	unsigned char*		pix;
+	unsigned char*		msk;		/* NULL if opaque */
+	unsigned int		w,h;
+};
+
+#define SCR_W			640
+#define SCR_H			480
+
+static unsigned char		scr[SCR_W*SCR_H];
+static unsigned char		ref[SCR_W*SCR_H];
+static unsigned int		failures = 0;
+
+static bool load_png(bbimage &im,const char *path) {
+	struct minipng_reader *rdr = NULL;
+	unsigned int alloc_w,i,x;
+	bool transparency = false;
+
+	memset(&im,0,sizeof(im));
+	im.path = path;
+
+	if ((rdr=minipng_reader_open(path)) == NULL)
+		return false;
+	if (minipng_reader_parse_head(rdr) || rdr->ihdr.color_type != 3 || rdr->ihdr.width > SCR_W || rdr->ihdr.height > SCR_H ||
+		!(rdr->ihdr.bit_depth == 1 || rdr->ihdr.bit_depth == 4 || rdr->ihdr.bit_depth == 8)) {
+		minipng_reader_close(&rdr);
+		return false;
+	}
+
+	for (i=0;rdr->trns != NULL && i < rdr->trns_size;i++) {
+		if (!(rdr->trns[i] & 0x80)) transparency = true;
+	}
+
+	im.w = rdr->ihdr.width;
+	im.h = rdr->ihdr.height;
+	alloc_w = (im.w + 7u) & (~7u);
+	im.pix = (unsigned char*)malloc(alloc_w * im.h);
+	if (minipng_decode_to_buffer(rdr,im.pix,alloc_w)) {
+		minipng_reader_close(&rdr);
+		return false;
+	}
+
+	for (i=0;i < im.h;i++) {
+		if (rdr->ihdr.bit_depth == 4)
+			minipng_expand4to8(im.pix + (i * alloc_w),im.w);
+		else if (rdr->ihdr.bit_depth == 1)
+			minipng_expand1to8(im.pix + (i * alloc_w),im.w);
+	}
+
+	/* pack the rows at im.w apart */
+	for (i=1;i < im.h;i++)
+		memmove(im.pix + (i * im.w),im.pix + (i * alloc_w),im.w);
+
+	if (transparency) {
+		im.msk = (unsigned char*)malloc(im.w * im.h);
+		for (i=0;i < (im.w * im.h);i++) {
+			x = im.pix[i];
+			if (x < rdr->trns_size && !(rdr->trns[x] & 0x80)) {
+				im.msk[i] = 0xFF;
+				im.pix[i] = 0x00;
+			}
+			else {
+				im.msk[i] = 0x00;
+			}
+		}
+	}
+
+	minipng_reader_close(&rdr);
+	return true;
+}
+
+/* w x h of noise, about a third of it transparent */
+static void make_glyph(bbimage &im,unsigned int w,unsigned int h) {
+	static char name[32];
+	unsigned int i;
+
+	sprintf(name,"glyph %ux%u",w,h);
+	im.path = name;
+	im.w = w;
+	im.h = h;
+	im.pix = (unsigned char*)malloc(w * h);
+	im.msk = (unsigned char*)malloc(w * h);
+	for (i=0;i < (w * h);i++) {
+		if ((rand() % 3) == 0) {
+			im.msk[i] = 0xFF;
+			im.pix[i] = 0x00;
+		}
+		else {
+			im.msk[i] = 0x00;
+			im.pix[i] = (unsigned char)rand();
+		}
+	}
+}
+
+/* the same row loops as IFEBitBlt(), IFETBitBlt() and IFEFillRect() */
+static void blit(const bbimage &im,unsigned int dx,unsigned int dy) {
+	unsigned char *dst = scr + (dy * SCR_W) + dx;
+	const unsigned char *src = im.pix;
+	unsigned int w = im.w,h = im.h;
+
+	if (w == SCR_W) {
+		w *= h;
+		h = 1;
+	}
+
+	while (h > 0) {
+		IFEblit.copy(dst,src,w);
+		dst += SCR_W;
+		src += im.w;
+		h--;
+	}
+}
+
+static void tblit(const bbimage &im,unsigned int dx,unsigned int dy) {
+	unsigned char *dst = scr + (dy * SCR_W) + dx;
+	const unsigned char *src = im.pix;
+	const unsigned char *msk = im.msk;
+	unsigned int h = im.h;
+
+	while (h > 0) {
+		IFEblit.mask(dst,src,msk,im.w);
+		dst += SCR_W;
+		src += im.w;
+		msk += im.w;
+		h--;
+	}
+}
+
+static void fill(const bbimage &im,unsigned int dx,unsigned int dy,uint8_t c) {
+	unsigned char *dst = scr + (dy * SCR_W) + dx;
+	unsigned int w = im.w,h = im.h;
+
+	if (w == SCR_W) {
+		w *= h;
+		h = 1;
+	}
+
+	while (h > 0) {
+		IFEblit.fill(dst,c,w);
+		dst += SCR_W;
+		h--;
+	}
+}
+
+/* positions step by odd amounts so that every alignment comes up */
+static unsigned int run(const bbimage &im,const char op,const unsigned int count) {
+	const unsigned int xr = SCR_W - im.w + 1,yr = SCR_H - im.h + 1;
+	unsigned int i,x = 0,y = 0;
+
+	for (i=0;i < count;i++) {
+		if (op == 'c')
+			blit(im,x,y);
+		else if (op == 't')
+			tblit(im,x,y);
+		else
+			fill(im,x,y,(uint8_t)i);
+
+		x = (x + 37u) % xr;
+		y = (y + 23u) % yr;
+	}
+
+	return count;
+}
+
+static void bench(const bbimage &im,const char op,const char *what) {
+	const unsigned long pixels_per = (unsigned long)im.w * im.h;
+	unsigned int count = (unsigned int)(4000000ul / pixels_per) + 16u;
+	double c_rate = 0;
+	clock_t t;
+	size_t i;
+
+	printf("  %-6s",what);
+	for (i=0;IFEblit_impl[i].name != NULL;i++) {
+		if (!IFEblit_impl[i].supported()) continue;
+
+		/* check against the C set */
+		memset(scr,0x5A,sizeof(scr));
+		IFEBlitSelect("c");
+		run(im,op,64);
+		memcpy(ref,scr,sizeof(scr));
+
+		memset(scr,0x5A,sizeof(scr));
+		IFEBlitSelect(IFEblit_impl[i].name);
+		run(im,op,64);
+		if (memcmp(ref,scr,sizeof(scr))) {
+			printf(" %s MISMATCH",IFEblit_impl[i].name);
+			failures++;
+			continue;
+		}
+
+		/* at least 0.2 seconds worth */
+		do {
+			t = clock();
+			run(im,op,count);
+			t = clock() - t;
+			if (t < (CLOCKS_PER_SEC / 5)) count *= 2u;
+		} while (t < (CLOCKS_PER_SEC / 5));
+
+		{
+			const double rate = ((double)pixels_per * count) / ((double)t / CLOCKS_PER_SEC) / 1000000.0;
+
+			if (c_rate == 0) c_rate = rate;
+			printf("  %s %8.1f Mpix/s (x%.2f)",IFEblit_impl[i].name,rate,rate / c_rate);
+		}
+	}
+	printf("\n");
+}
+
+int main(int argc,char **argv) {
+	static const char *def_png[] = { "test1.png", "woo1.png", "st_arrow.png", "ariarsm.png", "ariarlg.png", NULL };
+	static const unsigned int glyph_w[] = { 8, 16, 32, 0 };
+	bbimage im;
+	int i;
+
+	IFEBlitInit();
+	printf("Startup selects: %s\n",IFEblit.name);
+
+	for (i=1;i < argc || (argc <= 1 && def_png[i-1] != NULL);i++) {
+		const char *path = (argc > 1) ? argv[i] : def_png[i-1];
+
+		if (!load_png(im,path)) {
+			fprintf(stderr,"Cannot load %s\n",path);
+			failures++;
+			continue;
+		}
+
+		printf("%s: %ux%u%s\n",path,im.w,im.h,im.msk != NULL ? ", transparent" : "");
+		bench(im,'c',"copy");
+		if (im.msk != NULL) bench(im,'t',"mask");
+		bench(im,'f',"fill");
+
+		free(im.pix);
+		if (im.msk) free(im.msk);
+	}
+
+	for (i=0;glyph_w[i] != 0;i++) {
+		make_glyph(im,glyph_w[i],16);
+		printf("%s:\n",im.path);
+		bench(im,'c',"copy");
+		bench(im,'t',"mask");
+		bench(im,'f',"fill");
+		free(im.pix);
+		free(im.msk);
+	}
+
+	if (failures != 0) {
+		printf("%u failures\n",failures);
+		return 1;
+	}
+
+	return 0;
+}
+
@@ -38,8 +38,8 @@ lib: .symbolic
 exe: $(IFICT_EXE) .symbolic
 
 !ifdef IFICT_EXE
-$(IFICT_EXE): $(FMT_MINIPNG_LIB) $(FMT_MINIPNG_LIB_DEPENDENCIES) $(HW_DOSBOXID_LIB) $(HW_DOSBOXID_LIB_DEPENDENCIES) $(HW_8251_LIB) $(HW_8251_LIB_DEPENDENCIES) $(HW_8042_LIB) $(HW_8042_LIB_DEPENDENCIES) $(HW_CPU_LIB) $(HW_CPU_LIB_DEPENDENCIES) $(HW_DOS_LIB) $(HW_DOS_LIB_DEPENDENCIES) $(HW_VGA_LIB) $(HW_VGA_LIB_DEPENDENCIES) $(HW_VESA_LIB) $(HW_VESA_LIB_DEPENDENCIES) $(HW_8254_LIB) $(HW_8254_LIB_DEPENDENCIES) $(HW_8259_LIB) $(HW_8259_LIB_DEPENDENCIES) $(FMT_MINIPNG_LIB) $(FMT_MINIPNG_LIB_DEPENDENCIES) $(COMMON_LIB) $(SUBDIR)$(HPS)ifict.obj $(SUBDIR)$(HPS)utils.obj $(SUBDIR)$(HPS)debug.obj $(SUBDIR)$(HPS)palette.obj $(SUBDIR)$(HPS)fatal.obj $(SUBDIR)$(HPS)t_sdl2.obj $(SUBDIR)$(HPS)t_win32.obj $(SUBDIR)$(HPS)t_doslib.obj $(SUBDIR)$(HPS)keyboard.obj $(SUBDIR)$(HPS)mouse.obj $(SUBDIR)$(HPS)bitmap.obj
-	%write tmp.cmd option quiet option map=$(IFICT_EXE).map system $(WLINK_SYSTEM) $(FMT_MINIPNG_LIB_WLINK_LIBRARIES) $(HW_8251_LIB_WLINK_LIBRARIES) $(HW_DOSBOXID_LIB_WLINK_LIBRARIES) $(HW_8042_LIB_WLINK_LIBRARIES) $(HW_CPU_LIB_WLINK_LIBRARIES) $(HW_DOS_LIB_WLINK_LIBRARIES) $(HW_VGA_LIB_WLINK_LIBRARIES) $(HW_VESA_LIB_WLINK_LIBRARIES) $(HW_8254_LIB_WLINK_LIBRARIES) $(HW_8259_LIB_WLINK_LIBRARIES) $(FMT_MINIPNG_LIB_WLINK_LIBRARIES) file $(SUBDIR)$(HPS)ifict.obj file $(SUBDIR)$(HPS)utils.obj file $(SUBDIR)$(HPS)debug.obj file $(SUBDIR)$(HPS)palette.obj file $(SUBDIR)$(HPS)fatal.obj file $(SUBDIR)$(HPS)t_sdl2.obj file $(SUBDIR)$(HPS)t_win32.obj file $(SUBDIR)$(HPS)t_doslib.obj file $(SUBDIR)$(HPS)keyboard.obj file $(SUBDIR)$(HPS)mouse.obj file $(SUBDIR)$(HPS)bitmap.obj
+$(IFICT_EXE): $(FMT_MINIPNG_LIB) $(FMT_MINIPNG_LIB_DEPENDENCIES) $(HW_DOSBOXID_LIB) $(HW_DOSBOXID_LIB_DEPENDENCIES) $(HW_8251_LIB) $(HW_8251_LIB_DEPENDENCIES) $(HW_8042_LIB) $(HW_8042_LIB_DEPENDENCIES) $(HW_CPU_LIB) $(HW_CPU_LIB_DEPENDENCIES) $(HW_DOS_LIB) $(HW_DOS_LIB_DEPENDENCIES) $(HW_VGA_LIB) $(HW_VGA_LIB_DEPENDENCIES) $(HW_VESA_LIB) $(HW_VESA_LIB_DEPENDENCIES) $(HW_8254_LIB) $(HW_8254_LIB_DEPENDENCIES) $(HW_8259_LIB) $(HW_8259_LIB_DEPENDENCIES) $(FMT_MINIPNG_LIB) $(FMT_MINIPNG_LIB_DEPENDENCIES) $(COMMON_LIB) $(SUBDIR)$(HPS)ifict.obj $(SUBDIR)$(HPS)utils.obj $(SUBDIR)$(HPS)debug.obj $(SUBDIR)$(HPS)palette.obj $(SUBDIR)$(HPS)fatal.obj $(SUBDIR)$(HPS)t_sdl2.obj $(SUBDIR)$(HPS)t_win32.obj $(SUBDIR)$(HPS)t_doslib.obj $(SUBDIR)$(HPS)keyboard.obj $(SUBDIR)$(HPS)mouse.obj $(SUBDIR)$(HPS)bitmap.obj $(SUBDIR)$(HPS)updrgn.obj $(SUBDIR)$(HPS)blit.obj $(SUBDIR)$(HPS)asset.obj
+	%write tmp.cmd option quiet option map=$(IFICT_EXE).map system $(WLINK_SYSTEM) $(FMT_MINIPNG_LIB_WLINK_LIBRARIES) $(HW_8251_LIB_WLINK_LIBRARIES) $(HW_DOSBOXID_LIB_WLINK_LIBRARIES) $(HW_8042_LIB_WLINK_LIBRARIES) $(HW_CPU_LIB_WLINK_LIBRARIES) $(HW_DOS_LIB_WLINK_LIBRARIES) $(HW_VGA_LIB_WLINK_LIBRARIES) $(HW_VESA_LIB_WLINK_LIBRARIES) $(HW_8254_LIB_WLINK_LIBRARIES) $(HW_8259_LIB_WLINK_LIBRARIES) $(FMT_MINIPNG_LIB_WLINK_LIBRARIES) file $(SUBDIR)$(HPS)ifict.obj file $(SUBDIR)$(HPS)utils.obj file $(SUBDIR)$(HPS)debug.obj file $(SUBDIR)$(HPS)palette.obj file $(SUBDIR)$(HPS)fatal.obj file $(SUBDIR)$(HPS)t_sdl2.obj file $(SUBDIR)$(HPS)t_win32.obj file $(SUBDIR)$(HPS)t_doslib.obj file $(SUBDIR)$(HPS)keyboard.obj file $(SUBDIR)$(HPS)mouse.obj file $(SUBDIR)$(HPS)bitmap.obj file $(SUBDIR)$(HPS)updrgn.obj file $(SUBDIR)$(HPS)blit.obj file $(SUBDIR)$(HPS)asset.obj
 	%write tmp.cmd name $(IFICT_EXE)
 	@wlink @tmp.cmd
 ! ifdef TARGET_WINDOWS
@@ -4,7 +4,6 @@
 #endif
 
 #include <stdio.h>
-#include <assert.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -17,20 +16,6 @@
 #include "bitmap.h"
 #include "palette.h"
 
-#if defined(TARGET_MSDOS)
-#include <ext/zlib/zlib.h>
-#else
-#include <zlib.h>
-#endif
-
-#ifndef O_BINARY
-#define O_BINARY (0)
-#endif
-
-extern "C" {
-#include <fmt/minipng/minipng.h>
-}
-
 ifeapi_t *ifeapi = &ifeapi_default;
 
 IFEBitmap* IFEscrbmp = NULL;
@@ -76,157 +61,6 @@ IFEcursor_state_t	priv_IFEcursor;
 
 void IFESetCursor(IFEBitmap* new_cursor,size_t sr=0);
 
-/* load one PNG into ONE bitmap, that's it */
-bool IFELoadPNG(IFEBitmap &bmp,const char *path) {
-	bool res = false,transparency = false;
-	struct minipng_reader *rdr = NULL;
-	unsigned int alloc_w;
-	unsigned int i;
-
-	if ((rdr=minipng_reader_open(path)) == NULL)
-		goto done;
-	if (minipng_reader_parse_head(rdr))
-		goto done;
-	if (rdr->ihdr.width > 2048 || rdr->ihdr.width < 1 || rdr->ihdr.height > 2048 || rdr->ihdr.height < 1)
-		goto done;
-	if (rdr->ihdr.color_type != 3) /* PNG_COLOR_TYPE_PALETTE = PNG_COLOR_MASK_COLOR | PNG_COLOR_MASK_PALETTE */
-		goto done;
-
-	if (rdr->trns != NULL && rdr->trns_size != 0) {
-		for (i=0;i < rdr->trns_size;i++) {
-			if (!(rdr->trns[i] & 0x80)) {
-				transparency = true;
-			}
-		}
-	}
-
-	switch (rdr->ihdr.bit_depth) {
-		case 8:
-			alloc_w = rdr->ihdr.width;
-			break;
-		case 4:
-			alloc_w = (rdr->ihdr.width + 1u) & (~1u); /* round up to multiple of 2 */
-			break;
-		case 1:
-			alloc_w = (rdr->ihdr.width + 7u) & (~7u); /* round up to multiple of 8 */
-			break;
-		default:
-			goto done;
-	};
-
-	/* transparency is accomplished by allocating twice the width,
-	 * making the right hand side the mask and the left hand the image */
-
-	if (!bmp.alloc_subrects(1))
-		goto done;
-	if (!bmp.alloc_storage(alloc_w, rdr->ihdr.height, transparency ? IFEBitmap::IMT_TRANSPARENT_MASK : IFEBitmap::IMT_OPAQUE))
-		goto done;
-
-	/* reset bitmap width to what we intended */
-	if (bmp.width < rdr->ihdr.width)
-		goto done;
-
-	bmp.width = rdr->ihdr.width;
-	bmp.reset_scissor_rect();
-
-	if (rdr->ihdr.bit_depth >= 1 && rdr->ihdr.bit_depth <= 8) {
-		if (rdr->plte == NULL)
-			goto done;
-		if (!bmp.alloc_palette(1u << rdr->ihdr.bit_depth))
-			goto done;
-
-		i=0;
-		while (i < bmp.palette_alloc && i < rdr->plte_count) {
-			bmp.palette[i].r = rdr->plte[i].red;
-			bmp.palette[i].g = rdr->plte[i].green;
-			bmp.palette[i].b = rdr->plte[i].blue;
-			i++;
-		}
-		while (i < bmp.palette_alloc) {
-			bmp.palette[i].r = 0;
-			bmp.palette[i].g = 0;
-			bmp.palette[i].b = 0;
-			i++;
-		}
-
-		bmp.palette_size = rdr->plte_count;
-	}
-	else {
-		bmp.free_palette();
-	}
-
-	{
-		IFEBitmap::subrect &sr = bmp.get_subrect(0);
-		sr.reset();
-		sr.r.w = rdr->ihdr.width;
-		sr.r.h = rdr->ihdr.height;
-		sr.r.x = 0;
-		sr.r.y = 0;
-
-		if (rdr->ihdr.bit_depth == 8) {
-			unsigned char *ptr = bmp.bitmap;
-
-			for (i=0;i < bmp.height;i++) {
-				minipng_reader_read_idat(rdr,ptr,1); /* pad byte */
-				minipng_reader_read_idat(rdr,ptr,rdr->ihdr.width); /* row */
-				ptr += bmp.stride;
-			}
-		}
-		else if (rdr->ihdr.bit_depth == 4) {
-			unsigned char *ptr = bmp.bitmap;
-
-			for (i=0;i < bmp.height;i++) {
-				minipng_reader_read_idat(rdr,ptr,1); /* pad byte */
-				minipng_reader_read_idat(rdr,ptr,(rdr->ihdr.width+1u)/2u); /* row */
-				minipng_expand4to8(ptr,rdr->ihdr.width);
-				ptr += bmp.stride;
-			}
-		}
-		else if (rdr->ihdr.bit_depth == 1) {
-			unsigned char *ptr = bmp.bitmap;
-
-			for (i=0;i < bmp.height;i++) {
-				minipng_reader_read_idat(rdr,ptr,1); /* pad byte */
-				minipng_reader_read_idat(rdr,ptr,(rdr->ihdr.width+7u)/8u); /* row */
-				minipng_expand1to8(ptr,rdr->ihdr.width);
-				ptr += bmp.stride;
-			}
-		}
-		else {
-			memset(bmp.bitmap,0,bmp.stride * bmp.height);
-		}
-
-		if (transparency) {
-			/* NTS: Remember the bitmap allocated is twice the width of the PNG, mask starts on right hand side */
-			unsigned int x;
-			unsigned char *ptr = bmp.bitmap;
-			unsigned char *msk = ptr + bmp.get_transparent_mask_offset();
-
-			assert((bmp.get_transparent_mask_offset() + bmp.width) <= abs(bmp.stride));
-
-			for (i=0;i < bmp.height;i++) {
-				for (x=0;x < rdr->ihdr.width;x++) {
-					if (ptr[x] < rdr->trns_size && !(rdr->trns[ptr[x]] & 0x80)) {
-						msk[x] = 0xFF; /* transparent ((dst AND msk) + src) == dst */
-						ptr[x] = 0x00; /* for this to work, make sure src == 0 */
-					}
-					else {
-						msk[x] = 0x00; /* opaque ((dst AND msk) + src) == src */
-					}
-				}
-				ptr += bmp.stride;
-				msk += bmp.stride;
-			}
-		}
-
-		res = true;
-	}
-
-done:
-        minipng_reader_close(&rdr);
-	return res;
-}
-
 void IFEAddScreenUpdate(int x1,int y1,int x2,int y2) {
 	if (x1 < IFEscrbmp->scissor.x)
 		x1 = IFEscrbmp->scissor.x;
@@ -425,8 +259,8 @@ void IFEFillRect(IFEBitmap &dbmp,int x1,int y1,int x2,int y2,const uint8_t color
 					unsigned char *msk = row + dbmp.get_transparent_mask_offset();
 
 					do {
-						memset(row,color,(unsigned int)dw);
-						memset(msk,0x00,(unsigned int)dw);
+						IFEblit.fill(row,color,(unsigned int)dw);
+						IFEblit.fill(msk,0x00,(unsigned int)dw);
 						row += dbmp.stride;
 						msk += dbmp.stride;
 					} while ((--dh) > 0);
@@ -436,8 +270,14 @@ void IFEFillRect(IFEBitmap &dbmp,int x1,int y1,int x2,int y2,const uint8_t color
 				{
 					unsigned char *row = dbmp.row(y1) + x1;
 
+					/* full width rows are one run of memory, fill them in one go */
+					if (dbmp.stride == dw) {
+						dw *= dh;
+						dh = 1;
+					}
+
 					do {
-						memset(row,color,(unsigned int)dw);
+						IFEblit.fill(row,color,(unsigned int)dw);
 						row += dbmp.stride;
 					} while ((--dh) > 0);
 				}
@@ -468,8 +308,8 @@ void IFETFillRect(IFEBitmap &dbmp,int x1,int y1,int x2,int y2) {
 					unsigned char *msk = row + dbmp.get_transparent_mask_offset();
 
 					do {
-						memset(row,0x00,(unsigned int)dw);
-						memset(msk,0xFF,(unsigned int)dw);
+						IFEblit.fill(row,0x00,(unsigned int)dw);
+						IFEblit.fill(msk,0xFF,(unsigned int)dw);
 						row += dbmp.stride;
 						msk += dbmp.stride;
 					} while ((--dh) > 0);
@@ -522,10 +362,10 @@ void IFEBitBlt(IFEBitmap &dbmp,int dx,int dy,int w,int h,int sx,int sy,IFEBitmap
 						unsigned char *dms = dst + dbmp.get_transparent_mask_offset();
 
 						while (h > 0) {
-							memcpy(dst,src,w);
+							IFEblit.copy(dst,src,(unsigned int)w);
 							dst += dbmp.stride; /* NTS: stride is negative if Windows 3.1 */
 							src += sbmp.stride;
-							memcpy(dms,sms,w);
+							IFEblit.copy(dms,sms,(unsigned int)w);
 							dms += dbmp.stride; /* NTS: stride is negative if Windows 3.1 */
 							sms += sbmp.stride;
 							h--;
@@ -537,8 +377,14 @@ void IFEBitBlt(IFEBitmap &dbmp,int dx,int dy,int w,int h,int sx,int sy,IFEBitmap
 						const unsigned char *src = sbmp.row(sy) + sx;
 						unsigned char *dst = dbmp.row(dy) + dx;
 
+						/* full width rows of both are one run of memory (a full screen scene), copy them in one go */
+						if (dbmp.stride == w && sbmp.stride == w) {
+							w *= h;
+							h = 1;
+						}
+
 						while (h > 0) {
-							memcpy(dst,src,w);
+							IFEblit.copy(dst,src,(unsigned int)w);
 							dst += dbmp.stride; /* NTS: stride is negative if Windows 3.1 */
 							src += sbmp.stride;
 							h--;
@@ -554,38 +400,6 @@ void IFEBitBlt(IFEBitmap &dbmp,int dx,int dy,int w,int h,int sx,int sy,IFEBitmap
 	}
 }
 
-static inline void memcpyand(unsigned char *dst,const unsigned char *src,unsigned int w) {
-	while (w >= 4) {
-		*((uint32_t*)dst) &= *((uint32_t*)src);
-		dst += 4;
-		src += 4;
-		w -= 4;
-	}
-	while (w > 0) {
-		*dst &= *src;
-		dst++;
-		src++;
-		w--;
-	}
-}
-
-static inline void memcpymask(unsigned char *dst,const unsigned char *src,const unsigned char *msk,unsigned int w) {
-	while (w >= 4) {
-		*((uint32_t*)dst) = (*((uint32_t*)dst) & *((uint32_t*)msk)) + *((uint32_t*)src);
-		dst += 4;
-		msk += 4;
-		src += 4;
-		w -= 4;
-	}
-	while (w > 0) {
-		*dst = (unsigned char)((*dst & *msk) + *src);
-		dst++;
-		msk++;
-		src++;
-		w--;
-	}
-}
-
 void IFETBitBlt(IFEBitmap &dbmp,int dx,int dy,int w,int h,int sx,int sy,IFEBitmap &sbmp) {
 	if (!IFEBitBlt_clipcheck(dx,dy,w,h,sx,sy,(int)sbmp.width,(int)sbmp.height,dbmp.scissor)) return;
 
@@ -604,10 +418,10 @@ void IFETBitBlt(IFEBitmap &dbmp,int dx,int dy,int w,int h,int sx,int sy,IFEBitma
 						unsigned char *dms = dst + dbmp.get_transparent_mask_offset();
 
 						while (h > 0) {
-							memcpymask(dst,src,sms,w); /* mask combine pixels given source mask */
+							IFEblit.mask(dst,src,sms,(unsigned int)w); /* mask combine pixels given source mask */
 							dst += dbmp.stride; /* NTS: buf_pitch is negative if Windows 3.1 */
 							src += sbmp.stride;
-							memcpyand(dms,sms,w); /* then combine masks */
+							IFEblit.and_(dms,sms,(unsigned int)w); /* then combine masks */
 							dms += dbmp.stride;
 							sms += sbmp.stride;
 							h--;
@@ -622,7 +436,7 @@ void IFETBitBlt(IFEBitmap &dbmp,int dx,int dy,int w,int h,int sx,int sy,IFEBitma
 						unsigned char *dst = dbmp.row(dy) + dx;
 
 						while (h > 0) {
-							memcpymask(dst,src,msk,w);
+							IFEblit.mask(dst,src,msk,(unsigned int)w);
 							dst += dbmp.stride; /* NTS: buf_pitch is negative if Windows 3.1 */
 							src += sbmp.stride;
 							msk += sbmp.stride;
@@ -763,12 +577,14 @@ void IFESetCursor(IFEBitmap* new_cursor,size_t sr) {
 }
 
 void IFECheckEvent(void) {
+	IFEAssetIdle();
 	ifeapi->CheckEvents();
 	IFEUpdateCursor();
 	ifeapi->UpdateScreen();
 }
 
 void IFEWaitEvent(const int wait_ms) {
+	IFEAssetIdle();
 	ifeapi->WaitEvent(wait_ms);
 	IFEUpdateCursor();
 	ifeapi->UpdateScreen();
@@ -779,6 +595,7 @@ void IFENormalExit(void) {
 	IFE_win95_tf_hang_check();
 #endif
 
+	IFEAssetShutdown();
 	ifeapi->ShutdownVideo();
 	IFEscrbmp = NULL;
 	exit(0);
@@ -801,6 +618,10 @@ int main(int argc,char **argv) {
 	if (!priv_IFEMainInit(argc,argv))
 		return 1;
 
+	IFEBlitInit();
+	IFEDBG("Blitter: %s",IFEblit.name);
+	IFEAssetInit();
+
 	if (!IFELoadPNG(IFEcursor_arrow,"st_arrow.png"))
 		IFEFatalError("Failed to load arrow image");
 	if (!IFELoadPNG(IFEcursor_wait,"st_wait.png"))
@@ -817,6 +638,11 @@ int main(int argc,char **argv) {
 	IFESetCursor(&IFEcursor_arrow);
 	IFEShowCursor(true);
 
+	/* decode these while the palette tests run */
+	IFEPreloadPNG("test1.png");
+	IFEPreloadPNG("woo1.png");
+	IFEPreloadPNG("ariarlg.png");
+
 	ifeapi->ResetTicks(ifeapi->GetTicks());
 	while (ifeapi->GetTicks() < 1000) {
 		if (ifeapi->UserWantsToQuit()) IFENormalExit();
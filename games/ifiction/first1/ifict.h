@@ -15,6 +15,9 @@ struct iferect_t {
 #include "keyboard.h"
 #include "bitmap.h"
 #include "mouse.h"
+#include "updrgn.h"
+#include "blit.h"
+#include "asset.h"
 
 struct ifevidinfo_t {
 	unsigned int						width,height;
@@ -45,11 +45,6 @@ bool				opt_nolfb = false; /* disable framebuffer */
 bool				opt_nopmwf = false; /* disable VBE 2.0 protected mode window bank switch call */
 bool				opt_normwf = false; /* disable VBE 1.x real mode window bank switch call */
 
-/* update region management */
-unsigned int			upd_ystep = 8;
-SCR_Rect*			upd_yspan = NULL;
-size_t				upd_yspan_size = 0;
-
 unsigned char*			vesa_non_lfb = NULL;
 unsigned char*			vesa_lfb = NULL; /* video memory, linear framebuffer */
 unsigned char*			vesa_lfb_offscreen = NULL; /* system memory framebuffer, to copy to video memory */
@@ -284,16 +279,12 @@ static void vesa_windowed_memcpy(uint32_t o/*target*/,const unsigned char *src,u
 }
 
 static void p_UpdateFullScreen(void) {
-	size_t i;
-
 	if (vesa_use_lfb)
 		memcpy(vesa_lfb,vesa_lfb_offscreen,vesa_lfb_map_size);
 	else
 		vesa_windowed_memcpy(0/*target linear vram address*/,vesa_lfb_offscreen,vesa_lfb_map_size);
 
-	/* clear update region list */
-	for (i=0;i < upd_yspan_size;i++)
-		upd_yspan[i].x = upd_yspan[i].w = upd_yspan[i].h = 0;
+	IFEUpdateRegionEndFullFrame();
 }
 
 static ifevidinfo_t* p_GetVidInfo(void) {
@@ -582,11 +573,7 @@ static void p_ShutdownVideo(void) {
 		}
 	}
 
-	upd_yspan_size = 0;
-	if (upd_yspan) {
-		free(upd_yspan);
-		upd_yspan = NULL;
-	}
+	IFEUpdateRegionPrintStats();
 	keybirq_unhook();
 	_sti();
 	if (vesa_lfb_offscreen != NULL) {
@@ -606,8 +593,6 @@ static void p_ShutdownVideo(void) {
 }
 
 static void p_InitVideo(void) {
-	size_t i;
-
 	/* IBM PC/AT compatible */
 	/* Find 640x480 256-color mode.
 	 * Linear framebuffer required (we'll support older bank switched stuff later) */
@@ -740,15 +725,9 @@ static void p_InitVideo(void) {
 		ifevidinfo_doslib.buf_pitch = ifevidinfo_doslib.vram_pitch = vesa_lfb_stride;
 		ifevidinfo_doslib.buf_alloc = ifevidinfo_doslib.buf_size = ifevidinfo_doslib.vram_size = vesa_lfb_map_size;
 
-		upd_yspan_size = (ifevidinfo_doslib.height + upd_ystep - 1) / upd_ystep;
-		upd_yspan = (SCR_Rect*)malloc(sizeof(SCR_Rect) * upd_yspan_size);
-		if (upd_yspan == NULL)
-			IFEFatalError("Cannot update yspans");
-
-		for (i=0;i < upd_yspan_size;i++) {
-			upd_yspan[i].x = upd_yspan[i].w = upd_yspan[i].h = 0;
-			upd_yspan[i].y = (int)(i * upd_ystep);
-		}
+		/* with a linear framebuffer a rect costs little more than its memcpy() per scanline.
+		 * bank switching costs a call into the BIOS every time a rect crosses into another bank. */
+		IFEUpdateRegionInit(ifevidinfo_doslib.width,ifevidinfo_doslib.height,vesa_use_lfb ? 256 : 2048);
 
 		/* use 8-bit DAC if available */
 		if (vbe_info->capabilities & VBE_CAP_8BIT_DAC) {
@@ -1072,86 +1051,22 @@ void SCR_UpdateWindowSurfaceRect(SCR_Rect *r) {
 	}
 }
 
-void SCR_UpdateWindowSurfaceRects(SCR_Rect *r,size_t count) {
-	size_t i;
-
-	for (i=0;i < count;i++)
-		SCR_UpdateWindowSurfaceRect(r+i);
-}
-
 void p_UpdateScreen(void) {
-#define MAX_RUPD 32
-	SCR_Rect rupd[MAX_RUPD];
-	size_t rupdi=0;
 	SCR_Rect r;
-	size_t i;
-
-	/* draw spans as needed, clear them as well */
-	for (i=0;i < upd_yspan_size;) {
-		if (upd_yspan[i].h != 0) { /* update span exists */
-			r = upd_yspan[i];
-			upd_yspan[i].x = upd_yspan[i].w = upd_yspan[i].h = 0;
-			i++;
-
-			/* combine with rects that have the same horizontal span */
-			while (i < upd_yspan_size && upd_yspan[i].x == r.x && upd_yspan[i].w == r.w) {
-				r.h += upd_yspan[i].h;
-				upd_yspan[i].x = upd_yspan[i].w = upd_yspan[i].h = 0;
-				i++;
-			}
+	unsigned int i;
 
-			if (rupdi >= MAX_RUPD) {
-				SCR_UpdateWindowSurfaceRects(rupd,rupdi);
-				rupdi = 0;
-			}
-			rupd[rupdi++] = r;
-		}
-		else {
-			i++;
-		}
-	}
+	for (i=0;i < IFEupdrgn.count;i++) {
+		const iferect_t &u = IFEupdrgn.rect[i];
 
-	if (rupdi > 0) {
-		SCR_UpdateWindowSurfaceRects(rupd,rupdi);
+		r.x = u.x; r.y = u.y; r.w = u.w; r.h = u.h;
+		SCR_UpdateWindowSurfaceRect(&r);
 	}
-#undef MAX_RUPD
+
+	IFEUpdateRegionEndFrame();
 }
 
 void p_AddScreenUpdate(int x1,int y1,int x2,int y2) {
-	if (x1 < 0) x1 = 0;
-	if (y1 < 0) y1 = 0;
-
-	if ((unsigned int)x2 > ifevidinfo_doslib.width)
-		x2 = ifevidinfo_doslib.width;
-	if ((unsigned int)y2 > ifevidinfo_doslib.height)
-		y2 = ifevidinfo_doslib.height;
-
-	if (x1 >= x2 || y1 >= y2) return;
-
-	y1 = y1 / (int)upd_ystep;
-	y2 = (y2 + (int)upd_ystep - 1) / (int)upd_ystep;
-
-	if ((size_t)y2 > upd_yspan_size)
-		IFEFatalError("UpdateScreen region bug");
-
-	while ((unsigned int)y1 < (unsigned int)y2) {
-		if (upd_yspan[(size_t)y1].h == 0) {
-			upd_yspan[(size_t)y1].w = x2-x1;
-			upd_yspan[(size_t)y1].h = upd_ystep;
-			upd_yspan[(size_t)y1].x = x1;
-		}
-		else {
-			if (upd_yspan[(size_t)y1].x > x1) {
-				const unsigned int orig_x = upd_yspan[(size_t)y1].x;
-				upd_yspan[(size_t)y1].x = x1;
-				upd_yspan[(size_t)y1].w += orig_x - x1;
-			}
-			if ((upd_yspan[(size_t)y1].x+upd_yspan[(size_t)y1].w) < x2) {
-				upd_yspan[(size_t)y1].w = x2-upd_yspan[(size_t)y1].x;
-			}
-		}
-		y1++;
-	}
+	IFEUpdateRegionAdd(x1,y1,x2,y2);
 }
 
 static bool p_SetHostStdCursor(const unsigned int id) {
@@ -46,7 +46,7 @@ IFEMouseStatus				ifemousestat;
 bool					mousecap_on = false;
 HRGN					upd_region = NULL;
 HRGN					upd_rect = NULL;
-bool					upd_region_valid = false;
+bool					upd_region_valid = false; /* upd_region holds the rects pushed last frame */
 bool					is_minimized = false;
 bool					is_maximized = false;
 bool					is_fullscreen = false;
@@ -76,6 +76,9 @@ void UpdateScreenPosOffset(void) {
 	screen_region_offset.y = ((r.bottom - r.top) - abs((int)hwndMainDIB->bmiHeader.biHeight)) / 2;
 	if (screen_region_offset.x < 0) screen_region_offset.x = 0;
 	if (screen_region_offset.y < 0) screen_region_offset.y = 0;
+
+	/* the update region is in window coordinates */
+	upd_region_valid = false;
 }
 
 void MakeRgnEmpty(HRGN r) {
@@ -214,7 +217,7 @@ static void p_DoUpdateFullScreen(HDC useDC=NULL) {
 		SelectPalette(hDC,oldPal,FALSE);
 		if (useDC == NULL) ReleaseDC(hwndMain,hDC);
 
-		MakeRgnEmpty(upd_region);
+		IFEUpdateRegionEndFullFrame();
 		upd_region_valid = false;
 	}
 }
@@ -281,6 +284,7 @@ static void p_ShutdownVideo(void) {
 		free((void*)win_dib);
 		win_dib = NULL;
 	}
+	IFEUpdateRegionPrintStats();
 	if (upd_region != NULL) {
 		DeleteObject((HGDIOBJ)upd_region);
 		upd_region = NULL;
@@ -407,6 +411,9 @@ static void p_InitVideo(void) {
 			IFEFatalError("Update Region create fail 2");
 		upd_region_valid = false;
 
+		/* a rect is one more rectangle in the clip region GDI walks, which is cheap next to the call itself */
+		IFEUpdateRegionInit(ifevidinfo_win32.width,ifevidinfo_win32.height,1024);
+
 		{
 			DWORD dwStyle = hwndMainDefaultStyle;
 			RECT um;
@@ -482,10 +489,29 @@ IFEMouseEvent *p_GetMouseInput(void) {
 }
 
 void p_UpdateScreen(void) {
-	if (upd_region_valid && !is_minimized) {
+	if (IFEupdrgn.count != 0 && !is_minimized) {
 		HDC hDC = GetDC(hwndMain);
 		HPALETTE oldPal = SelectPalette(hDC,hwndMainPAL,FALSE);
-		HRGN oldRgn = (HRGN)SelectObject(hDC,upd_region);
+		HRGN oldRgn;
+		unsigned int i;
+
+		/* the same rects as last frame (a blinking caret, an animation in place) need not be combined again */
+		if (!upd_region_valid || !IFEUpdateRegionSameAsPrev()) {
+			MakeRgnEmpty(upd_region);
+			for (i=0;i < IFEupdrgn.count;i++) {
+				const iferect_t &r = IFEupdrgn.rect[i];
+
+				SetRectRgn(upd_rect,
+					r.x+screen_region_offset.x,r.y+screen_region_offset.y,
+					r.x+r.w+screen_region_offset.x,r.y+r.h+screen_region_offset.y); /* "The region does not include the lower and right boundaries of the rectangle", same as this API */
+
+				if (CombineRgn(upd_region,upd_region,upd_rect,RGN_OR) == ERROR)
+					IFEDBG("CombineRgn error");
+			}
+			upd_region_valid = true;
+		}
+
+		oldRgn = (HRGN)SelectObject(hDC,upd_region);
 
 		SetDIBitsToDevice(hDC,
 			/*dest x/y*/screen_region_offset.x,screen_region_offset.y,
@@ -501,22 +527,12 @@ void p_UpdateScreen(void) {
 		SelectObject(hDC,oldRgn);
 		ReleaseDC(hwndMain,hDC);
 
-		MakeRgnEmpty(upd_region);
-		upd_region_valid = false;
+		IFEUpdateRegionEndFrame();
 	}
 }
 
 void p_AddScreenUpdate(int x1,int y1,int x2,int y2) {
-	if (x1 < x2 && y1 < y2) {
-		upd_region_valid = true;
-
-		SetRectRgn(upd_rect,
-			x1+screen_region_offset.x,y1+screen_region_offset.y,
-			x2+screen_region_offset.x,y2+screen_region_offset.y); /* "The region does not include the lower and right boundaries of the rectangle", same as this API */
-
-		if (CombineRgn(upd_region,upd_region,upd_rect,RGN_OR) == ERROR)
-			IFEDBG("CombineRgn error");
-	}
+	IFEUpdateRegionAdd(x1,y1,x2,y2);
 }
 
 static bool p_SetHostStdCursor(const unsigned int id) {
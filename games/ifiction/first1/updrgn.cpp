@@ -0,0 +1,243 @@
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ifict.h"
+#include "utils.h"
+#include "debug.h"
+#include "fatal.h"
+
+IFEUpdateRegion			IFEupdrgn;
+
+/* a split rectangle is added again piece by piece, which can split again on another rectangle.
+ * past this depth the pieces are listed as they are even if they overlap something. */
+#define IFEUpdateRegionMaxSplitDepth	4
+
+void IFEUpdateStats::clear(void) {
+	frames = full_frames = rects = reused_rects = 0;
+	pixels = requested = reused_pixels = 0;
+}
+
+static inline int imin(const int a,const int b) {
+	return (a < b) ? a : b;
+}
+
+static inline int imax(const int a,const int b) {
+	return (a > b) ? a : b;
+}
+
+static inline unsigned long rect_area(const iferect_t &r) {
+	return (unsigned long)r.w * (unsigned long)r.h;
+}
+
+static inline bool rect_contains(const iferect_t &o,const iferect_t &i) {
+	return i.x >= o.x && i.y >= o.y && (i.x+i.w) <= (o.x+o.w) && (i.y+i.h) <= (o.y+o.h);
+}
+
+static inline bool rect_same(const iferect_t &a,const iferect_t &b) {
+	return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+/* area of the intersection, 0 if none */
+static unsigned long rect_overlap(const iferect_t &a,const iferect_t &b) {
+	const int x1 = imax(a.x,b.x),x2 = imin(a.x+a.w,b.x+b.w);
+	const int y1 = imax(a.y,b.y),y2 = imin(a.y+a.h,b.y+b.h);
+
+	if (x1 >= x2 || y1 >= y2) return 0;
+	return (unsigned long)(x2-x1) * (unsigned long)(y2-y1);
+}
+
+static iferect_t rect_union(const iferect_t &a,const iferect_t &b) {
+	const int x1 = imin(a.x,b.x),x2 = imax(a.x+a.w,b.x+b.w);
+	const int y1 = imin(a.y,b.y),y2 = imax(a.y+a.h,b.y+b.h);
+
+	return iferect_t(x1,y1,x2-x1,y2-y1);
+}
+
+/* pixels pushed for nothing if a and b are pushed as their bounding box instead of separately */
+static unsigned long rect_union_waste(const iferect_t &a,const iferect_t &b) {
+	return rect_area(rect_union(a,b)) + rect_overlap(a,b) - rect_area(a) - rect_area(b);
+}
+
+static void rect_remove(const unsigned int i) {
+	IFEupdrgn.rect[i] = IFEupdrgn.rect[--IFEupdrgn.count];
+}
+
+static void IFEUpdateRegionAddRect(iferect_t n,const unsigned int depth) {
+	unsigned long waste,best_waste;
+	unsigned int i,best;
+
+	do {
+		/* already covered? remove whatever the new one covers */
+		for (i=0;i < IFEupdrgn.count;) {
+			if (rect_contains(IFEupdrgn.rect[i],n))
+				return;
+			else if (rect_contains(n,IFEupdrgn.rect[i]))
+				rect_remove(i);
+			else
+				i++;
+		}
+
+		/* merge with the rectangle that wastes the fewest pixels, if that costs less than another push.
+		 * the bounding box can take in other rectangles, so check again with it. */
+		best = IFEupdrgn.count;
+		best_waste = ~0ul;
+		for (i=0;i < IFEupdrgn.count;i++) {
+			waste = rect_union_waste(IFEupdrgn.rect[i],n);
+			if (best_waste > waste) {
+				best_waste = waste;
+				best = i;
+			}
+		}
+
+		if (best < IFEupdrgn.count && (best_waste <= IFEupdrgn.push_cost || IFEupdrgn.count >= IFEUpdateRegionMax)) {
+			n = rect_union(IFEupdrgn.rect[best],n);
+			rect_remove(best);
+			continue;
+		}
+
+		break;
+	} while (1);
+
+	/* split around a rectangle it overlaps. the pieces are a band above, a band below,
+	 * and what is left and right of it within its rows. it is only worth it if the
+	 * overlap costs more than pushing the extra pieces. */
+	if (depth < IFEUpdateRegionMaxSplitDepth) {
+		for (i=0;i < IFEupdrgn.count;i++) {
+			const unsigned long overlap = rect_overlap(IFEupdrgn.rect[i],n);
+
+			if (overlap != 0) {
+				const iferect_t o = IFEupdrgn.rect[i];
+				const int y1 = imax(n.y,o.y),y2 = imin(n.y+n.h,o.y+o.h);
+				const unsigned int pieces =
+					(n.y < y1 ? 1u : 0u) + ((n.y+n.h) > y2 ? 1u : 0u) +
+					(n.x < o.x ? 1u : 0u) + ((n.x+n.w) > (o.x+o.w) ? 1u : 0u);
+
+				if (overlap <= (IFEupdrgn.push_cost * (pieces - 1u)))
+					break;
+
+				if (n.y < y1)
+					IFEUpdateRegionAddRect(iferect_t(n.x,n.y,n.w,y1-n.y),depth+1);
+				if ((n.y+n.h) > y2)
+					IFEUpdateRegionAddRect(iferect_t(n.x,y2,n.w,(n.y+n.h)-y2),depth+1);
+				if (n.x < o.x)
+					IFEUpdateRegionAddRect(iferect_t(n.x,y1,o.x-n.x,y2-y1),depth+1);
+				if ((n.x+n.w) > (o.x+o.w))
+					IFEUpdateRegionAddRect(iferect_t(o.x+o.w,y1,(n.x+n.w)-(o.x+o.w),y2-y1),depth+1);
+
+				return;
+			}
+		}
+	}
+
+	IFEupdrgn.rect[IFEupdrgn.count++] = n;
+}
+
+void IFEUpdateRegionInit(const unsigned int width,const unsigned int height,const unsigned long push_cost) {
+	IFEupdrgn.count = IFEupdrgn.prev_count = 0;
+	IFEupdrgn.width = (int)width;
+	IFEupdrgn.height = (int)height;
+	IFEupdrgn.push_cost = push_cost;
+	IFEupdrgn.frame.clear();
+	IFEupdrgn.total.clear();
+}
+
+void IFEUpdateRegionAdd(int x1,int y1,int x2,int y2) {
+	if (x1 < 0) x1 = 0;
+	if (y1 < 0) y1 = 0;
+	if (x2 > IFEupdrgn.width) x2 = IFEupdrgn.width;
+	if (y2 > IFEupdrgn.height) y2 = IFEupdrgn.height;
+
+	if (x1 >= x2 || y1 >= y2) return;
+
+	IFEupdrgn.frame.requested += (uint64_t)(x2-x1) * (uint64_t)(y2-y1);
+	IFEUpdateRegionAddRect(iferect_t(x1,y1,x2-x1,y2-y1),0);
+}
+
+/* the region is exactly what was pushed last frame */
+bool IFEUpdateRegionSameAsPrev(void) {
+	unsigned int i,j;
+
+	if (IFEupdrgn.count != IFEupdrgn.prev_count)
+		return false;
+
+	for (i=0;i < IFEupdrgn.count;i++) {
+		for (j=0;j < IFEupdrgn.prev_count && !rect_same(IFEupdrgn.rect[i],IFEupdrgn.prev[j]);j++);
+		if (j == IFEupdrgn.prev_count) return false;
+	}
+
+	return true;
+}
+
+static void IFEUpdateRegionAddStats(void) {
+	IFEupdrgn.total.frames += IFEupdrgn.frame.frames;
+	IFEupdrgn.total.full_frames += IFEupdrgn.frame.full_frames;
+	IFEupdrgn.total.rects += IFEupdrgn.frame.rects;
+	IFEupdrgn.total.pixels += IFEupdrgn.frame.pixels;
+	IFEupdrgn.total.requested += IFEupdrgn.frame.requested;
+	IFEupdrgn.total.reused_rects += IFEupdrgn.frame.reused_rects;
+	IFEupdrgn.total.reused_pixels += IFEupdrgn.frame.reused_pixels;
+}
+
+void IFEUpdateRegionEndFrame(void) {
+	unsigned int i,j;
+
+	if (IFEupdrgn.count == 0)
+		return;
+
+	IFEupdrgn.frame.frames = 1;
+	IFEupdrgn.frame.full_frames = 0;
+	IFEupdrgn.frame.rects = IFEupdrgn.count;
+	IFEupdrgn.frame.pixels = 0;
+	IFEupdrgn.frame.reused_rects = 0;
+	IFEupdrgn.frame.reused_pixels = 0;
+
+	for (i=0;i < IFEupdrgn.count;i++) {
+		const iferect_t &r = IFEupdrgn.rect[i];
+
+		IFEupdrgn.frame.pixels += rect_area(r);
+		for (j=0;j < IFEupdrgn.prev_count;j++) {
+			if (rect_same(r,IFEupdrgn.prev[j])) IFEupdrgn.frame.reused_rects++;
+			IFEupdrgn.frame.reused_pixels += rect_overlap(r,IFEupdrgn.prev[j]);
+		}
+	}
+
+	IFEUpdateRegionAddStats();
+
+	memcpy(IFEupdrgn.prev,IFEupdrgn.rect,sizeof(iferect_t) * IFEupdrgn.count);
+	IFEupdrgn.prev_count = IFEupdrgn.count;
+	IFEupdrgn.count = 0;
+	IFEupdrgn.frame.requested = 0;
+}
+
+void IFEUpdateRegionEndFullFrame(void) {
+	IFEupdrgn.frame.frames = 1;
+	IFEupdrgn.frame.full_frames = 1;
+	IFEupdrgn.frame.rects = 1;
+	IFEupdrgn.frame.pixels = (uint64_t)IFEupdrgn.width * (uint64_t)IFEupdrgn.height;
+	IFEupdrgn.frame.reused_rects = 0;
+	IFEupdrgn.frame.reused_pixels = 0;
+
+	IFEUpdateRegionAddStats();
+
+	/* nothing to compare the next frame with */
+	IFEupdrgn.count = IFEupdrgn.prev_count = 0;
+	IFEupdrgn.frame.requested = 0;
+}
+
+void IFEUpdateRegionPrintStats(void) {
+	const IFEUpdateStats &t = IFEupdrgn.total;
+
+	if (t.frames == 0)
+		return;
+
+	IFEDBG("Screen updates: %lu frames (%lu full screen), %lu rects, %.0f pixels pushed (%.0f per frame), %.0f requested",
+		t.frames,t.full_frames,t.rects,(double)t.pixels,(double)t.pixels / t.frames,(double)t.requested);
+	IFEDBG("Screen updates: %lu rects and %.0f pixels also pushed the frame before",
+		t.reused_rects,(double)t.reused_pixels);
+}
+
@@ -0,0 +1,54 @@
+
+/* screen update region, shared by all backends.
+ *
+ * IFEAddScreenUpdate() marks what drawing code changed, UpdateScreen() pushes those areas to the
+ * screen. The region is a short list of rectangles. Each push costs something no matter how small
+ * (a blit call, a GDI call, setting up a bank switched window) on top of the pixels it moves, so the
+ * backend states the cost of one push in pixels and the region merges or splits rectangles to keep
+ * the total cost down:
+ *
+ * - a rectangle within one already listed is dropped, rectangles within a new one are removed.
+ * - a new rectangle is merged with a listed one if one push of the bounding box costs no more than
+ *   pushing both, i.e. the bounding box wastes no more pixels than the cost of a push.
+ * - a new rectangle that overlaps a listed one but is not worth merging is split around it, so that
+ *   the overlap is not pushed twice.
+ * - if the list is full, the new rectangle is merged with whichever one wastes the fewest pixels.
+ *
+ * The rectangles pushed in the previous frame are kept so that the backend can tell when it is
+ * pushing the same region again (a blinking caret, an animation in place) and reuse what it built
+ * for it last time, and for the frame statistics. */
+
+#define IFEUpdateRegionMax		32
+
+struct IFEUpdateStats {
+	unsigned long		frames;		/* frames that pushed anything */
+	unsigned long		full_frames;	/* full screen updates */
+	unsigned long		rects;		/* rectangles pushed */
+	uint64_t		pixels;		/* pixels pushed */
+	uint64_t		requested;	/* pixels marked by IFEAddScreenUpdate(), after clipping, before merging */
+	unsigned long		reused_rects;	/* rectangles that were also pushed the frame before */
+	uint64_t		reused_pixels;	/* pixels that were also pushed the frame before */
+
+	void clear(void);
+};
+
+struct IFEUpdateRegion {
+	iferect_t		rect[IFEUpdateRegionMax];
+	unsigned int		count;
+	iferect_t		prev[IFEUpdateRegionMax];
+	unsigned int		prev_count;
+	int			width,height;	/* screen size, to clip to */
+	unsigned long		push_cost;	/* cost of one push, in pixels */
+	IFEUpdateStats		frame;		/* the last frame pushed */
+	IFEUpdateStats		total;		/* since IFEUpdateRegionInit() */
+};
+
+extern IFEUpdateRegion		IFEupdrgn;
+
+void IFEUpdateRegionInit(const unsigned int width,const unsigned int height,const unsigned long push_cost);
+void IFEUpdateRegionAdd(int x1,int y1,int x2,int y2); /* x1 <= x < x2, y1 <= y < y2 */
+bool IFEUpdateRegionSameAsPrev(void);
+void IFEUpdateRegionEndFrame(void); /* backend pushed rect[0...count-1] */
+void IFEUpdateRegionEndFullFrame(void); /* backend pushed the whole screen */
+void IFEUpdateRegionPrintStats(void);
+
@@ -9,6 +9,7 @@
  *
  * Compiles for intended target environments:
  *   - MS-DOS [pure DOS mode, or Windows or OS/2 DOS Box]
+ *   - Linux host, as a "virtual" OPL2 for tools that record register writes
  *
  * On most Sound Blaster compatible cards all the way up to the late 1990s, a
  * Yamaha OPL2 or OPL3 chipset exists (or may be emulated on PCI cards) that
@@ -21,15 +22,19 @@
  *       other than 388h */
  
 #include <stdio.h>
+#ifndef LINUX
 #include <conio.h> /* this is where Open Watcom hides the outp() etc. functions */
+#endif
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <malloc.h>
 #include <fcntl.h>
+#ifndef LINUX
 #include <dos.h>
 
 #include <hw/8254/8254.h>		/* 8254 timer */
+#endif
 #include <hw/adlib/adlib.h>
 
 #if defined(TARGET_PC98)
@@ -46,6 +51,17 @@ struct adlib_fm_channel		adlib_fm[ADLIB_FM_VOICES];
 int				adlib_fm_voices = 0;
 unsigned char			adlib_flags = 0;
 
+/* shadow copy of the chip registers (both banks). adlib_reg_known says which ones we know the value of,
+ * adlib_reg_dirty which ones have a value in adlib_reg_pending not yet written (adlib_batch_begin()) */
+unsigned char			adlib_reg_shadow[ADLIB_REGS];
+unsigned char			adlib_reg_pending[ADLIB_REGS];
+unsigned char			adlib_reg_known[ADLIB_REGS/8];
+unsigned char			adlib_reg_dirty[ADLIB_REGS/8];
+unsigned char			adlib_batch = 0;
+unsigned long			adlib_writes_issued = 0;
+unsigned long			adlib_writes_suppressed = 0;
+void				(*adlib_write_capture)(unsigned short i,unsigned char d) = NULL;
+
 struct adlib_fm_channel adlib_fm_preset_violin_opl3 = {
 	.mod = {0,	1,	1,	1,	1,	1,	42,	6,	1,	1,	4,	0,
 		3,	456,	1,	1,	1,	1,	4,	0,	5},
@@ -146,34 +162,136 @@ struct adlib_fm_channel adlib_fm_preset_small_drum = {
 
 unsigned char adlib_read(unsigned short i) {
 	unsigned char c;
-#if defined(TARGET_PC98)
-	outp(ADLIB_IO_INDEX+((i>>8)*0x200),(unsigned char)i);
+#if defined(LINUX)
+	c = adlib_reg_shadow[i & (ADLIB_REGS - 1)];
 #else
+# if defined(TARGET_PC98)
+	outp(ADLIB_IO_INDEX+((i>>8)*0x200),(unsigned char)i);
+# else
 	outp(ADLIB_IO_INDEX+((i>>8)*2),(unsigned char)i);
-#endif
+# endif
 	adlib_wait();
-#if defined(TARGET_PC98)
+# if defined(TARGET_PC98)
 	c = inp(ADLIB_IO_DATA+((i>>8)*0x200));
-#else
+# else
 	c = inp(ADLIB_IO_DATA+((i>>8)*2));
-#endif
+# endif
 	adlib_wait();
+#endif
 	return c;
 }
 
-void adlib_write(unsigned short i,unsigned char d) {
-#if defined(TARGET_PC98)
+/* the actual I/O. every write goes through here and updates the shadow copy */
+void adlib_write_uncached(unsigned short i,unsigned char d) {
+#if !defined(LINUX)
+# if defined(TARGET_PC98)
 	outp(ADLIB_IO_INDEX+((i>>8)*0x200),(unsigned char)i);
-#else
+# else
 	outp(ADLIB_IO_INDEX+((i>>8)*2),(unsigned char)i);
-#endif
+# endif
 	adlib_wait();
-#if defined(TARGET_PC98)
+# if defined(TARGET_PC98)
 	outp(ADLIB_IO_DATA+((i>>8)*0x200),d);
-#else
+# else
 	outp(ADLIB_IO_DATA+((i>>8)*2),d);
-#endif
+# endif
 	adlib_wait();
+#endif
+
+	i &= (ADLIB_REGS - 1);
+	if (adlib_write_capture != NULL)
+		adlib_write_capture(i,d);
+
+	adlib_reg_shadow[i] = d;
+	adlib_reg_known[i>>3] |= 1u << (i&7);
+	adlib_reg_dirty[i>>3] &= ~(1u << (i&7));
+	adlib_writes_issued++;
+}
+
+/* timer control (02h-04h) has side effects every time it is written, never skip those */
+static inline unsigned char adlib_reg_cacheable(unsigned short i) {
+	return ((i&0xFF) < 0x02 || (i&0xFF) > 0x04);
+}
+
+/* key on bits, see adlib_write() */
+static inline unsigned char adlib_reg_key_mask(unsigned short i) {
+	if ((i&0xFF) >= 0xB0 && (i&0xFF) <= 0xB8) return 0x20;
+	if ((i&0xFF) == 0xBD) return 0x1F; /* rhythm instruments */
+	return 0;
+}
+
+void adlib_write(unsigned short i,unsigned char d) {
+	unsigned char bit,idx,km;
+
+	i &= (ADLIB_REGS - 1);
+	if (!adlib_reg_cacheable(i)) {
+		adlib_write_uncached(i,d);
+		return;
+	}
+
+	idx = (unsigned char)(i>>3);
+	bit = (unsigned char)(1u << (i&7));
+
+	/* control registers (below 20h) are never held back, the order of things like the OPL3 enable bit matters */
+	if (!adlib_batch || (i&0xFF) < 0x20) {
+		if ((adlib_reg_known[idx] & bit) && !(adlib_reg_dirty[idx] & bit) && adlib_reg_shadow[i] == d) {
+			adlib_writes_suppressed++;
+			return;
+		}
+
+		adlib_write_uncached(i,d);
+		return;
+	}
+
+	if (adlib_reg_dirty[idx] & bit) {
+		/* a pending key on/off that this write would undo must still reach the chip, or the note is lost or not restarted */
+		km = adlib_reg_key_mask(i);
+		if (km != 0 && (((adlib_reg_shadow[i] ^ adlib_reg_pending[i]) & (adlib_reg_pending[i] ^ d)) & km) != 0) {
+			adlib_write_uncached(i,adlib_reg_pending[i]);
+		}
+		else {
+			adlib_writes_suppressed++; /* the pending write never happens */
+			adlib_reg_dirty[idx] &= ~bit;
+		}
+	}
+
+	if ((adlib_reg_known[idx] & bit) && adlib_reg_shadow[i] == d) {
+		adlib_writes_suppressed++;
+		return;
+	}
+
+	adlib_reg_pending[i] = d;
+	adlib_reg_dirty[idx] |= bit;
+}
+
+/* hold back register writes until adlib_flush(), so that several changes to one register cost one write */
+void adlib_batch_begin() {
+	adlib_batch = 1;
+}
+
+/* write the registers changed since adlib_batch_begin(), operator and channel settings first and key on last */
+void adlib_flush() {
+	unsigned short i;
+	unsigned char pass;
+
+	adlib_batch = 0;
+	for (pass=0;pass < 2;pass++) {
+		for (i=0;i < ADLIB_REGS;i++) {
+			if ((i&7) == 0 && adlib_reg_dirty[i>>3] == 0) {
+				i += 7;
+				continue;
+			}
+
+			if ((adlib_reg_dirty[i>>3] & (1u << (i&7))) && (adlib_reg_key_mask(i) != 0) == (pass != 0))
+				adlib_write_uncached(i,adlib_reg_pending[i]);
+		}
+	}
+}
+
+/* forget what we know about the chip, every register is written again the next time */
+void adlib_shadow_invalidate() {
+	memset(adlib_reg_known,0,sizeof(adlib_reg_known));
+	memset(adlib_reg_dirty,0,sizeof(adlib_reg_dirty));
 }
 
 /* TODO: adlib_write_imm_1() and adlib_write_imm_2()
@@ -181,6 +299,10 @@ void adlib_write(unsigned short i,unsigned char d) {
  *       an interrupt routine */
 
 int probe_adlib(unsigned char sec) {
+#if defined(LINUX)
+	/* the virtual chip is one OPL2 */
+	return sec ? 0 : 1;
+#else
 	unsigned char a,b,retry=3;
 	unsigned short bas = sec ? 0x100 : 0;
 
@@ -205,10 +327,13 @@ int probe_adlib(unsigned char sec) {
 	} while (--retry != 0);
 
 	return 0;
+#endif
 }
 
 int init_adlib() {
 	adlib_flags = 0;
+	adlib_batch = 0;
+	adlib_shadow_invalidate();
 	if (!probe_adlib(0))
 		return 0;
 
@@ -220,6 +345,7 @@ int init_adlib() {
 		adlib_fm_voices = 18;
 		adlib_flags = ADLIB_FM_DUAL_OPL2;
 	}
+#if !defined(LINUX)
 	else {
 		/* NTS: "unofficial" method of detecting OPL3 */
 		if ((adlib_status(0) & 0x06) == 0) {
@@ -233,6 +359,7 @@ int init_adlib() {
 			adlib_write(0x104,0x00);		/* disable any 4op connections */
 		}
 	}
+#endif
 
 	return 1;
 }
@@ -8,13 +8,19 @@
  * <insert LGPL legal text here>
  *
  * Compiles for intended target environments:
- *   - MS-DOS [pure DOS mode, or Windows or OS/2 DOS Box] */
+ *   - MS-DOS [pure DOS mode, or Windows or OS/2 DOS Box]
+ *   - Linux host (no hardware, register writes only go to adlib_write_capture) */
  
+#ifndef LINUX
 #include <hw/cpu/cpu.h>
+#endif
 #include <stdint.h>
 
 #define ADLIB_FM_VOICES			18
 
+/* registers 000h-0FFh and 100h-1FFh (OPL3 or second OPL2) */
+#define ADLIB_REGS			0x200
+
 #if defined(TARGET_PC98)
 // ADLIB is tied to Sound Blaster base I/O on PC-98
 extern uint16_t _adlib_sb_base;
@@ -97,6 +103,10 @@ void shutdown_adlib_opl3();
 int probe_adlib(unsigned char sec);
 unsigned char adlib_read(unsigned short i);
 void adlib_write(unsigned short i,unsigned char d);
+void adlib_write_uncached(unsigned short i,unsigned char d);
+void adlib_batch_begin();
+void adlib_flush();
+void adlib_shadow_invalidate();
 void adlib_update_group20(unsigned int op,struct adlib_fm_operator *f);
 void adlib_update_group40(unsigned int op,struct adlib_fm_operator *f);
 void adlib_update_group60(unsigned int op,struct adlib_fm_operator *f);
@@ -119,6 +129,15 @@ extern struct adlib_fm_channel		adlib_fm[ADLIB_FM_VOICES];
 extern int				adlib_fm_voices;
 extern unsigned char			adlib_flags;
 
+/* register shadow. adlib_write() skips writes of the value a register already has */
+extern unsigned char			adlib_reg_shadow[ADLIB_REGS];
+extern unsigned char			adlib_batch;
+extern unsigned long			adlib_writes_issued;		/* register writes that went to the chip */
+extern unsigned long			adlib_writes_suppressed;	/* adlib_write() calls that did not need to */
+
+/* if set, called for every register write that goes to the chip (i.e. to record an IMF) */
+extern void				(*adlib_write_capture)(unsigned short i,unsigned char d);
+
 extern struct adlib_fm_channel		adlib_fm_preset_deep_bass_drum;
 extern struct adlib_fm_channel		adlib_fm_preset_violin_opl3;
 extern struct adlib_fm_channel		adlib_fm_preset_violin_opl2;
@@ -142,6 +161,18 @@ extern struct adlib_fm_channel      adlib_fm_preset_synth_lead_2_sawtooth;
  *      (unless run just after the Sound Blaster test program) and even if it
  *      did run, only about 1/3rd of the voices would work. Upping the delay
  *      to 40us for OPL3 and 100us for OPL2 resolved these issues. */
+#if defined(LINUX)
+static inline void adlib_wait() {
+}
+
+static inline unsigned char adlib_status(unsigned char which) {
+	return 0;
+}
+
+static inline unsigned char adlib_status_imm(unsigned char which) {
+	return 0;
+}
+#else
 static inline void adlib_wait() {
 	t8254_wait(t8254_us2ticks((adlib_flags & ADLIB_FM_OPL3) ? 40 : 100));
 }
@@ -162,4 +193,5 @@ static inline unsigned char adlib_status_imm(unsigned char which) {
 	return inp(ADLIB_IO_STATUS+(which*2));
 #endif
 }
+#endif
 
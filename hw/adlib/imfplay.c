@@ -238,6 +238,8 @@ int main(int argc,char **argv) {
 	shutdown_adlib();
 	_dos_setvect(8,old_irq0);
 	write_8254_system_timer(0); /* back to normal 18.2Hz */
+
+	printf("OPL register writes: %lu issued, %lu skipped\n",adlib_writes_issued,adlib_writes_suppressed);
 	return 0;
 }
 
@@ -807,10 +807,13 @@ void midi_tick() {
 		unsigned int i;
 		int eof=0;
 
+		/* all the note and instrument changes of this tick go out at once, each register once */
+		adlib_batch_begin();
 		for (i=0;i < midi_trk_count;i++) {
 			midi_tick_track(i);
 			eof += midi_trk[i].eof?1:0;
 		}
+		adlib_flush();
 
 		if (eof >= midi_trk_count) {
             fprintf(stderr,"MIDI EOF. Restarting\n");
@@ -1121,6 +1124,8 @@ int main(int argc,char **argv) {
 	_dos_setvect(8,old_irq0);
 	write_8254_system_timer(0); /* back to normal 18.2Hz */
 
+	printf("OPL register writes: %lu issued, %lu skipped\n",adlib_writes_issued,adlib_writes_suppressed);
+
 	for (i=0;i < MIDI_MAX_TRACKS;i++) {
 		if (midi_trk[i].raw) {
 #if TARGET_MSDOS == 16 && (defined(__LARGE__) || defined(__COMPACT__) || defined(__HUGE__))
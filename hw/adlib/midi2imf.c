@@ -11,26 +11,45 @@
  *
  * Compiles for intended target environments:
  *   - MS-DOS [pure DOS mode, or Windows or OS/2 DOS Box]
+ *   - Linux host (batch conversion only)
+ *
+ * By default the MIDI file is played in virtual time, one IMF tick after another
+ * as fast as the CPU allows, and the register writes are recorded. Writes that do
+ * not change a register are left out and the writes of one tick are merged (see
+ * adlib_batch_begin()), so the IMF needs fewer port writes to play back. On DOS,
+ * -rt plays the file on the OPL in real time instead, recording as it goes.
  */
  
 #include <stdio.h>
+#ifndef LINUX
 #include <conio.h> /* this is where Open Watcom hides the outp() etc. functions */
+#endif
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <malloc.h>
+#include <assert.h>
 #include <ctype.h>
 #include <fcntl.h>
 #include <math.h>
+#ifndef LINUX
 #include <dos.h>
 
 #include <hw/dos/dos.h>
 #include <hw/8254/8254.h>		/* 8254 timer */
 #include <hw/8259/8259.h>
+#endif
 #include <hw/adlib/adlib.h>
 
+#ifndef O_BINARY
+#define O_BINARY (0)
+#endif
+
 int imf_fd = -1;
-int imf_ticks_per_quarter_note = 700;
+int imf_ticks_per_quarter_note = 700;	/* NTS: this is the IMF tick rate in Hz */
+unsigned int imf_quantize = 1;		/* write registers every this many IMF ticks */
+unsigned long imf_tick = 0;		/* IMF tick the current register writes happen at */
+unsigned long imf_entries = 0;
 
 #pragma pack(push,1)
 struct imf_entry {
@@ -78,9 +97,13 @@ static volatile unsigned char	midi_playing=0;
  * NTS: These are for reading reference. Internally we convert everything to 100Hz time base. */
 static unsigned int ticks_per_quarter_note=0;	/* "Ticks per beat" */
 
+static unsigned char		midi_loop=0;	/* restart at the end instead of stopping */
+
+#ifndef LINUX
 static void (interrupt *old_irq0)();
 static volatile unsigned long irq0_ticks=0;
 static volatile unsigned int irq0_cnt=0,irq0_add=0,irq0_max=0;
+#endif
 
 #if TARGET_MSDOS == 16 && (defined(__LARGE__) || defined(__COMPACT__) || defined(__HUGE__))
 static inline unsigned long farptr2phys(unsigned char far *p) { /* take 16:16 pointer convert to physical memory address */
@@ -282,7 +305,8 @@ static struct midi_note *get_fm_note(struct midi_track *t,struct midi_channel *c
 	unsigned int ach = (unsigned int)(ch - midi_ch); /* pointer math */
 	unsigned int i,freen=~0;
 
-	for (i=0;i < ADLIB_FM_VOICES;i++) {
+	/* NTS: only the voices the chip has. IMF files are OPL2 only anyway */
+	for (i=0;i < adlib_fm_voices;i++) {
 		if (midi_notes[i].busy) {
 			if (midi_notes[i].note_channel == ach && midi_notes[i].note_track == tch && midi_notes[i].note_number == key)
 				return &midi_notes[i];
@@ -300,7 +324,7 @@ static void drop_fm_note(struct midi_channel *ch,unsigned char key) {
 	unsigned int ach = (unsigned int)(ch - midi_ch); /* pointer math */
 	unsigned int i;
 
-	for (i=0;i < ADLIB_FM_VOICES;i++) {
+	for (i=0;i < adlib_fm_voices;i++) {
 		if (midi_notes[i].busy && midi_notes[i].note_channel == ach) {
 			midi_notes[i].busy = 0;
 			break;
@@ -469,13 +493,16 @@ void midi_tick_track(unsigned int i) {
 					on_control_change(t,ch,c,d);
 					} break;
 				case 0xC: { /* program change */
+					ch = midi_ch + (b&0xF);
 					on_program_change(t,ch,c); /* c=instrument d=not used */
 					} break;
 				case 0xD: { /* channel aftertouch */
+					ch = midi_ch + (b&0xF);
 					on_channel_aftertouch(t,ch,c); /* c=velocity d=not used */
 					} break;
 				case 0xE: { /* pitch bend */
 					d = midi_trk_read(t);
+					ch = midi_ch + (b&0xF);
 					on_pitch_bend(t,ch,((c&0x7F)|((d&0x7F)<<7))-8192); /* c=LSB d=MSB */
 					} break;
 				case 0xF: { /* event */
@@ -558,6 +585,11 @@ void midi_tick() {
 		}
 
 		if (eof >= midi_trk_count) {
+			if (!midi_loop) {
+				midi_playing = 0;
+				return;
+			}
+
             fprintf(stderr,"MIDI EOF. Restarting\n");
 			adlib_shut_up();
 			midi_reset_tracks();
@@ -566,6 +598,64 @@ void midi_tick() {
 	}
 }
 
+/* IMF output. The entry's delay is the time until the next entry, so each write is held until the next one comes in. */
+#define IMF_BUFFER_ENTRIES	256
+
+static struct imf_entry		imf_buffer[IMF_BUFFER_ENTRIES];
+static unsigned int		imf_buffer_count = 0;
+static struct imf_entry		imf_pending;
+static unsigned long		imf_pending_tick = 0;
+static unsigned char		imf_have_pending = 0;
+
+static void imf_buffer_flush() {
+	if (imf_buffer_count != 0) {
+		write(imf_fd,imf_buffer,imf_buffer_count * sizeof(struct imf_entry));
+		imf_buffer_count = 0;
+	}
+}
+
+static void imf_put(struct imf_entry *ent) {
+	imf_buffer[imf_buffer_count++] = *ent;
+	if (imf_buffer_count >= IMF_BUFFER_ENTRIES) imf_buffer_flush();
+	imf_entries++;
+}
+
+/* write the pending entry with the delay up to tick */
+static void imf_emit_pending(unsigned long tick) {
+	unsigned long delay = tick - imf_pending_tick;
+
+	if (!imf_have_pending) return;
+
+	/* longer silences than the delay field can hold are padded with writes to register 0 */
+	while (delay > 0xFFFFUL) {
+		imf_pending.delay = 0xFFFF;
+		imf_put(&imf_pending);
+		imf_pending.reg = 0;
+		imf_pending.data = 0;
+		delay -= 0xFFFFUL;
+	}
+
+	imf_pending.delay = (uint16_t)delay;
+	imf_put(&imf_pending);
+	imf_have_pending = 0;
+}
+
+static void imf_capture(unsigned short i,unsigned char d) {
+	if (i >= 0x100) return; /* not an OPL2 register, IMF can't have it */
+
+	imf_emit_pending(imf_tick);
+	imf_pending.reg = (uint8_t)i;
+	imf_pending.data = d;
+	imf_pending_tick = imf_tick;
+	imf_have_pending = 1;
+}
+
+static void imf_finish() {
+	imf_emit_pending(imf_tick);
+	imf_buffer_flush();
+}
+
+#ifndef LINUX
 /* WARNING: subroutine call in interrupt handler. make sure you compile with -zu flag for large/compact memory models */
 void interrupt irq0() {
 	irq0_ticks++;
@@ -577,6 +667,7 @@ void interrupt irq0() {
 		p8259_OCW2(0,P8259_OCW2_NON_SPECIFIC_EOI);
 	}
 }
+#endif
 
 void adlib_shut_up() {
 	int i;
@@ -713,7 +804,7 @@ int load_midi_file(const char *path) {
 			if (sz == 0UL) continue;
 #if TARGET_MSDOS == 16 && (defined(__LARGE__) || defined(__COMPACT__) || defined(__HUGE__))
 			if (sz > (640UL << 10UL)) goto err; /* 640KB */
-#elif TARGET_MSDOS == 32
+#elif TARGET_MSDOS == 32 || defined(LINUX)
 			if (sz > (1UL << 20UL)) goto err; /* 1MB */
 #else
 			if (sz > (60UL << 10UL)) goto err; /* 60KB */
@@ -782,13 +873,66 @@ err:
 	return 0;
 }
 
+static void help() {
+	printf("MIDI2IMF [options] <source .mid file> <output .imf file>\n");
+	printf("  -r <hz>      IMF tick rate (default 700)\n");
+	printf("  -q <ticks>   Only write registers every this many ticks (default 1)\n");
+#ifndef LINUX
+	printf("  -rt          Play on the OPL in real time (ESC to stop) instead\n");
+#endif
+}
+
 int main(int argc,char **argv) {
-	unsigned long ptick;
-	int i,c;
+	const char *src_file = NULL,*dst_file = NULL;
+#ifndef LINUX
+	unsigned char realtime = 0;
+#endif
+	unsigned long tick,writes;
+	unsigned int n;
+	const char *a;
+	int i;
 
 	printf("MIDI to IMF converter\n");
-	if (argc < 3) {
-		printf("MIDI2IMF <source .mid file> <output .imf file>\n");
+	for (i=1;i < argc;) {
+		a = argv[i++];
+		if (*a == '-') {
+			do { a++; } while (*a == '-');
+
+			if (!strcmp(a,"r") && i < argc) {
+				imf_ticks_per_quarter_note = atoi(argv[i++]);
+				if (imf_ticks_per_quarter_note < 10 || imf_ticks_per_quarter_note > 10000) {
+					printf("Bad tick rate\n");
+					return 1;
+				}
+			}
+			else if (!strcmp(a,"q") && i < argc) {
+				imf_quantize = (unsigned int)atoi(argv[i++]);
+				if (imf_quantize == 0) imf_quantize = 1;
+			}
+#ifndef LINUX
+			else if (!strcmp(a,"rt")) {
+				realtime = 1;
+			}
+#endif
+			else {
+				help();
+				return 1;
+			}
+		}
+		else if (src_file == NULL) {
+			src_file = a;
+		}
+		else if (dst_file == NULL) {
+			dst_file = a;
+		}
+		else {
+			help();
+			return 1;
+		}
+	}
+
+	if (src_file == NULL || dst_file == NULL) {
+		help();
 		return 1;
 	}
 
@@ -796,10 +940,12 @@ int main(int argc,char **argv) {
 		printf("Cannot init library\n");
 		return 1;
 	}
+#ifndef LINUX
 	if (!probe_8254()) { /* we need the timer to keep time with the music */
 		printf("8254 timer not found\n");
 		return 1;
 	}
+#endif
 
 	for (i=0;i < MIDI_MAX_TRACKS;i++) {
 		midi_trk[i].raw = NULL;
@@ -807,76 +953,108 @@ int main(int argc,char **argv) {
 		midi_trk[i].fence = NULL;
 	}
 
-	if (load_midi_file(argv[1]) == 0) {
+	if (load_midi_file(src_file) == 0) {
 		printf("Failed to load MIDI\n");
 		return 1;
 	}
 
-    imf_fd = open(argv[2],O_WRONLY|O_BINARY|O_CREAT|O_TRUNC,0644);
+    imf_fd = open(dst_file,O_WRONLY|O_BINARY|O_CREAT|O_TRUNC,0644);
     if (imf_fd < 0) {
         printf("Failed to open IMF\n");
         return 1;
     }
 
+    assert(sizeof(struct imf_entry) == 4);
+
+    /* record from here on. forget what the chip has so that the IMF sets every register it needs */
+    adlib_shadow_invalidate();
+    adlib_writes_issued = adlib_writes_suppressed = 0;
+    adlib_write_capture = imf_capture;
+    imf_tick = 0;
+
     /* right away, issue OPL3 commands to key off all notes as fast as possible */
-    {
-        struct imf_entry ent;
-        unsigned int i;
-
-        assert(sizeof(ent) == 4);
-
-        ent.delay = 1;
-        for (i=0;i < 9;i++) {
-            ent.reg = 0xB0 + i;
-            ent.data = 0x00;        /* KEY OFF, block number 0 */
-            write(imf_fd,&ent,sizeof(ent));
-        }
+    for (n=0;n < 9;n++) {
+        adlib_write(0xB0 + n,0x00);	/* KEY OFF, block number 0 */
     }
 
-	write_8254_system_timer(T8254_REF_CLOCK_HZ / imf_ticks_per_quarter_note); /* tick faster at IMF tick rate please */
-	irq0_cnt = 0;
-	irq0_add = 182;
-	irq0_max = 10 * imf_ticks_per_quarter_note; /* about 18.2Hz */
-	old_irq0 = _dos_getvect(8);/*IRQ0*/
-	_dos_setvect(8,irq0);
-
 	adlib_shut_up();
 	midi_reset_channels();
 	midi_reset_tracks();
-	_cli();
-	irq0_ticks = ptick = 0;
-	_sti();
 	midi_playing = 1;
 
-	while (1) {
-		unsigned long adv;
+#ifndef LINUX
+	if (realtime) {
+		unsigned long ptick;
+		int c;
+
+		midi_loop = 1;
+		write_8254_system_timer(T8254_REF_CLOCK_HZ / imf_ticks_per_quarter_note); /* tick faster at IMF tick rate please */
+		irq0_cnt = 0;
+		irq0_add = 182;
+		irq0_max = 10 * imf_ticks_per_quarter_note; /* about 18.2Hz */
+		old_irq0 = _dos_getvect(8);/*IRQ0*/
+		_dos_setvect(8,irq0);
 
 		_cli();
-		adv = irq0_ticks - ptick;
-		if (adv >= 100UL) adv = 100UL;
-		ptick = irq0_ticks;
+		irq0_ticks = ptick = 0;
 		_sti();
 
-		while (adv != 0) {
-			midi_tick();
-			adv--;
-		}
+		while (1) {
+			unsigned long adv;
+
+			_cli();
+			adv = irq0_ticks - ptick;
+			if (adv >= 100UL) adv = 100UL;
+			ptick = irq0_ticks;
+			_sti();
+
+			while (adv != 0) {
+				adlib_batch_begin();
+				midi_tick();
+				adlib_flush();
+				imf_tick++;
+				adv--;
+			}
 
-		if (kbhit()) {
-			c = getch();
-			if (c == 0) c = getch() << 8;
+			if (kbhit()) {
+				c = getch();
+				if (c == 0) c = getch() << 8;
 
-			if (c == 27) {
-				break;
+				if (c == 27) {
+					break;
+				}
 			}
 		}
+
+		_dos_setvect(8,old_irq0);
+		write_8254_system_timer(0); /* back to normal 18.2Hz */
+	}
+	else
+#endif
+	{
+		/* virtual time. register writes of each group of ticks are merged and written at the start of the group */
+		for (tick=0;midi_playing;tick += n) {
+			imf_tick = tick;
+			adlib_batch_begin();
+			for (n=0;n < imf_quantize && midi_playing;n++)
+				midi_tick();
+
+			adlib_flush();
+		}
+
+		imf_tick = tick;
 	}
 
 	midi_playing = 0;
 	adlib_shut_up();
+	imf_finish();
+	adlib_write_capture = NULL;
 	shutdown_adlib();
-	_dos_setvect(8,old_irq0);
-	write_8254_system_timer(0); /* back to normal 18.2Hz */
+
+	writes = adlib_writes_issued + adlib_writes_suppressed;
+	printf("%lu ticks (%.1f seconds) at %uHz, %lu IMF entries, %lu of %lu register writes left out\n",
+		imf_tick,(double)imf_tick / imf_ticks_per_quarter_note,imf_ticks_per_quarter_note,
+		imf_entries,adlib_writes_suppressed,writes);
 
 	for (i=0;i < MIDI_MAX_TRACKS;i++) {
 		if (midi_trk[i].raw) {
@@ -894,4 +1072,3 @@ int main(int argc,char **argv) {
     close(imf_fd);
 	return 0;
 }
-
@@ -3,14 +3,14 @@
 NOW_BUILDING = HW_ULTRASND_LIB
 CFLAGS_THIS = -fr=nul -fo=$(SUBDIR)$(HPS).obj -i.. -i"../.."
 
-C_SOURCE =    ultrasnd.c
-OBJS =        $(SUBDIR)$(HPS)ultrasnd.obj
+C_SOURCE =    ultrasnd.c gusheap.c gusxfer.c
+OBJS =        $(SUBDIR)$(HPS)ultrasnd.obj $(SUBDIR)$(HPS)gusheap.obj $(SUBDIR)$(HPS)gusxfer.obj
 TEST_EXE =    $(SUBDIR)$(HPS)test.$(EXEEXT)
 TSRS_EXE =    $(SUBDIR)$(HPS)tsrs.$(EXEEXT)
 MODPLAY_EXE = $(SUBDIR)$(HPS)modplay.$(EXEEXT)
 
 $(HW_ULTRASND_LIB): $(OBJS)
-	wlib -q -b -c $(HW_ULTRASND_LIB) -+$(SUBDIR)$(HPS)ultrasnd.obj
+	wlib -q -b -c $(HW_ULTRASND_LIB) -+$(SUBDIR)$(HPS)ultrasnd.obj -+$(SUBDIR)$(HPS)gusheap.obj -+$(SUBDIR)$(HPS)gusxfer.obj
 
 # NTS we have to construct the command line into tmp.cmd because for MS-DOS
 # systems all arguments would exceed the pitiful 128 char command line limit
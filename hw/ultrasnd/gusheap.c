@@ -0,0 +1,175 @@
+/* GUS DRAM heap.
+ *
+ * Keeps track of what is where in GUS DRAM, so that programs can load and unload samples
+ * instead of laying them out once from the bottom up. The heap is a short array of blocks
+ * in address order that together cover the whole DRAM. Allocation is best fit, which
+ * keeps the big free blocks big for the big samples that come later.
+ *
+ * Every allocation is aligned for DMA (ULTRASND_DRAM_ALIGN). Allocations can be kept
+ * within a 256KB bank, which 16-bit samples need (the GF1 16-bit address translation
+ * cannot cross one) and which everything needs on cards where boundary256k is set. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <hw/ultrasnd/ultrasnd.h>
+
+void ultrasnd_dram_heap_init(struct ultrasnd_dram_heap *h,uint32_t total_ram,uint32_t reserve,uint8_t boundary256k) {
+	memset(h,0,sizeof(*h));
+	h->total = total_ram;
+	h->boundary256k = boundary256k;
+
+	reserve = (reserve + ULTRASND_DRAM_ALIGN - 1UL) & (~(ULTRASND_DRAM_ALIGN - 1UL));
+	if (reserve > total_ram) reserve = total_ram;
+
+	/* the bottom of DRAM is often kept for a few bytes of silence to park idle voices on */
+	if (reserve != 0UL) {
+		h->block[h->blocks].ofs = 0;
+		h->block[h->blocks].len = reserve;
+		h->block[h->blocks].used = 1;
+		h->blocks++;
+	}
+	if (reserve < total_ram) {
+		h->block[h->blocks].ofs = reserve;
+		h->block[h->blocks].len = total_ram - reserve;
+		h->block[h->blocks].used = 0;
+		h->blocks++;
+	}
+}
+
+/* where len bytes would go in free block b, or ULTRASND_DRAM_NONE */
+static uint32_t ultrasnd_dram_fit(const struct ultrasnd_dram_block *b,uint32_t len,unsigned int flags) {
+	uint32_t s = (b->ofs + ULTRASND_DRAM_ALIGN - 1UL) & (~(ULTRASND_DRAM_ALIGN - 1UL));
+
+	if ((flags & ULTRASND_DRAM_ALLOC_BANK) && (s / ULTRASND_DRAM_BANK) != ((s + len - 1UL) / ULTRASND_DRAM_BANK)) {
+		if (len > ULTRASND_DRAM_BANK) return ULTRASND_DRAM_NONE;
+		s = (s + ULTRASND_DRAM_BANK) & (~(ULTRASND_DRAM_BANK - 1UL)); /* start of the next bank */
+	}
+
+	if (s < b->ofs || (s - b->ofs) >= b->len || (b->len - (s - b->ofs)) < len)
+		return ULTRASND_DRAM_NONE;
+
+	return s;
+}
+
+/* make room for n more blocks after index i */
+static int ultrasnd_dram_insert(struct ultrasnd_dram_heap *h,unsigned int i,unsigned int n) {
+	if ((h->blocks + n) > ULTRASND_DRAM_BLOCKS) return 0;
+	memmove(&h->block[i+1+n],&h->block[i+1],(h->blocks - (i+1)) * sizeof(struct ultrasnd_dram_block));
+	h->blocks += n;
+	return 1;
+}
+
+/* returns the DRAM address, or ULTRASND_DRAM_NONE */
+uint32_t ultrasnd_dram_alloc(struct ultrasnd_dram_heap *h,uint32_t len,unsigned int flags) {
+	uint32_t s,best_s = ULTRASND_DRAM_NONE,waste,best_waste = 0xFFFFFFFFUL,pre,post;
+	unsigned int i,best = 0;
+	struct ultrasnd_dram_block *b;
+
+	if (len == 0UL) return ULTRASND_DRAM_NONE;
+	len = (len + ULTRASND_DRAM_ALIGN - 1UL) & (~(ULTRASND_DRAM_ALIGN - 1UL));
+	if (h->boundary256k) flags |= ULTRASND_DRAM_ALLOC_BANK;
+
+	for (i=0;i < h->blocks;i++) {
+		b = &h->block[i];
+		if (b->used || b->len < len) continue;
+		if ((s=ultrasnd_dram_fit(b,len,flags)) == ULTRASND_DRAM_NONE) continue;
+
+		waste = b->len - len;
+		if (waste < best_waste) {
+			best_waste = waste;
+			best_s = s;
+			best = i;
+			if (waste == 0UL) break;
+		}
+	}
+
+	if (best_s == ULTRASND_DRAM_NONE)
+		return ULTRASND_DRAM_NONE;
+
+	/* split into [free pre] [used] [free post] */
+	b = &h->block[best];
+	pre = best_s - b->ofs;
+	post = b->len - pre - len;
+	if (!ultrasnd_dram_insert(h,best,(pre != 0UL ? 1u : 0u) + (post != 0UL ? 1u : 0u)))
+		return ULTRASND_DRAM_NONE; /* out of blocks */
+
+	if (pre != 0UL) {
+		b->len = pre;
+		b++;
+	}
+	b->ofs = best_s;
+	b->len = len;
+	b->used = 1;
+	if (post != 0UL) {
+		b[1].ofs = best_s + len;
+		b[1].len = post;
+		b[1].used = 0;
+	}
+
+	return best_s;
+}
+
+/* returns 1 if freed, 0 if ofs is not an allocation */
+int ultrasnd_dram_free(struct ultrasnd_dram_heap *h,uint32_t ofs) {
+	unsigned int i,lo,hi;
+
+	for (i=0;i < h->blocks && h->block[i].ofs != ofs;i++);
+	if (i >= h->blocks || !h->block[i].used)
+		return 0;
+
+	/* merge with the free neighbors */
+	h->block[i].used = 0;
+	lo = hi = i;
+	if (lo > 0 && !h->block[lo-1].used) lo--;
+	if ((hi+1) < h->blocks && !h->block[hi+1].used) hi++;
+
+	if (lo != hi) {
+		h->block[lo].len = (h->block[hi].ofs + h->block[hi].len) - h->block[lo].ofs;
+		memmove(&h->block[lo+1],&h->block[hi+1],(h->blocks - (hi+1)) * sizeof(struct ultrasnd_dram_block));
+		h->blocks -= hi - lo;
+	}
+
+	return 1;
+}
+
+/* total free DRAM */
+uint32_t ultrasnd_dram_heap_avail(struct ultrasnd_dram_heap *h) {
+	uint32_t r = 0;
+	unsigned int i;
+
+	for (i=0;i < h->blocks;i++) {
+		if (!h->block[i].used) r += h->block[i].len;
+	}
+
+	return r;
+}
+
+/* largest allocation that would succeed with these flags */
+uint32_t ultrasnd_dram_heap_largest(struct ultrasnd_dram_heap *h,unsigned int flags) {
+	uint32_t r = 0,s,e,l;
+	unsigned int i;
+
+	if (h->boundary256k) flags |= ULTRASND_DRAM_ALLOC_BANK;
+
+	for (i=0;i < h->blocks;i++) {
+		if (h->block[i].used) continue;
+
+		s = (h->block[i].ofs + ULTRASND_DRAM_ALIGN - 1UL) & (~(ULTRASND_DRAM_ALIGN - 1UL));
+		e = h->block[i].ofs + h->block[i].len;
+		while (s < e) {
+			l = e - s;
+			if (flags & ULTRASND_DRAM_ALLOC_BANK) {
+				const uint32_t be = (s + ULTRASND_DRAM_BANK) & (~(ULTRASND_DRAM_BANK - 1UL));
+				if (l > (be - s)) l = be - s;
+			}
+			l &= ~(ULTRASND_DRAM_ALIGN - 1UL);
+			if (r < l) r = l;
+			if (!(flags & ULTRASND_DRAM_ALLOC_BANK)) break;
+			s = (s + ULTRASND_DRAM_BANK) & (~(ULTRASND_DRAM_BANK - 1UL));
+		}
+	}
+
+	return r;
+}
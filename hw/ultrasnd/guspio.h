@@ -0,0 +1,51 @@
+/* PIO upload to GF1 DRAM through the DRAM I/O port, shared by ultrasnd.c and the simulated GF1 in
+ * gussim.c (which defines outp(), outpw(), get_cpu_flags(), _cli() and _sti_if_flags() to its own port model).
+ *
+ * The GF1 does not advance the DRAM address by itself, but the address only needs the low 16 bits
+ * written for each byte, with register 0x43 already selected, and none of the settle delays
+ * ultrasnd_select_write() does for the voice registers (the GUS SDK does not delay for DRAM I/O
+ * either). That is 2 I/O writes per byte instead of ultrasnd_poke()'s 30 or so.
+ *
+ * Keeping register 0x43 selected across the transfer is only safe while nothing else can touch the
+ * register select, and an IRQ handler (ours for the voices, or the DMA TC) will. So the transfer is
+ * done in chunks of ULTRASND_PIO_CHUNK bytes with interrupts off, the register select and the upper
+ * address bits written again at the start of each one, and interrupts let through between chunks. */
+
+static void ultrasnd_pio_write_chunks(struct ultrasnd_ctx *u,uint32_t ofs,const unsigned char FAR *src,unsigned long len,uint16_t flags) {
+	/* 0x80 to flip every byte (8-bit) or every odd byte (16-bit) */
+	const unsigned char flip = (flags & ULTRASND_DMA_FLIP_MSB) ? 0x80 : 0x00;
+	const unsigned char odd = (flags & ULTRASND_DMA_DATA_SIZE_16BIT) ? 1 : 0;
+	unsigned long i = 0;
+	unsigned int cpu_flags;
+	unsigned int c,n;
+	uint16_t lo;
+
+	if (ofs & 0xFF000000UL) return; /* The GUS only has 24-bit addressing */
+
+	while (i < len) {
+		/* no more than a chunk, and never across a 64KB page of the address */
+		lo = (uint16_t)ofs;
+		c = ULTRASND_PIO_CHUNK;
+		if ((unsigned long)c > (len - i)) c = (unsigned int)(len - i);
+		if ((unsigned long)c > (0x10000UL - lo)) c = (unsigned int)(0x10000UL - lo);
+
+		cpu_flags = get_cpu_flags();
+		_cli();
+		outp(u->port+0x103,0x44); /* 0x44: DRAM address upper 8 bits */
+		outp(u->port+0x105,(uint8_t)(ofs >> 16UL));
+		outp(u->port+0x103,0x43); /* 0x43: DRAM address low 16 bits */
+		n = c;
+		do {
+			outpw(u->port+0x104,lo);
+			if (odd)
+				outp(u->port+0x107,src[i] ^ ((i & 1ul) ? flip : 0x00));
+			else
+				outp(u->port+0x107,src[i] ^ flip);
+			i++;
+			lo++;
+		} while (--n != 0u);
+		_sti_if_flags(cpu_flags);
+
+		ofs += c;
+	}
+}
@@ -0,0 +1,232 @@
+/* Simulated GF1 DRAM and DMA, for the Linux host. See gussim.h */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hw/ultrasnd/ultrasnd.h>
+#include <hw/ultrasnd/gussim.h>
+
+#if defined(LINUX)
+
+/* stands in for the 8237 library's DMA buffer */
+struct dma_8237_allocation {
+	unsigned char*	lin;
+	uint32_t	phys;
+	uint32_t	length;
+};
+
+struct ultrasnd_sim ultrasnd_sim;
+
+static void ultrasnd_sim_error(const char *what,uint32_t ofs,unsigned long len) {
+	fprintf(stderr,"GF1 sim: %s (ofs=0x%lx len=%lu)\n",what,(unsigned long)ofs,len);
+	ultrasnd_sim.errors++;
+}
+
+int ultrasnd_sim_init(struct ultrasnd_ctx *u,uint32_t dram_size,int8_t dma) {
+	memset(u,0,sizeof(*u));
+	u->port = 0x240;
+	u->dma1 = u->dma2 = dma;
+	u->irq1 = u->irq2 = -1;
+	u->total_ram = dram_size;
+	u->use_dma = (dma >= 0) ? 1 : 0;
+
+	memset(&ultrasnd_sim,0,sizeof(ultrasnd_sim));
+	if ((ultrasnd_sim.dram = malloc(dram_size)) == NULL) return 0;
+	memset(ultrasnd_sim.dram,0xAA,dram_size);
+	ultrasnd_sim.dram_size = dram_size;
+	ultrasnd_sim.dma_polls = 4;
+	ultrasnd_sim.cpu_if = 1;
+	return 1;
+}
+
+void ultrasnd_sim_free(struct ultrasnd_ctx *u) {
+	ultrasnd_dram_buffer_free(u);
+	free(ultrasnd_sim.dram);
+	free(ultrasnd_sim.dma_snapshot);
+	memset(&ultrasnd_sim,0,sizeof(ultrasnd_sim));
+}
+
+unsigned char FAR *ultrasnd_dram_buffer_alloc(struct ultrasnd_ctx *u,unsigned long len) {
+	if (len >= 0xFF00UL) {
+		ultrasnd_dram_buffer_free(u);
+		return NULL;
+	}
+
+	if (u->dram_xfer_a != NULL) {
+		if (len <= u->dram_xfer_a->length) return u->dram_xfer_a->lin;
+		ultrasnd_dram_buffer_free(u);
+	}
+
+	if ((u->dram_xfer_a = malloc(sizeof(struct dma_8237_allocation))) == NULL)
+		return NULL;
+	if ((u->dram_xfer_a->lin = malloc(len)) == NULL) {
+		free(u->dram_xfer_a);
+		u->dram_xfer_a = NULL;
+		return NULL;
+	}
+	u->dram_xfer_a->phys = 0x10000UL;
+	u->dram_xfer_a->length = len;
+	return u->dram_xfer_a->lin;
+}
+
+void ultrasnd_dram_buffer_free(struct ultrasnd_ctx *u) {
+	if (u->dram_xfer_a != NULL) {
+		free(u->dram_xfer_a->lin);
+		free(u->dram_xfer_a);
+		u->dram_xfer_a = NULL;
+	}
+}
+
+/* copy into DRAM the way the GF1 would, with the MSB flip */
+static void ultrasnd_sim_store(uint32_t ofs,const unsigned char *src,unsigned long len,uint16_t flags) {
+	unsigned long i;
+	unsigned char b;
+
+	if (ofs >= ultrasnd_sim.dram_size || len > (ultrasnd_sim.dram_size - ofs)) {
+		ultrasnd_sim_error("write past the end of DRAM",ofs,len);
+		return;
+	}
+
+	for (i=0;i < len;i++) {
+		b = src[i];
+		if ((flags & ULTRASND_DMA_FLIP_MSB) && (!(flags & ULTRASND_DMA_DATA_SIZE_16BIT) || (i & 1ul)))
+			b ^= 0x80;
+		ultrasnd_sim.dram[ofs+i] = b;
+	}
+}
+
+void ultrasnd_dma_write_start(struct ultrasnd_ctx *u,uint32_t buf_ofs,uint32_t ofs,unsigned long len,uint16_t flags) {
+	if (ultrasnd_sim.dma_busy)
+		ultrasnd_sim_error("DMA started while another is running",ofs,len);
+	if (u->dram_xfer_a == NULL || (buf_ofs + len) > u->dram_xfer_a->length) {
+		ultrasnd_sim_error("DMA outside the DMA buffer",ofs,len);
+		return;
+	}
+	if (!ultrasnd_dma_write_ok(u,ofs,len,flags))
+		ultrasnd_sim_error("DMA transfer the GF1 cannot do",ofs,len);
+	if (u->dma1 >= 4 && (ofs / ULTRASND_DRAM_BANK) != ((ofs + len - 1UL) / ULTRASND_DRAM_BANK))
+		ultrasnd_sim_error("16-bit DMA across a 256KB bank",ofs,len);
+	if (len == 0UL || len > 0xFF00UL)
+		ultrasnd_sim_error("DMA length",ofs,len);
+
+	free(ultrasnd_sim.dma_snapshot);
+	if ((ultrasnd_sim.dma_snapshot = malloc(len)) != NULL)
+		memcpy(ultrasnd_sim.dma_snapshot,u->dram_xfer_a->lin + buf_ofs,len);
+
+	ultrasnd_sim.dma_busy = 1;
+	ultrasnd_sim.dma_ofs = ofs;
+	ultrasnd_sim.dma_buf_ofs = buf_ofs;
+	ultrasnd_sim.dma_len = len;
+	ultrasnd_sim.dma_flags = flags;
+	ultrasnd_sim.dma_left = 1u + (unsigned int)((len * ultrasnd_sim.dma_polls) >> 10UL);
+	ultrasnd_sim.dma_transfers++;
+	ultrasnd_sim.dma_bytes += len;
+}
+
+static void ultrasnd_sim_dma_complete(struct ultrasnd_ctx *u) {
+	const unsigned char *src = u->dram_xfer_a->lin + ultrasnd_sim.dma_buf_ofs;
+
+	if (ultrasnd_sim.dma_snapshot != NULL && memcmp(ultrasnd_sim.dma_snapshot,src,ultrasnd_sim.dma_len) != 0)
+		ultrasnd_sim_error("DMA buffer changed during the transfer",ultrasnd_sim.dma_ofs,ultrasnd_sim.dma_len);
+
+	ultrasnd_sim_store(ultrasnd_sim.dma_ofs,src,ultrasnd_sim.dma_len,ultrasnd_sim.dma_flags);
+	ultrasnd_sim.dma_busy = 0;
+}
+
+int ultrasnd_dma_write_done(struct ultrasnd_ctx *u,uint16_t flags) {
+	(void)flags;
+
+	if (!ultrasnd_sim.dma_busy) {
+		ultrasnd_sim_error("DMA polled with no transfer",0,0);
+		return 1;
+	}
+
+	ultrasnd_sim.polls++;
+	if (--ultrasnd_sim.dma_left != 0u)
+		return 0;
+
+	ultrasnd_sim_dma_complete(u);
+	return 1;
+}
+
+int ultrasnd_dma_write_wait(struct ultrasnd_ctx *u,uint16_t flags) {
+	while (!ultrasnd_dma_write_done(u,flags));
+	return 1;
+}
+
+/* what a voice IRQ handler does between two instructions of the interrupted code: peek at DRAM
+ * somewhere else, then read the IRQ source register. It does not put the register select back. */
+static void ultrasnd_sim_irq(void) {
+	ultrasnd_sim.irq_pending = 0;
+	ultrasnd_sim.irqs++;
+	ultrasnd_sim.dram_addr = 0x0F1234UL; /* registers 0x43 and 0x44 */
+	ultrasnd_sim.reg = 0x8F; /* 0x8F: IRQ source */
+}
+
+/* GF1 register select and DRAM I/O ports, enough of them for guspio.h */
+
+static void ultrasnd_sim_port(uint16_t port,uint16_t val,int word) {
+	ultrasnd_sim.pio_io++;
+
+	/* the IRQ is raised every so often, and taken right away if interrupts are enabled */
+	if (ultrasnd_sim.irq_every != 0u && --ultrasnd_sim.irq_wait == 0u) {
+		ultrasnd_sim.irq_wait = ultrasnd_sim.irq_every;
+		ultrasnd_sim.irq_pending = 1;
+	}
+	if (ultrasnd_sim.irq_pending && ultrasnd_sim.cpu_if)
+		ultrasnd_sim_irq();
+
+	switch (port - 0x240u) {
+		case 0x103:
+			ultrasnd_sim.reg = (uint8_t)val;
+			break;
+		case 0x104:
+			if (word && ultrasnd_sim.reg == 0x43)
+				ultrasnd_sim.dram_addr = (ultrasnd_sim.dram_addr & 0xFF0000UL) | val;
+			else
+				ultrasnd_sim_error("PIO data write to the wrong GF1 register",ultrasnd_sim.dram_addr,ultrasnd_sim.reg);
+			break;
+		case 0x105:
+			if (ultrasnd_sim.reg == 0x44)
+				ultrasnd_sim.dram_addr = (ultrasnd_sim.dram_addr & 0xFFFFUL) | ((uint32_t)(val & 0xFFu) << 16UL);
+			else
+				ultrasnd_sim_error("PIO data write to the wrong GF1 register",ultrasnd_sim.dram_addr,ultrasnd_sim.reg);
+			break;
+		case 0x107:
+			if (ultrasnd_sim.dram_addr < ultrasnd_sim.dram_size)
+				ultrasnd_sim.dram[ultrasnd_sim.dram_addr] = (uint8_t)val;
+			else
+				ultrasnd_sim_error("DRAM I/O past the end of DRAM",ultrasnd_sim.dram_addr,1);
+			break;
+		default:
+			ultrasnd_sim_error("write to an unknown GF1 port",port,val);
+			break;
+	}
+}
+
+#define outp(p,v)		ultrasnd_sim_port((p),(v),0)
+#define outpw(p,v)		ultrasnd_sim_port((p),(v),1)
+#define get_cpu_flags()		(ultrasnd_sim.cpu_if ? 0x200u : 0u)
+#define _cli()			(ultrasnd_sim.cpu_if = 0)
+#define _sti_if_flags(f)	ultrasnd_sim_sti_if_flags(f)
+
+static void ultrasnd_sim_sti_if_flags(unsigned int f) {
+	if (f & 0x200u) {
+		ultrasnd_sim.cpu_if = 1;
+		if (ultrasnd_sim.irq_pending) ultrasnd_sim_irq();
+	}
+}
+
+#include <hw/ultrasnd/guspio.h>
+
+void ultrasnd_pio_write(struct ultrasnd_ctx *u,uint32_t ofs,const unsigned char FAR *src,unsigned long len,uint16_t flags) {
+	if (ultrasnd_sim.dma_busy)
+		ultrasnd_sim_error("PIO while DMA is running",ofs,len);
+
+	ultrasnd_sim.pio_bytes += len;
+	ultrasnd_pio_write_chunks(u,ofs,src,len,flags);
+}
+
+#endif /* LINUX */
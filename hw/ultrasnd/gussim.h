@@ -0,0 +1,41 @@
+
+/* Simulated GF1 for testing the DRAM heap and upload queue on the Linux host (gussim.c).
+ * It takes the place of the hardware half of ultrasnd.c: DMA transfers land in a DRAM array after
+ * a number of polls, as if the card were busy, and every transfer is checked against the rules
+ * the real card has (alignment, 16-bit DMA within a 256KB bank, one transfer at a time). PIO goes
+ * through the same code as on the real card (guspio.h) against a model of the GF1 register select
+ * and DRAM I/O ports, with a simulated IRQ handler that selects another register now and then. */
+
+struct ultrasnd_sim {
+	unsigned char*	dram;
+	uint32_t	dram_size;
+	unsigned int	dma_polls;	/* polls until a DMA transfer completes, per 1KB */
+	/* transfer in progress */
+	uint8_t		dma_busy;
+	uint32_t	dma_ofs;
+	uint32_t	dma_buf_ofs;
+	uint32_t	dma_len;
+	uint16_t	dma_flags;
+	unsigned int	dma_left;	/* polls left */
+	unsigned char*	dma_snapshot;	/* buffer contents at start, to catch the caller overwriting it during the transfer */
+	/* GF1 ports */
+	uint8_t		reg;		/* register selected at 3x3 */
+	uint32_t	dram_addr;	/* registers 0x43 and 0x44 */
+	uint8_t		cpu_if;		/* interrupts enabled */
+	unsigned int	irq_every;	/* port writes with interrupts enabled between simulated IRQs (0 = none) */
+	unsigned int	irq_wait;
+	uint8_t		irq_pending;	/* raised while interrupts were disabled */
+	/* counters */
+	unsigned long	dma_transfers;
+	unsigned long	dma_bytes;
+	unsigned long	pio_bytes;
+	unsigned long	pio_io;		/* I/O port writes made by the PIO path */
+	unsigned long	irqs;		/* simulated IRQs taken */
+	unsigned long	polls;
+	unsigned long	errors;
+};
+
+extern struct ultrasnd_sim ultrasnd_sim;
+
+int ultrasnd_sim_init(struct ultrasnd_ctx *u,uint32_t dram_size,int8_t dma);
+void ultrasnd_sim_free(struct ultrasnd_ctx *u);
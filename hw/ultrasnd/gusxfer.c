@@ -0,0 +1,204 @@
+/* GUS DRAM upload queue.
+ *
+ * ultrasnd_send_dram_buffer() starts a DMA transfer and waits for it, so a program loading
+ * samples spends its time either reading the file or waiting for the GUS, never both at once.
+ * The upload queue splits the DMA buffer into ULTRASND_UPLOAD_SLOTS slots. The caller fills
+ * a slot and queues it, and the next slot is free to fill while the GUS takes the previous one.
+ * Transfers happen in the order queued, one at a time (the GUS has one DMA engine).
+ *
+ * A slot that cannot go by DMA (no DMA channel, /nodma, unaligned DRAM address) is written
+ * with ultrasnd_pio_write() when its turn comes. DMA on a 16-bit channel is subject to the
+ * 16-bit address translation and cannot cross a 256KB bank, so such a slot goes in two transfers.
+ *
+ *   ultrasnd_upload_begin(&q,u,4096);
+ *   while (...) {
+ *       p = ultrasnd_upload_get(&q);          <- waits only if every slot is still queued
+ *       ... fill p with up to q.slot_size bytes ...
+ *       ultrasnd_upload_put(&q,dram_ofs,len,flags);
+ *   }
+ *   ultrasnd_upload_end(&q);                  <- waits for the rest, frees the DMA buffer */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <hw/ultrasnd/ultrasnd.h>
+
+/* whether a transfer can go by DMA (the rules ultrasnd_send_dram_buffer() has always applied) */
+int ultrasnd_dma_write_ok(struct ultrasnd_ctx *u,uint32_t ofs,unsigned long len,uint16_t flags) {
+	if (!u->use_dma || u->dma1 < 0)
+		return 0;
+	/* cannot do half-word transfers when 16-bit is involved */
+	if ((len & 1) && ((u->dma1 >= 4) || (flags & ULTRASND_DMA_DATA_SIZE_16BIT)))
+		return 0;
+	/* the target DRAM address must be 16-bit aligned (32-bit aligned for 16-bit audio) */
+	if ((ofs & 0xF) != 0)
+		return 0;
+	if (u->dma1 >= 4 && (ofs & 0x1F) != 0)
+		return 0;
+
+	return 1;
+}
+
+int ultrasnd_upload_begin(struct ultrasnd_upload *q,struct ultrasnd_ctx *u,unsigned int slot_size) {
+	memset(q,0,sizeof(*q));
+	if (u == NULL) return 0;
+
+	/* keep DMA transfers aligned for 16-bit channels */
+	slot_size &= ~0x1Fu;
+	if (slot_size == 0u || ((unsigned long)slot_size * ULTRASND_UPLOAD_SLOTS) >= 0xFF00UL)
+		return 0;
+
+	if ((q->buf = ultrasnd_dram_buffer_alloc(u,(unsigned long)slot_size * ULTRASND_UPLOAD_SLOTS)) == NULL)
+		return 0;
+
+	q->u = u;
+	q->slot_size = (uint16_t)slot_size;
+	return 1;
+}
+
+/* start the DMA transfer for the rest of slot i */
+static void ultrasnd_upload_start(struct ultrasnd_upload *q,unsigned int i) {
+	struct ultrasnd_upload_slot *s = &q->slot[i];
+	const uint32_t ofs = s->ofs + s->done;
+	uint32_t len = (uint32_t)(s->len - s->done);
+
+	if (q->u->dma1 >= 4) {
+		const uint32_t bank_end = (ofs + ULTRASND_DRAM_BANK) & (~(ULTRASND_DRAM_BANK - 1UL));
+		if (len > (bank_end - ofs)) len = bank_end - ofs;
+	}
+
+	s->xfer = (uint16_t)len;
+	s->state = ULTRASND_UPLOAD_DMA;
+	ultrasnd_dma_write_start(q->u,((uint32_t)i * q->slot_size) + s->done,ofs,len,s->flags);
+	q->dma_transfers++;
+}
+
+/* the transfer in progress finished (or failed) */
+static void ultrasnd_upload_finish(struct ultrasnd_upload *q,int ok) {
+	struct ultrasnd_upload_slot *s = &q->slot[q->next];
+
+	if (!ok) q->error = 1;
+	s->done += s->xfer;
+	s->xfer = 0;
+
+	if (s->done < s->len && ok) {
+		ultrasnd_upload_start(q,q->next);
+	}
+	else {
+		s->state = ULTRASND_UPLOAD_FREE;
+		q->next = (uint8_t)((q->next + 1u) % ULTRASND_UPLOAD_SLOTS);
+	}
+}
+
+/* move the queue along without waiting. returns the number of slots not yet in DRAM */
+unsigned int ultrasnd_upload_poll(struct ultrasnd_upload *q) {
+	struct ultrasnd_upload_slot *s;
+	unsigned int i,r = 0;
+
+	do {
+		s = &q->slot[q->next];
+
+		if (s->state == ULTRASND_UPLOAD_DMA) {
+			if (!ultrasnd_dma_write_done(q->u,s->flags))
+				break;
+
+			ultrasnd_upload_finish(q,1);
+		}
+		else if (s->state == ULTRASND_UPLOAD_QUEUED) {
+			if (ultrasnd_dma_write_ok(q->u,s->ofs,s->len,s->flags)) {
+				ultrasnd_upload_start(q,q->next);
+			}
+			else {
+				ultrasnd_pio_write(q->u,s->ofs,q->buf + ((uint32_t)q->next * q->slot_size),s->len,s->flags);
+				q->pio_transfers++;
+				s->state = ULTRASND_UPLOAD_FREE;
+				q->next = (uint8_t)((q->next + 1u) % ULTRASND_UPLOAD_SLOTS);
+			}
+		}
+		else {
+			break;
+		}
+	} while (1);
+
+	for (i=0;i < ULTRASND_UPLOAD_SLOTS;i++) {
+		if (q->slot[i].state == ULTRASND_UPLOAD_QUEUED || q->slot[i].state == ULTRASND_UPLOAD_DMA) r++;
+	}
+
+	return r;
+}
+
+/* wait for the transfer in progress */
+static void ultrasnd_upload_wait(struct ultrasnd_upload *q) {
+	struct ultrasnd_upload_slot *s = &q->slot[q->next];
+
+	if (s->state == ULTRASND_UPLOAD_DMA)
+		ultrasnd_upload_finish(q,ultrasnd_dma_write_wait(q->u,s->flags));
+}
+
+/* a slot for the caller to fill with up to slot_size bytes, or NULL if the caller still holds it */
+unsigned char FAR *ultrasnd_upload_get(struct ultrasnd_upload *q) {
+	struct ultrasnd_upload_slot *s;
+
+	if (q->buf == NULL) return NULL;
+
+	ultrasnd_upload_poll(q);
+	s = &q->slot[q->fill];
+	if (s->state == ULTRASND_UPLOAD_FILLING)
+		return NULL;
+
+	if (s->state != ULTRASND_UPLOAD_FREE) {
+		q->stalls++;
+		do {
+			ultrasnd_upload_wait(q);
+			ultrasnd_upload_poll(q);
+		} while (s->state != ULTRASND_UPLOAD_FREE);
+	}
+
+	if (q->slot[q->next].state == ULTRASND_UPLOAD_DMA)
+		q->overlapped++;
+
+	s->state = ULTRASND_UPLOAD_FILLING;
+	return q->buf + ((uint32_t)q->fill * q->slot_size);
+}
+
+/* queue the slot from ultrasnd_upload_get() for transfer to DRAM at ofs */
+int ultrasnd_upload_put(struct ultrasnd_upload *q,uint32_t ofs,unsigned int len,uint16_t flags) {
+	struct ultrasnd_upload_slot *s = &q->slot[q->fill];
+
+	if (q->buf == NULL || s->state != ULTRASND_UPLOAD_FILLING || len > q->slot_size)
+		return 0;
+
+	if (len == 0u) {
+		s->state = ULTRASND_UPLOAD_FREE;
+		return 1;
+	}
+
+	s->ofs = ofs;
+	s->len = (uint16_t)len;
+	s->done = 0;
+	s->xfer = 0;
+	s->flags = flags;
+	s->state = ULTRASND_UPLOAD_QUEUED;
+	q->fill = (uint8_t)((q->fill + 1u) % ULTRASND_UPLOAD_SLOTS);
+	q->bytes += len;
+
+	ultrasnd_upload_poll(q);
+	return 1;
+}
+
+/* finish every transfer and free the DMA buffer. returns 0 if a transfer timed out */
+int ultrasnd_upload_end(struct ultrasnd_upload *q) {
+	if (q->buf == NULL) return 0;
+
+	/* a slot taken but never queued is dropped */
+	if (q->slot[q->fill].state == ULTRASND_UPLOAD_FILLING)
+		q->slot[q->fill].state = ULTRASND_UPLOAD_FREE;
+
+	while (ultrasnd_upload_poll(q) != 0u)
+		ultrasnd_upload_wait(q);
+
+	ultrasnd_dram_buffer_free(q->u);
+	q->buf = NULL;
+	return !q->error;
+}
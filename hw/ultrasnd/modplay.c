@@ -246,12 +246,13 @@ void play_mod() {
     begin_pattern();
 }
 
+struct ultrasnd_dram_heap dram_heap;
+
 int load_mod() {
-    unsigned long rammax;
-    unsigned long ramofs[4];
+    struct ultrasnd_upload upload;
     unsigned long sof;
     unsigned long tof;
-    unsigned int i,ri;
+    unsigned int i;
     int fd;
 
     // default Amiga panning
@@ -262,12 +263,8 @@ int load_mod() {
         chpan[3] = 0;//left
     }
 
-    rammax = 256ul << 10ul;
-
-    ramofs[0] = 0;
-    ramofs[1] = 0;
-    ramofs[2] = 0;
-    ramofs[3] = 0;
+    // the first 32 bytes are left alone for idle voices to sit on
+    ultrasnd_dram_heap_init(&dram_heap,gus->total_ram,32,gus->boundary256k);
 
     fd = open(mod_file,O_RDONLY | O_BINARY);
     if (fd < 0) return 0;
@@ -383,18 +380,10 @@ int load_mod() {
         s->ram_offset = ~0ul;
 
         if (s->size != 0ul) {
-            // make room in GUS RAM for the sample,
-            // taking into consideration that you shouldn't cross 256KB boundaries.
-            // also take into consideration that DMA with the GUS requires DRAM offsets
-            // to be a multiple of 16 (32 if 16-bit PCM)
-            for (ri=0;ri < 4;ri++) {
-                if ((ramofs[ri] + s->size + 0x20) < rammax) {
-                    ramofs[ri] = (ramofs[ri] + 0x1F) & (~0x1F);
-                    s->ram_offset = ramofs[ri] + (rammax * (unsigned long)ri);
-                    ramofs[ri] += s->size;
-                    break;
-                }
-            }
+            // make room in GUS RAM for the sample, not crossing a 256KB boundary.
+            // the heap aligns for DMA (multiple of 16, 32 if 16-bit PCM).
+            if ((s->ram_offset = ultrasnd_dram_alloc(&dram_heap,s->size,ULTRASND_DRAM_ALLOC_BANK)) == ULTRASND_DRAM_NONE)
+                s->ram_offset = ~0ul;
         }
 
         printf("     sample[%u]: fofs=%lu rofs=%lu size=%lu ft=%d vol=%u rep=%lu rlen=%lu\n",
@@ -412,61 +401,58 @@ int load_mod() {
         }
     }
 
-    {
-        size_t bufsize = 16384;
-        unsigned char FAR *dram_buf = ultrasnd_dram_buffer_alloc(gus,bufsize);
-        if (dram_buf == NULL) {
-            printf("Cannot alloc DMA buffer\n");
-            goto fail;
-        }
+    printf("     DRAM free: %luKB, largest block %luKB\n",
+        (unsigned long)(ultrasnd_dram_heap_avail(&dram_heap) >> 10ul),
+        (unsigned long)(ultrasnd_dram_heap_largest(&dram_heap,0) >> 10ul));
 
-        /* load samples into GUS RAM. Use DMA, of course */
-        for (i=0;i < mod_samples;i++) {
-            struct mod_sample *s = &mod_sample[i];
+    /* load samples into GUS RAM. Use DMA, of course, and read the next block while the GUS takes the last one */
+    if (!ultrasnd_upload_begin(&upload,gus,4096)) {
+        printf("Cannot alloc DMA buffer\n");
+        goto fail;
+    }
 
-            if (s->size != 0 && s->ram_offset != (~0ul)) {
-                unsigned long rem,ramoff;
-                unsigned rd;
+    for (i=0;i < mod_samples;i++) {
+        struct mod_sample *s = &mod_sample[i];
 
-                printf("Loading sample %u\n",i);
+        if (s->size != 0 && s->ram_offset != (~0ul)) {
+            unsigned long rem,ramoff;
+            unsigned char FAR *buf;
+            unsigned rd,n;
 
-                if (lseek(fd,s->file_offset,SEEK_SET) != s->file_offset) {
-                    printf("Seek error, samples\n");
-                    goto fail;
-                }
+            printf("Loading sample %u\n",i);
 
-                rem = s->size;
-                ramoff = s->ram_offset;
-                while (rem >= bufsize) {
-                    rd = 0;
-                    if (_dos_read(fd,dram_buf,bufsize,&rd) != 0) {
-                        printf("Read error, samples\n");
-                        goto fail;
-                    }
-                    if (ultrasnd_send_dram_buffer(gus,ramoff,bufsize,ULTRASND_DMA_TC_IRQ) == 0) {
-                        printf("Send to GUS error\n");
-                        goto fail;
-                    }
-                    ramoff += bufsize;
-                    rem -= bufsize;
+            if (lseek(fd,s->file_offset,SEEK_SET) != s->file_offset) {
+                printf("Seek error, samples\n");
+                ultrasnd_upload_end(&upload);
+                goto fail;
+            }
+
+            rem = s->size;
+            ramoff = s->ram_offset;
+            while (rem != 0ul) {
+                n = (rem > upload.slot_size) ? upload.slot_size : (unsigned)rem;
+                buf = ultrasnd_upload_get(&upload);
+                rd = 0;
+                if (buf == NULL || _dos_read(fd,buf,n,&rd) != 0) {
+                    printf("Read error, samples\n");
+                    ultrasnd_upload_end(&upload);
+                    goto fail;
                 }
-                if (rem != 0) {
-                    rd = 0;
-                    if (_dos_read(fd,dram_buf,rem,&rd) != 0) {
-                        printf("Read error, samples\n");
-                        goto fail;
-                    }
-                    if (ultrasnd_send_dram_buffer(gus,ramoff,rem,ULTRASND_DMA_TC_IRQ) == 0) {
-                        printf("Send to GUS error\n");
-                        goto fail;
-                    }
+                if (ultrasnd_upload_put(&upload,ramoff,n,ULTRASND_DMA_TC_IRQ) == 0) {
+                    printf("Send to GUS error\n");
+                    ultrasnd_upload_end(&upload);
+                    goto fail;
                 }
+                ramoff += n;
+                rem -= n;
             }
         }
-
-        ultrasnd_dram_buffer_free(gus);
     }
 
+    if (!ultrasnd_upload_end(&upload))
+        printf("GUS DMA timeout while loading samples\n");
+    printf("     %lu DMA and %lu PIO transfers, %lu overlapped\n",upload.dma_transfers,upload.pio_transfers,upload.overlapped);
+
     pattern_block_ofs = 0u;
     song_pos = ~0u;
 
@@ -156,6 +156,7 @@
 #include <hw/8254/8254.h>		/* 8254 timer */
 #include <hw/8259/8259.h>		/* 8259 PIC interrupts */
 #include <hw/ultrasnd/ultrasnd.h>
+#include <hw/ultrasnd/guspio.h>
 
 static int debug_on = 0;
 static int ultrasnd_test_irq_fired = 0;
@@ -1053,105 +1054,116 @@ unsigned char FAR *ultrasnd_dram_buffer_alloc(struct ultrasnd_ctx *u,unsigned lo
 	return u->dram_xfer_a->lin;
 }
 
-int ultrasnd_send_dram_buffer(struct ultrasnd_ctx *u,uint32_t ofs,unsigned long len,uint16_t flags) {
-	unsigned char FAR *src;
-	uint8_t dma = u->use_dma;
-	unsigned int patience;
-	uint32_t phys,i;
+/* start a DMA transfer of len bytes at buf_ofs in the DMA buffer to DRAM at ofs. the caller has checked ultrasnd_dma_write_ok() */
+void ultrasnd_dma_write_start(struct ultrasnd_ctx *u,uint32_t buf_ofs,uint32_t ofs,unsigned long len,uint16_t flags) {
+	const uint32_t phys = u->dram_xfer_a->phys + buf_ofs;
+
+	_cli();
+
+	/* disable GUS DMA */
+	ultrasnd_select_write(u,0x41,(u->dma1 >= 4 ? 4 : 0) | (flags & 0xE0)); /* data size in bit 2, writing to DRAM, enable DMA, and bits 6-7 provided by caller */
+	ultrasnd_select_read(u,0x41); /* read to clear DMA terminal count---even though we didn't ask for TC IRQ */
+	u->dma_tc_irq_happened = 0;
+
+	/* Now initiate a DMA transfer (host) */
+	outp(d8237_ioport(u->dma1,D8237_REG_W_SINGLE_MASK),D8237_MASK_CHANNEL(u->dma1) | D8237_MASK_SET); /* mask */
+	outp(d8237_ioport(u->dma1,D8237_REG_W_WRITE_MODE),
+		D8237_MODER_CHANNEL(u->dma1) |
+		D8237_MODER_TRANSFER(D8237_MODER_XFER_READ) | /* "READ" from system memory */
+		D8237_MODER_MODESEL(D8237_MODER_MODESEL_DEMAND));
+	d8237_write_base(u->dma1,phys); /* RAM location with not much around */
+	d8237_write_count(u->dma1,len);
+
+	/* Now initiate a DMA transfer (GUS DRAM) */
+	ultrasnd_select_write(u,0x41,(u->dma1 >= 4 ? 4 : 0) | (flags & 0xE0)); /* data size in bit 2, writing to DRAM, enable DMA, and bits 6-7 provided by caller */
+	if (u->dma1 >= 4) /* Ugh, even DMA is subject to Gravis 16-bit translation */
+		ultrasnd_select_write16(u,0x42,(uint16_t)(ultrasnd_dram_16bit_xlate(ofs)>>4UL));
+	else
+		ultrasnd_select_write16(u,0x42,(uint16_t)(ofs>>4UL));
+	ultrasnd_select_write(u,0x41,(u->dma1 >= 4 ? 4 : 0) | 0x1 | (flags & 0xE0)); /* data size in bit 2, writing to DRAM, enable DMA, and bits 6-7 provided by caller */
+
+	/* GO! */
+	u->dma_tc_irq_happened = 0;
+	outp(d8237_ioport(u->dma1,D8237_REG_W_SINGLE_MASK),D8237_MASK_CHANNEL(u->dma1)); /* unmask */
+
+	_sti();
+}
+
+static int ultrasnd_dma_write_complete(struct ultrasnd_ctx *u,uint16_t flags) {
 	uint16_t rem;
 
-	if (u == NULL || u->dram_xfer_a == NULL || len > u->dram_xfer_a->length || len > 0xFF00UL)
-		return 0;
+	if (u->irq1 >= 0 && (flags & ULTRASND_DMA_TC_IRQ) != 0 && !(flags & ULTRASND_VOICE_MODE_IRQ_BUT_DMA_WAIT)) {
+		/* wait for caller's IRQ handler to set the flag */
+		if (u->dma_tc_irq_happened) return 1;
+	}
+	else {
+		rem = d8237_read_count(u->dma1);
+		if (rem == 0 || rem >= 0xFFFE)
+			return 1;
+	}
 
-	src = u->dram_xfer_a->lin;
-	phys = u->dram_xfer_a->phys;
+	return 0;
+}
 
-	/* cannot do half-word transfers when 16-bit is involved */
-	if (dma && ((len & 1) && ((u->dma1 >= 4) || (flags & ULTRASND_DMA_DATA_SIZE_16BIT))))
-		dma = 0;
-	/* the target DRAM address must be 16-bit aligned (32-bit aligned for 16-bit audio) */
-	if (dma && (ofs & 0xF) != 0)
-		dma = 0;
-	if (dma && u->dma1 >= 4 && (ofs & 0x1F) != 0)
-		dma = 0;
+static void ultrasnd_dma_write_stop(struct ultrasnd_ctx *u,uint16_t flags) {
+	/* mask DMA channel again */
+	outp(d8237_ioport(u->dma1,D8237_REG_W_SINGLE_MASK),D8237_MASK_CHANNEL(u->dma1) | D8237_MASK_SET); /* mask */
 
-	if (dma) {
-		_cli();
+	/* stop DMA */
+	ultrasnd_select_write(u,0x41,(u->dma1 >= 4 ? 4 : 0) | (flags & 0xE0)); /* data size in bit 2, writing to DRAM, enable DMA, and bits 6-7 provided by caller */
+}
 
-		/* disable GUS DMA */
-		ultrasnd_select_write(u,0x41,(u->dma1 >= 4 ? 4 : 0) | (flags & 0xE0)); /* data size in bit 2, writing to DRAM, enable DMA, and bits 6-7 provided by caller */
-		ultrasnd_select_read(u,0x41); /* read to clear DMA terminal count---even though we didn't ask for TC IRQ */
-		u->dma_tc_irq_happened = 0;
-
-		/* Now initiate a DMA transfer (host) */
-		outp(d8237_ioport(u->dma1,D8237_REG_W_SINGLE_MASK),D8237_MASK_CHANNEL(u->dma1) | D8237_MASK_SET); /* mask */
-		outp(d8237_ioport(u->dma1,D8237_REG_W_WRITE_MODE),
-			D8237_MODER_CHANNEL(u->dma1) |
-			D8237_MODER_TRANSFER(D8237_MODER_XFER_READ) | /* "READ" from system memory */
-			D8237_MODER_MODESEL(D8237_MODER_MODESEL_DEMAND));
-		d8237_write_base(u->dma1,phys); /* RAM location with not much around */
-		d8237_write_count(u->dma1,len);
-
-		/* Now initiate a DMA transfer (GUS DRAM) */
-		ultrasnd_select_write(u,0x41,(u->dma1 >= 4 ? 4 : 0) | (flags & 0xE0)); /* data size in bit 2, writing to DRAM, enable DMA, and bits 6-7 provided by caller */
-		if (u->dma1 >= 4) /* Ugh, even DMA is subject to Gravis 16-bit translation */
-			ultrasnd_select_write16(u,0x42,(uint16_t)(ultrasnd_dram_16bit_xlate(ofs)>>4UL));
-		else
-			ultrasnd_select_write16(u,0x42,(uint16_t)(ofs>>4UL));
-		ultrasnd_select_write(u,0x41,(u->dma1 >= 4 ? 4 : 0) | 0x1 | (flags & 0xE0)); /* data size in bit 2, writing to DRAM, enable DMA, and bits 6-7 provided by caller */
+/* if the DMA transfer has finished, stop the DMA channel and return 1. does not wait */
+int ultrasnd_dma_write_done(struct ultrasnd_ctx *u,uint16_t flags) {
+	if (!ultrasnd_dma_write_complete(u,flags))
+		return 0;
 
-		/* GO! */
-		u->dma_tc_irq_happened = 0;
-		outp(d8237_ioport(u->dma1,D8237_REG_W_SINGLE_MASK),D8237_MASK_CHANNEL(u->dma1)); /* unmask */
+	ultrasnd_dma_write_stop(u,flags);
+	return 1;
+}
 
-		_sti();
+/* wait for the DMA transfer to finish, and stop the DMA channel. returns 0 on timeout */
+int ultrasnd_dma_write_wait(struct ultrasnd_ctx *u,uint16_t flags) {
+	unsigned int patience;
+	uint16_t rem;
 
-		/* watch it run */
-		patience = 10000; /* 100ns * 10000 = 1 sec */
-		do {
-			if (u->irq1 >= 0 && (flags & ULTRASND_DMA_TC_IRQ) != 0 && !(flags & ULTRASND_VOICE_MODE_IRQ_BUT_DMA_WAIT)) {
-				/* wait for caller's IRQ handler to set the flag */
-				if (u->dma_tc_irq_happened) break;
-			}
-			else {
-				rem = d8237_read_count(u->dma1);
-				if (rem == 0 || rem >= 0xFFFE)
-					break;
-			}
+	/* watch it run */
+	patience = 10000; /* 100ns * 10000 = 1 sec */
+	do {
+		if (ultrasnd_dma_write_complete(u,flags))
+			break;
 
-			t8254_wait(t8254_us2ticks(100));
-		} while (--patience != 0);
-		rem = d8237_read_count(u->dma1);
-		if (rem >= 0xFFFE) rem = 0;
+		t8254_wait(t8254_us2ticks(100));
+	} while (--patience != 0);
+	rem = d8237_read_count(u->dma1);
+	if (rem >= 0xFFFE) rem = 0;
 
-		if (debug_on) {
-			if (patience == 0)
-				fprintf(stderr,"GUS DMA transfer timeout (rem=%lu)\n",rem);
-			if (rem != 0)
-				fprintf(stderr,"GUS DMA transfer TC while DMA controller has %u remaining\n",rem);
-		}
+	if (debug_on) {
+		if (patience == 0)
+			fprintf(stderr,"GUS DMA transfer timeout (rem=%lu)\n",rem);
+		if (rem != 0)
+			fprintf(stderr,"GUS DMA transfer TC while DMA controller has %u remaining\n",rem);
+	}
+
+	ultrasnd_dma_write_stop(u,flags);
+	return (patience != 0);
+}
 
-		/* mask DMA channel again */
-		outp(d8237_ioport(u->dma1,D8237_REG_W_SINGLE_MASK),D8237_MASK_CHANNEL(u->dma1) | D8237_MASK_SET); /* mask */
+/* write to DRAM through the DRAM I/O port. See guspio.h */
+void ultrasnd_pio_write(struct ultrasnd_ctx *u,uint32_t ofs,const unsigned char FAR *src,unsigned long len,uint16_t flags) {
+	ultrasnd_pio_write_chunks(u,ofs,src,len,flags);
+}
 
-		/* stop DMA */
-		ultrasnd_select_write(u,0x41,(u->dma1 >= 4 ? 4 : 0) | (flags & 0xE0)); /* data size in bit 2, writing to DRAM, enable DMA, and bits 6-7 provided by caller */
+int ultrasnd_send_dram_buffer(struct ultrasnd_ctx *u,uint32_t ofs,unsigned long len,uint16_t flags) {
+	if (u == NULL || u->dram_xfer_a == NULL || len > u->dram_xfer_a->length || len > 0xFF00UL)
+		return 0;
+
+	if (ultrasnd_dma_write_ok(u,ofs,len,flags)) {
+		ultrasnd_dma_write_start(u,0,ofs,len,flags);
+		ultrasnd_dma_write_wait(u,flags);
 	}
 	else {
-		if (flags & ULTRASND_DMA_FLIP_MSB) {
-			if (flags & ULTRASND_DMA_DATA_SIZE_16BIT) {
-				for (i=0;i < len;i += 2) {
-					ultrasnd_poke(u,ofs+i,src[i]);
-					ultrasnd_poke(u,ofs+i+1,src[i+1] ^ 0x80);
-				}
-			}
-			else {
-				for (i=0;i < len;i++) ultrasnd_poke(u,ofs+i,src[i] ^ 0x80);
-			}
-		}
-		else {
-			for (i=0;i < len;i++) ultrasnd_poke(u,ofs+i,src[i]);
-		}
+		ultrasnd_pio_write(u,ofs,u->dram_xfer_a->lin,len,flags);
 	}
 
 	return 1;
@@ -1,6 +1,14 @@
 
-#include <hw/cpu/cpu.h>
-#include <stdint.h>
+#if defined(LINUX)
+/* Linux host: only the DRAM heap and upload queue are built, against the simulated GF1 in gussim.c */
+# include <stdint.h>
+# ifndef FAR
+#  define FAR
+# endif
+#else
+# include <hw/cpu/cpu.h>
+# include <stdint.h>
+#endif
 
 /* 2 seems a reasonable max, since 1 is most common */
 #define MAX_ULTRASND				2
@@ -26,6 +34,22 @@
 /* during transfer invert bit 7 (or bit 15) to convert unsigned->signed */
 #define ULTRASND_DMA_FLIP_MSB			0x80
 
+/* PIO writes to DRAM are done this many bytes at a time with interrupts off (guspio.h) */
+#define ULTRASND_PIO_CHUNK			256u
+
+/* DRAM heap (gusheap.c) */
+#define ULTRASND_DRAM_BLOCKS			128
+#define ULTRASND_DRAM_NONE			0xFFFFFFFFUL
+/* allocations are aligned for DMA (16 bytes, 32 if the DMA channel or the data is 16-bit) */
+#define ULTRASND_DRAM_ALIGN			32UL
+#define ULTRASND_DRAM_BANK			(256UL << 10UL)
+/* alloc flags */
+/* keep within one 256KB bank (the GF1 cannot play 16-bit samples across one, and some cards not even 8-bit ones) */
+#define ULTRASND_DRAM_ALLOC_BANK		0x01
+
+/* upload queue (gusxfer.c) */
+#define ULTRASND_UPLOAD_SLOTS			4
+
 struct ultrasnd_ctx {
 	int16_t		port;		/* NOTE: Gravis ultrasound takes port+0x0 to port+0xF, and port+0x100 to port+0x10F */
 	int8_t		dma1,dma2;	/* NOTE: These can be the same */
@@ -42,6 +66,55 @@ struct ultrasnd_ctx {
 	uint8_t		reserved2:7;
 };
 
+struct ultrasnd_dram_block {
+	uint32_t	ofs;
+	uint32_t	len;
+	uint8_t		used;
+};
+
+/* DRAM heap: the blocks cover the whole DRAM, in order of address, adjacent free blocks merged */
+struct ultrasnd_dram_heap {
+	uint32_t	total;		/* DRAM size */
+	uint8_t		boundary256k;	/* every allocation is kept within a 256KB bank */
+	unsigned int	blocks;
+	struct ultrasnd_dram_block block[ULTRASND_DRAM_BLOCKS];
+};
+
+enum {
+	ULTRASND_UPLOAD_FREE=0,		/* caller may take it with ultrasnd_upload_get() */
+	ULTRASND_UPLOAD_FILLING,	/* caller is filling it */
+	ULTRASND_UPLOAD_QUEUED,		/* waiting for its turn */
+	ULTRASND_UPLOAD_DMA		/* DMA in progress */
+};
+
+struct ultrasnd_upload_slot {
+	uint32_t	ofs;		/* DRAM address */
+	uint16_t	len;
+	uint16_t	done;		/* bytes already in DRAM */
+	uint16_t	xfer;		/* bytes in the DMA transfer in progress */
+	uint16_t	flags;		/* ULTRASND_DMA_* */
+	uint8_t		state;
+};
+
+/* queue of DMA transfers from a ring of buffer slots, so the caller can fill one slot (read the file,
+ * convert samples) while the GUS is taking another. transfers happen in the order queued */
+struct ultrasnd_upload {
+	struct ultrasnd_ctx*		u;
+	unsigned char FAR*		buf;
+	uint16_t			slot_size;
+	uint8_t				fill;		/* next slot to give to the caller */
+	uint8_t				next;		/* oldest slot not yet in DRAM */
+	struct ultrasnd_upload_slot	slot[ULTRASND_UPLOAD_SLOTS];
+	/* statistics */
+	unsigned long			dma_transfers;
+	unsigned long			pio_transfers;
+	unsigned long			bytes;
+	unsigned long			overlapped;	/* slots handed to the caller while a DMA transfer was running */
+	unsigned long			stalls;		/* times the caller had to wait for a slot */
+	uint8_t				error:1;	/* a DMA transfer timed out */
+	uint8_t				reserved:7;
+};
+
 extern const uint32_t ultrasnd_rate_per_voices[33];
 extern struct ultrasnd_ctx ultrasnd_card[MAX_ULTRASND];
 extern struct ultrasnd_ctx *ultrasnd_env;
@@ -96,3 +169,24 @@ void ultrasnd_drain_irq_events(struct ultrasnd_ctx *u);
 void ultrasnd_stop_all_voices(struct ultrasnd_ctx *u);
 void ultrasnd_stop_timers(struct ultrasnd_ctx *u);
 
+/* low level DRAM transfers (ultrasnd.c, or gussim.c on the Linux host). buf_ofs is the offset into the buffer from ultrasnd_dram_buffer_alloc() */
+void ultrasnd_dma_write_start(struct ultrasnd_ctx *u,uint32_t buf_ofs,uint32_t ofs,unsigned long len,uint16_t flags);
+int ultrasnd_dma_write_done(struct ultrasnd_ctx *u,uint16_t flags);
+int ultrasnd_dma_write_wait(struct ultrasnd_ctx *u,uint16_t flags);
+void ultrasnd_pio_write(struct ultrasnd_ctx *u,uint32_t ofs,const unsigned char FAR *src,unsigned long len,uint16_t flags);
+
+/* DRAM heap (gusheap.c) */
+void ultrasnd_dram_heap_init(struct ultrasnd_dram_heap *h,uint32_t total_ram,uint32_t reserve,uint8_t boundary256k);
+uint32_t ultrasnd_dram_alloc(struct ultrasnd_dram_heap *h,uint32_t len,unsigned int flags);
+int ultrasnd_dram_free(struct ultrasnd_dram_heap *h,uint32_t ofs);
+uint32_t ultrasnd_dram_heap_avail(struct ultrasnd_dram_heap *h);
+uint32_t ultrasnd_dram_heap_largest(struct ultrasnd_dram_heap *h,unsigned int flags);
+
+/* DRAM upload queue (gusxfer.c) */
+int ultrasnd_dma_write_ok(struct ultrasnd_ctx *u,uint32_t ofs,unsigned long len,uint16_t flags);
+int ultrasnd_upload_begin(struct ultrasnd_upload *q,struct ultrasnd_ctx *u,unsigned int slot_size);
+unsigned char FAR *ultrasnd_upload_get(struct ultrasnd_upload *q);
+int ultrasnd_upload_put(struct ultrasnd_upload *q,uint32_t ofs,unsigned int len,uint16_t flags);
+unsigned int ultrasnd_upload_poll(struct ultrasnd_upload *q);
+int ultrasnd_upload_end(struct ultrasnd_upload *q);
+
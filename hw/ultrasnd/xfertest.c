@@ -0,0 +1,315 @@
+/* Linux host test of the GUS DRAM heap and upload queue against the simulated GF1 (gussim.c).
+ *
+ *   xfertest [file.mod ...]
+ *
+ * Checks heap placement (alignment, 256KB banks, no overlaps, free space merged back), then
+ * uploads data through the queue with an 8-bit DMA channel, a 16-bit DMA channel and no DMA,
+ * and compares the simulated DRAM with the source. Given MOD files, loads their samples the way
+ * MODPLAY does and reports transfer counts. Exit status is nonzero on any failure. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hw/ultrasnd/ultrasnd.h>
+#include <hw/ultrasnd/gussim.h>
+
+static struct ultrasnd_ctx		gus;
+static struct ultrasnd_dram_heap	heap;
+static unsigned int			failures = 0;
+
+#define CHECK(x) do { if (!(x)) { fprintf(stderr,"FAIL %s:%d: %s\n",__FILE__,__LINE__,#x); failures++; } } while (0)
+
+/* the blocks must cover DRAM in order, with no two free blocks next to each other */
+static void check_heap(struct ultrasnd_dram_heap *h) {
+	uint32_t o = 0;
+	unsigned int i;
+
+	for (i=0;i < h->blocks;i++) {
+		CHECK(h->block[i].ofs == o);
+		CHECK(h->block[i].len != 0UL);
+		if (i > 0) CHECK(h->block[i].used || h->block[i-1].used);
+		o += h->block[i].len;
+	}
+	CHECK(o == h->total);
+}
+
+static void test_heap(uint8_t boundary256k) {
+	struct { uint32_t ofs,len; unsigned int flags; } a[96];
+	unsigned int n = 0,i,j,iter;
+	uint32_t ofs,len;
+
+	srand(1234);
+	ultrasnd_dram_heap_init(&heap,1024UL << 10UL,32,boundary256k);
+	check_heap(&heap);
+	CHECK(ultrasnd_dram_heap_avail(&heap) == (1024UL << 10UL) - 32UL);
+
+	for (iter=0;iter < 20000;iter++) {
+		if (n < 96 && (n == 0 || (rand() & 1))) {
+			const unsigned int flags = (rand() & 3) == 0 ? ULTRASND_DRAM_ALLOC_BANK : 0;
+
+			len = 1UL + ((unsigned long)rand() % ((rand() & 7) == 0 ? 200000UL : 20000UL));
+			ofs = ultrasnd_dram_alloc(&heap,len,flags);
+			if (ofs == ULTRASND_DRAM_NONE) {
+				CHECK(ultrasnd_dram_heap_largest(&heap,flags) < len);
+				continue;
+			}
+
+			CHECK((ofs & (ULTRASND_DRAM_ALIGN - 1UL)) == 0UL);
+			CHECK((ofs + len) <= heap.total);
+			CHECK(ofs >= 32UL);
+			if (flags || boundary256k) CHECK((ofs / ULTRASND_DRAM_BANK) == ((ofs + len - 1UL) / ULTRASND_DRAM_BANK));
+			for (j=0;j < n;j++) CHECK((ofs + len) <= a[j].ofs || ofs >= (a[j].ofs + a[j].len));
+
+			a[n].ofs = ofs;
+			a[n].len = len;
+			a[n].flags = flags;
+			n++;
+		}
+		else {
+			i = (unsigned int)rand() % n;
+			CHECK(ultrasnd_dram_free(&heap,a[i].ofs));
+			a[i] = a[--n];
+		}
+		check_heap(&heap);
+	}
+
+	CHECK(!ultrasnd_dram_free(&heap,1)); /* not an allocation */
+	while (n > 0) CHECK(ultrasnd_dram_free(&heap,a[--n].ofs));
+	check_heap(&heap);
+	CHECK(heap.blocks == 2); /* reserved + one free block */
+	CHECK(ultrasnd_dram_heap_largest(&heap,0) == (boundary256k ? ULTRASND_DRAM_BANK : ((1024UL << 10UL) - 32UL)));
+
+	printf("Heap%s: OK\n",boundary256k ? " (256KB boundary card)" : "");
+}
+
+/* upload src to DRAM at ofs through the queue, in pieces of up to piece bytes */
+static void upload(struct ultrasnd_upload *q,uint32_t ofs,const unsigned char *src,unsigned long len,unsigned int piece,uint16_t flags) {
+	unsigned char FAR *p;
+	unsigned int n;
+
+	while (len > 0UL) {
+		n = (len > piece) ? piece : (unsigned int)len;
+		if (n > q->slot_size) n = q->slot_size;
+
+		p = ultrasnd_upload_get(q);
+		CHECK(p != NULL);
+		if (p == NULL) return;
+		memcpy(p,src,n);
+		CHECK(ultrasnd_upload_put(q,ofs,n,flags));
+
+		ofs += n;
+		src += n;
+		len -= n;
+	}
+}
+
+static void test_upload(int8_t dma) {
+	struct ultrasnd_upload q;
+	unsigned char *src;
+	unsigned long i;
+
+	src = malloc(300000UL);
+	for (i=0;i < 300000UL;i++) src[i] = (unsigned char)rand();
+
+	ultrasnd_sim_init(&gus,1024UL << 10UL,dma);
+	ultrasnd_sim.irq_every = ultrasnd_sim.irq_wait = 101;
+	CHECK(ultrasnd_upload_begin(&q,&gus,4096));
+
+	/* plain, across a 256KB bank, unaligned (PIO), MSB flipped 8 and 16-bit */
+	upload(&q,0x1000,src,100000UL,4096,0);
+	upload(&q,ULTRASND_DRAM_BANK - 0x800UL,src+100000UL,10000UL,4096,0);
+	upload(&q,0x30003,src+110000UL,5000UL,4096,0);
+	upload(&q,0x50000,src+120000UL,8192UL,4096,ULTRASND_DMA_FLIP_MSB);
+	upload(&q,0x60000,src+130000UL,8192UL,4096,ULTRASND_DMA_FLIP_MSB | ULTRASND_DMA_DATA_SIZE_16BIT);
+	CHECK(ultrasnd_upload_end(&q));
+
+	CHECK(!memcmp(ultrasnd_sim.dram+0x1000,src,100000UL));
+	CHECK(!memcmp(ultrasnd_sim.dram+ULTRASND_DRAM_BANK-0x800UL,src+100000UL,10000UL));
+	CHECK(!memcmp(ultrasnd_sim.dram+0x30003,src+110000UL,5000UL));
+	for (i=0;i < 8192UL;i++) {
+		CHECK(ultrasnd_sim.dram[0x50000+i] == (src[120000UL+i] ^ 0x80));
+		CHECK(ultrasnd_sim.dram[0x60000+i] == (src[130000UL+i] ^ ((i & 1ul) ? 0x80 : 0x00)));
+	}
+	CHECK(ultrasnd_sim.errors == 0);
+	CHECK(!ultrasnd_sim.dma_busy);
+
+	printf("Upload, %s: OK, %lu DMA + %lu PIO transfers, %lu overlapped with DMA, %lu stalls, %lu I/O writes for PIO\n",
+		dma < 0 ? "no DMA" : (dma >= 4 ? "16-bit DMA" : "8-bit DMA"),
+		q.dma_transfers,q.pio_transfers,q.overlapped,q.stalls,ultrasnd_sim.pio_io);
+
+	if (dma >= 0) {
+		/* the 16-bit channel splits the transfer that crosses the bank (+1), both leave the unaligned one to PIO */
+		CHECK(q.pio_transfers == 2);
+		CHECK(q.dma_transfers == ((100000UL+4095UL)/4096UL) + 3UL + 2UL + 2UL + (dma >= 4 ? 1UL : 0UL));
+		CHECK(q.overlapped != 0UL);
+	}
+	else {
+		CHECK(q.dma_transfers == 0UL);
+	}
+
+	ultrasnd_sim_free(&gus);
+	free(src);
+}
+
+/* PIO with the simulated IRQ handler selecting another register and moving the DRAM address
+ * between any two port writes it can get in between */
+static void test_pio_irq(void) {
+	static const uint16_t flags[3] = { 0, ULTRASND_DMA_FLIP_MSB, ULTRASND_DMA_FLIP_MSB | ULTRASND_DMA_DATA_SIZE_16BIT };
+	const unsigned long len = 70000UL;
+	unsigned long i,irqs;
+	unsigned int every,f;
+	unsigned char *src;
+	uint32_t ofs;
+
+	src = malloc(len);
+	for (i=0;i < len;i++) src[i] = (unsigned char)rand();
+
+	for (every=1;every <= 7;every += 3) {
+		for (f=0;f < 3;f++) {
+			ultrasnd_sim_init(&gus,1024UL << 10UL,-1);
+			ultrasnd_sim.irq_every = ultrasnd_sim.irq_wait = every;
+			ofs = 0x2FF80UL + f; /* across a 64KB page of the address */
+
+			ultrasnd_pio_write(&gus,ofs,src,len,flags[f]);
+			for (i=0;i < len;i++) {
+				if (flags[f] & ULTRASND_DMA_DATA_SIZE_16BIT)
+					CHECK(ultrasnd_sim.dram[ofs+i] == (src[i] ^ ((i & 1ul) ? 0x80 : 0x00)));
+				else
+					CHECK(ultrasnd_sim.dram[ofs+i] == (src[i] ^ (flags[f] ? 0x80 : 0x00)));
+			}
+			CHECK(ultrasnd_sim.dram[ofs-1UL] == 0xAA && ultrasnd_sim.dram[ofs+len] == 0xAA);
+			/* one chance per chunk at least */
+			CHECK(ultrasnd_sim.irqs >= ((len + ULTRASND_PIO_CHUNK - 1UL) / ULTRASND_PIO_CHUNK) - 1UL);
+			CHECK(ultrasnd_sim.cpu_if);
+			CHECK(ultrasnd_sim.errors == 0);
+
+			/* called with interrupts off, they stay off */
+			irqs = ultrasnd_sim.irqs;
+			ultrasnd_sim.cpu_if = 0;
+			ultrasnd_pio_write(&gus,0x1000,src,1000UL,0);
+			CHECK(!memcmp(ultrasnd_sim.dram+0x1000,src,1000UL));
+			CHECK(!ultrasnd_sim.cpu_if);
+			CHECK(ultrasnd_sim.irqs == irqs);
+			CHECK(ultrasnd_sim.errors == 0);
+
+			ultrasnd_sim_free(&gus);
+		}
+	}
+
+	printf("PIO with register selects from IRQs in between: OK\n");
+	free(src);
+}
+
+/* the sample layout of a ProTracker MOD */
+static int mod_samples(const unsigned char *f,unsigned long fsz,unsigned long *sofs,unsigned long *ssz,unsigned int *count) {
+	unsigned int samples = 15,channels = 4,patterns = 0,i;
+	unsigned long o;
+	const unsigned char *sig = f + 1080;
+
+	if (fsz < 1084UL) return 0;
+	if (!memcmp(sig,"M.K.",4) || !memcmp(sig,"M!K!",4) || !memcmp(sig,"FLT4",4) || !memcmp(sig,"4CHN",4)) samples = 31;
+	else if (sig[1] == 'C' && sig[2] == 'H' && sig[3] == 'N' && sig[0] >= '1' && sig[0] <= '9') { samples = 31; channels = sig[0] - '0'; }
+	else if (sig[2] == 'C' && sig[3] == 'H' && sig[0] >= '1' && sig[0] <= '3') { samples = 31; channels = ((sig[0] - '0') * 10) + (sig[1] - '0'); }
+
+	o = 20UL + (30UL * samples);
+	for (i=0;i < 128;i++) {
+		if (patterns < (unsigned int)f[o+2+i] + 1u) patterns = (unsigned int)f[o+2+i] + 1u;
+	}
+	o += 2UL + 128UL + (samples == 31 ? 4UL : 0UL) + ((unsigned long)patterns * 64UL * 4UL * channels);
+
+	for (i=0;i < samples;i++) {
+		const unsigned char *h = f + 20 + (30 * i);
+		ssz[i] = (((unsigned long)h[22] << 8UL) + (unsigned long)h[23]) * 2UL;
+		sofs[i] = o;
+		if ((o + ssz[i]) > fsz) ssz[i] = (o < fsz) ? (fsz - o) : 0UL;
+		o += ssz[i];
+	}
+
+	*count = samples;
+	return 1;
+}
+
+static void test_mod(const char *path,int8_t dma) {
+	unsigned long sofs[31],ssz[31],fsz,total = 0,o;
+	uint32_t ram[31];
+	struct ultrasnd_upload q;
+	unsigned int count,i;
+	unsigned char *f;
+	FILE *fp;
+
+	if ((fp=fopen(path,"rb")) == NULL) {
+		fprintf(stderr,"Cannot open %s\n",path);
+		failures++;
+		return;
+	}
+	fseek(fp,0,SEEK_END);
+	fsz = (unsigned long)ftell(fp);
+	fseek(fp,0,SEEK_SET);
+	f = malloc(fsz);
+	if (fread(f,1,fsz,fp) != fsz) fsz = 0;
+	fclose(fp);
+
+	if (!mod_samples(f,fsz,sofs,ssz,&count)) {
+		fprintf(stderr,"%s: not a MOD\n",path);
+		failures++;
+		free(f);
+		return;
+	}
+
+	ultrasnd_sim_init(&gus,1024UL << 10UL,dma);
+	ultrasnd_dram_heap_init(&heap,gus.total_ram,32,gus.boundary256k);
+	CHECK(ultrasnd_upload_begin(&q,&gus,4096));
+
+	for (i=0;i < count;i++) {
+		ram[i] = ULTRASND_DRAM_NONE;
+		if (ssz[i] == 0UL) continue;
+
+		ram[i] = ultrasnd_dram_alloc(&heap,ssz[i],ULTRASND_DRAM_ALLOC_BANK);
+		CHECK(ram[i] != ULTRASND_DRAM_NONE);
+		if (ram[i] == ULTRASND_DRAM_NONE) continue;
+
+		upload(&q,ram[i],f + sofs[i],ssz[i],4096,0);
+		total += ssz[i];
+	}
+	CHECK(ultrasnd_upload_end(&q));
+	check_heap(&heap);
+
+	for (i=0;i < count;i++) {
+		if (ram[i] != ULTRASND_DRAM_NONE) CHECK(!memcmp(ultrasnd_sim.dram+ram[i],f + sofs[i],ssz[i]));
+	}
+	CHECK(ultrasnd_sim.errors == 0);
+
+	o = ultrasnd_dram_heap_avail(&heap);
+	printf("%s, %s: %lu bytes of samples, %luKB DRAM free, %lu DMA transfers (%lu overlapped), %lu PIO, %lu simulated polls\n",
+		path,dma < 0 ? "no DMA" : (dma >= 4 ? "16-bit DMA" : "8-bit DMA"),
+		total,o >> 10UL,q.dma_transfers,q.overlapped,q.pio_transfers,ultrasnd_sim.polls);
+
+	ultrasnd_sim_free(&gus);
+	free(f);
+}
+
+int main(int argc,char **argv) {
+	int i;
+
+	test_heap(0);
+	test_heap(1);
+	test_upload(1);
+	test_upload(5);
+	test_upload(-1);
+	test_pio_irq();
+
+	for (i=1;i < argc;i++) {
+		test_mod(argv[i],1);
+		test_mod(argv[i],5);
+	}
+
+	if (failures != 0) {
+		printf("%u failures\n",failures);
+		return 1;
+	}
+
+	printf("All tests passed\n");
+	return 0;
+}
@@ -43,9 +43,11 @@ PCXSSCUT_EXE = $(SUBDIR)$(HPS)pcxsscut.$(EXEEXT)
 MCGACAPM_EXE = $(SUBDIR)$(HPS)mcgacapm.$(EXEEXT)
 !  endif
 !  ifeq MMODE f
+# vrl2vcs needs more than 64KB of data (emulated VGA planes), flat model only
 VRLDBG_EXE =   $(SUBDIR)$(HPS)vrldbg.$(EXEEXT)
 PCX2VRL_EXE =  $(SUBDIR)$(HPS)pcx2vrl.$(EXEEXT)
 VRL2VRS_EXE =  $(SUBDIR)$(HPS)vrl2vrs.$(EXEEXT)
+VRL2VCS_EXE =  $(SUBDIR)$(HPS)vrl2vcs.$(EXEEXT)
 VRSDUMP_EXE =  $(SUBDIR)$(HPS)vrsdump.$(EXEEXT)
 PCXSSCUT_EXE = $(SUBDIR)$(HPS)pcxsscut.$(EXEEXT)
 !  endif
@@ -58,7 +60,7 @@ MCGACAPM_EXE = $(SUBDIR)$(HPS)mcgacapm.$(EXEEXT)
 ! endif
 !endif
 
-$(HW_VGA_LIB): $(SUBDIR)$(HPS)vga.obj $(SUBDIR)$(HPS)herc.obj $(SUBDIR)$(HPS)tseng.obj $(SUBDIR)$(HPS)vgach3c0.obj $(SUBDIR)$(HPS)vgastget.obj $(SUBDIR)$(HPS)vgatxt50.obj $(SUBDIR)$(HPS)vgaclks.obj $(SUBDIR)$(HPS)vgabicur.obj $(SUBDIR)$(HPS)vgasetmm.obj $(SUBDIR)$(HPS)vgarcrtc.obj $(SUBDIR)$(HPS)vgasemo.obj $(SUBDIR)$(HPS)vgaseco.obj $(SUBDIR)$(HPS)vgacrtcc.obj $(SUBDIR)$(HPS)vgacrtcr.obj $(SUBDIR)$(HPS)vgacrtcs.obj $(SUBDIR)$(HPS)vgasplit.obj $(SUBDIR)$(HPS)vgamodex.obj $(SUBDIR)$(HPS)vga9wide.obj $(SUBDIR)$(HPS)vgaalfpl.obj $(SUBDIR)$(HPS)vgaselcs.obj $(SUBDIR)$(HPS)vgastloc.obj $(SUBDIR)$(HPS)vrl1xlof.obj $(SUBDIR)$(HPS)vrl1xdrw.obj $(SUBDIR)$(HPS)vrl1ydrw.obj $(SUBDIR)$(HPS)vrl1xdrs.obj $(SUBDIR)$(HPS)vgawm1bc.obj $(SUBDIR)$(HPS)pcjrmem.obj $(SUBDIR)$(HPS)vgattyp8.obj $(SUBDIR)$(HPS)vgattyg.obj $(SUBDIR)$(HPS)vgattyj.obj $(SUBDIR)$(HPS)vrlrbasp.obj $(SUBDIR)$(HPS)vgapalb.obj
+$(HW_VGA_LIB): $(SUBDIR)$(HPS)vga.obj $(SUBDIR)$(HPS)herc.obj $(SUBDIR)$(HPS)tseng.obj $(SUBDIR)$(HPS)vgach3c0.obj $(SUBDIR)$(HPS)vgastget.obj $(SUBDIR)$(HPS)vgatxt50.obj $(SUBDIR)$(HPS)vgaclks.obj $(SUBDIR)$(HPS)vgabicur.obj $(SUBDIR)$(HPS)vgasetmm.obj $(SUBDIR)$(HPS)vgarcrtc.obj $(SUBDIR)$(HPS)vgasemo.obj $(SUBDIR)$(HPS)vgaseco.obj $(SUBDIR)$(HPS)vgacrtcc.obj $(SUBDIR)$(HPS)vgacrtcr.obj $(SUBDIR)$(HPS)vgacrtcs.obj $(SUBDIR)$(HPS)vgasplit.obj $(SUBDIR)$(HPS)vgamodex.obj $(SUBDIR)$(HPS)vga9wide.obj $(SUBDIR)$(HPS)vgaalfpl.obj $(SUBDIR)$(HPS)vgaselcs.obj $(SUBDIR)$(HPS)vgastloc.obj $(SUBDIR)$(HPS)vrl1xlof.obj $(SUBDIR)$(HPS)vrl1xdrw.obj $(SUBDIR)$(HPS)vrl1ydrw.obj $(SUBDIR)$(HPS)vrl1xdrs.obj $(SUBDIR)$(HPS)vgawm1bc.obj $(SUBDIR)$(HPS)pcjrmem.obj $(SUBDIR)$(HPS)vgattyp8.obj $(SUBDIR)$(HPS)vgattyg.obj $(SUBDIR)$(HPS)vgattyj.obj $(SUBDIR)$(HPS)vrlrbasp.obj $(SUBDIR)$(HPS)vgapalb.obj $(SUBDIR)$(HPS)vrsidx.obj
 	wlib -q -b -c $(HW_VGA_LIB) -+$(SUBDIR)$(HPS)vga.obj      -+$(SUBDIR)$(HPS)herc.obj     -+$(SUBDIR)$(HPS)tseng.obj
 	wlib -q -b -c $(HW_VGA_LIB) -+$(SUBDIR)$(HPS)vgach3c0.obj -+$(SUBDIR)$(HPS)vgastget.obj -+$(SUBDIR)$(HPS)vgatxt50.obj
 	wlib -q -b -c $(HW_VGA_LIB) -+$(SUBDIR)$(HPS)vgaclks.obj  -+$(SUBDIR)$(HPS)vgabicur.obj -+$(SUBDIR)$(HPS)vgasetmm.obj
@@ -69,7 +71,7 @@ $(HW_VGA_LIB): $(SUBDIR)$(HPS)vga.obj $(SUBDIR)$(HPS)herc.obj $(SUBDIR)$(HPS)tse
 	wlib -q -b -c $(HW_VGA_LIB) -+$(SUBDIR)$(HPS)vrl1xlof.obj -+$(SUBDIR)$(HPS)vrl1xdrw.obj -+$(SUBDIR)$(HPS)vrl1ydrw.obj
 	wlib -q -b -c $(HW_VGA_LIB) -+$(SUBDIR)$(HPS)vrl1xdrs.obj -+$(SUBDIR)$(HPS)vgawm1bc.obj -+$(SUBDIR)$(HPS)pcjrmem.obj
 	wlib -q -b -c $(HW_VGA_LIB) -+$(SUBDIR)$(HPS)vgattyp8.obj -+$(SUBDIR)$(HPS)vgattyg.obj  -+$(SUBDIR)$(HPS)vgattyj.obj
-	wlib -q -b -c $(HW_VGA_LIB) -+$(SUBDIR)$(HPS)vrlrbasp.obj -+$(SUBDIR)$(HPS)vgapalb.obj
+	wlib -q -b -c $(HW_VGA_LIB) -+$(SUBDIR)$(HPS)vrlrbasp.obj -+$(SUBDIR)$(HPS)vgapalb.obj  -+$(SUBDIR)$(HPS)vrsidx.obj
 
 $(HW_VGATTY_LIB): $(SUBDIR)$(HPS)vgatty.obj $(HW_VGA_LIB)
 	wlib -q -b -c $(HW_VGATTY_LIB) -+$(SUBDIR)$(HPS)vgatty.obj
@@ -101,7 +103,7 @@ all: $(OMFSEGDG) lib exe
        
 lib: $(HW_VGA_LIB) $(HW_VGATTY_LIB) $(HW_VGAGUI_LIB) $(HW_VGAGFX_LIB) .symbolic
 	
-exe: $(TEST_EXE) $(TMODESET_EXE) $(TMOTSENG_EXE) $(PCX2VRL_EXE) $(VRLDBG_EXE) $(VRL2VRS_EXE) $(PCXSSCUT_EXE) $(DRAWVRL_EXE) $(VRSDUMP_EXE) $(DRAWVRL2_EXE) $(DRAWVRL3_EXE) $(DRAWVRL4_EXE) $(DRAWVRL5_EXE) $(TGFX_EXE) $(VGA240_EXE) $(CGAFX1_EXE) $(CGAFX2_EXE) $(CGAFX3_EXE) $(CGAFX4_EXE) $(CGAFX4B_EXE) $(CGAFX4C_EXE) $(CGAFX5_EXE) $(CGAFX6_EXE) $(CGAFX6B_EXE) $(CGAFX6C_EXE) $(FONTEDIT_EXE) $(FONTLOAD_EXE) $(FONTSAVE_EXE) $(MCGACAPM_EXE) .symbolic
+exe: $(TEST_EXE) $(TMODESET_EXE) $(TMOTSENG_EXE) $(PCX2VRL_EXE) $(VRLDBG_EXE) $(VRL2VRS_EXE) $(VRL2VCS_EXE) $(PCXSSCUT_EXE) $(DRAWVRL_EXE) $(VRSDUMP_EXE) $(DRAWVRL2_EXE) $(DRAWVRL3_EXE) $(DRAWVRL4_EXE) $(DRAWVRL5_EXE) $(TGFX_EXE) $(VGA240_EXE) $(CGAFX1_EXE) $(CGAFX2_EXE) $(CGAFX3_EXE) $(CGAFX4_EXE) $(CGAFX4B_EXE) $(CGAFX4C_EXE) $(CGAFX5_EXE) $(CGAFX6_EXE) $(CGAFX6B_EXE) $(CGAFX6C_EXE) $(FONTEDIT_EXE) $(FONTLOAD_EXE) $(FONTSAVE_EXE) $(MCGACAPM_EXE) .symbolic
 
 !ifdef TEST_EXE
 $(TEST_EXE): $(HW_VGATTY_LIB) $(HW_VGATTY_LIB_DEPENDENCIES) $(HW_VGA_LIB) $(HW_VGA_LIB_DEPENDENCIES) $(HW_8254_LIB) $(HW_8254_LIB_DEPENDENCIES) $(SUBDIR)$(HPS)test.obj
@@ -237,8 +239,8 @@ $(VGA240_EXE): $(SUBDIR)$(HPS)vga240.obj
 !endif
 
 !ifdef PCX2VRL_EXE
-$(PCX2VRL_EXE): $(SUBDIR)$(HPS)pcx2vrl.obj
-	%write tmp.cmd option quiet option map=$(PCX2VRL_EXE).map system $(WLINK_CON_SYSTEM) file $(SUBDIR)$(HPS)pcx2vrl.obj name $(PCX2VRL_EXE)
+$(PCX2VRL_EXE): $(SUBDIR)$(HPS)pcx2vrl.obj $(SUBDIR)$(HPS)vrlenc.obj
+	%write tmp.cmd option quiet option map=$(PCX2VRL_EXE).map system $(WLINK_CON_SYSTEM) file $(SUBDIR)$(HPS)pcx2vrl.obj file $(SUBDIR)$(HPS)vrlenc.obj name $(PCX2VRL_EXE)
 	@wlink @tmp.cmd
 	@$(COPY) ..$(HPS)..$(HPS)dos32a.dat $(SUBDIR)$(HPS)dos4gw.exe
 !endif
@@ -251,8 +253,8 @@ $(VRLDBG_EXE): $(SUBDIR)$(HPS)vrldbg.obj
 !endif
 
 !ifdef VRSDUMP_EXE
-$(VRSDUMP_EXE): $(SUBDIR)$(HPS)vrsdump.obj
-	%write tmp.cmd option quiet option map=$(VRSDUMP_EXE).map system $(WLINK_CON_SYSTEM) file $(SUBDIR)$(HPS)vrsdump.obj name $(VRSDUMP_EXE)
+$(VRSDUMP_EXE): $(SUBDIR)$(HPS)vrsdump.obj $(SUBDIR)$(HPS)vrsidx.obj
+	%write tmp.cmd option quiet option map=$(VRSDUMP_EXE).map system $(WLINK_CON_SYSTEM) file $(SUBDIR)$(HPS)vrsdump.obj file $(SUBDIR)$(HPS)vrsidx.obj name $(VRSDUMP_EXE)
 	@wlink @tmp.cmd
 	@$(COPY) ..$(HPS)..$(HPS)dos32a.dat $(SUBDIR)$(HPS)dos4gw.exe
 !endif
@@ -264,6 +266,13 @@ $(VRL2VRS_EXE): $(SUBDIR)$(HPS)vrl2vrs.obj $(SUBDIR)$(HPS)comshtps.obj
 	@$(COPY) ..$(HPS)..$(HPS)dos32a.dat $(SUBDIR)$(HPS)dos4gw.exe
 !endif
 
+!ifdef VRL2VCS_EXE
+$(VRL2VCS_EXE): $(SUBDIR)$(HPS)vrl2vcs.obj $(SUBDIR)$(HPS)vrlref.obj $(SUBDIR)$(HPS)vrlenc.obj
+	%write tmp.cmd option quiet option map=$(VRL2VCS_EXE).map system $(WLINK_CON_SYSTEM) file $(SUBDIR)$(HPS)vrl2vcs.obj file $(SUBDIR)$(HPS)vrlref.obj file $(SUBDIR)$(HPS)vrlenc.obj name $(VRL2VCS_EXE)
+	@wlink @tmp.cmd
+	@$(COPY) ..$(HPS)..$(HPS)dos32a.dat $(SUBDIR)$(HPS)dos4gw.exe
+!endif
+
 !ifdef DRAWVRL_EXE
 $(DRAWVRL_EXE): $(HW_VGA_LIB) $(HW_VGA_LIB_DEPENDENCIES) $(SUBDIR)$(HPS)drawvrl.obj
 	%write tmp.cmd option quiet option map=$(DRAWVRL_EXE).map system $(WLINK_CON_SYSTEM) $(HW_VGA_LIB_WLINK_LIBRARIES) file $(SUBDIR)$(HPS)drawvrl.obj name $(DRAWVRL_EXE)
@@ -300,8 +309,8 @@ $(DRAWVRL5_EXE): $(HW_VGA_LIB) $(HW_VGA_LIB_DEPENDENCIES) $(SUBDIR)$(HPS)drawvrl
 !endif
 
 !ifdef PCXSSCUT_EXE
-$(PCXSSCUT_EXE): $(SUBDIR)$(HPS)pcxsscut.obj $(SUBDIR)$(HPS)comshtps.obj
-	%write tmp.cmd option quiet option map=$(PCXSSCUT_EXE).map system $(WLINK_CON_SYSTEM) file $(SUBDIR)$(HPS)pcxsscut.obj file $(SUBDIR)$(HPS)comshtps.obj name $(PCXSSCUT_EXE)
+$(PCXSSCUT_EXE): $(SUBDIR)$(HPS)pcxsscut.obj $(SUBDIR)$(HPS)comshtps.obj $(SUBDIR)$(HPS)vrlenc.obj
+	%write tmp.cmd option quiet option map=$(PCXSSCUT_EXE).map system $(WLINK_CON_SYSTEM) file $(SUBDIR)$(HPS)pcxsscut.obj file $(SUBDIR)$(HPS)comshtps.obj file $(SUBDIR)$(HPS)vrlenc.obj name $(PCXSSCUT_EXE)
 	@wlink @tmp.cmd
 	@$(COPY) ..$(HPS)..$(HPS)dos32a.dat $(SUBDIR)$(HPS)dos4gw.exe
 !endif
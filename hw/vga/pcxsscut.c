@@ -10,6 +10,7 @@
 #include <unistd.h>
 
 #include "vrl.h"
+#include "vrlenc.h"
 #include "pcxfmt.h"
 #include "comshtps.h"
 
@@ -26,7 +27,8 @@ static unsigned int		src_pcx_stride = 0;
 static unsigned int		src_pcx_width = 0;
 static unsigned int		src_pcx_height = 0;
 
-static unsigned char		out_strip[(256*3)+16];
+static unsigned char		out_strip[VRL_STRIP_MAX];
+static unsigned char		enc_profile = VRL_ENC_SIZE;
 static unsigned int		out_strip_height = 0;
 static unsigned int		out_strips = 0;
 
@@ -43,13 +45,16 @@ static void help() {
 	fprintf(stderr,"  -s <filename>                File on how to cut the sprite sheet\n");
 	fprintf(stderr,"  -i <filename>                Read image from PCX file\n");
 	fprintf(stderr,"  -tc <index>                  Specify transparency color\n");
+	fprintf(stderr,"  -e <profile>                 Encoding: size (fewest bytes, default),\n");
+	fprintf(stderr,"                               speed (fewest draw instructions), greedy (old)\n");
 	fprintf(stderr,"  -p <filename>                Write PCX palette to file\n");
 	fprintf(stderr,"  -y                           Always overwrite (careful!)\n");
 }
 
 int main(int argc,char **argv) {
 	const char *src_file = NULL,*scr_file = NULL,*pal_file = NULL,*hdr_file = NULL,*hdr_prefix = NULL;
-	unsigned int x,y,runcount,skipcount,cut;
+	unsigned int x,len,cut;
+	struct vrl_enc_stats enc_stats;
 	struct vrl_spritesheetentry_t *cutreg;
 	unsigned char y_overwrite = 0;
 	unsigned char *s,*d,*dfence;
@@ -88,6 +93,16 @@ int main(int argc,char **argv) {
 			else if (!strcmp(a,"tc")) {
 				transparent_color = (unsigned char)strtoul(argv[i++],NULL,0);
 			}
+			else if (!strcmp(a,"e")) {
+				int p;
+
+				a = argv[i++];
+				if (a == NULL || (p=vrl_enc_profile_from_str(a)) < 0) {
+					fprintf(stderr,"Unknown encoding profile. Use size, speed, or greedy\n");
+					return 1;
+				}
+				enc_profile = (unsigned char)p;
+			}
 			else {
 				fprintf(stderr,"Unknown switch '%s'. Use --help\n",a);
 				return 1;
@@ -300,100 +315,14 @@ int main(int argc,char **argv) {
 		hdr.width = out_strips;
 		write(fd,&hdr,sizeof(hdr));
 
+		memset(&enc_stats,0,sizeof(enc_stats));
 		for (x=0;x < out_strips;x++) {
-			y = 0;
-			d = out_strip;
-			s = src_pcx + x + cutreg->x + (cutreg->y * src_pcx_stride);
-			dfence = out_strip + sizeof(out_strip);
-			while (y < out_strip_height) {
-				unsigned char *stripstart = d;
-				unsigned char color_run = 0;
-
-				d += 2; // patch bytes later
-				runcount = 0;
-				skipcount = 0;
-				while (y < out_strip_height && *s == transparent_color) {
-					y++;
-					s += src_pcx_stride;
-					if ((++skipcount) == 254) break;
-				}
-
-				// check: can we do a run length of one color?
-				if (y < out_strip_height && *s != transparent_color) {
-					unsigned char first_color = *s;
-					unsigned char *scan_s = s;
-					unsigned int scan_y = y;
-
-					color_run = 1;
-					scan_s += src_pcx_stride;
-					scan_y++;
-					while (scan_y < out_strip_height) {
-						if (*scan_s != first_color) break;
-						scan_y++;
-						scan_s += src_pcx_stride;
-						if ((++color_run) == 126) break;
-					}
-
-					if (color_run < 3) color_run = 0;
-
-					if (color_run == 0) {
-						unsigned char ppixel = transparent_color,same_count = 0;
-
-						scan_s = s;
-						scan_y = y;
-						while (scan_y < out_strip_height && *scan_s != transparent_color) {
-							if (*scan_s == ppixel) {
-								if (same_count >= 4) {
-									d -= same_count;
-									scan_y -= same_count;
-									scan_s -= same_count * src_pcx_stride;
-									runcount -= same_count;
-									break;
-								}
-								same_count++;
-							}
-							else {
-								same_count=0;
-							}
-
-							scan_y++;
-							*d++ = ppixel = *scan_s;
-							scan_s += src_pcx_stride;
-							if ((++runcount) == 126) break;
-						}
-					}
-					else {
-						*d++ = first_color;
-						runcount = color_run;
-					}
-
-					y = scan_y;
-					s = scan_s;
-				}
-
-				if (runcount == 0 && skipcount == 0) {
-					d = stripstart;
-				}
-				else {
-					// overwrite the first byte with run + skip count
-					if (color_run != 0) {
-						stripstart[0] = runcount + 0x80; // it's a run of one color
-						d = stripstart + 3; // it becomes <runcount+0x80> <skipcount> <color to repeat>
-					}
-					else {
-						stripstart[0] = runcount; // <runcount> <skipcount> [run]
-					}
-					stripstart[1] = skipcount;
-				}
-			}
-
-			// final byte
-			*d++ = 0xFF;
-			assert(d <= dfence);
-			write(fd,out_strip,(int)(d - out_strip));
+			len = vrl_encode_strip(out_strip,src_pcx + x + cutreg->x + (cutreg->y * src_pcx_stride),src_pcx_stride,out_strip_height,transparent_color,enc_profile,&enc_stats);
+			write(fd,out_strip,(int)len);
 		}
 
 		close(fd);
+		vrl_enc_report(tmpname,out_strips,out_strip_height,enc_profile,&enc_stats);
 	}
 
 	return 0;
@@ -0,0 +1,64 @@
+
+#ifndef __DOSLIB_HW_VGA_VCS_H
+#define __DOSLIB_HW_VGA_VCS_H
+
+#include <stdint.h>
+
+#include "vrl.h"
+
+// VCS (VGA compiled sprites) blob, as written by vrl2vcs.
+//
+//       Each sprite of a VRL or VRS sheet is compiled into straight-line x86 code that writes the sprite's pixels
+//       directly to Mode X video memory, one plane at a time, with no run stream to interpret. Sprites in Mode X
+//       land on a different plane depending on X & 3, so every sprite has four routines, one per alignment.
+//
+//       Like VRS, the file is meant to be loaded into memory as one blob, and all offsets are relative to the
+//       start of the blob. 16-bit blobs must be loaded at a paragraph (segment:0000) and may be larger than 64KB,
+//       each routine is called through a segment of its own and no single routine is larger than 0xFFF0 bytes.
+//
+//       The code is compiled for one scanline stride (header), normally 80 bytes for a 320 pixel wide mode.
+//       To draw sprite at (x,y):
+//
+//         16-bit (VCS_CPU_16): ES:DI = VGA memory + (y * stride) + (x >> 2)
+//                              CALL FAR (blob_segment + (code[x & 3] >> 4)):(code[x & 3] & 0xF)
+//                              AX, DX destroyed. Returns with RETF.
+//
+//         32-bit (VCS_CPU_32): EDI = VGA memory + (y * stride) + (x >> 2), flat
+//                              CALL NEAR blob_base + code[x & 3]
+//                              EAX, EDX destroyed. Returns with RET.
+//
+//       The code writes the Sequencer Map Mask (3C4h index 2) itself and leaves it set to the last plane drawn.
+//       There is no clipping, the caller must only draw sprites entirely on screen.
+
+#pragma pack(push,1)
+struct vcs_header {
+	uint8_t			vcs_sig[4];		// +0x00  "VCS1"
+	uint8_t			cpu;			// +0x04  VCS_CPU_16 or VCS_CPU_32
+	uint8_t			reserved;		// +0x05
+	uint16_t		stride;			// +0x06  scanline stride (bytes) the code was compiled for
+	uint16_t		sprite_count;		// +0x08  entries in the entry table
+	uint16_t		reserved2;		// +0x0A
+	uint32_t		entry_table;		// +0x0C  offset of struct vcs_entry[sprite_count]
+};							// =0x10
+
+struct vcs_entry {
+	uint16_t		sprite_id;		// +0x00  sprite ID from the VRS sheet (1 for a single VRL)
+	uint16_t		width;			// +0x02
+	uint16_t		height;			// +0x04
+	int16_t			hotspot_x;		// +0x06  from the VRL header
+	int16_t			hotspot_y;		// +0x08
+	uint32_t		code[4];		// +0x0A  offset of the routine for (x & 3) == 0, 1, 2, 3
+};							// =0x1A
+#pragma pack(pop)
+
+enum {
+	VCS_CPU_16=16,
+	VCS_CPU_32=32
+};
+
+/* portable reference renderer: draw a VRL sprite into a linear 8-bit framebuffer (stride bytes per line), the way
+ * draw_vrl1_vgax_modex() would on screen. transparent pixels are left alone. no clipping. (vrlref.c) */
+void draw_vrl1_linear(unsigned char *fb,unsigned int fb_stride,unsigned int x,unsigned int y,const struct vrl1_vgax_header *hdr,const unsigned char *data,unsigned int datasz);
+
+#endif //__DOSLIB_HW_VGA_VCS_H
+
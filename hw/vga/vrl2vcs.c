@@ -0,0 +1,648 @@
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <errno.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "vrl.h"
+#include "vrs.h"
+#include "vcs.h"
+#include "vrlenc.h"
+
+#ifndef O_BINARY
+#define O_BINARY (0)
+#endif
+
+/* VRL/VRS to compiled sprite (VCS) compiler. See vcs.h for the format and calling convention. */
+
+#define MAX_SPRITES			1024
+#define MAX_SPRITE_WIDTH		512
+#define MAX_SPRITE_HEIGHT		256
+
+struct sprite_t {
+	uint16_t			sprite_id;
+	const struct vrl1_vgax_header*	hdr;
+	const unsigned char*		data;		// after the header
+	unsigned int			datasz;
+	uint32_t			code[4];	// offset in the output
+	unsigned long			stores;		// store instructions, all 4 routines
+};
+
+static unsigned char*			buffer = NULL;
+static unsigned long			buffer_size = 0;
+
+static struct sprite_t			sprites[MAX_SPRITES];
+static unsigned int			sprite_count = 0;
+
+static unsigned char			cpu = VCS_CPU_16;
+static unsigned int			stride = 80;
+
+static unsigned char*			out = NULL;
+static unsigned long			out_size = 0;
+static unsigned long			out_alloc = 0;
+
+/* decoded sprite */
+static unsigned char			spr_pix[MAX_SPRITE_HEIGHT][MAX_SPRITE_WIDTH];
+static unsigned char			spr_opaque[MAX_SPRITE_HEIGHT][MAX_SPRITE_WIDTH];
+
+static void help() {
+	fprintf(stderr,"VRL2VCS VGA Mode X compiled sprite generator\n");
+	fprintf(stderr,"Turns a VRL sprite or VRS sprite sheet into straight-line x86 code for Mode X.\n");
+	fprintf(stderr,"\n");
+	fprintf(stderr,"vrl2vcs [options]\n");
+	fprintf(stderr,"  -i <filename>                Read VRL or VRS file\n");
+	fprintf(stderr,"  -o <filename>                Write VCS blob\n");
+	fprintf(stderr,"  -cpu <16|32>                 Generate 16-bit (default) or 32-bit code\n");
+	fprintf(stderr,"  -stride <n>                  Scanline stride in bytes (default 80)\n");
+}
+
+/*----------------------------------------------------------------------------------------------*/
+
+static void emit(const unsigned char b) {
+	if (out_size >= out_alloc) {
+		unsigned char *np;
+
+		out_alloc = (out_alloc == 0) ? 0x4000UL : (out_alloc * 2UL);
+		np = realloc(out,out_alloc);
+		if (np == NULL) {
+			fprintf(stderr,"Out of memory\n");
+			exit(1);
+		}
+		out = np;
+	}
+
+	out[out_size++] = b;
+}
+
+static void emit16(const uint16_t w) {
+	emit((unsigned char)w);
+	emit((unsigned char)(w >> 8u));
+}
+
+static void emit32(const uint32_t w) {
+	emit16((uint16_t)w);
+	emit16((uint16_t)(w >> 16ul));
+}
+
+/* ModR/M for [DI+disp] (16-bit) or [EDI+disp] (32-bit), /0, followed by the displacement */
+static void emit_modrm_disp(unsigned long disp) {
+	const unsigned char rm = (cpu == VCS_CPU_32) ? 7 : 5;
+
+	if (cpu == VCS_CPU_16) disp &= 0xFFFFUL;
+
+	if (disp == 0UL) {
+		emit(0x00 | rm);
+	}
+	else if (disp < 0x80UL) {
+		emit(0x40 | rm);
+		emit((unsigned char)disp);
+	}
+	else if (cpu == VCS_CPU_32) {
+		emit(0x80 | rm);
+		emit32((uint32_t)disp);
+	}
+	else {
+		emit(0x80 | rm);
+		emit16((uint16_t)disp);
+	}
+}
+
+/* MOV [DI+disp],imm with n = 1, 2 or 4 bytes */
+static void emit_store(const unsigned long disp,const unsigned int n,const unsigned char *px) {
+	if (cpu == VCS_CPU_16) emit(0x26);			// ES:
+	else if (n == 2) emit(0x66);				// operand size
+
+	emit(n == 1 ? 0xC6 : 0xC7);
+	emit_modrm_disp(disp);
+
+	if (n == 4) emit32((uint32_t)px[0] + ((uint32_t)px[1] << 8ul) + ((uint32_t)px[2] << 16ul) + ((uint32_t)px[3] << 24ul));
+	else if (n == 2) emit16((uint16_t)(px[0] + (px[1] << 8u)));
+	else emit(px[0]);
+}
+
+static void emit_map_mask(const unsigned char mask) {
+	if (cpu == VCS_CPU_32) emit(0x66);
+	emit(0xB8);						// MOV AX,(mask << 8) + 2
+	emit16((uint16_t)(0x02 + ((unsigned int)mask << 8u)));
+	if (cpu == VCS_CPU_32) emit(0x66);
+	emit(0xEF);						// OUT DX,AX
+}
+
+/* compile the sprite currently in spr_pix/spr_opaque for the alignment (x & 3) == align, for scanlines cstride bytes apart */
+static unsigned long compile_align(const struct sprite_t *spr,const unsigned int align,const unsigned int cstride) {
+	const unsigned int w = spr->hdr->width,h = spr->hdr->height;
+	const unsigned int maxn = (cpu == VCS_CPU_32) ? 4 : 2;
+	unsigned char px[4];
+	unsigned long stores = 0;
+	unsigned int plane,y,b,n,i,first;
+
+	emit(0xBA);						// MOV DX,3C4h
+	if (cpu == VCS_CPU_32) emit32(0x3C4);
+	else emit16(0x3C4);
+
+	/* screen column x+c lands on plane (align+c)&3, byte (align+c)>>2 from DI */
+	for (plane=0;plane < 4;plane++) {
+		first = (plane >= align) ? (plane - align) : (plane + 4u - align); /* first sprite column on this plane */
+		if (first >= w) continue;
+
+		/* any pixels at all? */
+		for (y=0;y < h;y++) {
+			for (b=first;b < w;b += 4u) {
+				if (spr_opaque[y][b]) break;
+			}
+			if (b < w) break;
+		}
+		if (y >= h) continue;
+
+		emit_map_mask((unsigned char)(1u << plane));
+
+		for (y=0;y < h;y++) {
+			/* sprite column c = first + (4 * i) is VRAM byte ((align + first) >> 2) + i of this row */
+			for (i=0;(first + (i * 4u)) < w;) {
+				if (!spr_opaque[y][first + (i * 4u)]) {
+					i++;
+					continue;
+				}
+
+				/* widest store of adjacent opaque bytes */
+				for (n=0;n < maxn && (first + ((i + n) * 4u)) < w && spr_opaque[y][first + ((i + n) * 4u)];n++)
+					px[n] = spr_pix[y][first + ((i + n) * 4u)];
+				if (n == 3) n = 2;
+
+				emit_store(((unsigned long)y * (unsigned long)cstride) + (unsigned long)(((align + first) >> 2u) + i),n,px);
+				stores++;
+				i += n;
+			}
+		}
+	}
+
+	emit(cpu == VCS_CPU_32 ? 0xC3 : 0xCB);			// RET / RETF
+	return stores;
+}
+
+/*----------------------------------------------------------------------------------------------*/
+
+/* Mode X emulation, just enough of x86 to run what compile_align() writes */
+static unsigned char			emu_vram[4][0x10000];
+
+static int emulate(const unsigned char *code,const unsigned char *fence,unsigned long di) {
+	unsigned long dx = 0,ax = 0,disp,imm;
+	unsigned char map_mask = 0;
+	unsigned char opsize,seg,op,modrm;
+	unsigned int n,i,p;
+
+	while (code < fence) {
+		opsize = 0;
+		seg = 0;
+		if (*code == 0x66) { opsize = 1; code++; }
+		if (*code == 0x26) { seg = 1; code++; }
+		if (code >= fence) return -1;
+
+		op = *code++;
+		switch (op) {
+			case 0xBA: /* MOV DX/EDX,imm */
+				if (cpu == VCS_CPU_32) { dx = (unsigned long)code[0] + ((unsigned long)code[1] << 8ul) + ((unsigned long)code[2] << 16ul) + ((unsigned long)code[3] << 24ul); code += 4; }
+				else { dx = (unsigned long)code[0] + ((unsigned long)code[1] << 8ul); code += 2; }
+				break;
+			case 0xB8: /* MOV AX,imm */
+				if ((cpu == VCS_CPU_32) != (opsize != 0)) return -1;
+				ax = (unsigned long)code[0] + ((unsigned long)code[1] << 8ul);
+				code += 2;
+				break;
+			case 0xEF: /* OUT DX,AX */
+				if ((cpu == VCS_CPU_32) != (opsize != 0)) return -1;
+				if (dx != 0x3C4) return -1;
+				if ((ax & 0xFF) == 0x02) map_mask = (unsigned char)(ax >> 8ul);
+				break;
+			case 0xC6: /* MOV r/m8,imm8 */
+			case 0xC7: /* MOV r/m16/32,imm */
+				if ((cpu == VCS_CPU_16) != (seg != 0)) return -1;
+				modrm = *code++;
+				if ((modrm & 0x3F) != ((cpu == VCS_CPU_32) ? 7 : 5)) return -1;
+				if ((modrm >> 6) == 0) {
+					disp = 0;
+				}
+				else if ((modrm >> 6) == 1) {
+					disp = (unsigned long)((long)((signed char)code[0]));
+					code++;
+				}
+				else if ((modrm >> 6) == 2 && cpu == VCS_CPU_32) {
+					disp = (unsigned long)code[0] + ((unsigned long)code[1] << 8ul) + ((unsigned long)code[2] << 16ul) + ((unsigned long)code[3] << 24ul);
+					code += 4;
+				}
+				else if ((modrm >> 6) == 2) {
+					disp = (unsigned long)code[0] + ((unsigned long)code[1] << 8ul);
+					code += 2;
+				}
+				else {
+					return -1;
+				}
+
+				if (op == 0xC6) n = 1;
+				else if (cpu == VCS_CPU_32) n = opsize ? 2 : 4;
+				else n = opsize ? 4 : 2;
+				if (cpu == VCS_CPU_16 && n == 4) return -1;
+
+				imm = 0;
+				for (i=0;i < n;i++) imm += (unsigned long)code[i] << (8ul * i);
+				code += n;
+
+				for (i=0;i < n;i++) {
+					unsigned long a = (di + disp + i);
+
+					a &= (cpu == VCS_CPU_16) ? 0xFFFFUL : 0xFFFFFFFFUL;
+					if (a >= 0x10000UL) return -1;
+
+					for (p=0;p < 4;p++) {
+						if (map_mask & (1u << p))
+							emu_vram[p][a] = (unsigned char)(imm >> (8ul * i));
+					}
+				}
+				break;
+			case 0xC3: /* RET */
+				return (cpu == VCS_CPU_32) ? 0 : -1;
+			case 0xCB: /* RETF */
+				return (cpu == VCS_CPU_16) ? 0 : -1;
+			default:
+				return -1;
+		}
+	}
+
+	return -1; /* ran off the end */
+}
+
+/* draw with the compiled code at each alignment and compare against draw_vrl1_linear(), pixel for pixel.
+ * The emulated screen needs room for the sprite at x = 8..11 in each row. If the output stride is too narrow
+ * for that (a 320 pixel wide sprite at stride 80), or too wide for the emulated 64KB, the sprite is compiled
+ * again for a screen of its own and that is what runs. The two differ only in the row stride of the store addresses. */
+static int verify(const struct sprite_t *spr) {
+	const unsigned int w = spr->hdr->width,h = spr->hdr->height;
+	const unsigned long keep_size = out_size;
+	unsigned int vstride = stride,fbw,fbh,align,x,y,sx,sy;
+	uint32_t code[4];
+	unsigned char *fb;
+	int ret = 0;
+
+	if ((8u + 3u + w) > (vstride * 4u) || ((unsigned long)(h + 8u) * (unsigned long)vstride) > 0x10000UL) {
+		vstride = (8u + 3u + w + 3u) / 4u;
+		for (align=0;align < 4;align++) {
+			code[align] = (uint32_t)out_size;
+			compile_align(spr,align,vstride);
+		}
+	}
+	else {
+		for (align=0;align < 4;align++) code[align] = spr->code[align];
+	}
+
+	fbw = vstride * 4u;
+	fbh = h + 8u;
+	if (((unsigned long)fbh * (unsigned long)vstride) > 0x10000UL) {
+		fprintf(stderr,"Sprite %u is too large to verify\n",spr->sprite_id);
+		out_size = keep_size;
+		return -1;
+	}
+
+	fb = malloc(fbw * fbh);
+	if (fb == NULL) {
+		out_size = keep_size;
+		return -1;
+	}
+
+	for (align=0;align < 4 && ret == 0;align++) {
+		sx = 8u + align;
+		sy = 4u;
+
+		/* a background that transparency must show through */
+		for (y=0;y < fbh;y++) {
+			for (x=0;x < fbw;x++) {
+				fb[(y * fbw) + x] = (unsigned char)((x * 7u) + (y * 13u) + 0x5A);
+				emu_vram[x & 3u][(y * vstride) + (x >> 2u)] = fb[(y * fbw) + x];
+			}
+		}
+
+		draw_vrl1_linear(fb,fbw,sx,sy,spr->hdr,spr->data,spr->datasz);
+		if (emulate(out + code[sx & 3u],out + out_size,((unsigned long)sy * (unsigned long)vstride) + (unsigned long)(sx >> 2u)) < 0) {
+			fprintf(stderr,"Sprite %u alignment %u: generated code did not run\n",spr->sprite_id,align);
+			ret = -1;
+			break;
+		}
+
+		for (y=0;y < fbh && ret == 0;y++) {
+			for (x=0;x < fbw;x++) {
+				if (fb[(y * fbw) + x] != emu_vram[x & 3u][(y * vstride) + (x >> 2u)]) {
+					fprintf(stderr,"Sprite %u alignment %u: pixel mismatch at (%u,%u)\n",spr->sprite_id,align,x - sx,y - sy);
+					ret = -1;
+					break;
+				}
+			}
+		}
+	}
+
+	/* drop the code compiled only for verification */
+	out_size = keep_size;
+	free(fb);
+	return ret;
+}
+
+/*----------------------------------------------------------------------------------------------*/
+
+/* how far the strips of a VRL go. returns 0 if they run off the end. */
+static unsigned int vrl_data_size(const struct vrl1_vgax_header *hdr,const unsigned char *data,const unsigned char *fence) {
+	const unsigned char *s = data;
+	unsigned int x;
+	unsigned char run;
+
+	for (x=0;x < hdr->width;x++) {
+		do {
+			if (s >= fence) return 0;
+			run = *s++;
+			if (run == 0xFF) break;
+			if ((fence - s) < 2) return 0;
+			s++; /* skip */
+			s += (run & 0x80) ? 1 : run;
+		} while (1);
+	}
+
+	return (s <= fence) ? (unsigned int)(s - data) : 0;
+}
+
+static int decode_sprite(const struct sprite_t *spr) {
+	const unsigned char *s = spr->data,*fence = spr->data + spr->datasz;
+	unsigned int x,y;
+	unsigned char run,skip;
+
+	memset(spr_opaque,0,sizeof(spr_opaque));
+
+	for (x=0;x < spr->hdr->width;x++) {
+		y = 0;
+		while ((run = *s++) != 0xFF) {
+			skip = *s++;
+			y += skip;
+
+			if (run & 0x80) {
+				for (run &= 0x7F;run > 0;run--,y++) {
+					if (y >= spr->hdr->height) return -1;
+					spr_pix[y][x] = *s;
+					spr_opaque[y][x] = 1;
+				}
+				s++;
+			}
+			else {
+				for (;run > 0;run--,y++) {
+					if (y >= spr->hdr->height) return -1;
+					spr_pix[y][x] = *s++;
+					spr_opaque[y][x] = 1;
+				}
+			}
+		}
+	}
+
+	return (s <= fence) ? 0 : -1;
+}
+
+static int add_sprite(const uint16_t id,const unsigned long offset) {
+	struct sprite_t *spr;
+
+	if (sprite_count >= MAX_SPRITES) {
+		fprintf(stderr,"Too many sprites\n");
+		return -1;
+	}
+	if ((offset + sizeof(struct vrl1_vgax_header)) > buffer_size || memcmp(buffer + offset,"VRL1",4) || memcmp(buffer + offset + 4,"VGAX",4)) {
+		fprintf(stderr,"Sprite %u is not a VRL1 VGAX sprite\n",id);
+		return -1;
+	}
+
+	spr = &sprites[sprite_count];
+	memset(spr,0,sizeof(*spr));
+	spr->sprite_id = id;
+	spr->hdr = (const struct vrl1_vgax_header*)(buffer + offset);
+	spr->data = buffer + offset + sizeof(struct vrl1_vgax_header);
+
+	if (spr->hdr->width == 0 || spr->hdr->width > MAX_SPRITE_WIDTH || spr->hdr->height == 0 || spr->hdr->height > MAX_SPRITE_HEIGHT) {
+		fprintf(stderr,"Sprite %u has unsupported dimensions %ux%u\n",id,spr->hdr->width,spr->hdr->height);
+		return -1;
+	}
+
+	spr->datasz = vrl_data_size(spr->hdr,spr->data,buffer + buffer_size);
+	if (spr->datasz == 0) {
+		fprintf(stderr,"Sprite %u is truncated\n",id);
+		return -1;
+	}
+
+	sprite_count++;
+	return 0;
+}
+
+static int load_sprites(void) {
+	if (buffer_size >= 8 && !memcmp(buffer,"VRL1",4))
+		return add_sprite(1,0);
+
+	if (buffer_size >= sizeof(struct vrs_header) && !memcmp(buffer,"VRS1",4)) {
+		const struct vrs_header *vrshdr = (const struct vrs_header*)buffer;
+		const unsigned long lofs = vrshdr->offset_table[VRS_HEADER_OFFSET_VRS_LIST];
+		const unsigned long iofs = vrshdr->offset_table[VRS_HEADER_OFFSET_SPRITE_ID_LIST];
+		unsigned int i;
+		uint32_t o;
+		uint16_t id;
+
+		if (lofs == 0UL || iofs == 0UL) {
+			fprintf(stderr,"VRS has no sprite list\n");
+			return -1;
+		}
+
+		for (i=0;;i++) {
+			if ((lofs + ((i + 1UL) * 4UL)) > buffer_size || (iofs + ((i + 1UL) * 2UL)) > buffer_size) {
+				fprintf(stderr,"VRS sprite list overruns the file\n");
+				return -1;
+			}
+
+			memcpy(&o,buffer + lofs + (i * 4UL),4);
+			memcpy(&id,buffer + iofs + (i * 2UL),2);
+			if (o == 0 || id == 0) break;
+
+			if (add_sprite(id,o)) return -1;
+		}
+
+		return 0;
+	}
+
+	fprintf(stderr,"Not a VRL or VRS file\n");
+	return -1;
+}
+
+int main(int argc,char **argv) {
+	const char *src_file = NULL,*dst_file = NULL;
+	struct vcs_header vcshdr;
+	struct vcs_entry ent;
+	unsigned long entry_ofs,code_size,total_code = 0;
+	struct vrl_enc_stats st;
+	const unsigned char *s;
+	struct sprite_t *spr;
+	unsigned int si,a,x;
+	const char *a_;
+	int i,fd;
+
+	for (i=1;i < argc;) {
+		a_ = argv[i++];
+		if (*a_ == '-') {
+			do { a_++; } while (*a_ == '-');
+
+			if (!strcmp(a_,"h") || !strcmp(a_,"help")) {
+				help();
+				return 1;
+			}
+			else if (!strcmp(a_,"i")) {
+				src_file = argv[i++];
+			}
+			else if (!strcmp(a_,"o")) {
+				dst_file = argv[i++];
+			}
+			else if (!strcmp(a_,"cpu")) {
+				a_ = argv[i++];
+				if (a_ == NULL) a_ = "";
+				if (!strcmp(a_,"16")) cpu = VCS_CPU_16;
+				else if (!strcmp(a_,"32")) cpu = VCS_CPU_32;
+				else {
+					fprintf(stderr,"-cpu must be 16 or 32\n");
+					return 1;
+				}
+			}
+			else if (!strcmp(a_,"stride")) {
+				a_ = argv[i++];
+				stride = (a_ != NULL) ? (unsigned int)strtoul(a_,NULL,0) : 0;
+				if (stride == 0 || stride > 0x1000) {
+					fprintf(stderr,"Bad stride\n");
+					return 1;
+				}
+			}
+			else {
+				fprintf(stderr,"Unknown switch '%s'. Use --help\n",a_);
+				return 1;
+			}
+		}
+		else {
+			fprintf(stderr,"Unknown param %s\n",a_);
+			return 1;
+		}
+	}
+
+	if (src_file == NULL || dst_file == NULL) {
+		help();
+		return 1;
+	}
+
+	/* load the whole VRL/VRS, as a game would */
+	fd = open(src_file,O_RDONLY|O_BINARY);
+	if (fd < 0) {
+		fprintf(stderr,"Cannot open source file '%s', %s\n",src_file,strerror(errno));
+		return 1;
+	}
+	buffer_size = (unsigned long)lseek(fd,0,SEEK_END);
+	if (buffer_size == 0UL || (sizeof(unsigned int) == 2 && buffer_size > 0xFFF0UL)) {
+		fprintf(stderr,"Source file is empty or too large\n");
+		return 1;
+	}
+	buffer = malloc((size_t)buffer_size);
+	if (buffer == NULL) {
+		fprintf(stderr,"Cannot malloc for source file\n");
+		return 1;
+	}
+	lseek(fd,0,SEEK_SET);
+	if ((unsigned long)read(fd,buffer,(size_t)buffer_size) != buffer_size) {
+		fprintf(stderr,"Cannot read source file\n");
+		return 1;
+	}
+	close(fd);
+
+	if (load_sprites() || sprite_count == 0)
+		return 1;
+
+	/* header and entry table first, code after */
+	for (x=0;x < (sizeof(struct vcs_header) + (sprite_count * sizeof(struct vcs_entry)));x++) emit(0);
+	entry_ofs = sizeof(struct vcs_header);
+
+	for (si=0;si < sprite_count;si++) {
+		spr = &sprites[si];
+
+		if (decode_sprite(spr)) {
+			fprintf(stderr,"Sprite %u: VRL data overruns the sprite\n",spr->sprite_id);
+			return 1;
+		}
+
+		/* 16-bit store addresses are DI + 16-bit displacement */
+		if (cpu == VCS_CPU_16 && ((((unsigned long)spr->hdr->height - 1UL) * (unsigned long)stride) + ((3UL + spr->hdr->width) >> 2UL)) > 0xFFFFUL) {
+			fprintf(stderr,"Sprite %u: %u rows at stride %u do not fit in a 16-bit segment\n",spr->sprite_id,spr->hdr->height,stride);
+			return 1;
+		}
+
+		for (a=0;a < 4;a++) {
+			spr->code[a] = (uint32_t)out_size;
+			spr->stores += compile_align(spr,a,stride);
+
+			/* 16-bit code is called at (segment + (code >> 4)):(code & 15), one routine must fit in a segment */
+			if (cpu == VCS_CPU_16 && (out_size - spr->code[a]) > 0xFFF0UL) {
+				fprintf(stderr,"Sprite %u: a routine is %lu bytes, too large for 16-bit code, use -cpu 32\n",
+					spr->sprite_id,out_size - spr->code[a]);
+				return 1;
+			}
+		}
+
+		if (verify(spr)) return 1;
+
+		/* compare with what the VRL interpreter would go through (for alignment 0) */
+		memset(&st,0,sizeof(st));
+		for (x=0,s=spr->data;x < spr->hdr->width;x++) {
+			vrl_strip_stats(s,&st);
+			while (*s != 0xFF) s += (*s & 0x80) ? 3 : (2 + s[0]);
+			s++;
+		}
+
+		code_size = out_size - spr->code[0];
+		printf("Sprite %u: %ux%u, %lu bytes of code (4 alignments), avg %lu stores per draw, VRL draw est. %lu instructions\n",
+			spr->sprite_id,spr->hdr->width,spr->hdr->height,code_size,spr->stores / 4UL,st.cost);
+		total_code += code_size;
+	}
+
+	/* fill in the header and the entry table */
+	memset(&vcshdr,0,sizeof(vcshdr));
+	memcpy(vcshdr.vcs_sig,"VCS1",4);
+	vcshdr.cpu = cpu;
+	vcshdr.stride = (uint16_t)stride;
+	vcshdr.sprite_count = (uint16_t)sprite_count;
+	vcshdr.entry_table = (uint32_t)entry_ofs;
+	memcpy(out,&vcshdr,sizeof(vcshdr));
+
+	for (si=0;si < sprite_count;si++) {
+		spr = &sprites[si];
+
+		memset(&ent,0,sizeof(ent));
+		ent.sprite_id = spr->sprite_id;
+		ent.width = spr->hdr->width;
+		ent.height = spr->hdr->height;
+		ent.hotspot_x = spr->hdr->hotspot_x;
+		ent.hotspot_y = spr->hdr->hotspot_y;
+		for (a=0;a < 4;a++) ent.code[a] = spr->code[a];
+		memcpy(out + entry_ofs + (si * sizeof(struct vcs_entry)),&ent,sizeof(ent));
+	}
+
+	fd = open(dst_file,O_WRONLY|O_CREAT|O_TRUNC|O_BINARY,0644);
+	if (fd < 0) {
+		fprintf(stderr,"Cannot create file '%s', %s\n",dst_file,strerror(errno));
+		return 1;
+	}
+	write(fd,out,(size_t)out_size);
+	close(fd);
+
+	printf("%u sprites, %lu bytes (%lu of code), %u-bit, stride %u, verified against the reference renderer\n",
+		sprite_count,out_size,total_code,cpu,stride);
+
+	free(out);
+	free(buffer);
+	return 0;
+}
+
@@ -20,6 +20,90 @@
 
 static unsigned char			tempbuffer[8192];
 
+enum {
+	IDX_NONE=0,
+	IDX_AUTO,
+	IDX_DIRECT,
+	IDX_SORTED
+};
+
+static const char*			idx_mode_str[] = { "none", "auto", "direct", "sorted" };
+static unsigned char			idx_mode = IDX_AUTO;
+
+static int id_index_sort_cmp(const void *a,const void *b) {
+	const struct vrs_id_index_sorted_entry_t *ea = (const struct vrs_id_index_sorted_entry_t*)a;
+	const struct vrs_id_index_sorted_entry_t *eb = (const struct vrs_id_index_sorted_entry_t*)b;
+
+	if (ea->id != eb->id) return (ea->id < eb->id) ? -1 : 1;
+	if (ea->index != eb->index) return (ea->index < eb->index) ? -1 : 1;
+	return 0;
+}
+
+/* write the ID index for ids[0..count-1], the same list as written to the ID list. Returns the offset, or 0 if none. */
+static unsigned long write_id_index(int fd,unsigned long *foffset,const uint16_t *ids,unsigned int count) {
+	struct vrs_id_index_sorted_entry_t *srt;
+	struct vrs_id_index_t idx;
+	unsigned long ofs = *foffset;
+	unsigned int i,o,range;
+	uint16_t *dir;
+
+	if (idx_mode == IDX_NONE || count == 0) return 0;
+
+	/* word align, the lookup reads nothing but 16-bit values */
+	if (ofs & 1UL) {
+		tempbuffer[0] = 0;
+		write(fd,tempbuffer,1);
+		*foffset += 1;
+		ofs++;
+	}
+
+	memset(&idx,0,sizeof(idx));
+	idx.min_id = idx.max_id = ids[0];
+	for (i=1;i < count;i++) {
+		if (idx.min_id > ids[i]) idx.min_id = ids[i];
+		if (idx.max_id < ids[i]) idx.max_id = ids[i];
+	}
+	range = idx.max_id + 1u - idx.min_id;
+
+	/* direct costs 2 bytes per ID in the range, sorted 4 bytes per ID. direct is also faster, so let it use up to twice the space. */
+	if (idx_mode == IDX_DIRECT || (idx_mode == IDX_AUTO && range <= (count * 4u))) {
+		dir = malloc(range * sizeof(uint16_t));
+		if (dir == NULL) return 0;
+		for (i=0;i < range;i++) dir[i] = VRS_ID_INDEX_NONE;
+		for (i=count;i > 0;) { i--; dir[ids[i] - idx.min_id] = (uint16_t)i; } /* backwards, so the first of duplicate IDs wins like the scan */
+
+		idx.index_type = VRS_ID_INDEX_DIRECT;
+		idx.count = (uint16_t)range;
+		write(fd,&idx,sizeof(idx));
+		write(fd,dir,range * sizeof(uint16_t));
+		*foffset += sizeof(idx) + (range * sizeof(uint16_t));
+		free(dir);
+	}
+	else {
+		srt = malloc(count * sizeof(*srt));
+		if (srt == NULL) return 0;
+		for (i=0;i < count;i++) {
+			srt[i].id = ids[i];
+			srt[i].index = (uint16_t)i;
+		}
+		qsort(srt,count,sizeof(*srt),id_index_sort_cmp);
+
+		/* keep the first of duplicate IDs */
+		for (i=1,o=1;i < count;i++) {
+			if (srt[i].id != srt[o-1].id) srt[o++] = srt[i];
+		}
+
+		idx.index_type = VRS_ID_INDEX_SORTED;
+		idx.count = (uint16_t)o;
+		write(fd,&idx,sizeof(idx));
+		write(fd,srt,o * sizeof(*srt));
+		*foffset += sizeof(idx) + (o * sizeof(*srt));
+		free(srt);
+	}
+
+	return ofs;
+}
+
 static void help() {
 	fprintf(stderr,"VRL2VRS sprite sheet compiler (C) 2016 Jonathan Campbell\n");
 	fprintf(stderr,"Program will read multiple VRL files as directed by sprite sheet file\n");
@@ -30,6 +114,7 @@ static void help() {
 	fprintf(stderr,"  -hc <filename>               Emit sprite names and IDs to C header\n");
 	fprintf(stderr,"  -s <filename>                File on how to cut the sprite sheet\n");
 	fprintf(stderr,"  -o <filename>                Output VRS file\n");
+	fprintf(stderr,"  -idx <auto|direct|sorted|none> ID index to write (default auto)\n");
 }
 
 int main(int argc,char **argv) {
@@ -37,6 +122,7 @@ int main(int argc,char **argv) {
 	struct vrs_header vrshdr;
 	unsigned long foffset;
 	unsigned int cut;
+	uint16_t idlist[MAX_CUTREGIONS];
 	char tmpname[14];
 	int i,fd,srcfd;
 	const char *a;
@@ -63,6 +149,15 @@ int main(int argc,char **argv) {
 			else if (!strcmp(a,"s")) {
 				scr_file = argv[i++];
 			}
+			else if (!strcmp(a,"idx")) {
+				a = argv[i++];
+				if (a == NULL) a = "";
+				for (idx_mode=0;idx_mode < 4 && strcmp(a,idx_mode_str[idx_mode]);idx_mode++);
+				if (idx_mode >= 4) {
+					fprintf(stderr,"Unknown index type '%s'\n",a);
+					return 1;
+				}
+			}
 			else {
 				fprintf(stderr,"Unknown switch '%s'. Use --help\n",a);
 				return 1;
@@ -299,6 +394,12 @@ int main(int argc,char **argv) {
 	write(fd,tempbuffer,1);
 	foffset += 1;
 
+	// ID indexes, so that programs do not have to scan the ID lists
+	for (cut=0;cut < cutregions && cutregion[cut].sprite_id != 0;cut++) idlist[cut] = cutregion[cut].sprite_id;
+	vrshdr.offset_table[VRS_HEADER_OFFSET_SPRITE_ID_INDEX] = write_id_index(fd,&foffset,idlist,cut);
+	for (cut=0;cut < animlists && animlist[cut].animation_id != 0;cut++) idlist[cut] = animlist[cut].animation_id;
+	vrshdr.offset_table[VRS_HEADER_OFFSET_ANIMATION_ID_INDEX] = write_id_index(fd,&foffset,idlist,cut);
+
 	// update header on disk
 	vrshdr.resident_size = foffset;
 	lseek(fd,0,SEEK_SET);
@@ -0,0 +1,297 @@
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vrl.h"
+#include "vrlenc.h"
+
+const char *vrl_enc_profile_str[VRL_ENC_MAX] = {
+	"size",
+	"speed",
+	"greedy"
+};
+
+int vrl_enc_profile_from_str(const char *s) {
+	int i;
+
+	for (i=0;i < VRL_ENC_MAX;i++) {
+		if (!strcmp(s,vrl_enc_profile_str[i]))
+			return i;
+	}
+
+	return -1;
+}
+
+#define VRL_MAX_SKIP			255
+#define VRL_MAX_COPY			127
+#define VRL_MAX_RUN			126	/* 0x80+127 would be the 0xFF end of strip marker */
+
+void vrl_strip_stats(const unsigned char *strip,struct vrl_enc_stats *stats) {
+	const unsigned char *s = strip;
+	unsigned char run;
+
+	while ((run = *s++) != 0xFF) {
+		s++; /* skip count */
+		stats->segments++;
+		stats->cost += VRL_COST_SEGMENT;
+
+		if (run & 0x80) {
+			run &= 0x7F;
+			s++;
+			stats->cost += VRL_COST_RUN + ((unsigned long)run * VRL_COST_RUN_PIXEL);
+		}
+		else {
+			s += run;
+			stats->cost += VRL_COST_COPY + ((unsigned long)run * VRL_COST_COPY_PIXEL);
+		}
+	}
+
+	stats->cost += VRL_COST_END;
+	stats->bytes += (unsigned long)(s - strip);
+}
+
+/* the original encoder: skip, then a run if 3 or more pixels repeat, else copy until 5 pixels repeat */
+static unsigned int vrl_encode_strip_greedy(unsigned char *d,const unsigned char *s,unsigned int stride,unsigned int height,unsigned char transparent_color) {
+	unsigned char *d0 = d;
+	unsigned int y = 0,runcount,skipcount;
+
+	while (y < height) {
+		unsigned char *stripstart = d;
+		unsigned char color_run = 0;
+
+		d += 2; // patch bytes later
+		runcount = 0;
+		skipcount = 0;
+		while (y < height && *s == transparent_color) {
+			y++;
+			s += stride;
+			if ((++skipcount) == 254) break;
+		}
+
+		// check: can we do a run length of one color?
+		if (y < height && *s != transparent_color) {
+			unsigned char first_color = *s;
+			const unsigned char *scan_s = s;
+			unsigned int scan_y = y;
+
+			color_run = 1;
+			scan_s += stride;
+			scan_y++;
+			while (scan_y < height) {
+				if (*scan_s != first_color) break;
+				scan_y++;
+				scan_s += stride;
+				if ((++color_run) == 126) break;
+			}
+
+			if (color_run < 3) color_run = 0;
+
+			if (color_run == 0) {
+				unsigned char ppixel = transparent_color,same_count = 0;
+
+				scan_s = s;
+				scan_y = y;
+				while (scan_y < height && *scan_s != transparent_color) {
+					if (*scan_s == ppixel) {
+						if (same_count >= 4) {
+							d -= same_count;
+							scan_y -= same_count;
+							scan_s -= same_count * stride;
+							runcount -= same_count;
+							break;
+						}
+						same_count++;
+					}
+					else {
+						same_count=0;
+					}
+
+					scan_y++;
+					*d++ = ppixel = *scan_s;
+					scan_s += stride;
+					if ((++runcount) == 126) break;
+				}
+			}
+			else {
+				*d++ = first_color;
+				runcount = color_run;
+			}
+
+			y = scan_y;
+			s = scan_s;
+		}
+
+		if (runcount == 0 && y >= height) {
+			/* avoid encoding strips with zero length just to skip to end of column */
+			d = stripstart;
+			break;
+		}
+
+		if (runcount == 0 && skipcount == 0) {
+			d = stripstart;
+		}
+		else {
+			// overwrite the first byte with run + skip count
+			if (color_run != 0) {
+				stripstart[0] = runcount + 0x80; // it's a run of one color
+				d = stripstart + 3; // it becomes <runcount+0x80> <skipcount> <color to repeat>
+			}
+			else {
+				stripstart[0] = runcount; // <runcount> <skipcount> [run]
+			}
+			stripstart[1] = skipcount;
+		}
+	}
+
+	// final byte
+	*d++ = 0xFF;
+	return (unsigned int)(d - d0);
+}
+
+/* Optimal segmentation by dynamic programming, working back from the bottom of the column.
+ *
+ * Transparent pixels can only be skipped and opaque pixels must be drawn, so a segment starting at y
+ * always skips all the transparent pixels in front of it (up to 255) and then draws n opaque pixels,
+ * either copied or, if they are all the same color, as a run. best[y] is the cheapest way to encode
+ * everything from y down. The two measures (bytes, instructions) are combined into one number with
+ * the one the profile cares about in the upper bits, so that ties go to the other one. Neither can
+ * reach 65536 for a 256 pixel column. */
+
+#define VRL_DP_MAX_HEIGHT		256
+
+static unsigned short			dp_trun[VRL_DP_MAX_HEIGHT+1];		/* transparent pixels from y on */
+static unsigned short			dp_orun[VRL_DP_MAX_HEIGHT+1];		/* opaque pixels from y on */
+static unsigned short			dp_erun[VRL_DP_MAX_HEIGHT+1];		/* opaque pixels of the same color from y on */
+static uint32_t				dp_best[VRL_DP_MAX_HEIGHT+1];
+static unsigned char			dp_n[VRL_DP_MAX_HEIGHT+1];		/* pixels drawn by the segment at y */
+static unsigned char			dp_is_run[VRL_DP_MAX_HEIGHT+1];
+
+static uint32_t vrl_dp_weight(const unsigned char profile,const unsigned int bytes,const unsigned int cost) {
+	if (profile == VRL_ENC_SPEED)
+		return ((uint32_t)cost << (uint32_t)16) + (uint32_t)bytes;
+
+	return ((uint32_t)bytes << (uint32_t)16) + (uint32_t)cost;
+}
+
+static unsigned int vrl_encode_strip_dp(unsigned char *d,const unsigned char *s,unsigned int stride,unsigned int height,unsigned char transparent_color,unsigned char profile) {
+	const uint32_t w_seg = vrl_dp_weight(profile,2,VRL_COST_SEGMENT);
+	const uint32_t w_run = vrl_dp_weight(profile,1,VRL_COST_RUN);
+	const uint32_t w_run_px = vrl_dp_weight(profile,0,VRL_COST_RUN_PIXEL);
+	const uint32_t w_copy = vrl_dp_weight(profile,0,VRL_COST_COPY);
+	const uint32_t w_copy_px = vrl_dp_weight(profile,1,VRL_COST_COPY_PIXEL);
+	unsigned int y,p,n,lim,skip;
+	unsigned char *d0 = d;
+	uint32_t c;
+
+	assert(height <= VRL_DP_MAX_HEIGHT);
+
+	dp_trun[height] = dp_orun[height] = dp_erun[height] = 0;
+	for (y=height;y > 0;) {
+		const unsigned char px = s[(--y) * stride];
+
+		if (px == transparent_color) {
+			dp_trun[y] = dp_trun[y+1] + 1u;
+			dp_orun[y] = dp_erun[y] = 0;
+		}
+		else {
+			dp_trun[y] = 0;
+			dp_orun[y] = dp_orun[y+1] + 1u;
+			dp_erun[y] = (y+1 < height && s[(y+1) * stride] == px) ? (dp_erun[y+1] + 1u) : 1u;
+		}
+	}
+
+	/* nothing left to draw costs only the end marker */
+	for (y=height+1u;y > 0;) {
+		y--;
+
+		if ((y + dp_trun[y]) >= height) {
+			dp_best[y] = vrl_dp_weight(profile,1,VRL_COST_END);
+			dp_n[y] = 0;
+			dp_is_run[y] = 0;
+			continue;
+		}
+
+		skip = dp_trun[y];
+		if (skip > VRL_MAX_SKIP) {
+			/* more transparency than one segment can skip, a segment that only skips */
+			dp_best[y] = w_seg + w_copy + dp_best[y+VRL_MAX_SKIP];
+			dp_n[y] = 0;
+			dp_is_run[y] = 0;
+			continue;
+		}
+
+		p = y + skip;
+		dp_best[y] = (uint32_t)0xFFFFFFFFUL;
+
+		lim = dp_orun[p];
+		if (lim > VRL_MAX_COPY) lim = VRL_MAX_COPY;
+		for (n=1;n <= lim;n++) {
+			c = w_seg + w_copy + (w_copy_px * n) + dp_best[p+n];
+			if (c < dp_best[y]) {
+				dp_best[y] = c;
+				dp_n[y] = (unsigned char)n;
+				dp_is_run[y] = 0;
+			}
+		}
+
+		lim = dp_erun[p];
+		if (lim > VRL_MAX_RUN) lim = VRL_MAX_RUN;
+		for (n=1;n <= lim;n++) {
+			c = w_seg + w_run + (w_run_px * n) + dp_best[p+n];
+			if (c < dp_best[y]) {
+				dp_best[y] = c;
+				dp_n[y] = (unsigned char)n;
+				dp_is_run[y] = 1;
+			}
+		}
+	}
+
+	/* walk the choices from the top */
+	y = 0;
+	while ((y + dp_trun[y]) < height) {
+		skip = dp_trun[y];
+		if (skip > VRL_MAX_SKIP) skip = VRL_MAX_SKIP;
+		p = y + skip;
+		n = dp_n[y];
+
+		if (dp_is_run[y]) {
+			*d++ = (unsigned char)(n + 0x80);
+			*d++ = (unsigned char)skip;
+			*d++ = s[p * stride];
+		}
+		else {
+			*d++ = (unsigned char)n;
+			*d++ = (unsigned char)skip;
+			for (;n > 0;n--,p++) *d++ = s[p * stride];
+		}
+
+		y += skip + dp_n[y];
+	}
+
+	*d++ = 0xFF;
+	return (unsigned int)(d - d0);
+}
+
+unsigned int vrl_encode_strip(unsigned char *d,const unsigned char *s,unsigned int stride,unsigned int height,unsigned char transparent_color,unsigned char profile,struct vrl_enc_stats *stats) {
+	unsigned int len;
+
+	if (profile == VRL_ENC_GREEDY)
+		len = vrl_encode_strip_greedy(d,s,stride,height,transparent_color);
+	else
+		len = vrl_encode_strip_dp(d,s,stride,height,transparent_color,profile);
+
+	assert(len <= VRL_STRIP_MAX);
+	if (stats != NULL) vrl_strip_stats(d,stats);
+	return len;
+}
+
+void vrl_enc_report(const char *name,unsigned int width,unsigned int height,unsigned char profile,const struct vrl_enc_stats *stats) {
+	printf("%s: %ux%u, %s encoding, %lu bytes, %lu segments, est. draw cost %lu instructions (%lu per column)\n",
+		name,width,height,vrl_enc_profile_str[profile],
+		(unsigned long)sizeof(struct vrl1_vgax_header) + stats->bytes,stats->segments,stats->cost,
+		width != 0 ? (stats->cost / (unsigned long)width) : 0UL);
+}
+
@@ -0,0 +1,52 @@
+
+#ifndef __DOSLIB_HW_VGA_VRLENC_H
+#define __DOSLIB_HW_VGA_VRLENC_H
+
+/* VRL1 strip encoder, shared by pcx2vrl, png2vrl and pcxsscut.
+ *
+ * A strip (one column) is a list of <len> <skip> [data] segments ended by 0xFF:
+ * skip transparent pixels, then either copy len (< 0x80) pixels or repeat one color
+ * (len & 0x7F) times (len >= 0x80). */
+
+/* encoder profiles */
+enum {
+	VRL_ENC_SIZE=0,				// fewest bytes (default)
+	VRL_ENC_SPEED,				// fewest estimated draw instructions
+	VRL_ENC_GREEDY,				// the original greedy run/copy split
+
+	VRL_ENC_MAX
+};
+
+/* estimated cost of draw_vrl1_vgax_modex_strip(), in instructions executed (vrl1xdrc.h) */
+#define VRL_COST_SEGMENT		10	// lodsb cmp jz xor mov lodsb mul add or jns
+#define VRL_COST_RUN			4	// and lodsb jcxz ... jmp
+#define VRL_COST_RUN_PIXEL		3	// stosb add loop
+#define VRL_COST_COPY			2	// jcxz ... jmp
+#define VRL_COST_COPY_PIXEL		4	// lodsb stosb add loop
+#define VRL_COST_END			3	// lodsb cmp jz
+
+/* largest encoded strip for a column of 256 pixels: every other pixel transparent, one segment per pixel */
+#define VRL_STRIP_MAX			((256*3)+16)
+
+struct vrl_enc_stats {
+	unsigned long			bytes;		// encoded size, strips only
+	unsigned long			cost;		// estimated draw instructions
+	unsigned long			segments;
+};
+
+extern const char *vrl_enc_profile_str[VRL_ENC_MAX];
+
+int vrl_enc_profile_from_str(const char *s);
+
+/* encode one column of height pixels, stride bytes apart, into d. returns the strip length including the 0xFF terminator.
+ * d must hold VRL_STRIP_MAX bytes. stats (if not NULL) are added to. */
+unsigned int vrl_encode_strip(unsigned char *d,const unsigned char *s,unsigned int stride,unsigned int height,unsigned char transparent_color,unsigned char profile,struct vrl_enc_stats *stats);
+
+/* measure an encoded strip. stats are added to. */
+void vrl_strip_stats(const unsigned char *strip,struct vrl_enc_stats *stats);
+
+/* print one line about an encoded sprite: size, segments and estimated draw cost */
+void vrl_enc_report(const char *name,unsigned int width,unsigned int height,unsigned char profile,const struct vrl_enc_stats *stats);
+
+#endif //__DOSLIB_HW_VGA_VRLENC_H
+
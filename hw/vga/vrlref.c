@@ -0,0 +1,47 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vrl.h"
+#include "vcs.h"
+
+/* Same walk as draw_vrl1_vgax_modex_strip() (vrl1xdrc.h), one column after another, but into a plain
+ * linear framebuffer so that it runs anywhere. Used to check compiled sprites against. */
+void draw_vrl1_linear(unsigned char *fb,unsigned int fb_stride,unsigned int x,unsigned int y,const struct vrl1_vgax_header *hdr,const unsigned char *data,unsigned int datasz) {
+	const unsigned char *fence = data + datasz;
+	const unsigned char *s = data;
+	unsigned char run,skip,c;
+	unsigned int sx;
+	unsigned char *d;
+
+	for (sx=0;sx < hdr->width && s < fence;sx++) {
+		d = fb + (y * fb_stride) + x + sx;
+
+		while (s < fence) {
+			run = *s++;
+			if (run == 0xFF) break;
+			if (s >= fence) return;
+			skip = *s++;
+			d += (unsigned int)skip * fb_stride;
+
+			if (run & 0x80) {
+				if (s >= fence) return;
+				c = *s++;
+				for (run &= 0x7F;run > 0;run--) {
+					*d = c;
+					d += fb_stride;
+				}
+			}
+			else {
+				if ((unsigned int)(fence - s) < run) return;
+				for (;run > 0;run--) {
+					*d = *s++;
+					d += fb_stride;
+				}
+			}
+		}
+	}
+}
+
@@ -26,6 +26,11 @@
 //       then use the same array index to look up the file offset of the VRL sprite image data and draw that
 //       sprite on screen. Same ID -> index mapping scheme applies to sprite names.
 //
+//       Sheets written by newer versions of vrl2vrs also carry an ID index (VRS_HEADER_OFFSET_SPRITE_ID_INDEX and
+//       VRS_HEADER_OFFSET_ANIMATION_ID_INDEX) that maps an ID to the array index directly, or by binary search, instead
+//       of scanning the ID list. The index is optional. If the offset is zero, scan the list as described above. The
+//       vrs_sprite_index() and vrs_animation_index() functions (vrsidx.c) do both for you.
+//
 //       Animation IDs work the same way, using the index of the ID you seek to look up the file offset to
 //       the animation sequence to follow, and the name of the animation. Animation frame lists end at the
 //       first entry where sprite ID is zero. It is intended that when you hit the end of the frame sequence,
@@ -77,8 +82,27 @@ struct vrs_animation_list_entry_t {			// one entry of the animation list.. zero
 	uint16_t		delay;			// if nonzero, delay this many ticks. if zero, stop animation until triggered to animate again by game engine.
 	uint16_t		event_id;		// if nonzero, game-specific event to trigger when entering the animation frame
 };
+
+struct vrs_id_index_t {					// ID index header. the entries follow immediately
+	uint16_t		index_type;		// +0x00  VRS_ID_INDEX_DIRECT or VRS_ID_INDEX_SORTED
+	uint16_t		count;			// +0x02  number of entries that follow
+	uint16_t		min_id;			// +0x04  lowest ID in the list
+	uint16_t		max_id;			// +0x06  highest ID in the list
+};							// =0x08
+
+struct vrs_id_index_sorted_entry_t {			// VRS_ID_INDEX_SORTED entry, sorted by ID (then by array index)
+	uint16_t		id;			// +0x00  ID
+	uint16_t		index;			// +0x02  array index in the ID list
+};							// =0x04
 #pragma pack(pop)
 
+enum vrs_id_index_type_t {
+	VRS_ID_INDEX_DIRECT=1,				// count == max_id + 1 - min_id entries of uint16_t, entry [id - min_id] is the array index or VRS_ID_INDEX_NONE
+	VRS_ID_INDEX_SORTED=2				// count entries of struct vrs_id_index_sorted_entry_t, one per ID, for binary search
+};
+
+#define VRS_ID_INDEX_NONE			(0xFFFFU)	// no such ID (VRS_ID_INDEX_DIRECT)
+
 enum vrs_header_offset_type_t { // offset table indexes
 	VRS_HEADER_OFFSET_VRS_LIST=0,			// offset points to array of sprite offsets (32-bit). seek to sprite offset to locate VRL sprite. Array ends at first zero entry.
 
@@ -95,6 +119,25 @@ enum vrs_header_offset_type_t { // offset table indexes
 
 	VRS_HEADER_OFFSET_ANIMATION_ID_LIST=4,		// offset points to array of animation IDs (16-bit). one entry per animation. Array ends at first zero entry.
 
-	VRS_HEADER_OFFSET_ANIMATION_NAME_LIST=5		// offset points to array of animation name offsets (32-bit). Array ends at first zero entry. Offset points to ASCIIZ string. OPTIONAL.
+	VRS_HEADER_OFFSET_ANIMATION_NAME_LIST=5,	// offset points to array of animation name offsets (32-bit). Array ends at first zero entry. Offset points to ASCIIZ string. OPTIONAL.
+
+	VRS_HEADER_OFFSET_SPRITE_ID_INDEX=6,		// offset points to struct vrs_id_index_t, an index of the sprite ID list. OPTIONAL.
+
+	VRS_HEADER_OFFSET_ANIMATION_ID_INDEX=7		// offset points to struct vrs_id_index_t, an index of the animation ID list. OPTIONAL.
 };
 
+struct vrl1_vgax_header;
+
+/* ID -> array index lookup (vrsidx.c). vrs is the whole VRS file in memory, vrs_size its size.
+ * list is VRS_HEADER_OFFSET_SPRITE_ID_LIST or VRS_HEADER_OFFSET_ANIMATION_ID_LIST. The index is used if
+ * the sheet has one, else the ID list is scanned. Returns -1 if the ID is not there. */
+int vrs_id_scan(const unsigned char *vrs,uint32_t vrs_size,unsigned int list,uint16_t id);
+int vrs_id_lookup(const unsigned char *vrs,uint32_t vrs_size,unsigned int list,uint16_t id);
+int vrs_id_index_validate(const unsigned char *vrs,uint32_t vrs_size,unsigned int list);
+
+#define vrs_sprite_index(vrs,vrs_size,id) vrs_id_lookup(vrs,vrs_size,VRS_HEADER_OFFSET_SPRITE_ID_LIST,id)
+#define vrs_animation_index(vrs,vrs_size,id) vrs_id_lookup(vrs,vrs_size,VRS_HEADER_OFFSET_ANIMATION_ID_LIST,id)
+
+const struct vrl1_vgax_header *vrs_sprite_by_id(const unsigned char *vrs,uint32_t vrs_size,uint16_t id);
+const struct vrs_animation_list_entry_t *vrs_animation_by_id(const unsigned char *vrs,uint32_t vrs_size,uint16_t id);
+
@@ -22,6 +22,56 @@ unsigned char		*fence = NULL;
 
 struct vrs_header	*vrshdr = NULL;
 
+static void dump_id_index(const unsigned long sz,const unsigned int list,const unsigned int slot,const char *what) {
+	unsigned long offs = (unsigned long)vrshdr->offset_table[slot];
+	struct vrs_id_index_t *idx;
+	unsigned int i,c=0;
+
+	if (offs == 0UL) return;
+	if ((offs+sizeof(*idx)) > sz) {
+		printf("*%s index offset out of range!\n",what);
+		return;
+	}
+
+	idx = (struct vrs_id_index_t*)(buffer + offs);
+	printf("*%s index: type=%u (%s) count=%u IDs %u-%u\n",what,idx->index_type,
+		idx->index_type == VRS_ID_INDEX_DIRECT ? "direct" : (idx->index_type == VRS_ID_INDEX_SORTED ? "sorted" : "?"),
+		idx->count,idx->min_id,idx->max_id);
+
+	if (idx->index_type == VRS_ID_INDEX_DIRECT && (offs+sizeof(*idx)+(idx->count*2UL)) <= sz) {
+		uint16_t *ent = (uint16_t*)(idx + 1);
+
+		printf("    ");
+		for (i=0;i < idx->count;i++) {
+			if (ent[i] == VRS_ID_INDEX_NONE) continue;
+			if ((++c) >= 16) {
+				c = 0;
+				printf("\n    ");
+			}
+			printf("%u=>%u ",idx->min_id+i,ent[i]);
+		}
+		printf("\n");
+	}
+	else if (idx->index_type == VRS_ID_INDEX_SORTED && (offs+sizeof(*idx)+(idx->count*4UL)) <= sz) {
+		struct vrs_id_index_sorted_entry_t *ent = (struct vrs_id_index_sorted_entry_t*)(idx + 1);
+
+		printf("    ");
+		for (i=0;i < idx->count;i++) {
+			if ((++c) >= 16) {
+				c = 0;
+				printf("\n    ");
+			}
+			printf("%u=>%u ",ent[i].id,ent[i].index);
+		}
+		printf("\n");
+	}
+
+	if (vrs_id_index_validate(buffer,(uint32_t)sz,list) < 0)
+		printf("*ERROR %s index does not match the ID list\n",what);
+	else
+		printf("    %s index matches the ID list\n",what);
+}
+
 int main(int argc,char **argv) {
 	unsigned long sz,offs;
 	unsigned int entry;
@@ -78,6 +128,8 @@ int main(int argc,char **argv) {
 	printf("    Offset of anim list:    %lu\n",(unsigned long)vrshdr->offset_table[VRS_HEADER_OFFSET_ANIMATION_LIST]);
 	printf("    Offset of anim IDs:     %lu\n",(unsigned long)vrshdr->offset_table[VRS_HEADER_OFFSET_ANIMATION_ID_LIST]);
 	printf("    Offset of anim names:   %lu\n",(unsigned long)vrshdr->offset_table[VRS_HEADER_OFFSET_ANIMATION_NAME_LIST]);
+	printf("    Offset of sprite index: %lu\n",(unsigned long)vrshdr->offset_table[VRS_HEADER_OFFSET_SPRITE_ID_INDEX]);
+	printf("    Offset of anim index:   %lu\n",(unsigned long)vrshdr->offset_table[VRS_HEADER_OFFSET_ANIMATION_ID_INDEX]);
 
 	if ((offs=(unsigned long)vrshdr->offset_table[VRS_HEADER_OFFSET_VRS_LIST]) != 0UL) {
 		if ((offs+4UL) <= sz) {
@@ -285,6 +337,9 @@ int main(int argc,char **argv) {
 		}
 	}
 
+	dump_id_index(sz,VRS_HEADER_OFFSET_SPRITE_ID_LIST,VRS_HEADER_OFFSET_SPRITE_ID_INDEX,"Sprite ID");
+	dump_id_index(sz,VRS_HEADER_OFFSET_ANIMATION_ID_LIST,VRS_HEADER_OFFSET_ANIMATION_ID_INDEX,"Animation ID");
+
 	if ((offs=(unsigned long)vrshdr->offset_table[VRS_HEADER_OFFSET_VRS_LIST]) != 0UL && (offs+4UL) <= sz) {
 		uint32_t *vrl_list_end = (uint32_t*)(fence - 1 + sizeof(uint32_t));
 		char *namelist_fence = NULL,*namelist_scan = NULL;
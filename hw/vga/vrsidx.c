@@ -0,0 +1,171 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vrl.h"
+#include "vrs.h"
+
+/* which offset table entry holds the index for an ID list */
+static int vrs_id_index_slot(const unsigned int list) {
+	if (list == VRS_HEADER_OFFSET_SPRITE_ID_LIST) return VRS_HEADER_OFFSET_SPRITE_ID_INDEX;
+	if (list == VRS_HEADER_OFFSET_ANIMATION_ID_LIST) return VRS_HEADER_OFFSET_ANIMATION_ID_INDEX;
+	return -1;
+}
+
+/* the old way: walk the ID list until the ID or zero. EOF is an error, same as the end of the list. */
+int vrs_id_scan(const unsigned char *vrs,uint32_t vrs_size,unsigned int list,uint16_t id) {
+	const struct vrs_header *hdr = (const struct vrs_header*)vrs;
+	const uint16_t *lst,*fnc;
+	uint32_t offs;
+
+	if (vrs_size < sizeof(*hdr) || list >= 16 || id == 0) return -1;
+	offs = hdr->offset_table[list];
+	if (offs == 0 || offs > (vrs_size - 2UL)) return -1;
+
+	lst = (const uint16_t*)(vrs + offs);
+	fnc = (const uint16_t*)(vrs + offs + ((vrs_size - offs) & (~1UL)));
+	for (;lst < fnc && *lst != 0;lst++) {
+		if (*lst == id) return (int)(lst - (const uint16_t*)(vrs + offs));
+	}
+
+	return -1;
+}
+
+/* the index, if any. returns NULL if there is none or it does not fit in the file. */
+static const struct vrs_id_index_t *vrs_id_index(const unsigned char *vrs,uint32_t vrs_size,unsigned int list) {
+	const struct vrs_header *hdr = (const struct vrs_header*)vrs;
+	const struct vrs_id_index_t *idx;
+	uint32_t offs,esz;
+	int slot;
+
+	if (vrs_size < sizeof(*hdr) || (slot=vrs_id_index_slot(list)) < 0) return NULL;
+	offs = hdr->offset_table[slot];
+	if (offs == 0 || offs > (vrs_size - sizeof(*idx))) return NULL;
+
+	idx = (const struct vrs_id_index_t*)(vrs + offs);
+	if (idx->index_type == VRS_ID_INDEX_DIRECT)
+		esz = sizeof(uint16_t);
+	else if (idx->index_type == VRS_ID_INDEX_SORTED)
+		esz = sizeof(struct vrs_id_index_sorted_entry_t);
+	else
+		return NULL;
+
+	if (((uint32_t)idx->count * esz) > (vrs_size - offs - sizeof(*idx))) return NULL;
+	return idx;
+}
+
+int vrs_id_lookup(const unsigned char *vrs,uint32_t vrs_size,unsigned int list,uint16_t id) {
+	const struct vrs_id_index_t *idx = vrs_id_index(vrs,vrs_size,list);
+
+	if (idx == NULL)
+		return vrs_id_scan(vrs,vrs_size,list,id);
+	if (id < idx->min_id || id > idx->max_id || id == 0)
+		return -1;
+
+	if (idx->index_type == VRS_ID_INDEX_DIRECT) {
+		const uint16_t *ent = (const uint16_t*)(idx + 1);
+		uint16_t i;
+
+		if ((unsigned int)(id - idx->min_id) >= idx->count) return -1;
+		i = ent[id - idx->min_id];
+		return (i != VRS_ID_INDEX_NONE) ? (int)i : -1;
+	}
+	else {
+		const struct vrs_id_index_sorted_entry_t *ent = (const struct vrs_id_index_sorted_entry_t*)(idx + 1);
+		unsigned int lo = 0,hi = idx->count,mid;
+
+		/* lowest entry with ID >= id, so duplicate IDs resolve the same way the scan does */
+		while (lo < hi) {
+			mid = (lo + hi) >> 1u;
+			if (ent[mid].id < id) lo = mid + 1u;
+			else hi = mid;
+		}
+
+		if (lo < idx->count && ent[lo].id == id) return (int)ent[lo].index;
+		return -1;
+	}
+}
+
+/* check that the index agrees with the ID list. 0 if it does or there is no index, -1 if not. */
+int vrs_id_index_validate(const unsigned char *vrs,uint32_t vrs_size,unsigned int list) {
+	const struct vrs_header *hdr = (const struct vrs_header*)vrs;
+	const struct vrs_id_index_t *idx;
+	const uint16_t *lst,*fnc;
+	unsigned int i,n,found;
+	uint32_t offs;
+
+	if (vrs_size < sizeof(*hdr) || vrs_id_index_slot(list) < 0) return -1;
+	if (hdr->offset_table[vrs_id_index_slot(list)] == 0) return 0;
+	if ((idx=vrs_id_index(vrs,vrs_size,list)) == NULL) return -1;
+
+	offs = hdr->offset_table[list];
+	if (offs == 0 || offs > (vrs_size - 2UL)) return -1;
+	lst = (const uint16_t*)(vrs + offs);
+	fnc = (const uint16_t*)(vrs + offs + ((vrs_size - offs) & (~1UL)));
+
+	/* every ID in the list must be found, at the index the scan finds it */
+	for (n=0;(lst+n) < fnc && lst[n] != 0;n++) {
+		if (lst[n] < idx->min_id || lst[n] > idx->max_id) return -1;
+		if (vrs_id_lookup(vrs,vrs_size,list,lst[n]) != vrs_id_scan(vrs,vrs_size,list,lst[n])) return -1;
+	}
+	if ((lst+n) >= fnc) return -1;
+
+	/* and every entry in the index must point at an ID in the list */
+	found = 0;
+	if (idx->index_type == VRS_ID_INDEX_DIRECT) {
+		const uint16_t *ent = (const uint16_t*)(idx + 1);
+
+		if (n != 0 && idx->count != (idx->max_id + 1u - idx->min_id)) return -1;
+		for (i=0;i < idx->count;i++) {
+			if (ent[i] == VRS_ID_INDEX_NONE) continue;
+			if (ent[i] >= n || lst[ent[i]] != (idx->min_id + i)) return -1;
+			found++;
+		}
+	}
+	else {
+		const struct vrs_id_index_sorted_entry_t *ent = (const struct vrs_id_index_sorted_entry_t*)(idx + 1);
+
+		for (i=0;i < idx->count;i++) {
+			if (i != 0 && ent[i].id <= ent[i-1].id) return -1;
+			if (ent[i].index >= n || lst[ent[i].index] != ent[i].id) return -1;
+			found++;
+		}
+	}
+
+	/* duplicate IDs in the list are found once */
+	if (found > n) return -1;
+	return 0;
+}
+
+const struct vrl1_vgax_header *vrs_sprite_by_id(const unsigned char *vrs,uint32_t vrs_size,uint16_t id) {
+	const struct vrs_header *hdr = (const struct vrs_header*)vrs;
+	const uint32_t *lst;
+	uint32_t offs;
+	int i;
+
+	if ((i=vrs_sprite_index(vrs,vrs_size,id)) < 0) return NULL;
+	offs = hdr->offset_table[VRS_HEADER_OFFSET_VRS_LIST];
+	if (offs == 0 || offs > (vrs_size - 4UL) || (uint32_t)i >= ((vrs_size - offs) / 4UL)) return NULL;
+
+	lst = (const uint32_t*)(vrs + offs);
+	if (lst[i] == 0 || lst[i] > (vrs_size - sizeof(struct vrl1_vgax_header))) return NULL;
+	return (const struct vrl1_vgax_header*)(vrs + lst[i]);
+}
+
+const struct vrs_animation_list_entry_t *vrs_animation_by_id(const unsigned char *vrs,uint32_t vrs_size,uint16_t id) {
+	const struct vrs_header *hdr = (const struct vrs_header*)vrs;
+	const uint32_t *lst;
+	uint32_t offs;
+	int i;
+
+	if ((i=vrs_animation_index(vrs,vrs_size,id)) < 0) return NULL;
+	offs = hdr->offset_table[VRS_HEADER_OFFSET_ANIMATION_LIST];
+	if (offs == 0 || offs > (vrs_size - 4UL) || (uint32_t)i >= ((vrs_size - offs) / 4UL)) return NULL;
+
+	lst = (const uint32_t*)(vrs + offs);
+	if (lst[i] == 0 || lst[i] > (vrs_size - sizeof(struct vrs_animation_list_entry_t))) return NULL;
+	return (const struct vrs_animation_list_entry_t*)(vrs + lst[i]);
+}
+
@@ -87,6 +87,8 @@
 
 #include "isadma.h"
 
+#include "modeng.h"
+
 #if defined(TARGET_WINDOWS)
 #include <signal.h>
 #endif
@@ -98,6 +100,13 @@
 
 /* file source */
 dosamp_file_source_t dosamp_file_source_file_fd_open(const char * const path);
+#if defined(LINUX)
+dosamp_file_source_t dosamp_file_source_read_ahead_open(const char * const path);
+#endif
+#if defined(HAS_TRACKER)
+int dosamp_file_source_tracker_match(const char * const path);
+dosamp_file_source_t dosamp_file_source_tracker_open(const char * const path,const uint32_t rate,const unsigned char interpolate);
+#endif
 
 /* tool */
 char                                            str_tmp[256];
@@ -115,6 +124,12 @@ static signed char                              opt_round = -1;
 /* DOSAMP debug state */
 static char                                     stuck_test = 0;
 static unsigned char                            use_mmap_write = 1;
+#if defined(LINUX)
+static unsigned char                            use_read_ahead = 1;
+#endif
+#if defined(HAS_TRACKER)
+static unsigned char                            tracker_interpolate = 1;
+#endif
 
 /* chosen time source.
  * NTS: Don't forget that by design, some time sources (8254 for example)
@@ -583,7 +598,18 @@ static int open_wav() {
         if (wav_file == NULL) return -1;
         if (strlen(wav_file) < 1) return -1;
 
-        wav_source = dosamp_file_source_file_fd_open(wav_file);
+#if defined(HAS_TRACKER)
+        /* MOD/S3M files are rendered by the tracker engine and appear to us as a WAV file */
+        if (dosamp_file_source_tracker_match(wav_file))
+            wav_source = dosamp_file_source_tracker_open(wav_file,(prefer_rate != 0UL) ? prefer_rate : TRACKER_DEFAULT_RATE,tracker_interpolate);
+        else
+#endif
+#if defined(LINUX)
+        if (use_read_ahead)
+            wav_source = dosamp_file_source_read_ahead_open(wav_file);
+        else
+#endif
+            wav_source = dosamp_file_source_file_fd_open(wav_file);
         if (wav_source == NULL) return -1;
         dosamp_file_source_addref(wav_source);
 
@@ -642,6 +668,13 @@ static int open_wav() {
         }
 
         if (file_codec.sample_rate == 0UL || wav_data_length == 0UL || wav_data_length_bytes == 0UL) goto fail;
+
+#if defined(LINUX)
+        /* header parsing is done. from here on the playback loop would rather take a short read
+         * (and skip ahead) than stall waiting on the disk */
+        if (wav_source->obj_id == dosamp_file_source_id_read_ahead)
+            wav_source->p.read_ahead.nonblock = 1;
+#endif
     }
 
     /* convert length to samples */
@@ -649,6 +682,15 @@ static int open_wav() {
     wav_data_length *= file_codec.samples_per_block;
 
     /* tell the user */
+#if defined(HAS_TRACKER)
+    if (wav_source->obj_id == dosamp_file_source_id_tracker) {
+        const struct modeng_song *song = wav_source->p.tracker.song;
+
+        printf("Tracker source: %s, %u channels, \"%s\", %s mixing\n",
+            modeng_format_str[song->format],(unsigned int)song->channels,song->title,
+            song->interpolate ? "interpolated" : "nearest");
+    }
+#endif
     printf("WAV file source: %luHz %u-channel %u-bit\n",
         (unsigned long)file_codec.sample_rate,
         (unsigned int)file_codec.number_of_channels,
@@ -805,6 +847,13 @@ static void stop_play() {
 static void help() {
     printf("dosamp [options] <file>\n");
     printf(" /h /help             This help\n");
+#if defined(LINUX)
+    printf(" /nra                 Read the file directly, no read-ahead thread\n");
+#endif
+#if defined(HAS_TRACKER)
+    printf(" /tfast               MOD/S3M: mix without interpolation (faster)\n");
+    printf("                      MOD/S3M are rendered at the /ar rate, default %luHz\n",(unsigned long)TRACKER_DEFAULT_RATE);
+#endif
 }
 
 char *prompt_open_file(void) {
@@ -870,6 +919,16 @@ static int parse_argv(int argc,char **argv) {
             else if (!strcmp(a,"nc")) {
                 prefer_no_clamp = 1;
             }
+#if defined(LINUX)
+            else if (!strcmp(a,"nra")) {
+                use_read_ahead = 0;
+            }
+#endif
+#if defined(HAS_TRACKER)
+            else if (!strcmp(a,"tfast")) {
+                tracker_interpolate = 0;
+            }
+#endif
             else {
                 return 0;
             }
@@ -104,6 +104,20 @@
 /* no */
 #endif
 
+/* platform has SSE2/AVX2 resampler kernels (GCC intrinsics, chosen at runtime by CPU detection) */
+#if defined(LINUX) && defined(__GNUC__) && (defined(__i386__) || defined(__amd64__))
+# define HAS_RESAMPLE_SIMD
+#else
+/* no */
+#endif
+
+/* platform has the MOD/S3M tracker engine (needs a flat address space for patterns and samples) */
+#if (TARGET_MSDOS == 32 && !defined(WIN386)) || defined(LINUX)
+# define HAS_TRACKER
+#else
+/* no */
+#endif
+
 /* platform has/could have DirectSound */
 #if defined(TARGET_WINDOWS) && TARGET_MSDOS == 32 && !defined(WIN386)
 # define HAS_DSOUND
@@ -1,7 +1,9 @@
 
 enum {
     dosamp_file_source_id_null = 0,
-    dosamp_file_source_id_file_fd = 1
+    dosamp_file_source_id_file_fd = 1,
+    dosamp_file_source_id_read_ahead = 2,
+    dosamp_file_source_id_tracker = 3
 };
 
 #if TARGET_MSDOS == 32 || defined(LINUX)
@@ -37,6 +39,35 @@ struct dosamp_file_source_priv_file_fd {
     int                                 fd;
 };
 
+#if defined(LINUX)
+/* obj_id == dosamp_file_source_id_read_ahead.
+ * must be sizeof() <= sizeof(private) */
+struct dosamp_file_source_read_ahead;
+
+struct dosamp_file_source_priv_read_ahead {
+    struct dosamp_file_source_read_ahead*   ra;
+    unsigned char                       nonblock;   /* if set, read() returns short instead of waiting for the read-ahead thread */
+    unsigned char                       primed;     /* data has arrived since the last seek that emptied the buffer */
+    unsigned long                       underruns;  /* number of times read() came up short in nonblock mode */
+    unsigned long                       skips;      /* number of forward seeks past the data read ahead so far */
+    unsigned long                       seeks;      /* number of seeks that emptied the buffer and had to wait for the thread */
+};
+#endif
+
+#if defined(HAS_TRACKER)
+/* obj_id == dosamp_file_source_id_tracker.
+ * must be sizeof() <= sizeof(private) */
+struct modeng_song;
+
+struct dosamp_file_source_priv_tracker {
+    struct modeng_song*                 song;
+    uint32_t                            data_bytes; /* rendered PCM after the 44-byte WAV header */
+    uint32_t                            cache_frame;/* frame in cache[], for reads that do not start on a frame */
+    int16_t                             cache[2];
+    unsigned char                       cache_valid;
+};
+#endif
+
 struct dosamp_file_source;
 typedef struct dosamp_file_source dosamp_FAR * dosamp_file_source_t;
 typedef struct dosamp_file_source dosamp_FAR * dosamp_FAR * dosamp_file_source_ptr_t;
@@ -55,6 +86,12 @@ struct dosamp_file_source {
     dosamp_file_off_t                   (dosamp_FAR * seek)(dosamp_file_source_t const inst,dosamp_file_off_t pos); /* seek function */
     union {
         struct dosamp_file_source_priv_file_fd      file_fd;
+#if defined(LINUX)
+        struct dosamp_file_source_priv_read_ahead   read_ahead;
+#endif
+#if defined(HAS_TRACKER)
+        struct dosamp_file_source_priv_tracker      tracker;
+#endif
     } p;
 };
 
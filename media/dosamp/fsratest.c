@@ -0,0 +1,140 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+
+#include "dosamp.h"
+#include "filesrc.h"
+
+/* read-ahead file source test (Linux host).
+ * plays a test file the way the playback loop does in nonblock mode: read a block, and on a short
+ * read seek ahead to where the read should have ended. it also seeks ahead past the read-ahead now
+ * and then to make sure underruns happen. checks that every byte read is from the right place in
+ * the file, and that none of the underruns made the source empty its buffer and wait on the thread. */
+
+dosamp_file_source_t dosamp_file_source_read_ahead_open(const char * const path);
+
+#define TEST_FILE_SIZE                          (16UL * 1024UL * 1024UL)
+#define TEST_BLOCK                              (4096U)
+
+static unsigned char                            buf[TEST_BLOCK];
+
+static unsigned char pattern(const unsigned long ofs) {
+    return (unsigned char)(ofs ^ (ofs >> 8UL) ^ (ofs >> 16UL) ^ (ofs >> 24UL));
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1000000000.0);
+}
+
+static int make_test_file(char *path) {
+    unsigned long ofs = 0,i;
+    int fd;
+
+    if ((fd=mkstemp(path)) < 0)
+        return -1;
+
+    while (ofs < TEST_FILE_SIZE) {
+        for (i=0;i < TEST_BLOCK;i++) buf[i] = pattern(ofs + i);
+        if (write(fd,buf,TEST_BLOCK) != (ssize_t)TEST_BLOCK) {
+            close(fd);
+            return -1;
+        }
+        ofs += TEST_BLOCK;
+    }
+
+    close(fd);
+    return 0;
+}
+
+int main(void) {
+    char path[] = "/tmp/fsratestXXXXXX";
+    unsigned long reads = 0,short_reads = 0,bad = 0,i;
+    dosamp_file_off_t expect;
+    dosamp_file_source_t src;
+    unsigned int rd;
+    double t,worst = 0;
+
+    if (make_test_file(path) < 0) {
+        fprintf(stderr,"Cannot create test file\n");
+        return 1;
+    }
+
+    if ((src=dosamp_file_source_read_ahead_open(path)) == NULL) {
+        fprintf(stderr,"Cannot open test file\n");
+        unlink(path);
+        return 1;
+    }
+
+    /* the first read waits for data, like dosamp does for the WAV header */
+    if (src->read(src,buf,TEST_BLOCK) != TEST_BLOCK) {
+        fprintf(stderr,"First read failed\n");
+        bad++;
+    }
+    src->p.read_ahead.nonblock = 1;
+
+    while (src->file_pos < (int64_t)(TEST_FILE_SIZE - (4UL * TEST_BLOCK))) {
+        /* every so often jump past what the thread could have read ahead so far */
+        if ((reads % 16UL) == 15UL)
+            src->seek(src,src->file_pos + (256UL * 1024UL) + 123UL);
+
+        expect = src->file_pos + TEST_BLOCK;
+
+        t = now();
+        rd = src->read(src,buf,TEST_BLOCK);
+        t = now() - t;
+        if (worst < t) worst = t;
+        reads++;
+
+        if (rd == dosamp_file_io_err) {
+            fprintf(stderr,"Read error\n");
+            bad++;
+            break;
+        }
+        for (i=0;i < rd;i++) {
+            if (buf[i] != pattern((unsigned long)(expect - TEST_BLOCK) + i)) {
+                bad++;
+                break;
+            }
+        }
+
+        /* what dosamp.c does on a short read, then go wait on the sound card for a bit */
+        if (rd != TEST_BLOCK) {
+            short_reads++;
+            if (src->seek(src,expect) != expect) {
+                fprintf(stderr,"Seek failed\n");
+                bad++;
+                break;
+            }
+            usleep(1000);
+        }
+    }
+
+    printf("%lu reads, %lu short, %lu underruns, %lu skips past the read-ahead, %lu seeks that waited on the thread\n",
+        reads,short_reads,src->p.read_ahead.underruns,src->p.read_ahead.skips,src->p.read_ahead.seeks);
+    printf("longest read: %.3fms\n",worst * 1000.0);
+
+    if (src->p.read_ahead.underruns == 0UL || src->p.read_ahead.skips == 0UL) {
+        printf("FAIL: no underruns happened, nothing was tested\n");
+        bad++;
+    }
+    if (src->p.read_ahead.seeks != 0UL) {
+        printf("FAIL: an underrun emptied the buffer\n");
+        bad++;
+    }
+    if (bad != 0UL)
+        printf("FAIL: %lu bad reads\n",bad);
+
+    src->close(src);
+    src->free(src);
+    unlink(path);
+    return (bad != 0UL) ? 1 : 0;
+}
+
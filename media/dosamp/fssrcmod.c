@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+#include "dosamp.h"
+#include "filesrc.h"
+#include "modeng.h"
+
+#ifndef LINUX
+#define strcasecmp strcmpi
+#endif
+
+#if defined(HAS_TRACKER)
+
+/* Tracker module file source.
+ *
+ * Presents a MOD/S3M as a 16-bit stereo PCM WAV file: a 44-byte header followed by the song rendered
+ * on the fly by the tracker engine, so that the rest of DOSAMP (WAV parsing, format conversion,
+ * resampling, sound card output) does not need to know. The length of the song is found at open by
+ * playing it through once without mixing. Seeking backwards restarts the song and skips forward. */
+
+#define TRACKER_WAV_HEADER              44u
+
+static void tracker_put16(unsigned char *p,const uint16_t v) {
+    p[0] = (unsigned char)(v & 0xFFu);
+    p[1] = (unsigned char)(v >> 8u);
+}
+
+static void tracker_put32(unsigned char *p,const uint32_t v) {
+    tracker_put16(p,(uint16_t)(v & 0xFFFFUL));
+    tracker_put16(p+2,(uint16_t)(v >> 16UL));
+}
+
+static void tracker_wav_header(unsigned char *h,const uint32_t rate,const uint32_t data_bytes) {
+    memcpy(h+0,"RIFF",4);
+    tracker_put32(h+4,data_bytes + TRACKER_WAV_HEADER - 8u);
+    memcpy(h+8,"WAVE",4);
+    memcpy(h+12,"fmt ",4);
+    tracker_put32(h+16,16);
+    tracker_put16(h+20,1);              /* wFormatTag = PCM */
+    tracker_put16(h+22,2);              /* nChannels */
+    tracker_put32(h+24,rate);           /* nSamplesPerSec */
+    tracker_put32(h+28,rate * 4UL);     /* nAvgBytesPerSec */
+    tracker_put16(h+32,4);              /* nBlockAlign */
+    tracker_put16(h+34,16);             /* wBitsPerSample */
+    memcpy(h+36,"data",4);
+    tracker_put32(h+40,data_bytes);
+}
+
+static int dosamp_FAR dosamp_file_source_tracker_close(dosamp_file_source_t const inst) {
+    if (inst->p.tracker.song != NULL) {
+        modeng_free(inst->p.tracker.song);
+        free(inst->p.tracker.song);
+        inst->p.tracker.song = NULL;
+    }
+
+    return 0;/*success*/
+}
+
+static void dosamp_FAR dosamp_file_source_tracker_free(dosamp_file_source_t const inst) {
+    dosamp_file_source_tracker_close(inst);
+    dosamp_file_source_free(inst);
+}
+
+/* move the engine to a frame */
+static void dosamp_file_source_tracker_goto(struct modeng_song *s,const uint32_t frame) {
+    if ((uint64_t)frame < s->position)
+        modeng_restart(s);
+
+    modeng_skip(s,frame - (uint32_t)s->position);
+}
+
+static unsigned int dosamp_FAR dosamp_file_source_tracker_read(dosamp_file_source_t const inst,void dosamp_FAR * buf,unsigned int count) {
+    struct dosamp_file_source_priv_tracker *t = &inst->p.tracker;
+    const uint32_t total = TRACKER_WAV_HEADER + t->data_bytes;
+    unsigned char *d = (unsigned char*)buf;
+    unsigned int rd = 0,n;
+    uint32_t pos,frame,sub,frames,r;
+
+    if (t->song == NULL || count > dosamp_file_io_maxb)
+        return dosamp_file_io_err;
+
+    while (count > 0 && (uint64_t)inst->file_pos < (uint64_t)total) {
+        pos = (uint32_t)inst->file_pos;
+
+        if (pos < TRACKER_WAV_HEADER) {
+            unsigned char h[TRACKER_WAV_HEADER];
+
+            tracker_wav_header(h,t->song->rate,t->data_bytes);
+            n = TRACKER_WAV_HEADER - pos;
+            if (n > count) n = count;
+            memcpy(d,h+pos,n);
+        }
+        else {
+            frame = (pos - TRACKER_WAV_HEADER) >> 2UL;
+            sub = (pos - TRACKER_WAV_HEADER) & 3UL;
+
+            if (sub == 0 && count >= 4u) {
+                frames = count >> 2u;
+                if (frames > ((total - pos) >> 2UL)) frames = (total - pos) >> 2UL;
+
+                if (t->song->position != (uint64_t)frame)
+                    dosamp_file_source_tracker_goto(t->song,frame);
+
+                r = modeng_render(t->song,(int16_t*)d,frames);
+                if (r < frames) memset(d + (r * 4UL),0,(frames - r) * 4UL); /* should not happen: the song ended early */
+                n = (unsigned int)(frames * 4UL);
+            }
+            else {
+                /* partial frame */
+                if (!t->cache_valid || t->cache_frame != frame) {
+                    if (t->song->position != (uint64_t)frame)
+                        dosamp_file_source_tracker_goto(t->song,frame);
+
+                    if (modeng_render(t->song,t->cache,1) != 1) t->cache[0] = t->cache[1] = 0;
+                    t->cache_frame = frame;
+                    t->cache_valid = 1;
+                }
+
+                n = 4u - (unsigned int)sub;
+                if (n > count) n = count;
+                memcpy(d,(unsigned char*)t->cache + sub,n);
+            }
+        }
+
+        d += n;
+        rd += n;
+        count -= n;
+        inst->file_pos += n;
+    }
+
+    return rd;
+}
+
+static unsigned int dosamp_FAR dosamp_file_source_tracker_write(dosamp_file_source_t const inst,const void dosamp_FAR * buf,unsigned int count) {
+    (void)inst;
+    (void)buf;
+    (void)count;
+
+    errno = EIO; /* not implemented */
+    return dosamp_file_io_err;
+}
+
+/* the engine follows on the next read */
+static dosamp_file_off_t dosamp_FAR dosamp_file_source_tracker_seek(dosamp_file_source_t const inst,dosamp_file_off_t pos) {
+    const dosamp_file_off_t total = (dosamp_file_off_t)(TRACKER_WAV_HEADER + inst->p.tracker.data_bytes);
+
+    if (inst->p.tracker.song == NULL || pos == dosamp_file_off_err)
+        return dosamp_file_off_err;
+
+    if (pos > total)
+        pos = total;
+
+    return (inst->file_pos = pos);
+}
+
+static const struct dosamp_file_source dosamp_file_source_priv_tracker_init = {
+    .obj_id =                           dosamp_file_source_id_tracker,
+    .file_size =                        -1LL,
+    .file_pos =                         0,
+    .free =                             dosamp_file_source_tracker_free,
+    .close =                            dosamp_file_source_tracker_close,
+    .read =                             dosamp_file_source_tracker_read,
+    .write =                            dosamp_file_source_tracker_write,
+    .seek =                             dosamp_file_source_tracker_seek,
+    .p.tracker.song =                   NULL
+};
+
+/* is this a file the tracker source can play? (by extension) */
+int dosamp_file_source_tracker_match(const char * const path) {
+    const char *e;
+
+    if (path == NULL) return 0;
+    if ((e=strrchr(path,'.')) == NULL) return 0;
+    e++;
+
+    return (!strcasecmp(e,"mod") || !strcasecmp(e,"s3m"));
+}
+
+dosamp_file_source_t dosamp_file_source_tracker_open(const char * const path,const uint32_t rate,const unsigned char interpolate) {
+    dosamp_file_source_t inst;
+    uint64_t frames;
+
+    if (path == NULL) return NULL;
+    if (*path == 0) return NULL;
+
+    inst = dosamp_file_source_alloc(&dosamp_file_source_priv_tracker_init);
+    if (inst == NULL) return NULL;
+
+    inst->p.tracker.song = malloc(sizeof(struct modeng_song));
+    if (inst->p.tracker.song == NULL) goto fail;
+
+    if (modeng_load(inst->p.tracker.song,path) < 0) {
+        free(inst->p.tracker.song);
+        inst->p.tracker.song = NULL;
+        goto fail;
+    }
+
+    modeng_set_output(inst->p.tracker.song,rate,interpolate);
+
+    frames = modeng_length(inst->p.tracker.song);
+    if (frames > (uint64_t)((0xFFFFFFFFUL - TRACKER_WAV_HEADER) / 4UL))
+        frames = (uint64_t)((0xFFFFFFFFUL - TRACKER_WAV_HEADER) / 4UL);
+    if (frames == 0ULL) goto fail;
+
+    inst->p.tracker.data_bytes = (uint32_t)frames * 4UL;
+    inst->file_size = (int64_t)(TRACKER_WAV_HEADER + inst->p.tracker.data_bytes);
+    return inst;
+fail:
+    inst->close(inst);
+    inst->free(inst);
+    return NULL;
+}
+
+#endif /* HAS_TRACKER */
@@ -0,0 +1,340 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <endian.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "dosamp.h"
+#include "filesrc.h"
+
+/* Read-ahead file source (Linux only).
+ *
+ * A background thread reads the file sequentially into a ring buffer ahead of the file pointer,
+ * so that the playback loop copies from memory instead of waiting on the disk. The ring is a
+ * single producer (read-ahead thread) single consumer (whoever calls read/seek) queue:
+ *
+ *   head        bytes written into the ring by the thread.   Only the thread writes it.
+ *   tail        bytes taken out of the ring by the consumer. Only the consumer writes it.
+ *   seek_req    bumped by the consumer when it seeks backwards, or too far forward.
+ *   seek_ack    set to seek_req by the thread once it has moved to the new position and emptied the ring.
+ *
+ * While seek_req != seek_ack the consumer does not touch the ring, which is what lets the thread
+ * reset head to tail without a lock. The mutex is only used to sleep and wake, and is never held
+ * across read() or lseek().
+ *
+ * A forward seek only moves tail, even past head. That is what the playback loop does after an
+ * underrun, and it must not have to wait for the thread. When the thread finds tail ahead of head
+ * it skips the file forward by the difference and carries on from there. */
+
+#define READ_AHEAD_RING_SIZE            (256UL * 1024UL)    /* must be a power of 2 */
+#define READ_AHEAD_CHUNK                (32UL * 1024UL)
+#define READ_AHEAD_SKIP_MAX             (64UL * 1024UL * 1024UL) /* forward seeks further than this go through seek_req */
+
+/* head - tail, which is negative while a forward skip past head is pending */
+#define ra_fill(h,t)                    ((long)((h) - (t)))
+
+struct dosamp_file_source_read_ahead {
+    int                                 fd;
+    pthread_t                           thread;
+    pthread_mutex_t                     lock;
+    pthread_cond_t                      wake;       /* thread waits here when the ring is full or at EOF */
+    pthread_cond_t                      ready;      /* consumer waits here for data */
+    unsigned char*                      ring;
+    unsigned long                       head;
+    unsigned long                       tail;
+    unsigned long                       seek_req;
+    unsigned long                       seek_ack;
+    dosamp_file_off_t                   seek_pos;
+    unsigned char                       eof;        /* thread hit end of file (or an error) for seek_ack */
+    unsigned char                       sleeping;   /* thread is (about to be) waiting on wake */
+    unsigned char                       waiting;    /* consumer is (about to be) waiting on ready */
+    unsigned char                       quit;
+};
+
+#define ra_load(x)                      __atomic_load_n(&(x),__ATOMIC_ACQUIRE)
+#define ra_store(x,v)                   __atomic_store_n(&(x),(v),__ATOMIC_RELEASE)
+#define ra_load_sc(x)                   __atomic_load_n(&(x),__ATOMIC_SEQ_CST)
+#define ra_store_sc(x,v)                __atomic_store_n(&(x),(v),__ATOMIC_SEQ_CST)
+
+static void ra_wake(struct dosamp_file_source_read_ahead * const ra,unsigned char *flag,pthread_cond_t *cond) {
+    /* the other side sets the flag under the lock, then checks again before waiting.
+     * taking the lock here means the signal cannot land between its check and its wait. */
+    if (ra_load_sc(*flag)) {
+        pthread_mutex_lock(&ra->lock);
+        pthread_cond_signal(cond);
+        pthread_mutex_unlock(&ra->lock);
+    }
+}
+
+/* thread side: 1 if there is nothing to do until the consumer moves tail or seeks */
+static int ra_thread_idle(struct dosamp_file_source_read_ahead * const ra) {
+    if (ra_load_sc(ra->quit)) return 0;
+    if (ra_load_sc(ra->seek_req) != ra->seek_ack) return 0;
+    if (ra->eof) return 1;
+    return ra_fill(ra->head,ra_load_sc(ra->tail)) >= (long)READ_AHEAD_RING_SIZE;
+}
+
+static void *ra_thread_proc(void *arg) {
+    struct dosamp_file_source_read_ahead * const ra = (struct dosamp_file_source_read_ahead*)arg;
+    unsigned long req,space,ofs,len,tail;
+    ssize_t rd;
+
+    while (!ra_load(ra->quit)) {
+        req = ra_load(ra->seek_req);
+        if (req != ra->seek_ack) {
+            const dosamp_file_off_t pos = __atomic_load_n(&ra->seek_pos,__ATOMIC_ACQUIRE);
+
+            ra_store(ra->eof,(lseek(ra->fd,(off_t)pos,SEEK_SET) == (off_t)-1L) ? 1 : 0);
+            ra_store(ra->head,ra_load(ra->tail));
+            ra_store(ra->seek_ack,req);
+            ra_wake(ra,&ra->waiting,&ra->ready);
+            continue;
+        }
+
+        if (ra_thread_idle(ra)) {
+            pthread_mutex_lock(&ra->lock);
+            ra_store_sc(ra->sleeping,1);
+            while (ra_thread_idle(ra))
+                pthread_cond_wait(&ra->wake,&ra->lock);
+            ra_store_sc(ra->sleeping,0);
+            pthread_mutex_unlock(&ra->lock);
+            continue;
+        }
+
+        /* the consumer skipped past what has been read so far. skip the file ahead to match. */
+        tail = ra_load(ra->tail);
+        if (ra_fill(ra->head,tail) < 0L) {
+            if (lseek(ra->fd,(off_t)(tail - ra->head),SEEK_CUR) == (off_t)-1L)
+                ra_store(ra->eof,1);
+            else if (ra_load(ra->seek_req) == ra->seek_ack)
+                ra_store(ra->head,tail);
+
+            continue;
+        }
+
+        /* fill the free part of the ring up to the wrap point, a chunk at a time */
+        space = READ_AHEAD_RING_SIZE - (ra->head - tail);
+        ofs = ra->head & (READ_AHEAD_RING_SIZE - 1UL);
+        len = READ_AHEAD_RING_SIZE - ofs;
+        if (len > space) len = space;
+        if (len > READ_AHEAD_CHUNK) len = READ_AHEAD_CHUNK;
+
+        rd = read(ra->fd,ra->ring + ofs,(size_t)len);
+        if (rd < 0 && errno == EINTR)
+            continue;
+
+        /* a seek that came in while we were reading makes this data stale, don't publish it */
+        if (ra_load(ra->seek_req) != ra->seek_ack)
+            continue;
+
+        if (rd <= 0)
+            ra_store(ra->eof,1);
+        else
+            ra_store(ra->head,ra->head + (unsigned long)rd);
+
+        ra_wake(ra,&ra->waiting,&ra->ready);
+    }
+
+    return NULL;
+}
+
+/* consumer side: 1 if read() has to wait before it can make progress */
+static int ra_consumer_starved(struct dosamp_file_source_read_ahead * const ra) {
+    if (ra_load_sc(ra->seek_req) != ra_load_sc(ra->seek_ack)) return 1;
+    if (ra_fill(ra_load_sc(ra->head),ra->tail) > 0L) return 0;
+    return !ra_load_sc(ra->eof);
+}
+
+static void ra_consumer_wait(struct dosamp_file_source_read_ahead * const ra) {
+    pthread_mutex_lock(&ra->lock);
+    ra_store_sc(ra->waiting,1);
+    while (ra_consumer_starved(ra) && !ra_load_sc(ra->quit))
+        pthread_cond_wait(&ra->ready,&ra->lock);
+    ra_store_sc(ra->waiting,0);
+    pthread_mutex_unlock(&ra->lock);
+}
+
+static int dosamp_FAR dosamp_file_source_read_ahead_close(dosamp_file_source_t const inst) {
+    struct dosamp_file_source_read_ahead * const ra = inst->p.read_ahead.ra;
+
+    /* ASSUME: inst != NULL */
+    if (ra != NULL) {
+        if (ra->ring != NULL) {
+            pthread_mutex_lock(&ra->lock);
+            ra_store_sc(ra->quit,1);
+            pthread_cond_broadcast(&ra->wake);
+            pthread_mutex_unlock(&ra->lock);
+            pthread_join(ra->thread,NULL);
+            free(ra->ring);
+            ra->ring = NULL;
+        }
+
+        if (ra->fd >= 0) {
+            close(ra->fd);
+            ra->fd = -1;
+        }
+
+        pthread_cond_destroy(&ra->ready);
+        pthread_cond_destroy(&ra->wake);
+        pthread_mutex_destroy(&ra->lock);
+        free(ra);
+        inst->p.read_ahead.ra = NULL;
+    }
+
+    return 0;/*success*/
+}
+
+static void dosamp_FAR dosamp_file_source_read_ahead_free(dosamp_file_source_t const inst) {
+    dosamp_file_source_read_ahead_close(inst);
+    dosamp_file_source_free(inst);
+}
+
+static unsigned int dosamp_FAR dosamp_file_source_read_ahead_read(dosamp_file_source_t const inst,void dosamp_FAR * buf,unsigned int count) {
+    struct dosamp_file_source_read_ahead * const ra = inst->p.read_ahead.ra;
+    unsigned long ofs,len;
+    unsigned int done = 0;
+    long avail;
+
+    if (ra == NULL || count > dosamp_file_io_maxb)
+        return dosamp_file_io_err;
+
+    while (done < count) {
+        /* data at the new position can't have been read ahead yet, so always wait for the first of it.
+         * after that, in nonblock mode a short read is better than stalling the caller on the disk. */
+        if (ra_consumer_starved(ra)) {
+            if (inst->p.read_ahead.nonblock && inst->p.read_ahead.primed) {
+                inst->p.read_ahead.underruns++;
+                break;
+            }
+
+            ra_consumer_wait(ra);
+        }
+
+        avail = ra_fill(ra_load(ra->head),ra->tail);
+        if (avail <= 0L) break; /* EOF */
+
+        ofs = ra->tail & (READ_AHEAD_RING_SIZE - 1UL);
+        len = READ_AHEAD_RING_SIZE - ofs;
+        if (len > (unsigned long)avail) len = (unsigned long)avail;
+        if (len > (unsigned long)(count - done)) len = (unsigned long)(count - done);
+
+        memcpy((unsigned char*)buf + done,ra->ring + ofs,(size_t)len);
+        ra_store_sc(ra->tail,ra->tail + len);
+        inst->p.read_ahead.primed = 1;
+        done += (unsigned int)len;
+
+        ra_wake(ra,&ra->sleeping,&ra->wake);
+    }
+
+    inst->file_pos += done;
+    return done;
+}
+
+static unsigned int dosamp_FAR dosamp_file_source_read_ahead_write(dosamp_file_source_t const inst,const void dosamp_FAR * buf,unsigned int count) {
+    (void)inst;
+    (void)buf;
+    (void)count;
+
+    errno = EIO; /* not implemented */
+    return dosamp_file_io_err;
+}
+
+static dosamp_file_off_t dosamp_FAR dosamp_file_source_read_ahead_seek(dosamp_file_source_t const inst,dosamp_file_off_t pos) {
+    struct dosamp_file_source_read_ahead * const ra = inst->p.read_ahead.ra;
+    dosamp_file_off_t cur;
+
+    if (ra == NULL || pos == dosamp_file_io_err)
+        return dosamp_file_off_err;
+
+    if (pos > dosamp_file_off_max)
+        pos = dosamp_file_off_max;
+
+    cur = (dosamp_file_off_t)inst->file_pos;
+
+    /* forward: skip over it, whether or not it has been read ahead yet. the thread catches up. */
+    if (ra_load(ra->seek_req) == ra_load(ra->seek_ack) && pos >= cur &&
+        (pos - cur) <= (dosamp_file_off_t)READ_AHEAD_SKIP_MAX) {
+        if (ra_fill(ra_load(ra->head),ra->tail + (unsigned long)(pos - cur)) < 0L)
+            inst->p.read_ahead.skips++;
+
+        ra_store_sc(ra->tail,ra->tail + (unsigned long)(pos - cur));
+        ra_wake(ra,&ra->sleeping,&ra->wake);
+        return (inst->file_pos = pos);
+    }
+
+    /* anything else invalidates the ring. the thread empties it and starts over at pos. */
+    __atomic_store_n(&ra->seek_pos,pos,__ATOMIC_RELEASE);
+    ra_store_sc(ra->seek_req,ra->seek_req + 1UL);
+    inst->p.read_ahead.primed = 0;
+    inst->p.read_ahead.seeks++;
+    ra_wake(ra,&ra->sleeping,&ra->wake);
+
+    return (inst->file_pos = pos);
+}
+
+static const struct dosamp_file_source dosamp_file_source_priv_read_ahead_init = {
+    .obj_id =                           dosamp_file_source_id_read_ahead,
+    .file_size =                        -1LL,
+    .file_pos =                         0,
+    .free =                             dosamp_file_source_read_ahead_free,
+    .close =                            dosamp_file_source_read_ahead_close,
+    .read =                             dosamp_file_source_read_ahead_read,
+    .write =                            dosamp_file_source_read_ahead_write,
+    .seek =                             dosamp_file_source_read_ahead_seek,
+    .p.read_ahead.ra =                  NULL
+};
+
+dosamp_file_source_t dosamp_file_source_read_ahead_open(const char * const path) {
+    struct dosamp_file_source_read_ahead *ra;
+    dosamp_file_source_t inst;
+    struct stat st;
+
+    if (path == NULL) return NULL;
+    if (*path == 0) return NULL;
+
+    inst = dosamp_file_source_alloc(&dosamp_file_source_priv_read_ahead_init);
+    if (inst == NULL) return NULL;
+
+    ra = calloc(1,sizeof(*ra));
+    if (ra == NULL) goto fail;
+    ra->fd = -1;
+    pthread_mutex_init(&ra->lock,NULL);
+    pthread_cond_init(&ra->wake,NULL);
+    pthread_cond_init(&ra->ready,NULL);
+    inst->p.read_ahead.ra = ra;
+
+    ra->fd = open(path,O_RDONLY);
+    if (ra->fd < 0) goto fail;
+    if (fstat(ra->fd,&st)) goto fail; /* cannot stat: fail */
+    if (!S_ISREG(st.st_mode)) goto fail; /* not a file: fail */
+    inst->file_size = (dosamp_file_off_t)st.st_size;
+
+    /* let the kernel know, too */
+    posix_fadvise(ra->fd,0,0,POSIX_FADV_SEQUENTIAL);
+
+    ra->ring = malloc(READ_AHEAD_RING_SIZE);
+    if (ra->ring == NULL) goto fail;
+
+    if (pthread_create(&ra->thread,NULL,ra_thread_proc,ra) != 0) {
+        free(ra->ring);
+        ra->ring = NULL;
+        goto fail;
+    }
+
+    return inst;
+fail:
+    inst->close(inst);
+    inst->free(inst);
+    return NULL;
+}
+
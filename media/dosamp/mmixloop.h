@@ -0,0 +1,57 @@
+/* inner mixing loop, included from modmix.c with:
+ *
+ *   mix_sample_t       int8_t or int16_t
+ *   mix_gain_shift     extra shift of the gain so that (sample * gain) fits in 24 bits (0 for 8-bit, 8 for 16-bit)
+ *   mix_interp         1 = linear interpolation, 0 = nearest
+ *   mix_ramp           1 = gain changes every frame (volume ramp), 0 = constant gain
+ *
+ * The caller has made sure that the n frames do not run past v->end, so there are no bounds checks here.
+ * Interpolation reads one sample past the current one, which at the end of the sample is the guard sample. */
+
+    const mix_sample_t *d = (const mix_sample_t*)v->data + v->pos;
+    const uint32_t step = v->step;
+    uint32_t f = v->frac;
+#if mix_ramp
+    int32_t gl = v->gain_l,gr = v->gain_r;
+    const int32_t dl = v->ramp_l,dr = v->ramp_r;
+#else
+    const int32_t gl = v->gain_l >> (8 + mix_gain_shift),gr = v->gain_r >> (8 + mix_gain_shift);
+#endif
+    int32_t s;
+
+    while (n-- > 0) {
+#if mix_interp
+        {
+            const mix_sample_t *p = d + (f >> 16UL);
+
+            /* (p[1] - p[0]) is 17 bits for 16-bit samples, so the fraction is cut to 15 bits to stay within 32 */
+            s = (int32_t)p[0] + ((((int32_t)p[1] - (int32_t)p[0]) * (int32_t)((f & 0xFFFFUL) >> 1UL)) >> 15L);
+        }
+#else
+        s = (int32_t)d[f >> 16UL];
+#endif
+
+#if mix_ramp
+        acc[0] += s * (gl >> (8 + mix_gain_shift));
+        acc[1] += s * (gr >> (8 + mix_gain_shift));
+        gl += dl;
+        gr += dr;
+#else
+        acc[0] += s * gl;
+        acc[1] += s * gr;
+#endif
+        acc += 2;
+        f += step;
+    }
+
+    v->pos += f >> 16UL;
+    v->frac = f & 0xFFFFUL;
+#if mix_ramp
+    v->gain_l = gl;
+    v->gain_r = gr;
+#endif
+
+#undef mix_sample_t
+#undef mix_gain_shift
+#undef mix_interp
+#undef mix_ramp
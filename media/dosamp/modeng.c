@@ -0,0 +1,715 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dosamp.h"
+#include "modeng.h"
+
+#if defined(HAS_TRACKER)
+
+/* Sequencer and effects.
+ *
+ * Each tick: on tick 0 the row is read and notes and first-tick effects are processed, on the other ticks
+ * the continuous effects (slides, vibrato, ...). Then every channel's period and volume are turned into a
+ * mixer step and gain, and (rate * 2.5 / tempo) frames are mixed before the next tick. */
+
+const char *modeng_format_str[] = {
+    "none",
+    "MOD",
+    "S3M"
+};
+
+/* ST3 period table, octave 0. period = (8363 * 16 * (table[note % 12] >> octave)) / c2spd */
+static const uint16_t modeng_st3_period[12] = {
+    1712,1616,1524,1440,1356,1280,1208,1140,1076,1016,960,907
+};
+
+/* C2SPD for finetune -8 to +7 (S2x, index 8 is no finetune) */
+const uint16_t modeng_finetune_c2spd[16] = {
+    7895,7941,7985,8046,8107,8169,8232,8280,8363,8413,8463,8529,8581,8651,8723,8757
+};
+
+/* ProTracker vibrato/tremolo sine table, half wave */
+static const uint8_t modeng_sine[32] = {
+      0, 24, 49, 74, 97,120,141,161,180,197,212,224,235,244,250,253,
+    255,253,250,244,235,224,212,197,180,161,141,120, 97, 74, 49, 24
+};
+
+uint16_t modeng_note_period(uint8_t note,uint32_t c2spd) {
+    uint32_t p;
+
+    if (c2spd == 0UL) c2spd = 8363UL;
+    if (note >= 120) note = 119;
+
+    p = ((uint32_t)modeng_st3_period[note % 12u] << 4UL) >> (uint32_t)(note / 12u);
+    p = (8363UL * p) / c2spd;
+    if (p < 1UL) p = 1UL;
+    if (p > 0xFFFFUL) p = 0xFFFFUL;
+    return (uint16_t)p;
+}
+
+static uint16_t modeng_note_period_8363(const uint8_t note) {
+    return (uint16_t)(((uint32_t)modeng_st3_period[note % 12u] << 4UL) >> (uint32_t)(note / 12u));
+}
+
+/* nearest note for a period (at C2SPD 8363). the loader calls this for every note of a MOD, so binary search */
+uint8_t modeng_period_note(uint16_t period) {
+    unsigned int lo = 0,hi = 119,mid;
+
+    /* periods go down as notes go up */
+    while (lo < hi) {
+        mid = (lo + hi) >> 1u;
+        if (modeng_note_period_8363((uint8_t)mid) > period)
+            lo = mid + 1u;
+        else
+            hi = mid;
+    }
+
+    /* lo is the first note at or above the pitch, the one below may be closer */
+    if (lo > 0u && (modeng_note_period_8363((uint8_t)(lo - 1u)) - period) < (period - modeng_note_period_8363((uint8_t)lo)))
+        lo--;
+
+    return (uint8_t)lo;
+}
+
+/* -255 to 255 */
+static int modeng_wave(const uint8_t wave,const uint8_t pos) {
+    const uint8_t p = pos & 63u;
+
+    switch (wave & 3u) {
+        case 1: /* ramp down */
+            return 255 - ((int)p * 8);
+        case 2: /* square */
+            return (p < 32u) ? 255 : -255;
+        default: /* sine (random is sine too) */
+            return (p < 32u) ? (int)modeng_sine[p] : -(int)modeng_sine[p - 32u];
+    }
+}
+
+static void modeng_mark_visited(struct modeng_song *s) {
+    const unsigned int i = ((unsigned int)s->cur_order * MODENG_ROWS) + s->cur_row;
+
+    s->visited[i >> 3u] |= (uint8_t)(1u << (i & 7u));
+}
+
+static int modeng_is_visited(struct modeng_song *s,const unsigned int order,const unsigned int row) {
+    const unsigned int i = (order * MODENG_ROWS) + row;
+
+    return (s->visited[i >> 3u] >> (i & 7u)) & 1u;
+}
+
+/* skip marker orders. returns the order, or -1 at the end of the song */
+static int modeng_valid_order(struct modeng_song *s,unsigned int order) {
+    while (order < s->orders && s->order[order] == 0xFE) order++;
+    if (order >= s->orders || s->order[order] == 0xFF) return -1;
+    return (int)order;
+}
+
+static void modeng_enter_order(struct modeng_song *s,unsigned int order,unsigned int row) {
+    int o = modeng_valid_order(s,order);
+
+    if (o < 0) {
+        /* end of the song */
+        if (!s->loop || (o = modeng_valid_order(s,s->restart)) < 0) {
+            s->end_pending = 1;
+            return;
+        }
+    }
+
+    if (row >= MODENG_ROWS) row = 0;
+
+    if (modeng_is_visited(s,(unsigned int)o,row)) {
+        /* we have been here before: the song loops back on itself */
+        if (!s->loop) {
+            s->end_pending = 1;
+            return;
+        }
+
+        memset(s->visited,0,sizeof(s->visited));
+    }
+
+    s->cur_order = (uint16_t)o;
+    s->cur_row = (uint8_t)row;
+}
+
+static void modeng_trigger(struct modeng_song *s,struct modeng_channel *c,uint32_t offset) {
+    const struct modeng_sample *sm = c->smp;
+
+    if (sm == NULL || sm->data == NULL || sm->length == 0UL || offset >= sm->length) {
+        c->v.active = 0;
+        return;
+    }
+
+    c->v.data = sm->data;
+    c->v.bits = sm->bits;
+    c->v.loop = sm->loop;
+    c->v.end = sm->length;
+    c->v.loop_start = sm->loop_start;
+    c->v.pos = offset;
+    c->v.frac = 0;
+    c->v.active = 1;
+    c->v.stop_after_ramp = 0;
+
+    /* fade in from silence */
+    c->v.ramp = 0;
+    c->v.gain_l = c->v.gain_r = 0;
+    c->v.target_l = c->v.target_r = 0;
+
+    if (!(c->vib_wave & 4u)) c->vib_pos = 0;
+    if (!(c->trem_wave & 4u)) c->trem_pos = 0;
+    c->tremor_count = 0;
+    c->tremor_on = 1;
+    (void)s;
+}
+
+/* note cut: fade out, then stop */
+static void modeng_stop(struct modeng_song *s,struct modeng_channel *c) {
+    if (!c->v.active) return;
+
+    modmix_set_gain(&c->v,0,0,s->ramp_frames);
+    if (c->v.ramp > 0)
+        c->v.stop_after_ramp = 1;
+    else
+        c->v.active = 0;
+}
+
+static void modeng_note(struct modeng_song *s,struct modeng_channel *c,const struct modeng_cell *cell) {
+    const int porta = (cell->cmd == MODENG_FX_G || cell->cmd == MODENG_FX_L);
+    uint32_t offset = 0;
+
+    if (cell->ins != 0 && cell->ins <= s->samples) {
+        const struct modeng_sample *sm = &s->sample[cell->ins - 1u];
+
+        c->ins = cell->ins;
+        c->vol = sm->volume;
+        c->c2spd = sm->c2spd;
+        if (!porta || !c->v.active) c->smp = sm;
+    }
+
+    if (cell->note < 120u) {
+        const uint16_t period = modeng_note_period(cell->note,c->c2spd);
+
+        if (porta && c->v.active && c->period != 0) {
+            c->porta_target = period;
+        }
+        else {
+            c->note = cell->note;
+            c->period = c->porta_target = period;
+
+            if (cell->cmd == MODENG_FX_O) {
+                if (cell->info != 0) c->mem_o = cell->info;
+                offset = (uint32_t)c->mem_o << 8UL;
+            }
+
+            modeng_trigger(s,c,offset);
+        }
+    }
+    else if (cell->note == MODENG_NOTE_CUT) {
+        modeng_stop(s,c);
+    }
+
+    if (cell->vol != MODENG_VOL_NONE)
+        c->vol = (cell->vol > 64u) ? 64u : cell->vol;
+}
+
+static void modeng_clamp_period(struct modeng_song *s,struct modeng_channel *c) {
+    if (c->period < s->min_period) c->period = s->min_period;
+    if (c->period > s->max_period) c->period = s->max_period;
+}
+
+/* Dxy: x = up, y = down. DxF = fine up, DFy = fine down (first tick only) */
+static void modeng_volslide(struct modeng_song *s,struct modeng_channel *c,uint8_t info,const unsigned char first_tick) {
+    int vol = c->vol;
+    uint8_t x,y;
+
+    /* MOD has no memory for volume slides, A00 and 500/600 do nothing */
+    if (s->format != MODENG_FMT_MOD) {
+        if (info != 0) c->mem_d = info;
+        info = c->mem_d;
+    }
+
+    x = info >> 4u;
+    y = info & 0xFu;
+
+    if (y == 0xFu && x != 0u) {
+        if (first_tick) vol += x;
+    }
+    else if (x == 0xFu && y != 0u) {
+        if (first_tick) vol -= y;
+    }
+    else if (!first_tick) {
+        if (x != 0u) vol += x;
+        else vol -= y;
+    }
+
+    if (vol < 0) vol = 0;
+    if (vol > 64) vol = 64;
+    c->vol = (uint8_t)vol;
+}
+
+/* Exx/Fxx: EFx = fine, EEx = extra fine (first tick only), else xx*4 every other tick */
+static void modeng_portamento(struct modeng_song *s,struct modeng_channel *c,const int dir,const unsigned char first_tick) {
+    const uint8_t v = c->mem_ef;
+    int amount = 0;
+
+    if (v >= 0xF0u) {
+        if (first_tick) amount = (v & 0xFu) * 4;
+    }
+    else if (v >= 0xE0u) {
+        if (first_tick) amount = (v & 0xFu);
+    }
+    else if (!first_tick) {
+        amount = v * 4;
+    }
+
+    if (amount != 0) {
+        long p = (long)c->period + (dir * amount);
+
+        if (p < 1L) p = 1L;
+        if (p > 0xFFFFL) p = 0xFFFFL;
+        c->period = (uint16_t)p;
+        modeng_clamp_period(s,c);
+    }
+}
+
+static void modeng_tone_portamento(struct modeng_channel *c) {
+    const unsigned int speed = (unsigned int)c->mem_g * 4u;
+
+    if (c->porta_target == 0 || c->period == c->porta_target) return;
+
+    if (c->period < c->porta_target) {
+        if ((unsigned int)(c->porta_target - c->period) <= speed) c->period = c->porta_target;
+        else c->period += speed;
+    }
+    else {
+        if ((unsigned int)(c->period - c->porta_target) <= speed) c->period = c->porta_target;
+        else c->period -= speed;
+    }
+}
+
+static void modeng_retrigger(struct modeng_song *s,struct modeng_channel *c) {
+    const uint8_t y = c->mem_q & 0xFu;
+    int vol = c->vol;
+
+    if (y == 0u || (s->tick % y) != 0u) return;
+
+    switch (c->mem_q >> 4u) {
+        case 0x1: vol -= 1; break;
+        case 0x2: vol -= 2; break;
+        case 0x3: vol -= 4; break;
+        case 0x4: vol -= 8; break;
+        case 0x5: vol -= 16; break;
+        case 0x6: vol = (vol * 2) / 3; break;
+        case 0x7: vol /= 2; break;
+        case 0x9: vol += 1; break;
+        case 0xA: vol += 2; break;
+        case 0xB: vol += 4; break;
+        case 0xC: vol += 8; break;
+        case 0xD: vol += 16; break;
+        case 0xE: vol = (vol * 3) / 2; break;
+        case 0xF: vol *= 2; break;
+        default: break;
+    }
+
+    if (vol < 0) vol = 0;
+    if (vol > 64) vol = 64;
+    c->vol = (uint8_t)vol;
+
+    modeng_trigger(s,c,0);
+}
+
+/* tick 0 */
+static void modeng_row_effect(struct modeng_song *s,struct modeng_channel *c) {
+    const uint8_t info = c->info;
+
+    switch (c->cmd) {
+        case MODENG_FX_A:
+            if (info != 0) s->speed = info;
+            break;
+        case MODENG_FX_B:
+            s->jump_order = info;
+            break;
+        case MODENG_FX_C:
+            s->break_row = (info < MODENG_ROWS) ? info : 0;
+            break;
+        case MODENG_FX_D:
+            modeng_volslide(s,c,info,1);
+            break;
+        case MODENG_FX_E:
+        case MODENG_FX_F:
+            if (info != 0) c->mem_ef = info;
+            modeng_portamento(s,c,(c->cmd == MODENG_FX_E) ? 1 : -1,1);
+            break;
+        case MODENG_FX_G:
+            if (info != 0) c->mem_g = info;
+            break;
+        case MODENG_FX_H:
+        case MODENG_FX_U:
+            if (info & 0xF0u) c->mem_h = (c->mem_h & 0x0Fu) | (info & 0xF0u);
+            if (info & 0x0Fu) c->mem_h = (c->mem_h & 0xF0u) | (info & 0x0Fu);
+            break;
+        case MODENG_FX_I:
+            if (info != 0) c->mem_i = info;
+            break;
+        case MODENG_FX_J:
+            if (info != 0) c->mem_j = info;
+            break;
+        case MODENG_FX_K:
+        case MODENG_FX_L:
+            modeng_volslide(s,c,info,1);
+            break;
+        case MODENG_FX_Q:
+            if (info != 0) c->mem_q = info;
+            break;
+        case MODENG_FX_R:
+            if (info & 0xF0u) c->mem_r = (c->mem_r & 0x0Fu) | (info & 0xF0u);
+            if (info & 0x0Fu) c->mem_r = (c->mem_r & 0xF0u) | (info & 0x0Fu);
+            break;
+        case MODENG_FX_S:
+            switch (info >> 4u) {
+                case 0x2: /* set finetune */
+                    c->c2spd = modeng_finetune_c2spd[info & 0xFu];
+                    break;
+                case 0x3:
+                    c->vib_wave = info & 7u;
+                    break;
+                case 0x4:
+                    c->trem_wave = info & 7u;
+                    break;
+                case 0x8:
+                    c->pan = (uint16_t)(((info & 0xFu) * 256u) / 15u);
+                    break;
+                case 0xB:
+                    if ((info & 0xFu) == 0u) {
+                        c->loop_row = s->cur_row;
+                    }
+                    else if (c->loop_count == 0u) {
+                        c->loop_count = info & 0xFu;
+                        s->loop_jump_row = c->loop_row;
+                    }
+                    else if (--c->loop_count != 0u) {
+                        s->loop_jump_row = c->loop_row;
+                    }
+                    break;
+                case 0xC:
+                    c->cut_tick = info & 0xFu;
+                    if (c->cut_tick == 0u && s->format == MODENG_FMT_MOD) c->vol = 0;
+                    break;
+                case 0xE:
+                    if (!s->in_pattern_delay && s->pattern_delay == 0u) s->pattern_delay = info & 0xFu;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case MODENG_FX_T:
+            if (info >= 0x20u) s->tempo = info;
+            break;
+        case MODENG_FX_V:
+            s->global_vol = (info > 64u) ? 64u : info;
+            break;
+        case MODENG_FX_X:
+            if (info <= 0x80u) c->pan = (uint16_t)info * 2u;
+            break;
+        default:
+            break;
+    }
+}
+
+/* ticks 1 and up */
+static void modeng_tick_effect(struct modeng_song *s,struct modeng_channel *c) {
+    switch (c->cmd) {
+        case MODENG_FX_D:
+            modeng_volslide(s,c,c->info,0);
+            break;
+        case MODENG_FX_E:
+        case MODENG_FX_F:
+            modeng_portamento(s,c,(c->cmd == MODENG_FX_E) ? 1 : -1,0);
+            break;
+        case MODENG_FX_G:
+            modeng_tone_portamento(c);
+            break;
+        case MODENG_FX_H:
+        case MODENG_FX_U:
+            c->vib_pos += c->mem_h >> 4u;
+            break;
+        case MODENG_FX_K:
+            c->vib_pos += c->mem_h >> 4u;
+            modeng_volslide(s,c,c->info,0);
+            break;
+        case MODENG_FX_L:
+            modeng_tone_portamento(c);
+            modeng_volslide(s,c,c->info,0);
+            break;
+        case MODENG_FX_I:
+            c->tremor_count++;
+            if (c->tremor_on) {
+                if (c->tremor_count > (c->mem_i >> 4u)) {
+                    c->tremor_on = 0;
+                    c->tremor_count = 0;
+                }
+            }
+            else {
+                if (c->tremor_count > (c->mem_i & 0xFu)) {
+                    c->tremor_on = 1;
+                    c->tremor_count = 0;
+                }
+            }
+            break;
+        case MODENG_FX_Q:
+            modeng_retrigger(s,c);
+            break;
+        case MODENG_FX_R:
+            c->trem_pos += c->mem_r >> 4u;
+            break;
+        case MODENG_FX_S:
+            if ((c->info >> 4u) == 0xCu && s->tick == c->cut_tick) {
+                c->vol = 0;
+            }
+            else if ((c->info >> 4u) == 0xDu && s->tick == c->delay_tick) {
+                modeng_note(s,c,&c->delayed);
+                c->delay_tick = 0;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* period and volume after vibrato, arpeggio, tremolo, tremor. to the mixer */
+static void modeng_channel_output(struct modeng_song *s,struct modeng_channel *c) {
+    long period = c->period;
+    int vol = c->vol;
+    int32_t gain,pan;
+
+    switch (c->cmd) {
+        case MODENG_FX_H:
+        case MODENG_FX_K:
+            period += (modeng_wave(c->vib_wave,c->vib_pos) * (int)(c->mem_h & 0xFu)) >> 5;
+            break;
+        case MODENG_FX_U:
+            period += (modeng_wave(c->vib_wave,c->vib_pos) * (int)(c->mem_h & 0xFu)) >> 7;
+            break;
+        case MODENG_FX_J:
+            switch (s->tick % 3u) {
+                case 1: period = modeng_note_period(c->note + (c->mem_j >> 4u),c->c2spd); break;
+                case 2: period = modeng_note_period(c->note + (c->mem_j & 0xFu),c->c2spd); break;
+                default: break;
+            }
+            break;
+        case MODENG_FX_R:
+            vol += (modeng_wave(c->trem_wave,c->trem_pos) * (int)(c->mem_r & 0xFu)) >> 6;
+            break;
+        case MODENG_FX_I:
+            if (!c->tremor_on) vol = 0;
+            break;
+        default:
+            break;
+    }
+
+    if (period < (long)s->min_period) period = s->min_period;
+    if (period > (long)s->max_period) period = s->max_period;
+    if (vol < 0) vol = 0;
+    if (vol > 64) vol = 64;
+
+    c->out_period = (uint16_t)period;
+    c->out_vol = (uint8_t)vol;
+
+    if (!c->v.active || c->v.stop_after_ramp) return;
+
+    c->v.step = (uint32_t)(((uint64_t)MODENG_PERIOD_CLOCK << (uint64_t)16) / ((uint64_t)c->out_period * (uint64_t)s->rate));
+
+    gain = (int32_t)c->out_vol * (int32_t)s->global_vol; /* 0-4096 */
+    pan = 128L + ((((int32_t)c->pan - 128L) * (int32_t)s->separation) / 100L);
+    modmix_set_gain(&c->v,(gain * (256L - pan)) >> 4L,(gain * pan) >> 4L,s->ramp_frames);
+}
+
+static void modeng_tick(struct modeng_song *s) {
+    struct modeng_channel *c;
+    unsigned int i;
+    uint32_t t;
+
+    if (s->tick == 0 && !s->in_pattern_delay) {
+        const struct modeng_cell *row = NULL;
+        const uint8_t pat = s->order[s->cur_order];
+
+        modeng_mark_visited(s);
+        if (pat < s->patterns)
+            row = s->pattern + (((size_t)pat * MODENG_ROWS) + s->cur_row) * s->channels;
+
+        for (i=0;i < s->channels;i++) {
+            static const struct modeng_cell empty = { MODENG_NOTE_NONE, 0, MODENG_VOL_NONE, MODENG_FX_NONE, 0 };
+            const struct modeng_cell *cell = (row != NULL) ? &row[i] : &empty;
+
+            c = &s->chan[i];
+            c->cmd = cell->cmd;
+            c->info = cell->info;
+            c->delay_tick = 0;
+            c->cut_tick = 0;
+
+            if (cell->cmd == MODENG_FX_S && (cell->info >> 4u) == 0xDu && (cell->info & 0xFu) != 0u) {
+                /* note delay: the whole cell happens later */
+                c->delayed = *cell;
+                c->delayed.cmd = MODENG_FX_NONE;
+                c->delay_tick = cell->info & 0xFu;
+                continue;
+            }
+
+            modeng_note(s,c,cell);
+            modeng_row_effect(s,c);
+        }
+    }
+    else if (s->tick != 0) {
+        for (i=0;i < s->channels;i++)
+            modeng_tick_effect(s,&s->chan[i]);
+    }
+
+    for (i=0;i < s->channels;i++)
+        modeng_channel_output(s,&s->chan[i]);
+
+    /* frames per tick = rate * 2.5 / tempo, remainder carried */
+    t = s->tick_rem + (s->rate * 5UL);
+    s->tick_frames_left = t / ((uint32_t)s->tempo * 2UL);
+    s->tick_rem = t % ((uint32_t)s->tempo * 2UL);
+
+    /* next tick, next row */
+    if (++s->tick >= s->speed) {
+        s->tick = 0;
+
+        if (s->pattern_delay > 0u) {
+            s->pattern_delay--;
+            s->in_pattern_delay = 1;
+            return;
+        }
+
+        s->in_pattern_delay = 0;
+        if (s->jump_order >= 0 || s->break_row >= 0) {
+            const unsigned int order = (s->jump_order >= 0) ? (unsigned int)s->jump_order : (s->cur_order + 1u);
+            const unsigned int row = (s->break_row >= 0) ? (unsigned int)s->break_row : 0u;
+
+            s->jump_order = s->break_row = s->loop_jump_row = -1;
+            modeng_enter_order(s,order,row);
+        }
+        else if (s->loop_jump_row >= 0) {
+            s->cur_row = (uint8_t)s->loop_jump_row;
+            s->loop_jump_row = -1;
+        }
+        else if (++s->cur_row >= MODENG_ROWS) {
+            modeng_enter_order(s,s->cur_order + 1u,0);
+        }
+    }
+}
+
+void modeng_set_output(struct modeng_song *s,uint32_t rate,unsigned char interpolate) {
+    s->rate = rate;
+    s->interpolate = interpolate;
+    s->ramp_frames = (unsigned int)(rate >> 9UL); /* about 2ms */
+    if (s->ramp_frames == 0) s->ramp_frames = 1;
+}
+
+void modeng_restart(struct modeng_song *s) {
+    unsigned int i;
+
+    memset(s->chan,0,sizeof(s->chan));
+    for (i=0;i < s->channels;i++)
+        s->chan[i].pan = s->init_pan[i];
+
+    memset(s->visited,0,sizeof(s->visited));
+    s->speed = s->init_speed;
+    s->tempo = s->init_tempo;
+    s->global_vol = s->init_global_vol;
+    s->tick = 0;
+    s->pattern_delay = 0;
+    s->in_pattern_delay = 0;
+    s->jump_order = s->break_row = s->loop_jump_row = -1;
+    s->tick_frames_left = 0;
+    s->tick_rem = 0;
+    s->position = 0;
+    s->ended = 0;
+    s->end_pending = 0;
+    s->cur_order = 0;
+    s->cur_row = 0;
+    modeng_enter_order(s,0,0);
+}
+
+/* returns the frames rendered, less than asked only at the end of the song */
+uint32_t modeng_render(struct modeng_song *s,int16_t *out,uint32_t frames) {
+    uint32_t done = 0;
+    unsigned int i,n;
+
+    while (done < frames) {
+        if (s->tick_frames_left == 0) {
+            if (s->end_pending) s->ended = 1;
+            if (s->ended) break;
+            modeng_tick(s);
+            continue;
+        }
+
+        n = MODENG_MIX_FRAMES;
+        if (n > (frames - done)) n = (unsigned int)(frames - done);
+        if (n > s->tick_frames_left) n = (unsigned int)s->tick_frames_left;
+
+        memset(s->mixbuf,0,(size_t)n * 2u * sizeof(int32_t));
+        for (i=0;i < s->channels;i++) {
+            if (s->chan[i].v.active)
+                modmix_voice(&s->chan[i].v,s->mixbuf,n,s->interpolate);
+        }
+        modmix_output(out + ((size_t)done * 2u),s->mixbuf,n,s->amp);
+
+        done += n;
+        s->tick_frames_left -= n;
+        s->position += n;
+    }
+
+    return done;
+}
+
+/* advance without output (seeking). returns the frames skipped */
+uint32_t modeng_skip(struct modeng_song *s,uint32_t frames) {
+    uint32_t done = 0,n;
+    unsigned int i;
+
+    while (done < frames) {
+        if (s->tick_frames_left == 0) {
+            if (s->end_pending) s->ended = 1;
+            if (s->ended) break;
+            modeng_tick(s);
+            continue;
+        }
+
+        n = frames - done;
+        if (n > s->tick_frames_left) n = s->tick_frames_left;
+
+        for (i=0;i < s->channels;i++)
+            modmix_voice_skip(&s->chan[i].v,n);
+
+        done += n;
+        s->tick_frames_left -= n;
+        s->position += n;
+    }
+
+    return done;
+}
+
+/* play through the song once without mixing to find its length in frames. leaves the song restarted.
+ * songs that never come back to a row they played (they can, with pattern loops and delays) are cut at 2 hours */
+uint64_t modeng_length(struct modeng_song *s) {
+    const uint64_t limit = (uint64_t)s->rate * (uint64_t)(2UL * 60UL * 60UL);
+    const uint8_t loop = s->loop;
+    uint64_t total = 0;
+    uint32_t n;
+
+    s->loop = 0;
+    modeng_restart(s);
+    do {
+        n = modeng_skip(s,s->rate * 60UL);
+        total += n;
+    } while (n != 0UL && !s->ended && total < limit);
+
+    s->loop = loop;
+    modeng_restart(s);
+    return total;
+}
+
+#endif /* HAS_TRACKER */
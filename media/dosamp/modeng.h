@@ -0,0 +1,195 @@
+/* MOD/S3M tracker engine with fixed point software mixer.
+ *
+ * The module is loaded completely into memory (patterns unpacked, samples converted to signed PCM), which
+ * needs a flat address space, so this is only built where HAS_TRACKER is defined (32-bit and Linux).
+ *
+ * Both formats are converted on load to one internal form modeled after S3M: notes are octave*12+semitone
+ * with C-4 (48) playing the sample at its C2SPD rate, effects are S3M effect letters, and periods are in
+ * ST3 units (4 x Amiga period). MOD finetune becomes a C2SPD, the way ST3 loads MODs. */
+
+#define MODENG_MAX_CHANNELS                 32
+#define MODENG_MAX_SAMPLES                  99
+#define MODENG_MAX_ORDERS                   256
+#define MODENG_ROWS                         64
+
+#define MODENG_NOTE_NONE                    0xFF
+#define MODENG_NOTE_CUT                     0xFE
+#define MODENG_VOL_NONE                     0xFF
+
+/* ST3 period clock: Hz = MODENG_PERIOD_CLOCK / period */
+#define MODENG_PERIOD_CLOCK                 14317056UL
+
+/* render rate when the user does not ask for one */
+#if defined(LINUX)
+# define TRACKER_DEFAULT_RATE               44100UL
+#else
+# define TRACKER_DEFAULT_RATE               22050UL
+#endif
+
+/* mixing buffer size (stereo frames) per pass */
+#define MODENG_MIX_FRAMES                   512
+
+enum {
+    MODENG_FMT_NONE=0,
+    MODENG_FMT_MOD,
+    MODENG_FMT_S3M
+};
+
+/* internal effects, numbered like the S3M letters (A=1 ... Z=26) */
+enum {
+    MODENG_FX_NONE=0,
+    MODENG_FX_A=1,                          /* set speed */
+    MODENG_FX_B,                            /* jump to order */
+    MODENG_FX_C,                            /* pattern break (param already converted from BCD) */
+    MODENG_FX_D,                            /* volume slide */
+    MODENG_FX_E,                            /* portamento down */
+    MODENG_FX_F,                            /* portamento up */
+    MODENG_FX_G,                            /* tone portamento */
+    MODENG_FX_H,                            /* vibrato */
+    MODENG_FX_I,                            /* tremor */
+    MODENG_FX_J,                            /* arpeggio */
+    MODENG_FX_K,                            /* vibrato + volume slide */
+    MODENG_FX_L,                            /* tone portamento + volume slide */
+    MODENG_FX_M,
+    MODENG_FX_N,
+    MODENG_FX_O,                            /* sample offset */
+    MODENG_FX_P,
+    MODENG_FX_Q,                            /* retrigger + volume change */
+    MODENG_FX_R,                            /* tremolo */
+    MODENG_FX_S,                            /* special */
+    MODENG_FX_T,                            /* set tempo */
+    MODENG_FX_U,                            /* fine vibrato */
+    MODENG_FX_V,                            /* set global volume */
+    MODENG_FX_W,
+    MODENG_FX_X,                            /* set panning 00-80 */
+    MODENG_FX_MAX
+};
+
+struct modeng_cell {
+    uint8_t                                 note;       /* octave*12+semitone, MODENG_NOTE_NONE or MODENG_NOTE_CUT */
+    uint8_t                                 ins;        /* 1-based, 0 = none */
+    uint8_t                                 vol;        /* 0-64 or MODENG_VOL_NONE */
+    uint8_t                                 cmd;        /* MODENG_FX_* */
+    uint8_t                                 info;
+};
+
+struct modeng_sample {
+    void*                                   data;       /* signed 8 or 16-bit PCM, length+1 samples (one guard sample for interpolation) */
+    uint32_t                                length;     /* in samples. if looped, cut at loop_end */
+    uint32_t                                loop_start;
+    uint32_t                                c2spd;      /* rate in Hz that C-4 plays at */
+    uint8_t                                 volume;     /* default volume 0-64 */
+    uint8_t                                 bits;       /* 8 or 16 */
+    uint8_t                                 loop;
+    char                                    name[29];
+};
+
+/* mixer voice state (modmix.c) */
+struct modmix_voice {
+    const void*                             data;
+    uint32_t                                pos;
+    uint32_t                                frac;       /* 0-0xFFFF */
+    uint32_t                                step;       /* 16.16 source samples per output frame */
+    uint32_t                                end;        /* sample length (or loop end) */
+    uint32_t                                loop_start;
+    int32_t                                 gain_l,gain_r;          /* current gain << 8, 0-65536 << 8 */
+    int32_t                                 target_l,target_r;      /* gain << 8 after the ramp */
+    int32_t                                 ramp_l,ramp_r;          /* per frame change during the ramp */
+    unsigned int                            ramp;       /* frames of ramp left */
+    uint8_t                                 bits;
+    uint8_t                                 loop;
+    uint8_t                                 active;
+    uint8_t                                 stop_after_ramp;        /* note cut: stop once faded out */
+};
+
+struct modeng_channel {
+    struct modmix_voice                     v;
+    const struct modeng_sample*             smp;
+    struct modeng_cell                      delayed;    /* SDx: cell to play at tick delay_tick */
+    uint32_t                                c2spd;
+    uint16_t                                period;     /* current period (ST3 units) */
+    uint16_t                                porta_target;
+    uint16_t                                out_period; /* after vibrato/arpeggio */
+    uint8_t                                 note;
+    uint8_t                                 ins;
+    uint8_t                                 vol;        /* 0-64 */
+    uint8_t                                 out_vol;    /* after tremolo/tremor */
+    uint16_t                                pan;        /* 0 (left) - 256 (right) */
+    uint8_t                                 cmd,info;   /* effect of the current row */
+    uint8_t                                 delay_tick; /* SDx, 0 = none */
+    uint8_t                                 cut_tick;   /* SCx, 0 = none */
+    uint8_t                                 mem_d,mem_ef,mem_g,mem_h,mem_i,mem_j,mem_o,mem_q,mem_r; /* effect memory */
+    uint8_t                                 vib_pos,vib_wave;
+    uint8_t                                 trem_pos,trem_wave;
+    uint8_t                                 tremor_count,tremor_on;
+    uint8_t                                 retrig_count;
+    uint8_t                                 loop_row,loop_count;
+    unsigned int                            enabled:1;
+};
+
+struct modeng_song {
+    uint8_t                                 format;     /* MODENG_FMT_* */
+    char                                    title[29];
+    uint8_t                                 channels;
+    uint8_t                                 samples;
+    uint16_t                                orders;
+    uint16_t                                patterns;
+    uint8_t                                 restart;    /* order to continue from at the end of the song (if looping) */
+    uint8_t                                 init_speed,init_tempo,init_global_vol;
+    uint16_t                                min_period,max_period;
+    uint16_t                                init_pan[MODENG_MAX_CHANNELS];
+    uint8_t                                 order[MODENG_MAX_ORDERS];       /* 0xFF end, 0xFE skip */
+    struct modeng_cell*                     pattern;    /* patterns * MODENG_ROWS * channels */
+    struct modeng_sample                    sample[MODENG_MAX_SAMPLES];
+
+    /* output */
+    uint32_t                                rate;
+    uint8_t                                 interpolate;    /* linear interpolation (else nearest) */
+    uint8_t                                 separation;     /* stereo separation, percent */
+    uint8_t                                 loop;           /* play forever instead of stopping at the end */
+    uint16_t                                amp;            /* master amplification, 8.8 */
+    unsigned int                            ramp_frames;
+
+    /* playback */
+    struct modeng_channel                   chan[MODENG_MAX_CHANNELS];
+    uint16_t                                cur_order;
+    uint8_t                                 cur_row;
+    uint8_t                                 tick;
+    uint8_t                                 speed,tempo,global_vol;
+    uint8_t                                 pattern_delay;
+    uint8_t                                 in_pattern_delay;
+    int16_t                                 jump_order;     /* -1 = none */
+    int16_t                                 break_row;      /* -1 = none */
+    int16_t                                 loop_jump_row;  /* -1 = none */
+    uint32_t                                tick_frames_left;
+    uint32_t                                tick_rem;
+    uint64_t                                position;       /* frames rendered since restart */
+    uint8_t                                 ended;
+    uint8_t                                 end_pending;
+    uint8_t                                 visited[MODENG_MAX_ORDERS * MODENG_ROWS / 8];
+
+    int32_t                                 mixbuf[MODENG_MIX_FRAMES * 2];
+};
+
+extern const char *modeng_format_str[];
+extern const uint16_t modeng_finetune_c2spd[16];
+
+/* modload.c */
+int modeng_load(struct modeng_song *s,const char *path);
+void modeng_free(struct modeng_song *s);
+
+/* modeng.c */
+void modeng_set_output(struct modeng_song *s,uint32_t rate,unsigned char interpolate);
+void modeng_restart(struct modeng_song *s);
+uint32_t modeng_render(struct modeng_song *s,int16_t *out,uint32_t frames);
+uint32_t modeng_skip(struct modeng_song *s,uint32_t frames);
+uint64_t modeng_length(struct modeng_song *s);
+uint16_t modeng_note_period(uint8_t note,uint32_t c2spd);
+uint8_t modeng_period_note(uint16_t period);
+
+/* modmix.c */
+void modmix_voice(struct modmix_voice *v,int32_t *acc,unsigned int frames,unsigned char interpolate);
+void modmix_voice_skip(struct modmix_voice *v,uint32_t frames);
+void modmix_set_gain(struct modmix_voice *v,int32_t gain_l,int32_t gain_r,unsigned int ramp_frames);
+void modmix_output(int16_t *out,const int32_t *acc,unsigned int frames,unsigned int amp);
+
@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "dosamp.h"
+#include "modeng.h"
+
+#if defined(HAS_TRACKER)
+
+#ifndef O_BINARY
+#define O_BINARY (0)
+#endif
+
+/* MOD and S3M loaders. The file is read into memory whole, parsed, and converted to the internal form
+ * described in modeng.h. Anything that points outside the file is treated as missing data, not an error,
+ * since truncated modules are common. */
+
+static uint16_t mod_be16(const unsigned char *p) {
+    return (uint16_t)(((unsigned int)p[0] << 8u) | (unsigned int)p[1]);
+}
+
+static uint16_t mod_le16(const unsigned char *p) {
+    return (uint16_t)(((unsigned int)p[1] << 8u) | (unsigned int)p[0]);
+}
+
+static uint32_t mod_le32(const unsigned char *p) {
+    return ((uint32_t)p[3] << 24UL) | ((uint32_t)p[2] << 16UL) | ((uint32_t)p[1] << 8UL) | (uint32_t)p[0];
+}
+
+static void mod_copy_name(char *d,const unsigned char *s,const unsigned int len) {
+    unsigned int i;
+
+    for (i=0;i < len && s[i] != 0;i++)
+        d[i] = (s[i] >= 32 && s[i] < 127) ? (char)s[i] : ' ';
+
+    while (i > 0 && d[i-1] == ' ') i--;
+    d[i] = 0;
+}
+
+static unsigned char *mod_read_file(const char *path,size_t *len) {
+    unsigned char *buf;
+    long sz;
+    int fd;
+
+    fd = open(path,O_RDONLY|O_BINARY);
+    if (fd < 0) return NULL;
+
+    sz = (long)lseek(fd,0,SEEK_END);
+    if (sz <= 0L || sz > (64L << 20L) || lseek(fd,0,SEEK_SET) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    buf = malloc((size_t)sz);
+    if (buf == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    if (read(fd,buf,(size_t)sz) != (int)sz) {
+        free(buf);
+        close(fd);
+        return NULL;
+    }
+
+    close(fd);
+    *len = (size_t)sz;
+    return buf;
+}
+
+/* copy (and convert) sample data, cut the sample at the loop end, add the guard sample */
+static int mod_load_sample_data(struct modeng_sample *sm,const unsigned char *buf,size_t buflen,size_t ofs,uint32_t loop_end,const unsigned char is_unsigned) {
+    const uint32_t bps = sm->bits / 8u;
+    uint32_t avail,i;
+
+    if (sm->loop) {
+        if (loop_end > sm->length) loop_end = sm->length;
+        if (sm->loop_start >= loop_end) sm->loop = 0;
+        else sm->length = loop_end;
+    }
+
+    if (ofs >= buflen) return 0; /* no data at all */
+    avail = (uint32_t)((buflen - ofs) / bps);
+    if (sm->length > avail) sm->length = avail; /* truncated file */
+    if (sm->loop && sm->loop_start >= sm->length) sm->loop = 0;
+    if (sm->length == 0UL) return 0;
+
+    sm->data = malloc((size_t)(sm->length + 1UL) * bps);
+    if (sm->data == NULL) return -1;
+
+    if (sm->bits == 16) {
+        int16_t *d = (int16_t*)sm->data;
+        const uint16_t x = is_unsigned ? 0x8000u : 0u;
+
+        for (i=0;i < sm->length;i++) d[i] = (int16_t)(mod_le16(buf + ofs + (i * 2UL)) ^ x);
+        d[sm->length] = sm->loop ? d[sm->loop_start] : 0;
+    }
+    else {
+        int8_t *d = (int8_t*)sm->data;
+        const uint8_t x = is_unsigned ? 0x80u : 0u;
+
+        for (i=0;i < sm->length;i++) d[i] = (int8_t)(buf[ofs + i] ^ x);
+        d[sm->length] = sm->loop ? d[sm->loop_start] : 0;
+    }
+
+    return 0;
+}
+
+/* ProTracker Axy/5xy/6xy (up if x, else down) as S3M Dxy */
+static uint8_t mod_volslide(const uint8_t param) {
+    return (param & 0xF0u) ? (param & 0xF0u) : (param & 0x0Fu);
+}
+
+static void mod_convert_effect(struct modeng_cell *c,const uint8_t fx,const uint8_t param) {
+    const uint8_t x = param & 0xFu;
+
+    c->cmd = MODENG_FX_NONE;
+    c->info = param;
+
+    switch (fx) {
+        case 0x0: if (param != 0) c->cmd = MODENG_FX_J; break;
+        /* 1xx/2xx have no memory. E0-FF would be read as fine slides, and slide that fast is unusable anyway */
+        case 0x1: if (param != 0) { c->cmd = MODENG_FX_F; if (param >= 0xE0u) c->info = 0xDF; } break;
+        case 0x2: if (param != 0) { c->cmd = MODENG_FX_E; if (param >= 0xE0u) c->info = 0xDF; } break;
+        case 0x3: c->cmd = MODENG_FX_G; break;
+        case 0x4: c->cmd = MODENG_FX_H; break;
+        case 0x5: c->cmd = MODENG_FX_L; c->info = mod_volslide(param); break;
+        case 0x6: c->cmd = MODENG_FX_K; c->info = mod_volslide(param); break;
+        case 0x7: c->cmd = MODENG_FX_R; break;
+        case 0x8: c->cmd = MODENG_FX_X; c->info = (param == 0xFFu) ? 0x80u : (param >> 1u); break;
+        case 0x9: c->cmd = MODENG_FX_O; break;
+        case 0xA: if (param != 0) { c->cmd = MODENG_FX_D; c->info = mod_volslide(param); } break;
+        case 0xB: c->cmd = MODENG_FX_B; break;
+        case 0xC: c->vol = (param > 64u) ? 64u : param; break;
+        case 0xD: c->cmd = MODENG_FX_C; c->info = (uint8_t)(((param >> 4u) * 10u) + (param & 0xFu)); break;
+        case 0xE:
+            switch (param >> 4u) {
+                case 0x1: if (x != 0) { c->cmd = MODENG_FX_F; c->info = 0xF0u | x; } break;
+                case 0x2: if (x != 0) { c->cmd = MODENG_FX_E; c->info = 0xF0u | x; } break;
+                case 0x4: c->cmd = MODENG_FX_S; c->info = 0x30u | x; break;
+                case 0x5: c->cmd = MODENG_FX_S; c->info = 0x20u | ((x + 8u) & 0xFu); break;
+                case 0x6: c->cmd = MODENG_FX_S; c->info = 0xB0u | x; break;
+                case 0x7: c->cmd = MODENG_FX_S; c->info = 0x40u | x; break;
+                case 0x8: c->cmd = MODENG_FX_S; c->info = 0x80u | x; break;
+                case 0x9: if (x != 0) { c->cmd = MODENG_FX_Q; c->info = x; } break;
+                case 0xA: if (x != 0) { c->cmd = MODENG_FX_D; c->info = (uint8_t)((x << 4u) | 0xFu); } break;
+                case 0xB: if (x != 0) { c->cmd = MODENG_FX_D; c->info = 0xF0u | x; } break;
+                case 0xC: c->cmd = MODENG_FX_S; c->info = 0xC0u | x; break;
+                case 0xD: c->cmd = MODENG_FX_S; c->info = 0xD0u | x; break;
+                case 0xE: c->cmd = MODENG_FX_S; c->info = 0xE0u | x; break;
+                default: break; /* E0x filter, E3x glissando, EFx invert loop */
+            }
+            break;
+        case 0xF:
+            if (param == 0) break;
+            c->cmd = (param < 0x20u) ? MODENG_FX_A : MODENG_FX_T;
+            break;
+        default:
+            break;
+    }
+}
+
+static int modeng_load_mod(struct modeng_song *s,const unsigned char *buf,const size_t len) {
+    unsigned int i,j,channels = 0,samples = 31;
+    size_t hdr,ofs,pat_bytes;
+
+    if (len < 1084) return -1;
+
+    {
+        const unsigned char *sig = buf + 1080;
+
+        if (!memcmp(sig,"M.K.",4) || !memcmp(sig,"M!K!",4) || !memcmp(sig,"FLT4",4) || !memcmp(sig,"4CHN",4))
+            channels = 4;
+        else if (!memcmp(sig,"OKTA",4) || !memcmp(sig,"CD81",4))
+            channels = 8;
+        else if (sig[0] >= '1' && sig[0] <= '9' && !memcmp(sig+1,"CHN",3))
+            channels = sig[0] - '0';
+        else if (sig[0] >= '1' && sig[0] <= '9' && sig[1] >= '0' && sig[1] <= '9' && !memcmp(sig+2,"CH",2))
+            channels = ((sig[0] - '0') * 10u) + (sig[1] - '0');
+    }
+
+    if (channels == 0) {
+        /* no signature: maybe an old 15-sample Soundtracker module. there is nothing to identify those
+         * by, so check that the header makes sense. FLT8 is not supported. */
+        samples = 15;
+        channels = 4;
+
+        if (buf[470] == 0 || buf[470] > 128) return -1;
+        for (i=0;i < 15;i++) {
+            if (buf[20 + (i * 30u) + 25] > 64u) return -1;
+        }
+        for (i=0;i < 128;i++) {
+            if (buf[472+i] >= 64u) return -1;
+        }
+    }
+
+    if (channels > MODENG_MAX_CHANNELS) return -1;
+
+    /* header: title, samples, song length, restart, 128 orders, signature */
+    hdr = 20u + (samples * 30u);
+
+    s->format = MODENG_FMT_MOD;
+    s->channels = channels;
+    s->samples = samples;
+    mod_copy_name(s->title,buf,20);
+
+    s->orders = buf[hdr];
+    if (s->orders == 0 || s->orders > 128) return -1;
+    s->restart = (buf[hdr+1] < s->orders) ? buf[hdr+1] : 0;
+    for (i=0;i < 128;i++) {
+        s->order[i] = buf[hdr+2+i];
+        if (s->order[i] >= s->patterns) s->patterns = s->order[i] + 1u;
+    }
+    /* orders past the song length do not count as the end of the song */
+    for (i=s->orders;i < MODENG_MAX_ORDERS;i++) s->order[i] = 0xFF;
+
+    /* 4 channel MODs are Amiga ProTracker: hard panned L R R L, 3 octaves (with finetune) */
+    for (i=0;i < channels;i++)
+        s->init_pan[i] = ((i & 3u) == 0u || (i & 3u) == 3u) ? 0 : 256;
+
+    if (channels == 4) {
+        s->min_period = 107u * 4u;
+        s->max_period = 907u * 4u;
+    }
+    else {
+        s->min_period = 32u;
+        s->max_period = 0xFFFFu;
+    }
+
+    s->init_speed = 6;
+    s->init_tempo = 125;
+    s->init_global_vol = 64;
+
+    /* patterns */
+    ofs = hdr + 2u + 128u + ((samples == 31u) ? 4u : 0u);
+    pat_bytes = (size_t)MODENG_ROWS * channels * 4u;
+    s->pattern = malloc((size_t)s->patterns * MODENG_ROWS * channels * sizeof(struct modeng_cell));
+    if (s->pattern == NULL) return -1;
+
+    for (i=0;i < (unsigned int)s->patterns * MODENG_ROWS * channels;i++) {
+        struct modeng_cell *c = &s->pattern[i];
+        const unsigned char *p = buf + ofs + ((size_t)i * 4u);
+        uint16_t period;
+
+        c->note = MODENG_NOTE_NONE;
+        c->ins = 0;
+        c->vol = MODENG_VOL_NONE;
+        c->cmd = MODENG_FX_NONE;
+        c->info = 0;
+
+        if ((ofs + ((size_t)i * 4u) + 4u) > len) continue;
+
+        c->ins = (p[0] & 0xF0u) | (p[2] >> 4u);
+        period = ((p[0] & 0x0Fu) << 8u) | p[1];
+        if (period != 0) c->note = modeng_period_note(period * 4u);
+        mod_convert_effect(c,p[2] & 0x0Fu,p[3]);
+    }
+    ofs += pat_bytes * s->patterns;
+
+    /* samples */
+    for (i=0;i < samples;i++) {
+        const unsigned char *h = buf + 20 + (i * 30u);
+        struct modeng_sample *sm = &s->sample[i];
+        const uint32_t loop_len = (uint32_t)mod_be16(h+28) * 2UL;
+
+        mod_copy_name(sm->name,h,22);
+        sm->length = (uint32_t)mod_be16(h+22) * 2UL;
+        sm->c2spd = modeng_finetune_c2spd[((h[24] & 0xFu) + 8u) & 0xFu];
+        sm->volume = (h[25] > 64u) ? 64u : h[25];
+        sm->bits = 8;
+        sm->loop_start = (uint32_t)mod_be16(h+26) * 2UL;
+        sm->loop = (loop_len > 2UL);
+
+        j = (unsigned int)sm->length;
+        if (mod_load_sample_data(sm,buf,len,ofs,sm->loop_start + loop_len,0) < 0) return -1;
+        ofs += j;
+    }
+
+    return 0;
+}
+
+static uint8_t s3m_note(const uint8_t n) {
+    if (n == 0xFFu) return MODENG_NOTE_NONE;
+    if (n == 0xFEu) return MODENG_NOTE_CUT;
+    if ((n & 0xFu) >= 12u || (n >> 4u) >= 10u) return MODENG_NOTE_NONE;
+    return (uint8_t)(((n >> 4u) * 12u) + (n & 0xFu));
+}
+
+static int modeng_load_s3m(struct modeng_song *s,const unsigned char *buf,const size_t len) {
+    signed char chmap[32];
+    unsigned int ordnum,insnum,patnum,ffi,i,row;
+    size_t ofs,p,end;
+    unsigned char dp,mv;
+
+    if (len < 0x60 || buf[0x1C] != 0x1A || buf[0x1D] != 16 || memcmp(buf+0x2C,"SCRM",4)) return -1;
+
+    ordnum = mod_le16(buf+0x20);
+    insnum = mod_le16(buf+0x22);
+    patnum = mod_le16(buf+0x24);
+    ffi = mod_le16(buf+0x2A);
+    mv = buf[0x33];
+    dp = buf[0x35];
+
+    if (ordnum > MODENG_MAX_ORDERS || insnum > MODENG_MAX_SAMPLES || patnum > 255u) return -1;
+    if ((0x60UL + ordnum + (insnum * 2UL) + (patnum * 2UL)) > len) return -1;
+
+    s->format = MODENG_FMT_S3M;
+    mod_copy_name(s->title,buf,28);
+
+    /* enabled channels (settings 0-15) get packed together */
+    for (i=0;i < 32;i++) {
+        const uint8_t cs = buf[0x40+i];
+
+        chmap[i] = -1;
+        if (cs < 16u && s->channels < MODENG_MAX_CHANNELS) {
+            chmap[i] = (signed char)s->channels;
+            if (mv & 0x80u)
+                s->init_pan[s->channels] = (cs < 8u) ? ((3u * 256u) / 15u) : ((12u * 256u) / 15u);
+            else
+                s->init_pan[s->channels] = 128;
+
+            if (dp == 252u && (0x60UL + ordnum + (insnum * 2UL) + (patnum * 2UL) + 32UL) <= len) {
+                const uint8_t pb = buf[0x60 + ordnum + (insnum * 2u) + (patnum * 2u) + i];
+
+                if (pb & 0x20u) s->init_pan[s->channels] = (uint16_t)(((pb & 0xFu) * 256u) / 15u);
+            }
+
+            s->channels++;
+        }
+    }
+    if (s->channels == 0) return -1;
+
+    s->orders = ordnum;
+    for (i=0;i < MODENG_MAX_ORDERS;i++)
+        s->order[i] = (i < ordnum) ? buf[0x60+i] : 0xFF;
+
+    s->init_speed = (buf[0x31] != 0) ? buf[0x31] : 6;
+    s->init_tempo = (buf[0x32] >= 0x20) ? buf[0x32] : 125;
+    s->init_global_vol = (buf[0x30] > 64u) ? 64u : buf[0x30];
+    s->min_period = 32u;
+    s->max_period = 0xFFFFu;
+
+    /* samples */
+    s->samples = insnum;
+    for (i=0;i < insnum;i++) {
+        struct modeng_sample *sm = &s->sample[i];
+        uint32_t loop_end;
+        uint8_t flags;
+
+        p = (size_t)mod_le16(buf + 0x60 + ordnum + (i * 2u)) << 4u;
+        if ((p + 0x50u) > len || buf[p] != 1u) continue; /* empty or AdLib instrument */
+
+        mod_copy_name(sm->name,buf+p+0x30,28);
+        flags = buf[p+0x1F];
+        sm->bits = (flags & 4u) ? 16 : 8;
+        sm->length = mod_le32(buf+p+0x10);
+        sm->loop_start = mod_le32(buf+p+0x14);
+        loop_end = mod_le32(buf+p+0x18);
+        sm->loop = (flags & 1u) ? 1 : 0;
+        sm->volume = (buf[p+0x1C] > 64u) ? 64u : buf[p+0x1C];
+        sm->c2spd = mod_le32(buf+p+0x20);
+        if (sm->c2spd == 0UL || sm->c2spd > 0xFFFFUL) sm->c2spd = 8363UL;
+        if (buf[p+0x1E] != 0) continue; /* packed (DP30ADPCM) samples are not supported */
+
+        /* stereo samples store the left channel first, which is all we play */
+        ofs = (((size_t)buf[p+0x0D] << 16u) | (size_t)mod_le16(buf+p+0x0E)) << 4u;
+        if (mod_load_sample_data(sm,buf,len,ofs,loop_end,(ffi != 1u)) < 0) return -1;
+    }
+
+    /* patterns */
+    s->patterns = patnum;
+    s->pattern = malloc(((size_t)patnum * MODENG_ROWS * s->channels * sizeof(struct modeng_cell)) + 1u);
+    if (s->pattern == NULL) return -1;
+
+    for (i=0;i < (unsigned int)patnum * MODENG_ROWS * s->channels;i++) {
+        s->pattern[i].note = MODENG_NOTE_NONE;
+        s->pattern[i].ins = 0;
+        s->pattern[i].vol = MODENG_VOL_NONE;
+        s->pattern[i].cmd = MODENG_FX_NONE;
+        s->pattern[i].info = 0;
+    }
+
+    for (i=0;i < patnum;i++) {
+        p = (size_t)mod_le16(buf + 0x60 + ordnum + (insnum * 2u) + (i * 2u)) << 4u;
+        if (p == 0 || (p + 2u) > len) continue;
+
+        end = p + 2u + mod_le16(buf+p);
+        if (end > len) end = len;
+        p += 2u;
+
+        for (row=0;row < MODENG_ROWS && p < end;) {
+            struct modeng_cell dummy,*c;
+            const uint8_t what = buf[p++];
+
+            if (what == 0) {
+                row++;
+                continue;
+            }
+
+            if (chmap[what & 31u] >= 0)
+                c = &s->pattern[(((size_t)i * MODENG_ROWS) + row) * s->channels + (size_t)chmap[what & 31u]];
+            else
+                c = &dummy;
+
+            if (what & 0x20u) {
+                if ((p + 2u) > end) break;
+                c->note = s3m_note(buf[p]);
+                c->ins = buf[p+1];
+                p += 2u;
+            }
+            if (what & 0x40u) {
+                if ((p + 1u) > end) break;
+                c->vol = (buf[p] <= 64u) ? buf[p] : MODENG_VOL_NONE;
+                p++;
+            }
+            if (what & 0x80u) {
+                if ((p + 2u) > end) break;
+                c->cmd = (buf[p] < MODENG_FX_MAX) ? buf[p] : MODENG_FX_NONE;
+                c->info = buf[p+1];
+                if (c->cmd == MODENG_FX_C) c->info = (uint8_t)(((c->info >> 4u) * 10u) + (c->info & 0xFu));
+                p += 2u;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static unsigned int mod_isqrt(unsigned int x) {
+    unsigned int r = 0;
+
+    while (((r + 1u) * (r + 1u)) <= x) r++;
+    return r;
+}
+
+int modeng_load(struct modeng_song *s,const char *path) {
+    unsigned char *buf;
+    size_t len = 0;
+    int r;
+
+    memset(s,0,sizeof(*s));
+
+    if ((buf=mod_read_file(path,&len)) == NULL) return -1;
+
+    r = modeng_load_s3m(s,buf,len);
+    if (r < 0 && s->format == MODENG_FMT_NONE) r = modeng_load_mod(s,buf,len);
+    free(buf);
+
+    if (r < 0 || s->channels == 0) {
+        modeng_free(s);
+        return -1;
+    }
+
+    /* headroom for the channels playing at once: 1.4 / sqrt(channels) */
+    s->amp = (uint16_t)(362u / mod_isqrt(s->channels));
+    s->separation = 100;
+    modeng_set_output(s,44100UL,1);
+    modeng_restart(s);
+    return 0;
+}
+
+void modeng_free(struct modeng_song *s) {
+    unsigned int i;
+
+    for (i=0;i < MODENG_MAX_SAMPLES;i++) {
+        if (s->sample[i].data != NULL) {
+            free(s->sample[i].data);
+            s->sample[i].data = NULL;
+        }
+    }
+
+    if (s->pattern != NULL) {
+        free(s->pattern);
+        s->pattern = NULL;
+    }
+
+    s->format = MODENG_FMT_NONE;
+    s->channels = 0;
+}
+
+#endif /* HAS_TRACKER */
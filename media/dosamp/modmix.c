@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dosamp.h"
+#include "modeng.h"
+
+#if defined(HAS_TRACKER)
+
+/* Fixed point software mixer.
+ *
+ * Each voice steps through its sample with a 16.16 step and adds sample * gain into a 32-bit stereo
+ * accumulator. Gains are 0-65536 (volume 0-64 x global volume 0-64 x pan 0-256 >> 4), so one 8-bit
+ * voice at full volume adds up to 2^23 and 256 voices can be summed without overflow. 16-bit samples
+ * use the gain shifted down by 8 so they land on the same scale.
+ *
+ * The voice is mixed in segments that never cross the end of the sample or a loop point, and never
+ * cross the end of a volume ramp, so that the inner loops (mmixloop.h) need no checks at all. */
+
+typedef void (*modmix_run_t)(struct modmix_voice *v,int32_t *acc,unsigned int n);
+
+static void modmix_run_8(struct modmix_voice *v,int32_t *acc,unsigned int n) {
+#define mix_sample_t int8_t
+#define mix_gain_shift 0
+#define mix_interp 0
+#define mix_ramp 0
+#include "mmixloop.h"
+}
+
+static void modmix_run_8_ramp(struct modmix_voice *v,int32_t *acc,unsigned int n) {
+#define mix_sample_t int8_t
+#define mix_gain_shift 0
+#define mix_interp 0
+#define mix_ramp 1
+#include "mmixloop.h"
+}
+
+static void modmix_run_8_interp(struct modmix_voice *v,int32_t *acc,unsigned int n) {
+#define mix_sample_t int8_t
+#define mix_gain_shift 0
+#define mix_interp 1
+#define mix_ramp 0
+#include "mmixloop.h"
+}
+
+static void modmix_run_8_interp_ramp(struct modmix_voice *v,int32_t *acc,unsigned int n) {
+#define mix_sample_t int8_t
+#define mix_gain_shift 0
+#define mix_interp 1
+#define mix_ramp 1
+#include "mmixloop.h"
+}
+
+static void modmix_run_16(struct modmix_voice *v,int32_t *acc,unsigned int n) {
+#define mix_sample_t int16_t
+#define mix_gain_shift 8
+#define mix_interp 0
+#define mix_ramp 0
+#include "mmixloop.h"
+}
+
+static void modmix_run_16_ramp(struct modmix_voice *v,int32_t *acc,unsigned int n) {
+#define mix_sample_t int16_t
+#define mix_gain_shift 8
+#define mix_interp 0
+#define mix_ramp 1
+#include "mmixloop.h"
+}
+
+static void modmix_run_16_interp(struct modmix_voice *v,int32_t *acc,unsigned int n) {
+#define mix_sample_t int16_t
+#define mix_gain_shift 8
+#define mix_interp 1
+#define mix_ramp 0
+#include "mmixloop.h"
+}
+
+static void modmix_run_16_interp_ramp(struct modmix_voice *v,int32_t *acc,unsigned int n) {
+#define mix_sample_t int16_t
+#define mix_gain_shift 8
+#define mix_interp 1
+#define mix_ramp 1
+#include "mmixloop.h"
+}
+
+/* index: (16-bit ? 4 : 0) + (interpolate ? 2 : 0) + (ramp ? 1 : 0) */
+static const modmix_run_t modmix_run[8] = {
+    modmix_run_8,
+    modmix_run_8_ramp,
+    modmix_run_8_interp,
+    modmix_run_8_interp_ramp,
+    modmix_run_16,
+    modmix_run_16_ramp,
+    modmix_run_16_interp,
+    modmix_run_16_interp_ramp
+};
+
+static void modmix_end_ramp(struct modmix_voice *v) {
+    v->ramp = 0;
+    v->gain_l = v->target_l;
+    v->gain_r = v->target_r;
+    if (v->stop_after_ramp) {
+        v->stop_after_ramp = 0;
+        v->active = 0;
+    }
+}
+
+/* wrap around the loop, or stop at the end. returns 0 if the voice stopped */
+static int modmix_wrap(struct modmix_voice *v) {
+    if (v->pos >= v->end) {
+        if (!v->loop || v->end <= v->loop_start) {
+            v->active = 0;
+            return 0;
+        }
+
+        v->pos = v->loop_start + ((v->pos - v->end) % (v->end - v->loop_start));
+    }
+
+    return 1;
+}
+
+void modmix_voice(struct modmix_voice *v,int32_t *acc,unsigned int frames,unsigned char interpolate) {
+    unsigned int n,idx;
+    uint32_t remain,avail;
+
+    while (frames > 0 && v->active) {
+        if (!modmix_wrap(v)) break;
+
+        n = frames;
+        if (v->ramp > 0 && n > v->ramp) n = v->ramp;
+
+        /* frames until pos reaches the end. capped so that (remain << 16) fits in 32 bits */
+        if (v->step != 0) {
+            remain = v->end - v->pos;
+            if (remain > 0x7FFFUL) remain = 0x7FFFUL;
+            avail = ((remain << 16UL) - v->frac + v->step - 1UL) / v->step;
+            if (n > avail) n = (unsigned int)avail;
+        }
+
+        idx = (v->bits == 16 ? 4 : 0) + (interpolate ? 2 : 0) + (v->ramp > 0 ? 1 : 0);
+        modmix_run[idx](v,acc,n);
+        acc += n * 2u;
+        frames -= n;
+
+        if (v->ramp > 0) {
+            v->ramp -= n;
+            if (v->ramp == 0) modmix_end_ramp(v);
+        }
+    }
+}
+
+/* advance the voice as if mixed, without output (seeking) */
+void modmix_voice_skip(struct modmix_voice *v,uint32_t frames) {
+    uint64_t adv;
+    uint32_t n;
+
+    if (!v->active) return;
+
+    /* the ramp moves the same as it would when mixed, so that a seek lands on the same gain */
+    if (v->ramp > 0) {
+        n = (frames < v->ramp) ? frames : v->ramp;
+        v->gain_l += v->ramp_l * (int32_t)n;
+        v->gain_r += v->ramp_r * (int32_t)n;
+        v->ramp -= n;
+        if (v->ramp == 0) modmix_end_ramp(v);
+        if (!v->active) return;
+    }
+
+    adv = ((uint64_t)v->step * (uint64_t)frames) + (uint64_t)v->frac;
+    v->frac = (uint32_t)(adv & 0xFFFFUL);
+    adv >>= (uint64_t)16;
+
+    if (v->loop && v->end > v->loop_start && ((uint64_t)v->pos + adv) >= (uint64_t)v->end) {
+        /* how far past the end, folded into the loop */
+        adv = ((uint64_t)v->pos + adv) - (uint64_t)v->end;
+        v->pos = v->loop_start + (uint32_t)(adv % (uint64_t)(v->end - v->loop_start));
+    }
+    else if (((uint64_t)v->pos + adv) >= (uint64_t)v->end) {
+        v->active = 0;
+    }
+    else {
+        v->pos += (uint32_t)adv;
+    }
+}
+
+/* set the gain (0-65536 per side), fading to it over ramp_frames */
+void modmix_set_gain(struct modmix_voice *v,int32_t gain_l,int32_t gain_r,unsigned int ramp_frames) {
+    gain_l <<= 8L;
+    gain_r <<= 8L;
+
+    if (gain_l == v->target_l && gain_r == v->target_r)
+        return;
+
+    v->target_l = gain_l;
+    v->target_r = gain_r;
+
+    if (ramp_frames == 0 || !v->active) {
+        v->ramp = 0;
+        v->gain_l = gain_l;
+        v->gain_r = gain_r;
+    }
+    else {
+        v->ramp = ramp_frames;
+        v->ramp_l = (gain_l - v->gain_l) / (int32_t)ramp_frames;
+        v->ramp_r = (gain_r - v->gain_r) / (int32_t)ramp_frames;
+    }
+}
+
+/* accumulator to 16-bit stereo. full scale for one voice (2^23) is brought down by 8 bits, then
+ * amplified by amp (8.8 fixed point), and clipped */
+void modmix_output(int16_t *out,const int32_t *acc,unsigned int frames,unsigned int amp) {
+    unsigned int i;
+    int32_t s;
+
+    for (i=0;i < (frames * 2u);i++) {
+        s = ((acc[i] >> 8L) * (int32_t)amp) >> 8L;
+        if (s > 32767L) s = 32767L;
+        else if (s < -32768L) s = -32768L;
+        out[i] = (int16_t)s;
+    }
+}
+
+#endif /* HAS_TRACKER */
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "dosamp.h"
+#include "modeng.h"
+
+#ifndef O_BINARY
+#define O_BINARY (0)
+#endif
+
+/* MOD/S3M renderer and mixer benchmark.
+ *
+ *   modrend -o out.wav song.mod       render the song to a WAV file (regression testing of the engine)
+ *   modrend -bench                    CPU cost of the mixer per channel, on this machine
+ *   modrend -bench song.mod           and the cost of rendering that song
+ *
+ * Timing uses clock(), which on MS-DOS ticks at 18.2Hz, so every measurement runs for at least 2 seconds. */
+
+#if defined(HAS_TRACKER)
+
+static struct modeng_song               song;
+
+static int16_t                          outbuf[MODENG_MIX_FRAMES * 2];
+
+static char*                            out_file = NULL;
+static char*                            in_file = NULL;
+static unsigned long                    out_rate = TRACKER_DEFAULT_RATE;
+static unsigned char                    interpolate = 1;
+static unsigned char                    separation = 100;
+static unsigned char                    bench = 0;
+
+static void help(void) {
+    printf("modrend [options] <file.mod|file.s3m>\n");
+    printf(" -o <file.wav>        Render to WAV file (16-bit stereo)\n");
+    printf(" -r <rate>            Sample rate (default %lu)\n",(unsigned long)TRACKER_DEFAULT_RATE);
+    printf(" -fast                Nearest sample, no interpolation\n");
+    printf(" -sep <percent>       Stereo separation (default 100)\n");
+    printf(" -bench               Measure mixing cost per channel (and of the song, if given)\n");
+}
+
+static int parse_argv(int argc,char **argv) {
+    char *a;
+    int i;
+
+    for (i=1;i < argc;) {
+        a = argv[i++];
+
+        if (*a == '-') {
+            do { a++; } while (*a == '-');
+
+            if (!strcmp(a,"h") || !strcmp(a,"help")) {
+                help();
+                return 0;
+            }
+            else if (!strcmp(a,"o")) {
+                if ((out_file = argv[i++]) == NULL) return 0;
+            }
+            else if (!strcmp(a,"r")) {
+                if ((a = argv[i++]) == NULL) return 0;
+                out_rate = strtoul(a,NULL,0);
+                if (out_rate < 4000UL || out_rate > 96000UL) return 0;
+            }
+            else if (!strcmp(a,"fast")) {
+                interpolate = 0;
+            }
+            else if (!strcmp(a,"sep")) {
+                if ((a = argv[i++]) == NULL) return 0;
+                separation = (unsigned char)atoi(a);
+                if (separation > 100) separation = 100;
+            }
+            else if (!strcmp(a,"bench")) {
+                bench = 1;
+            }
+            else {
+                fprintf(stderr,"Unknown switch %s\n",a);
+                return 0;
+            }
+        }
+        else {
+            if (in_file != NULL) return 0;
+            in_file = a;
+        }
+    }
+
+    if (in_file == NULL && !bench) {
+        help();
+        return 0;
+    }
+
+    return 1;
+}
+
+static void put16(unsigned char *p,const uint16_t v) {
+    p[0] = (unsigned char)(v & 0xFFu);
+    p[1] = (unsigned char)(v >> 8u);
+}
+
+static void put32(unsigned char *p,const uint32_t v) {
+    put16(p,(uint16_t)(v & 0xFFFFUL));
+    put16(p+2,(uint16_t)(v >> 16UL));
+}
+
+static void wav_header(unsigned char *h,const uint32_t rate,const uint32_t data_bytes) {
+    memcpy(h+0,"RIFF",4);
+    put32(h+4,data_bytes + 36UL);
+    memcpy(h+8,"WAVE",4);
+    memcpy(h+12,"fmt ",4);
+    put32(h+16,16);
+    put16(h+20,1);
+    put16(h+22,2);
+    put32(h+24,rate);
+    put32(h+28,rate * 4UL);
+    put16(h+32,4);
+    put16(h+34,16);
+    memcpy(h+36,"data",4);
+    put32(h+40,data_bytes);
+}
+
+static int render_wav(void) {
+    unsigned char h[44];
+    uint32_t frames = 0,n;
+    clock_t t0,t;
+    int fd;
+
+    fd = open(out_file,O_WRONLY|O_CREAT|O_TRUNC|O_BINARY,0644);
+    if (fd < 0) {
+        fprintf(stderr,"Cannot create %s\n",out_file);
+        return 1;
+    }
+
+    memset(h,0,sizeof(h));
+    write(fd,h,sizeof(h));
+
+    modeng_restart(&song);
+    t0 = clock();
+    while ((n=modeng_render(&song,outbuf,MODENG_MIX_FRAMES)) != 0UL) {
+        /* NTS: x86 is little endian, like WAV */
+        if (write(fd,outbuf,n * 4u) != (int)(n * 4u)) {
+            fprintf(stderr,"Write error\n");
+            close(fd);
+            return 1;
+        }
+        frames += n;
+    }
+    t = clock() - t0;
+
+    wav_header(h,out_rate,frames * 4UL);
+    lseek(fd,0,SEEK_SET);
+    write(fd,h,sizeof(h));
+    close(fd);
+
+    printf("%s: %lu frames (%.1f seconds) in %.2f seconds\n",out_file,
+        (unsigned long)frames,(double)frames / out_rate,(double)t / CLOCKS_PER_SEC);
+    return 0;
+}
+
+/* seconds of CPU to render one second of the song */
+static void bench_song(void) {
+    uint64_t frames = 0;
+    clock_t t0,t;
+    uint32_t n;
+
+    t0 = clock();
+    do {
+        modeng_restart(&song);
+        while ((n=modeng_render(&song,outbuf,MODENG_MIX_FRAMES)) != 0UL)
+            frames += n;
+
+        t = clock() - t0;
+    } while (t < (clock_t)(2 * CLOCKS_PER_SEC));
+
+    printf("Song: %u channels, %.1f%% CPU at %luHz (%.1fx realtime)\n",(unsigned int)song.channels,
+        (100.0 * ((double)t / CLOCKS_PER_SEC)) / ((double)frames / out_rate),out_rate,
+        ((double)frames / out_rate) / ((double)t / CLOCKS_PER_SEC));
+}
+
+#define BENCH_SAMPLE                    8192u
+#define BENCH_VOICES                    8u
+
+static int8_t                           bench_data8[BENCH_SAMPLE + 1];
+static int16_t                          bench_data16[BENCH_SAMPLE + 1];
+static int32_t                          bench_acc[MODENG_MIX_FRAMES * 2];
+
+/* percent CPU to mix one voice at out_rate, for one mixer variant. voices play a looped noise sample at
+ * C-4 (8363Hz), the usual pitch, with a volume ramp every tick (1 in 8 frames at 44100Hz, 125 BPM is
+ * ramped, more at lower rates) like a busy song would */
+static double bench_voice(const unsigned char bits,const unsigned char interp) {
+    struct modmix_voice v[BENCH_VOICES];
+    const unsigned int tick = (unsigned int)((out_rate * 5UL) / 250UL);
+    unsigned long frames = 0,since_tick = 0;
+    clock_t t0,t;
+    unsigned int i;
+
+    memset(v,0,sizeof(v));
+    for (i=0;i < BENCH_VOICES;i++) {
+        v[i].data = (bits == 16) ? (const void*)bench_data16 : (const void*)bench_data8;
+        v[i].bits = bits;
+        v[i].loop = 1;
+        v[i].end = BENCH_SAMPLE;
+        v[i].loop_start = 0;
+        v[i].pos = i * 97u;
+        v[i].step = (uint32_t)((8363ULL << 16ULL) / out_rate) + i;
+        v[i].active = 1;
+    }
+
+    t0 = clock();
+    do {
+        if (since_tick >= tick) {
+            since_tick = 0;
+            for (i=0;i < BENCH_VOICES;i++)
+                modmix_set_gain(&v[i],(int32_t)(rand() & 0x7FFF),(int32_t)(rand() & 0x7FFF),(unsigned int)(out_rate >> 9UL));
+        }
+
+        memset(bench_acc,0,sizeof(bench_acc));
+        for (i=0;i < BENCH_VOICES;i++)
+            modmix_voice(&v[i],bench_acc,MODENG_MIX_FRAMES,interp);
+
+        frames += MODENG_MIX_FRAMES;
+        since_tick += MODENG_MIX_FRAMES;
+        t = clock() - t0;
+    } while (t < (clock_t)(2 * CLOCKS_PER_SEC));
+
+    return (100.0 * ((double)t / CLOCKS_PER_SEC)) / (((double)frames * BENCH_VOICES) / out_rate);
+}
+
+/* percent CPU for the final accumulator to 16-bit pass, paid once regardless of channels */
+static double bench_output(void) {
+    unsigned long frames = 0;
+    clock_t t0,t;
+
+    memset(bench_acc,0,sizeof(bench_acc));
+    t0 = clock();
+    do {
+        modmix_output(outbuf,bench_acc,MODENG_MIX_FRAMES,256);
+        frames += MODENG_MIX_FRAMES;
+        t = clock() - t0;
+    } while (t < (clock_t)(2 * CLOCKS_PER_SEC));
+
+    return (100.0 * ((double)t / CLOCKS_PER_SEC)) / ((double)frames / out_rate);
+}
+
+static void bench_mixer(void) {
+    static const char *name[4] = { "8-bit nearest", "8-bit interpolated", "16-bit nearest", "16-bit interpolated" };
+    double out,pc;
+    unsigned int i;
+
+    for (i=0;i <= BENCH_SAMPLE;i++) {
+        bench_data8[i] = (int8_t)(rand() & 0xFF);
+        bench_data16[i] = (int16_t)(rand() & 0xFFFF);
+    }
+    bench_data8[BENCH_SAMPLE] = bench_data8[0];
+    bench_data16[BENCH_SAMPLE] = bench_data16[0];
+
+    out = bench_output();
+    printf("Mixer at %luHz stereo: output stage %.3f%% CPU\n",out_rate,out);
+
+    for (i=0;i < 4;i++) {
+        pc = bench_voice((i & 2u) ? 16 : 8,(i & 1u));
+        printf("  %-20s %7.3f%% CPU per channel, %3u channels in 50%% CPU\n",name[i],pc,
+            (pc > 0.0 && out < 50.0) ? (unsigned int)((50.0 - out) / pc) : 0u);
+    }
+}
+
+int main(int argc,char **argv) {
+    int r = 0;
+
+    if (!parse_argv(argc,argv))
+        return 1;
+
+    if (in_file != NULL) {
+        if (modeng_load(&song,in_file) < 0) {
+            fprintf(stderr,"Cannot load %s\n",in_file);
+            return 1;
+        }
+
+        song.separation = separation;
+        modeng_set_output(&song,out_rate,interpolate);
+
+        printf("%s: %s, %u channels, %u orders, %u patterns, %u samples, \"%s\"\n",in_file,
+            modeng_format_str[song.format],(unsigned int)song.channels,(unsigned int)song.orders,
+            (unsigned int)song.patterns,(unsigned int)song.samples,song.title);
+        printf("Length: %.1f seconds\n",(double)modeng_length(&song) / out_rate);
+
+        if (out_file != NULL)
+            r = render_wav();
+    }
+
+    if (bench) {
+        bench_mixer();
+        if (in_file != NULL) bench_song();
+    }
+
+    if (in_file != NULL)
+        modeng_free(&song);
+
+    return r;
+}
+
+#else
+
+int main(int argc,char **argv) {
+    (void)argc;
+    (void)argv;
+
+    printf("The tracker engine is not available on this platform\n");
+    return 1;
+}
+
+#endif /* HAS_TRACKER */
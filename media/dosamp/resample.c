@@ -63,6 +63,10 @@ int resampler_init(struct resampler_state_t *r,struct wav_cbr_t * const d,const
     if (d->sample_rate == 0 || s->sample_rate == 0)
         return -1;
 
+#if defined(HAS_RESAMPLE_SIMD)
+    resample_simd_detect();
+#endif
+
     if (d->number_of_channels == 0 || s->number_of_channels == 0)
         return -1;
     if (d->number_of_channels > resample_max_channels || s->number_of_channels > resample_max_channels)
@@ -57,6 +57,20 @@ static inline int resample_interpolate_generic(const unsigned int channel) {
     return (int)tmp;
 }
 
+#if defined(HAS_RESAMPLE_SIMD)
+enum {
+    resample_simd_none=0,
+    resample_simd_sse2,
+    resample_simd_avx2
+};
+
+extern unsigned char                    resample_simd_level;
+
+void resample_simd_detect(void);
+int resample_simd_use(const unsigned int mode,const unsigned int bits,const unsigned int channels);
+uint32_t resample_simd_linear(void *dst,const unsigned int dst_bits,const unsigned int src_bits,const unsigned int channels,const uint32_t samples);
+#endif
+
 void resampler_state_reset(struct resampler_state_t *r);
 int resampler_init(struct resampler_state_t *r,struct wav_cbr_t * const d,const struct wav_cbr_t * const s);
 
@@ -0,0 +1,156 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dosamp.h"
+#include "cvrdbuf.h"
+#include "resample.h"
+
+/* resampler microbenchmark (Linux host).
+ * runs every resampler mode over the same random source with the scalar code and with each SIMD
+ * kernel the CPU supports, reports output samples per second and checks that the output is identical. */
+
+struct convert_rdbuf_t                          convert_rdbuf = {NULL,0,0,0};
+struct wav_cbr_t                                file_codec;
+struct wav_cbr_t                                play_codec;
+
+#define SRC_BYTES                               (256U * 1024U)
+
+static unsigned char                            src_buf[SRC_BYTES];
+static unsigned char                            out_buf[3][SRC_BYTES * 8U];
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1000000000.0);
+}
+
+static uint32_t run_chunk(const unsigned int mode,const unsigned int bits,const unsigned int channels,unsigned char *out,const uint32_t max) {
+    if (mode == resample_fast) {
+        if (bits == 16)
+            return (channels == 2) ? convert_rdbuf_resample_fast_to_16_stereo((int16_t*)out,max) : convert_rdbuf_resample_fast_to_16_mono((int16_t*)out,max);
+        else
+            return (channels == 2) ? convert_rdbuf_resample_fast_to_8_stereo(out,max) : convert_rdbuf_resample_fast_to_8_mono(out,max);
+    }
+    else if (mode == resample_good) {
+        if (bits == 16)
+            return (channels == 2) ? convert_rdbuf_resample_to_16_stereo((int16_t*)out,max) : convert_rdbuf_resample_to_16_mono((int16_t*)out,max);
+        else
+            return (channels == 2) ? convert_rdbuf_resample_to_8_stereo(out,max) : convert_rdbuf_resample_to_8_mono(out,max);
+    }
+    else {
+        if (bits == 16)
+            return (channels == 2) ? convert_rdbuf_resample_best_to_16_stereo((int16_t*)out,max) : convert_rdbuf_resample_best_to_16_mono((int16_t*)out,max);
+        else
+            return (channels == 2) ? convert_rdbuf_resample_best_to_8_stereo(out,max) : convert_rdbuf_resample_best_to_8_mono(out,max);
+    }
+}
+
+/* dosamp asks for output a tmpbuffer at a time. use an odd size so that the state carried from one
+ * call to the next gets exercised at every possible phase */
+static uint32_t run_once(const unsigned int mode,const unsigned int bits,const unsigned int channels,unsigned char *out) {
+    const uint32_t chunk = 1021;
+    uint32_t total = 0,r;
+
+    convert_rdbuf.pos = 0;
+    resampler_state_reset(&resample_state);
+
+    do {
+        r = run_chunk(mode,bits,channels,out + ((size_t)total * (bits / 8U) * channels),chunk);
+        total += r;
+    } while (r == chunk);
+
+    return total;
+}
+
+/* returns output samples per second, and the output in out */
+static double bench(const unsigned int mode,const unsigned int bits,const unsigned int channels,unsigned char *out,uint32_t *count) {
+    double t0,t;
+    uint32_t total = 0;
+    unsigned int loops = 0;
+
+    t0 = now();
+    do {
+        total += (*count = run_once(mode,bits,channels,out));
+        loops++;
+        t = now() - t0;
+    } while (t < 0.25 || loops < 4);
+
+    return (double)total / t;
+}
+
+int main(int argc,char **argv) {
+    static const char *mode_name[resample_MAX] = { "fast", "good", "best" };
+    static const char *level_name[3] = { "scalar", "sse2", "avx2" };
+    static const unsigned long rates[][2] = {
+        { 11025, 44100 },
+        { 22050, 48000 },
+        { 44100, 48000 },
+        { 48000, 22050 }
+    };
+    unsigned int ri,mode,bits,channels,simd;
+    struct wav_cbr_t s,d;
+    double rate[3];
+    uint32_t count[3];
+    unsigned char level;
+    int fail = 0,same;
+    size_t i;
+
+    (void)argc;
+    (void)argv;
+
+    srand(1234);
+    for (i=0;i < SRC_BYTES;i++) src_buf[i] = (unsigned char)rand();
+
+    convert_rdbuf.buffer = src_buf;
+    convert_rdbuf.size = SRC_BYTES;
+    convert_rdbuf.len = SRC_BYTES;
+
+    resample_simd_detect();
+    level = resample_simd_level;
+    printf("SIMD level: %s\n",level == resample_simd_avx2 ? "AVX2" : (level == resample_simd_sse2 ? "SSE2" : "none"));
+
+    for (ri=0;ri < (sizeof(rates) / sizeof(rates[0]));ri++) {
+        for (mode=0;mode < resample_MAX;mode++) {
+            for (bits=8;bits <= 16;bits += 8) {
+                for (channels=1;channels <= 2;channels++) {
+                    memset(&s,0,sizeof(s));
+                    s.sample_rate = rates[ri][0];
+                    s.number_of_channels = channels;
+                    s.bits_per_sample = bits;
+                    d = s;
+                    d.sample_rate = rates[ri][1];
+
+                    printf("%5lu -> %5lu %s %2u-bit %s:",
+                        rates[ri][0],rates[ri][1],mode_name[mode],bits,channels == 2 ? "stereo" : "mono  ");
+
+                    for (simd=resample_simd_none;simd <= level;simd++) {
+                        resample_state.resample_mode = mode;
+                        resampler_init(&resample_state,&d,&s);
+                        resample_simd_level = simd;
+                        rate[simd] = bench(mode,bits,channels,out_buf[simd],&count[simd]);
+
+                        same = (count[0] == count[simd] && memcmp(out_buf[0],out_buf[simd],(size_t)count[0] * (bits / 8U) * channels) == 0);
+                        if (!same) fail = 1;
+
+                        if (simd == resample_simd_none)
+                            printf(" %s %7.1f Msamples/s",level_name[simd],rate[simd] / 1000000.0);
+                        else if (mode == resample_fast) /* no SIMD kernel, this only checks the output */
+                            printf(", %s n/a%s",level_name[simd],same ? "" : " MISMATCH");
+                        else
+                            printf(", %s x%.2f%s%s",level_name[simd],rate[simd] / rate[0],
+                                resample_simd_use(mode,bits,channels) ? "" : " (not used)",same ? "" : " MISMATCH");
+                    }
+                    printf("\n");
+                }
+            }
+        }
+    }
+
+    return fail;
+}
+
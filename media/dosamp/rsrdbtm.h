@@ -19,6 +19,17 @@
         LOAD();
     }
 
+#if defined(HAS_RESAMPLE_SIMD)
+    if (resample_simd_use(resample_good,sizeof(sample_type_t) * 8u,sample_channels)) {
+        const uint32_t n = resample_simd_linear(dst,sizeof(sample_type_t) * 8u,sizeof(sample_type_t) * 8u,sample_channels,samples);
+
+        src = (sample_type_t dosamp_FAR*)dosamp_ptr_add_normalize(convert_rdbuf.buffer,convert_rdbuf.pos);
+        dst += n * sample_channels;
+        samples -= n;
+        r += n;
+    }
+#endif
+
     while (samples > 0) {
         if (resample_state.frac >= resample_100) {
             if ((convert_rdbuf.pos+bytes_per_sample) > convert_rdbuf.len) return r;
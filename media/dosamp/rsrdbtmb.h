@@ -24,6 +24,27 @@
         LOAD();
     }
 
+#if defined(HAS_RESAMPLE_SIMD)
+    /* interpolate a block at a time with SIMD. the lowpass on the output is a recurrence from
+     * one sample to the next, so it stays scalar. */
+    if (resample_simd_use(resample_best,sizeof(sample_type_t) * 8u,sample_channels)) {
+        int16_t run[256 * sample_channels];
+        uint32_t n,k;
+
+        do {
+            n = resample_simd_linear(run,16u,sizeof(sample_type_t) * 8u,sample_channels,samples < 256u ? samples : 256u);
+
+            for (k=0;k < n;k++) {
+                { register unsigned int i; for (i=0;i < sample_channels;i++) tmp[i] = (signed long)run[(k * sample_channels) + i] << 8L; }
+                AVERAGE();
+                STORE();
+            }
+        } while (n != 0 && samples > 0);
+
+        src = (sample_type_t dosamp_FAR*)dosamp_ptr_add_normalize(convert_rdbuf.buffer,convert_rdbuf.pos);
+    }
+#endif
+
     while (samples > 0) {
         if (resample_state.frac >= resample_100) {
             if ((convert_rdbuf.pos+bytes_per_sample) > convert_rdbuf.len) return r;
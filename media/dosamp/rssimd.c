@@ -0,0 +1,338 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "dosamp.h"
+#include "cvrdbuf.h"
+#include "dosptrnm.h"
+#include "resample.h"
+
+#if defined(HAS_RESAMPLE_SIMD)
+
+#include <immintrin.h>
+
+/* Vectorized linear interpolation for the resampler (Linux host, chosen at runtime).
+ *
+ * The scalar loop in rsrdbtm.h walks a state machine: output a sample while frac < 1.0, otherwise
+ * shift p <- c, load the next source sample into c and subtract 1.0. Unrolled, output k of a call
+ * sits at T = frac + k*step, interpolates between source samples x[(T>>16)-1] and x[T>>16] with
+ * fraction T & 0xFFFF, where x[-1] and x[0] are the p and c carried over in the state and x[1..]
+ * are the unread samples in convert_rdbuf. That is a pure function of k, so a whole block of outputs
+ * can be computed at once and the state then set to what the scalar loop would have left behind.
+ *
+ * The result must match resample_interpolate_generic() exactly:
+ *
+ *   x0 + (((x1 - x0) * frac) >> 16)
+ *
+ * (x1 - x0) * frac can need 33 bits, so it is split as d*(frac>>1)*2 + d*(frac&1), and the shift
+ * done as ((d*(frac>>1)) + ((d*(frac&1))>>1)) >> 15, which floors the same way and fits in 32 bits. */
+
+unsigned char                               resample_simd_level = resample_simd_none;
+
+void resample_simd_detect(void) {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        resample_simd_level = resample_simd_avx2;
+    else if (__builtin_cpu_supports("sse2"))
+        resample_simd_level = resample_simd_sse2;
+    else
+        resample_simd_level = resample_simd_none;
+}
+
+/* whether the kernel at resample_simd_level is used for this mode and format. only where rsbench
+ * shows it faster than the scalar loop. */
+int resample_simd_use(const unsigned int mode,const unsigned int bits,const unsigned int channels) {
+    switch (resample_simd_level) {
+        case resample_simd_avx2:
+            if (mode != resample_best)
+                return 1;
+            /* "best" runs its lowpass over the kernel's output in a second pass, and only when upsampling.
+             * that pays off for 16-bit mono upsampling by less than 2x. with 8-bit samples, stereo, or more
+             * upsampling than that, the interpolation is too small a part of the work */
+            if (bits == 8 || channels == 2)
+                return 0;
+            return (resample_state.step <= resample_100 && resample_state.step >= (resample_100 / 2UL));
+        case resample_simd_sse2:
+            /* loading the source one lane at a time costs too much for "best", and when upsampling,
+             * where the scalar loop uses each source pair for several outputs */
+            if (mode != resample_good)
+                return 0;
+            return (resample_state.step >= resample_100);
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/* source sample i of the unrolled sequence */
+static inline int resample_simd_x(const unsigned char *src,const unsigned int src_bits,const unsigned int channels,const long i,const unsigned int ch) {
+    if (i < 0L)
+        return resample_state.p[ch];
+    else if (i == 0L)
+        return resample_state.c[ch];
+    else if (src_bits == 16)
+        return ((const int16_t*)src)[((unsigned long)(i - 1L) * channels) + ch];
+    else
+        return src[((unsigned long)(i - 1L) * channels) + ch];
+}
+
+static void resample_simd_linear_scalar(void *dst,const unsigned int dst_bits,const unsigned char *src,const unsigned int src_bits,const unsigned int channels,uint32_t k,const uint32_t n) {
+    resample_intermediate_t tmp;
+    unsigned long T;
+    unsigned int ch;
+    long j;
+    int a;
+
+    for (;k < n;k++) {
+        T = (unsigned long)resample_state.frac + ((unsigned long)k * (unsigned long)resample_state.step);
+        j = (long)(T >> 16UL);
+
+        for (ch=0;ch < channels;ch++) {
+            a = resample_simd_x(src,src_bits,channels,j - 1L,ch);
+            tmp = (resample_intermediate_t)resample_simd_x(src,src_bits,channels,j,ch) - (resample_intermediate_t)a;
+            tmp *= (resample_intermediate_t)(T & 0xFFFFUL);
+            tmp >>= (resample_intermediate_t)resample_100_shift;
+            tmp += a;
+
+            if (dst_bits == 16)
+                ((int16_t*)dst)[(k * channels) + ch] = (int16_t)tmp;
+            else
+                ((uint8_t*)dst)[(k * channels) + ch] = (uint8_t)tmp;
+        }
+    }
+}
+
+/* 32x32 multiply, low 32 bits of the result. SSE2 only has pmuludq, which does lanes 0 and 2.
+ * the low 32 bits of the product are the same signed or unsigned. */
+__attribute__((target("sse2")))
+static inline __m128i resample_simd_mullo_sse2(const __m128i a,const __m128i b) {
+    const __m128i even = _mm_mul_epu32(a,b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a,32),_mm_srli_epi64(b,32));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even,_MM_SHUFFLE(0,0,2,0)),_mm_shuffle_epi32(odd,_MM_SHUFFLE(0,0,2,0)));
+}
+
+/* outputs k <= k' < n, 4 values (4 mono or 2 stereo samples) at a time. SSE2 has no gather, so
+ * the source pairs are loaded one lane at a time and only the interpolation is vectorized. inlined
+ * into one copy per format so that the loads are straight line code. the caller guarantees x[T>>16]
+ * is in the buffer. returns how far it got. */
+__attribute__((target("sse2"),always_inline))
+static inline uint32_t resample_simd_linear_sse2_fmt(void *dst,const unsigned int dst_bits,const unsigned char *src,const unsigned int src_bits,const unsigned int channels,uint32_t k,const uint32_t n) {
+    const unsigned int per = 4u / channels;
+    const unsigned long step = (unsigned long)per * (unsigned long)resample_state.step;
+    const __m128i lo16 = _mm_set1_epi32(0xFFFF);
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i T,Tstep,frac,a,b,d,X,Y,res,r16;
+    unsigned long t[4],i[4];
+    unsigned int l;
+
+    if ((k+per) > n)
+        return k;
+
+    for (l=0;l < 4;l++)
+        t[l] = (unsigned long)resample_state.frac + ((unsigned long)(k + (l / channels)) * (unsigned long)resample_state.step);
+    T = _mm_set_epi32((int32_t)t[3],(int32_t)t[2],(int32_t)t[1],(int32_t)t[0]);
+    Tstep = _mm_set1_epi32((int32_t)step);
+
+    for (;(k+per) <= n;k += per) {
+        frac = _mm_and_si128(T,lo16);
+
+        /* x[j-1] and x[j] for this lane's channel, element (j-2)*channels + ch and the one after */
+        for (l=0;l < 4;l++) {
+            i[l] = (((t[l] >> 16UL) - 2UL) * channels) + (l % channels);
+            t[l] += step;
+        }
+        if (src_bits == 16) {
+            const int16_t *s16 = (const int16_t*)src;
+
+            a = _mm_set_epi32(s16[i[3]],s16[i[2]],s16[i[1]],s16[i[0]]);
+            b = _mm_set_epi32(s16[i[3]+channels],s16[i[2]+channels],s16[i[1]+channels],s16[i[0]+channels]);
+        }
+        else {
+            a = _mm_set_epi32(src[i[3]],src[i[2]],src[i[1]],src[i[0]]);
+            b = _mm_set_epi32(src[i[3]+channels],src[i[2]+channels],src[i[1]+channels],src[i[0]+channels]);
+        }
+
+        d = _mm_sub_epi32(b,a);
+        X = resample_simd_mullo_sse2(d,_mm_srli_epi32(frac,1));
+        Y = _mm_and_si128(d,_mm_sub_epi32(_mm_setzero_si128(),_mm_and_si128(frac,one)));
+        res = _mm_add_epi32(a,_mm_srai_epi32(_mm_add_epi32(X,_mm_srai_epi32(Y,1)),15));
+
+        r16 = _mm_packs_epi32(res,res);
+        if (dst_bits == 16) {
+            _mm_storel_epi64((__m128i*)((int16_t*)dst + (k * channels)),r16);
+        }
+        else {
+            const int32_t r8 = _mm_cvtsi128_si32(_mm_packus_epi16(r16,r16));
+
+            memcpy((uint8_t*)dst + (k * channels),&r8,4);
+        }
+
+        T = _mm_add_epi32(T,Tstep);
+    }
+
+    return k;
+}
+
+__attribute__((target("sse2")))
+static uint32_t resample_simd_linear_sse2(void *dst,const unsigned int dst_bits,const unsigned char *src,const unsigned int src_bits,const unsigned int channels,uint32_t k,const uint32_t n) {
+    if (src_bits == 16) {
+        if (channels == 2)
+            return resample_simd_linear_sse2_fmt(dst,16,src,16,2,k,n);
+        else
+            return resample_simd_linear_sse2_fmt(dst,16,src,16,1,k,n);
+    }
+    else if (dst_bits == 16) { /* "best" mode, 8-bit in, 16-bit intermediate out */
+        if (channels == 2)
+            return resample_simd_linear_sse2_fmt(dst,16,src,8,2,k,n);
+        else
+            return resample_simd_linear_sse2_fmt(dst,16,src,8,1,k,n);
+    }
+    else {
+        if (channels == 2)
+            return resample_simd_linear_sse2_fmt(dst,8,src,8,2,k,n);
+        else
+            return resample_simd_linear_sse2_fmt(dst,8,src,8,1,k,n);
+    }
+}
+
+/* outputs k <= k' < n, 8 values (8 mono or 4 stereo samples) at a time. the caller guarantees that
+ * x[T>>16] is at least two samples short of the end of the data, since the gathers load 4 bytes
+ * and may look past the samples they need. returns how far it got. */
+__attribute__((target("avx2")))
+static uint32_t resample_simd_linear_avx2(void *dst,const unsigned int dst_bits,const unsigned char *src,const unsigned int src_bits,const unsigned int channels,uint32_t k,const uint32_t n) {
+    const unsigned int per = 8u / channels;
+    const __m256i lo16 = _mm256_set1_epi32(0xFFFF);
+    const __m256i lo8 = _mm256_set1_epi32(0xFF);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    __m256i T,Tstep,chv,j,frac,idx,v,vb,a,b,d,X,Y,res;
+    __m128i r16;
+    int32_t lane[8];
+    unsigned int l;
+
+    if ((k+per) > n)
+        return k;
+
+    for (l=0;l < 8;l++)
+        lane[l] = (int32_t)((unsigned long)resample_state.frac + ((unsigned long)(k + (l / channels)) * (unsigned long)resample_state.step));
+    T = _mm256_loadu_si256((const __m256i*)lane);
+    Tstep = _mm256_set1_epi32((int32_t)((unsigned long)per * (unsigned long)resample_state.step));
+
+    for (l=0;l < 8;l++)
+        lane[l] = (int32_t)(l % channels);
+    chv = _mm256_loadu_si256((const __m256i*)lane);
+
+    for (;(k+per) <= n;k += per) {
+        j = _mm256_srli_epi32(T,16);
+        frac = _mm256_and_si256(T,lo16);
+
+        /* element index of x[j-1] for this lane's channel: (j-2)*channels + ch */
+        idx = _mm256_sub_epi32(j,two);
+        if (channels == 2) idx = _mm256_add_epi32(_mm256_add_epi32(idx,idx),chv);
+
+        if (src_bits == 16) {
+            v = _mm256_i32gather_epi32((const int*)src,idx,2);
+            a = _mm256_srai_epi32(_mm256_slli_epi32(v,16),16);
+            if (channels == 2) {
+                vb = _mm256_i32gather_epi32((const int*)src,_mm256_add_epi32(idx,two),2);
+                b = _mm256_srai_epi32(_mm256_slli_epi32(vb,16),16);
+            }
+            else {
+                b = _mm256_srai_epi32(v,16);
+            }
+        }
+        else {
+            v = _mm256_i32gather_epi32((const int*)src,idx,1);
+            a = _mm256_and_si256(v,lo8);
+            b = _mm256_and_si256(channels == 2 ? _mm256_srli_epi32(v,16) : _mm256_srli_epi32(v,8),lo8);
+        }
+
+        d = _mm256_sub_epi32(b,a);
+        X = _mm256_mullo_epi32(d,_mm256_srli_epi32(frac,1));
+        Y = _mm256_and_si256(d,_mm256_sub_epi32(_mm256_setzero_si256(),_mm256_and_si256(frac,one)));
+        res = _mm256_add_epi32(a,_mm256_srai_epi32(_mm256_add_epi32(X,_mm256_srai_epi32(Y,1)),15));
+
+        /* 8 x int32 -> 8 x int16. packs works per 128-bit half, gather the two low quadwords */
+        r16 = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packs_epi32(res,res),0x08));
+        if (dst_bits == 16)
+            _mm_storeu_si128((__m128i*)((int16_t*)dst + (k * channels)),r16);
+        else
+            _mm_storel_epi64((__m128i*)((uint8_t*)dst + (k * channels)),_mm_packus_epi16(r16,r16));
+
+        T = _mm256_add_epi32(T,Tstep);
+    }
+
+    return k;
+}
+
+/* emit up to samples linearly interpolated samples from convert_rdbuf, leaving resample_state and
+ * convert_rdbuf.pos exactly as the scalar loop would. may do fewer (or none) near the end of the
+ * buffer, the caller carries on with the scalar loop from there. */
+uint32_t resample_simd_linear(void *dst,const unsigned int dst_bits,const unsigned int src_bits,const unsigned int channels,const uint32_t samples) {
+    const unsigned int bytes_per_frame = (src_bits / 8u) * channels;
+    const unsigned char *src = (const unsigned char*)dosamp_ptr_add_normalize(convert_rdbuf.buffer,convert_rdbuf.pos);
+    const unsigned long F = (unsigned long)resample_state.frac;
+    const unsigned long step = (unsigned long)resample_state.step;
+    unsigned long avail,lim,T;
+    uint32_t n,k,kv;
+    unsigned int ch;
+    long J;
+
+    assert(channels >= 1 && channels <= resample_max_channels);
+    assert(resample_state.init != 0);
+
+    if (resample_simd_level == resample_simd_none || step == 0UL || convert_rdbuf.pos >= convert_rdbuf.len)
+        return 0;
+
+    /* how many outputs can be made with x[T>>16] at least two samples short of the end of the data,
+     * and with T still fitting in a signed 32-bit lane */
+    avail = (unsigned long)(convert_rdbuf.len - convert_rdbuf.pos) / bytes_per_frame;
+    if (avail < 3UL) return 0;
+
+    lim = ((avail - 2UL) << 16UL) | 0xFFFFUL;
+    if (lim > 0x7FFFFFFFUL) lim = 0x7FFFFFFFUL;
+    if (F > lim) return 0;
+
+    n = samples;
+    if ((unsigned long)n > (((lim - F) / step) + 1UL)) n = (uint32_t)(((lim - F) / step) + 1UL);
+    if (n == 0) return 0;
+
+    /* the first few outputs may still involve p and c from the state, which are not in the buffer */
+    if (F >= (2UL << 16UL))
+        kv = 0;
+    else
+        kv = (uint32_t)((((2UL << 16UL) - F) + step - 1UL) / step);
+    if (kv > n) kv = n;
+
+    resample_simd_linear_scalar(dst,dst_bits,src,src_bits,channels,0,kv);
+    if (resample_simd_level >= resample_simd_avx2)
+        k = resample_simd_linear_avx2(dst,dst_bits,src,src_bits,channels,kv,n);
+    else
+        k = resample_simd_linear_sse2(dst,dst_bits,src,src_bits,channels,kv,n);
+    resample_simd_linear_scalar(dst,dst_bits,src,src_bits,channels,k,n);
+
+    /* the scalar loop would have loaded J more samples to make the last one */
+    T = F + ((unsigned long)(n - 1u) * step);
+    J = (long)(T >> 16UL);
+
+    for (ch=0;ch < channels;ch++) {
+        const int np = resample_simd_x(src,src_bits,channels,J - 1L,ch);
+        const int nc = resample_simd_x(src,src_bits,channels,J,ch);
+
+        resample_state.p[ch] = (int16_t)np;
+        resample_state.c[ch] = (int16_t)nc;
+    }
+
+    resample_state.frac = (resample_whole_count_element_t)(F + ((unsigned long)n * step) - ((unsigned long)J << 16UL));
+    convert_rdbuf.pos += (unsigned int)J * bytes_per_frame;
+    return n;
+}
+
+#endif /* HAS_RESAMPLE_SIMD */
+
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "declabel.h"
+
+struct dec_label*               dec_label = NULL;
+size_t                          dec_label_count = 0;
+size_t                          dec_label_alloc = 0;
+
+unsigned char                   dec_label_by_offset = 0;
+unsigned char                   dec_label_linear = 0;
+
+unsigned long                   dec_label_lookups = 0;
+unsigned long                   dec_label_probes = 0;
+
+/* open addressing, linear probing. each entry is the label index + 1, 0 if empty.
+ * the table is at least twice dec_label_alloc, so it never fills. */
+static uint32_t*                dec_label_hash = NULL;
+static size_t                   dec_label_hash_mask = 0;
+static size_t                   dec_label_hashed = 0;   /* labels [0,hashed) are in the table */
+
+void cstr_free(char **l) {
+    if (l != NULL) {
+        if (*l != NULL) free(*l);
+        *l = NULL;
+    }
+}
+
+void cstr_copy(char **l,const char *s) {
+    cstr_free(l);
+
+    if (s != NULL) {
+        const size_t len = strlen(s);
+        *l = malloc(len+1);
+        if (*l != NULL)
+            strcpy(*l,s);
+    }
+}
+
+void dec_label_set_name(struct dec_label *l,const char *s) {
+    cstr_copy(&l->name,s);
+}
+
+int dec_label_init(size_t alloc) {
+    size_t hs = 64;
+
+    while (hs < (alloc * 2)) hs <<= 1;
+
+    dec_label_alloc = alloc;
+    dec_label_count = 0;
+    dec_label = malloc(sizeof(*dec_label) * dec_label_alloc);
+    dec_label_hash = malloc(sizeof(*dec_label_hash) * hs);
+    if (dec_label == NULL || dec_label_hash == NULL) {
+        dec_free_labels();
+        return 0;
+    }
+    memset(dec_label,0,sizeof(*dec_label) * dec_label_alloc);
+    memset(dec_label_hash,0,sizeof(*dec_label_hash) * hs);
+    dec_label_hash_mask = hs - 1;
+    dec_label_hashed = 0;
+    return 1;
+}
+
+void dec_free_labels() {
+    unsigned int i=0;
+
+    if (dec_label_hash != NULL) {
+        free(dec_label_hash);
+        dec_label_hash = NULL;
+    }
+
+    if (dec_label == NULL)
+        return;
+
+    while (i < dec_label_count) {
+        struct dec_label *l = dec_label + i;
+        cstr_free(&(l->name));
+        i++;
+    }
+
+    free(dec_label);
+    dec_label = NULL;
+}
+
+struct dec_label *dec_label_malloc() {
+    if (dec_label == NULL)
+        return NULL;
+
+    if (dec_label_count >= dec_label_alloc)
+        return NULL;
+
+    return dec_label + (dec_label_count++);
+}
+
+static inline uint16_t dec_label_key_seg(const struct dec_label *l) {
+    return dec_label_by_offset ? 0 : l->seg_v;
+}
+
+static inline uint32_t dec_label_key_ofs(const struct dec_label *l) {
+    return dec_label_by_offset ? l->offset : l->ofs_v;
+}
+
+static inline size_t dec_label_hashfn(const uint16_t so,const uint32_t oo) {
+    uint32_t h = ((uint32_t)so * 0x9E3779B1UL) ^ oo;
+
+    h ^= h >> 16UL;
+    h *= 0x85EBCA6BUL;
+    h ^= h >> 13UL;
+    return (size_t)h & dec_label_hash_mask;
+}
+
+/* bring the hash up to date with labels added since the last lookup.
+ * if the same key appears twice, the first label keeps it, same as the linear search. */
+static void dec_label_hash_update() {
+    struct dec_label *l;
+    uint16_t so;
+    uint32_t oo;
+    size_t h;
+
+    while (dec_label_hashed < dec_label_count) {
+        l = dec_label + dec_label_hashed;
+        so = dec_label_key_seg(l);
+        oo = dec_label_key_ofs(l);
+
+        h = dec_label_hashfn(so,oo);
+        while (dec_label_hash[h] != 0) {
+            const struct dec_label *e = dec_label + dec_label_hash[h] - 1;
+
+            if (dec_label_key_seg(e) == so && dec_label_key_ofs(e) == oo)
+                break;
+
+            h = (h + 1) & dec_label_hash_mask;
+        }
+
+        if (dec_label_hash[h] == 0)
+            dec_label_hash[h] = (uint32_t)(dec_label_hashed + 1);
+
+        dec_label_hashed++;
+    }
+}
+
+struct dec_label *dec_find_label(const uint16_t so,const uint32_t oo) {
+    struct dec_label *l;
+    unsigned int i=0;
+    size_t h;
+
+    if (dec_label == NULL)
+        return NULL;
+
+    dec_label_lookups++;
+
+    if (dec_label_linear) {
+        while (i < dec_label_count) {
+            l = dec_label + i;
+            dec_label_probes++;
+
+            if (dec_label_key_seg(l) == so && dec_label_key_ofs(l) == oo)
+                return l;
+
+            i++;
+        }
+
+        return NULL;
+    }
+
+    dec_label_hash_update();
+
+    h = dec_label_hashfn(so,oo);
+    while (dec_label_hash[h] != 0) {
+        l = dec_label + dec_label_hash[h] - 1;
+        dec_label_probes++;
+
+        if (dec_label_key_seg(l) == so && dec_label_key_ofs(l) == oo)
+            return l;
+
+        h = (h + 1) & dec_label_hash_mask;
+    }
+
+    return NULL;
+}
+
+/* labels moved or changed key, rebuild the hash on the next lookup */
+void dec_label_reindex() {
+    if (dec_label_hash != NULL)
+        memset(dec_label_hash,0,sizeof(*dec_label_hash) * (dec_label_hash_mask + 1));
+
+    dec_label_hashed = 0;
+}
+
+static int dec_label_qsortcb(const void *a,const void *b) {
+    const struct dec_label *as = (const struct dec_label*)a;
+    const struct dec_label *bs = (const struct dec_label*)b;
+
+    if (dec_label_key_seg(as) < dec_label_key_seg(bs))
+        return -1;
+    else if (dec_label_key_seg(as) > dec_label_key_seg(bs))
+        return 1;
+
+    if (dec_label_key_ofs(as) < dec_label_key_ofs(bs))
+        return -1;
+    else if (dec_label_key_ofs(as) > dec_label_key_ofs(bs))
+        return 1;
+
+    return 0;
+}
+
+/* sort by key, for the second pass to walk in order */
+void dec_label_sort() {
+    if (dec_label == NULL || dec_label_count == 0)
+        return;
+
+    qsort(dec_label,dec_label_count,sizeof(*dec_label),dec_label_qsortcb);
+    dec_label_reindex();
+}
+
+void dec_label_print_timing(const char *what,clock_t t) {
+    fprintf(stderr,"%s: %.3f sec\n",what,(double)t / CLOCKS_PER_SEC);
+}
+
+void dec_label_print_stats() {
+    fprintf(stderr,"%lu labels, %lu lookups, %lu compares (%.2f per lookup), %s\n",
+        (unsigned long)dec_label_count,dec_label_lookups,dec_label_probes,
+        dec_label_lookups != 0 ? ((double)dec_label_probes / dec_label_lookups) : 0.0,
+        dec_label_linear ? "linear search" : "hashed");
+}
@@ -0,0 +1,50 @@
+#ifndef __TOOL_DECOMPIL_DECLABEL_H
+#define __TOOL_DECOMPIL_DECLABEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+/* label store shared by dosdasm, wnedasm and wledasm.
+ *
+ * labels live in one array (dec_label) so that the first pass can walk it as a worklist
+ * while adding to it, and the second pass can walk it in order after dec_label_sort().
+ * dec_find_label() goes through a hash table on (seg_v,ofs_v), or on offset if
+ * dec_label_by_offset is set (dosdasm, where code is located by linear file offset).
+ *
+ * the caller fills in a label after dec_label_malloc(), so new labels are added to the hash
+ * on the next lookup rather than when allocated. if the caller changes the seg_v/ofs_v/offset
+ * of a label already looked up, it must call dec_label_reindex(). */
+
+struct dec_label {
+    uint16_t                    seg_v;
+    uint32_t                    ofs_v;
+    uint32_t                    offset;
+    char*                       name;
+};
+
+extern struct dec_label*        dec_label;
+extern size_t                   dec_label_count;
+extern size_t                   dec_label_alloc;
+
+extern unsigned char            dec_label_by_offset;
+extern unsigned char            dec_label_linear;       /* linear search, no hash (for comparison) */
+
+extern unsigned long            dec_label_lookups;
+extern unsigned long            dec_label_probes;
+
+void cstr_free(char **l);
+void cstr_copy(char **l,const char *s);
+
+int dec_label_init(size_t alloc);
+void dec_free_labels();
+struct dec_label *dec_label_malloc();
+void dec_label_set_name(struct dec_label *l,const char *s);
+struct dec_label *dec_find_label(const uint16_t so,const uint32_t oo);
+void dec_label_reindex();
+void dec_label_sort();
+
+void dec_label_print_timing(const char *what,clock_t t);
+void dec_label_print_stats();
+
+#endif /* __TOOL_DECOMPIL_DECLABEL_H */
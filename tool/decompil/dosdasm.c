@@ -14,41 +14,12 @@
 
 #include <hw/dos/exehdr.h>
 
+#include "declabel.h"
+
 #ifndef O_BINARY
 #define O_BINARY 0
 #endif
 
-struct dec_label {
-    uint16_t                    seg_v,ofs_v;
-    uint32_t                    offset;
-    char*                       name;
-};
-
-void cstr_free(char **l) {
-    if (l != NULL) {
-        if (*l != NULL) free(*l);
-        *l = NULL;
-    }
-}
-
-void cstr_copy(char **l,const char *s) {
-    cstr_free(l);
-
-    if (s != NULL) {
-        const size_t len = strlen(s);
-        *l = malloc(len+1);
-        if (*l != NULL)
-            strcpy(*l,s);
-    }
-}
-
-void dec_label_set_name(struct dec_label *l,const char *s) {
-    cstr_copy(&l->name,s);
-}
-
-struct dec_label*               dec_label = NULL;
-size_t                          dec_label_count = 0;
-size_t                          dec_label_alloc = 0;
 unsigned long                   dec_ofs;
 uint16_t                        dec_cs;
 
@@ -70,6 +41,7 @@ size_t                          exe_relocation_count = 0;
 struct exe_dos_header           exehdr;
 
 char*                           label_file = NULL;
+unsigned char                   show_timing = 0;
 
 char*                           src_file = NULL;
 int                             src_fd = -1;
@@ -93,6 +65,8 @@ void help() {
     fprintf(stderr,"MS-DOS COM/EXE/SYS decompiler\n");
     fprintf(stderr,"    -i <file>        File to decompile\n");
     fprintf(stderr,"    -lf <file>       Text file to define labels\n");
+    fprintf(stderr,"    -t               Print pass timing and label lookup stats to stderr\n");
+    fprintf(stderr,"    -nohash          Look up labels by linear search (to compare timing)\n");
 }
 
 int parse_argv(int argc,char **argv) {
@@ -113,6 +87,12 @@ int parse_argv(int argc,char **argv) {
                 label_file = argv[i++];
                 if (label_file == NULL) return 1;
             }
+            else if (!strcmp(a,"t")) {
+                show_timing = 1;
+            }
+            else if (!strcmp(a,"nohash")) {
+                dec_label_linear = 1;
+            }
             else if (!strcmp(a,"h") || !strcmp(a,"help")) {
                 help();
                 return 1;
@@ -179,50 +159,6 @@ int refill() {
     return (dec_read < dec_end);
 }
 
-void dec_free_labels() {
-    unsigned int i=0;
-
-    if (dec_label == NULL)
-        return;
-
-    while (i < dec_label_count) {
-        struct dec_label *l = dec_label + i;
-        cstr_free(&(l->name));
-        i++;
-    }
-
-    free(dec_label);
-    dec_label = NULL;
-}
-
-struct dec_label *dec_find_label(const uint32_t ofs) {
-    unsigned int i=0;
-
-    if (dec_label == NULL)
-        return NULL;
-
-    while (i < dec_label_count) {
-        struct dec_label *l = dec_label + i;
-
-        if (l->offset == ofs)
-            return l;
-
-        i++;
-    }
-
-    return NULL;
-}
-
-struct dec_label *dec_label_malloc() {
-    if (dec_label == NULL)
-        return NULL;
-
-    if (dec_label_count >= dec_label_alloc)
-        return NULL;
-
-    return dec_label + (dec_label_count++);
-}
-
 int exe_relocation_qsort_cb(const void *a,const void *b) {
     const uint32_t *au = (const uint32_t*)a;
     const uint32_t *bu = (const uint32_t*)b;
@@ -235,42 +171,21 @@ int exe_relocation_qsort_cb(const void *a,const void *b) {
     return 0;
 }
 
-int dec_label_qsortcb(const void *a,const void *b) {
-    const struct dec_label *as = (const struct dec_label*)a;
-    const struct dec_label *bs = (const struct dec_label*)b;
-
-    if (as->offset < bs->offset)
-        return -1;
-    else if (as->offset > bs->offset)
-        return 1;
-
-    return 0;
-}
-
-void dec_label_sort() {
-    if (dec_label == NULL || dec_label_count == 0)
-        return;
-
-    qsort(dec_label,dec_label_count,sizeof(*dec_label),dec_label_qsortcb);
-}
-
 int main(int argc,char **argv) {
     struct dec_label *label;
     unsigned int exereli;
     unsigned int labeli;
+    clock_t t_pass;
     int c;
 
     if (parse_argv(argc,argv))
         return 1;
 
-    dec_label_alloc = 4096;
-    dec_label_count = 0;
-    dec_label = malloc(sizeof(*dec_label) * dec_label_alloc);
-    if (dec_label == NULL) {
+    dec_label_by_offset = 1;
+    if (!dec_label_init(4096)) {
         fprintf(stderr,"Failed to alloc label array\n");
         return 1;
     }
-    memset(dec_label,0,sizeof(*dec_label) * dec_label_alloc);
 
     src_fd = open(src_file,O_RDONLY|O_BINARY);
     if (src_fd < 0) {
@@ -455,6 +370,8 @@ int main(int argc,char **argv) {
         fclose(fp);
     }
 
+    t_pass = clock();
+
     /* first pass: CALL + JMP + Jcc ident and label building from it.
      * for each label, decode until 1024 instructions or a JMP, RET */
     {
@@ -519,7 +436,7 @@ int main(int argc,char **argv) {
 
                     printf("Target: 0x%04lx @0x%08lx\n",(unsigned long)toffset,(unsigned long)noffset);
 
-                    label = dec_find_label(noffset);
+                    label = dec_find_label(0,noffset);
                     if (label == NULL) {
                         if ((label=dec_label_malloc()) != NULL) {
                             if (dec_i.opcode == MXOP_JMP || dec_i.opcode == MXOP_JCXZ ||
@@ -533,7 +450,7 @@ int main(int argc,char **argv) {
                             label->seg_v =
                                 dec_cs;
                             label->ofs_v =
-                                toffset;
+                                (uint16_t)toffset;
                         }
                     }
 
@@ -563,7 +480,7 @@ int main(int argc,char **argv) {
                                         (unsigned long)dec_i.argv[0].segval,
                                         (unsigned long)dec_i.argv[0].value);
 
-                                    label = dec_find_label(noffset);
+                                    label = dec_find_label(0,noffset);
                                     if (label == NULL) {
                                         if ((label=dec_label_malloc()) != NULL) {
                                             if (dec_i.opcode == MXOP_JMP_FAR)
@@ -576,7 +493,7 @@ int main(int argc,char **argv) {
                                             label->seg_v =
                                                 dec_i.argv[0].segval;
                                             label->ofs_v =
-                                                dec_i.argv[0].value;
+                                                (uint16_t)dec_i.argv[0].value;
                                         }
                                     }
 
@@ -598,6 +515,11 @@ int main(int argc,char **argv) {
         }
     }
 
+    if (show_timing) {
+        dec_label_print_timing("1st pass",clock() - t_pass);
+        t_pass = clock();
+    }
+
     /* sort labels */
     dec_label_sort();
 
@@ -759,6 +681,11 @@ int main(int argc,char **argv) {
         dec_read = dec_i.end;
     } while(1);
 
+    if (show_timing) {
+        dec_label_print_timing("2nd pass",clock() - t_pass);
+        dec_label_print_stats();
+    }
+
     close(src_fd);
     dec_free_labels();
 	return 0;
@@ -23,6 +23,8 @@
 
 #include <hw/dos/exehdr.h>
 
+#include "declabel.h"
+
 const char *vxd_device_to_name(const uint16_t id) {
     switch (id) {
         case 0x0000:    return "Undefined";             // Undefined_Device_ID             EQU     00000h
@@ -898,30 +900,6 @@ struct mod_symbols_list {
     size_t                      length;
 };
 
-struct dec_label {
-    uint16_t                    seg_v;
-    uint32_t                    ofs_v;
-    char*                       name;
-};
-
-void cstr_free(char **l) {
-    if (l != NULL) {
-        if (*l != NULL) free(*l);
-        *l = NULL;
-    }
-}
-
-void cstr_copy(char **l,const char *s) {
-    cstr_free(l);
-
-    if (s != NULL) {
-        const size_t len = strlen(s);
-        *l = malloc(len+1);
-        if (*l != NULL)
-            strcpy(*l,s);
-    }
-}
-
 void mod_symbol_table_free(struct mod_symbol_table *t) {
     unsigned int i;
 
@@ -947,13 +925,6 @@ void mod_symbols_list_free(struct mod_symbols_list *t) {
     t->length = 0;
 }
 
-void dec_label_set_name(struct dec_label *l,const char *s) {
-    cstr_copy(&l->name,s);
-}
-
-struct dec_label*               dec_label = NULL;
-size_t                          dec_label_count = 0;
-size_t                          dec_label_alloc = 0;
 unsigned long                   dec_ofs;
 uint16_t                        dec_cs;
 
@@ -978,26 +949,11 @@ uint32_t                        load_base = 0x00400000;
 
 char*                           sym_file = NULL;
 char*                           label_file = NULL;
+unsigned char                   show_timing = 0;
 
 char*                           src_file = NULL;
 int                             src_fd = -1;
 
-void dec_free_labels() {
-    unsigned int i=0;
-
-    if (dec_label == NULL)
-        return;
-
-    while (i < dec_label_count) {
-        struct dec_label *l = dec_label + i;
-        cstr_free(&(l->name));
-        i++;
-    }
-
-    free(dec_label);
-    dec_label = NULL;
-}
-
 uint32_t current_offset_minus_buffer() {
     return current_offset - (uint32_t)(dec_end - dec_buffer);
 }
@@ -1018,6 +974,8 @@ void help() {
     fprintf(stderr,"    -i <file>        File to decompile\n");
     fprintf(stderr,"    -lf <file>       Text file to define labels\n");
     fprintf(stderr,"    -sym <file>      Module symbols file\n");
+    fprintf(stderr,"    -t               Print pass timing and label lookup stats to stderr\n");
+    fprintf(stderr,"    -nohash          Look up labels by linear search (to compare timing)\n");
     fprintf(stderr,"    -b <a>           Load base\n");
 }
 
@@ -1072,6 +1030,12 @@ int parse_argv(int argc,char **argv) {
                 sym_file = argv[i++];
                 if (sym_file == NULL) return 1;
             }
+            else if (!strcmp(a,"t")) {
+                show_timing = 1;
+            }
+            else if (!strcmp(a,"nohash")) {
+                dec_label_linear = 1;
+            }
             else if (!strcmp(a,"h") || !strcmp(a,"help")) {
                 help();
                 return 1;
@@ -1180,51 +1144,6 @@ void dec_label_xlate_32flat_always(struct dec_label *l,struct le_header_parseinf
     }
 }
 
-struct dec_label *dec_find_label(const uint16_t so,const uint32_t oo) {
-    unsigned int i=0;
-
-    if (dec_label == NULL)
-        return NULL;
-
-    while (i < dec_label_count) {
-        struct dec_label *l = dec_label + i;
-
-        if (l->seg_v == so && l->ofs_v == oo)
-            return l;
-
-        i++;
-    }
-
-    return NULL;
-}
-
-struct dec_label *dec_label_malloc() {
-    if (dec_label == NULL)
-        return NULL;
-
-    if (dec_label_count >= dec_label_alloc)
-        return NULL;
-
-    return dec_label + (dec_label_count++);
-}
-
-int dec_label_qsortcb(const void *a,const void *b) {
-    const struct dec_label *as = (const struct dec_label*)a;
-    const struct dec_label *bs = (const struct dec_label*)b;
-
-    if (as->seg_v < bs->seg_v)
-        return -1;
-    else if (as->seg_v > bs->seg_v)
-        return 1;
-
-    if (as->ofs_v < bs->ofs_v)
-        return -1;
-    else if (as->ofs_v > bs->ofs_v)
-        return 1;
-
-    return 0;
-}
-
 int ne_segment_relocs_table_qsort(const void *a,const void *b) {
     const union exe_ne_header_segment_relocation_entry *as =
         (const union exe_ne_header_segment_relocation_entry *)a;
@@ -1239,13 +1158,6 @@ int ne_segment_relocs_table_qsort(const void *a,const void *b) {
     return 0;
 }
 
-void dec_label_sort() {
-    if (dec_label == NULL || dec_label_count == 0)
-        return;
-
-    qsort(dec_label,dec_label_count,sizeof(*dec_label),dec_label_qsortcb);
-}
-
 struct fixup_tracking_window_ent {
     uint32_t                                    fixup_rec_page;     // page it belongs to
     uint32_t                                    fixup_rec_index;    // index within page record array
@@ -1344,6 +1256,7 @@ int main(int argc,char **argv) {
     struct dec_label *label;
     unsigned int labeli;
     uint32_t file_size;
+    clock_t t_pass;
 
     fixup_tracking_window_init(&fixup_window);
     assert(sizeof(le_parser.le_header) == EXE_HEADER_LE_HEADER_SIZE);
@@ -1356,17 +1269,13 @@ int main(int argc,char **argv) {
     assert(sizeof(exehdr) == 0x1C);
 
 #if defined(TARGET_MSDOS) && TARGET_MSDOS == 16
-    dec_label_alloc = 4096;
+    if (!dec_label_init(4096)) {
 #else
-    dec_label_alloc = 65536;
+    if (!dec_label_init(65536)) {
 #endif
-    dec_label_count = 0;
-    dec_label = malloc(sizeof(*dec_label) * dec_label_alloc);
-    if (dec_label == NULL) {
         fprintf(stderr,"Failed to alloc label array\n");
         return 1;
     }
-    memset(dec_label,0,sizeof(*dec_label) * dec_label_alloc);
 
     if (src_file == NULL) {
         fprintf(stderr,"No source file specified\n");
@@ -1626,6 +1535,7 @@ int main(int argc,char **argv) {
                 label->seg_v = ~0;
                 label->ofs_v = ~0;
                 dec_label_set_name(label,"VXD DDB entry point");
+                dec_label_reindex();
             }
 
             if (le_segofs_to_trackio(&io,object,offset,&le_parser)) {
@@ -1760,6 +1670,8 @@ int main(int argc,char **argv) {
         }
     }
  
+    t_pass = clock();
+
     /* first pass: decompilation */
     {
         struct exe_le_header_object_table_entry *ent;
@@ -1951,6 +1863,11 @@ int main(int argc,char **argv) {
         }
     }
 
+    if (show_timing) {
+        dec_label_print_timing("1st pass",clock() - t_pass);
+        t_pass = clock();
+    }
+
     /* sort labels */
     dec_label_sort();
 
@@ -2407,6 +2324,11 @@ int main(int argc,char **argv) {
         }
     }
 
+    if (show_timing) {
+        dec_label_print_timing("2nd pass",clock() - t_pass);
+        dec_label_print_stats();
+    }
+
     fixup_tracking_window_free(&fixup_window);
     le_header_parseinfo_free(&le_parser);
     dec_free_labels();
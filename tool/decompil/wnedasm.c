@@ -41,6 +41,8 @@
 #include <hw/dos/exenehdr.h>
 #include <hw/dos/exenepar.h>
 
+#include "declabel.h"
+
 #ifndef O_BINARY
 #define O_BINARY 0
 #endif
@@ -56,29 +58,6 @@ struct mod_symbols_list {
     size_t                      length;
 };
 
-struct dec_label {
-    uint16_t                    seg_v,ofs_v;
-    char*                       name;
-};
-
-void cstr_free(char **l) {
-    if (l != NULL) {
-        if (*l != NULL) free(*l);
-        *l = NULL;
-    }
-}
-
-void cstr_copy(char **l,const char *s) {
-    cstr_free(l);
-
-    if (s != NULL) {
-        const size_t len = strlen(s);
-        *l = malloc(len+1);
-        if (*l != NULL)
-            strcpy(*l,s);
-    }
-}
-
 void mod_symbol_table_free(struct mod_symbol_table *t) {
     unsigned int i;
 
@@ -104,13 +83,6 @@ void mod_symbols_list_free(struct mod_symbols_list *t) {
     t->length = 0;
 }
 
-void dec_label_set_name(struct dec_label *l,const char *s) {
-    cstr_copy(&l->name,s);
-}
-
-struct dec_label*               dec_label = NULL;
-size_t                          dec_label_count = 0;
-size_t                          dec_label_alloc = 0;
 unsigned long                   dec_ofs;
 uint16_t                        dec_cs;
 
@@ -132,26 +104,11 @@ struct exe_dos_header           exehdr;
 
 char*                           sym_file = NULL;
 char*                           label_file = NULL;
+unsigned char                   show_timing = 0;
 
 char*                           src_file = NULL;
 int                             src_fd = -1;
 
-void dec_free_labels() {
-    unsigned int i=0;
-
-    if (dec_label == NULL)
-        return;
-
-    while (i < dec_label_count) {
-        struct dec_label *l = dec_label + i;
-        cstr_free(&(l->name));
-        i++;
-    }
-
-    free(dec_label);
-    dec_label = NULL;
-}
-
 uint32_t current_offset_minus_buffer() {
     return current_offset - (uint32_t)(dec_end - dec_buffer);
 }
@@ -172,6 +129,8 @@ void help() {
     fprintf(stderr,"    -i <file>        File to decompile\n");
     fprintf(stderr,"    -lf <file>       Text file to define labels\n");
     fprintf(stderr,"    -sym <file>      Module symbols file\n");
+    fprintf(stderr,"    -t               Print pass timing and label lookup stats to stderr\n");
+    fprintf(stderr,"    -nohash          Look up labels by linear search (to compare timing)\n");
 }
 
 int parse_argv(int argc,char **argv) {
@@ -196,6 +155,12 @@ int parse_argv(int argc,char **argv) {
                 sym_file = argv[i++];
                 if (sym_file == NULL) return 1;
             }
+            else if (!strcmp(a,"t")) {
+                show_timing = 1;
+            }
+            else if (!strcmp(a,"nohash")) {
+                dec_label_linear = 1;
+            }
             else if (!strcmp(a,"h") || !strcmp(a,"help")) {
                 help();
                 return 1;
@@ -262,51 +227,6 @@ int refill() {
     return (dec_read < dec_end);
 }
 
-struct dec_label *dec_find_label(const uint16_t so,const uint16_t oo) {
-    unsigned int i=0;
-
-    if (dec_label == NULL)
-        return NULL;
-
-    while (i < dec_label_count) {
-        struct dec_label *l = dec_label + i;
-
-        if (l->seg_v == so && l->ofs_v == oo)
-            return l;
-
-        i++;
-    }
-
-    return NULL;
-}
-
-struct dec_label *dec_label_malloc() {
-    if (dec_label == NULL)
-        return NULL;
-
-    if (dec_label_count >= dec_label_alloc)
-        return NULL;
-
-    return dec_label + (dec_label_count++);
-}
-
-int dec_label_qsortcb(const void *a,const void *b) {
-    const struct dec_label *as = (const struct dec_label*)a;
-    const struct dec_label *bs = (const struct dec_label*)b;
-
-    if (as->seg_v < bs->seg_v)
-        return -1;
-    else if (as->seg_v > bs->seg_v)
-        return 1;
-
-    if (as->ofs_v < bs->ofs_v)
-        return -1;
-    else if (as->ofs_v > bs->ofs_v)
-        return 1;
-
-    return 0;
-}
-
 int ne_segment_relocs_table_qsort(const void *a,const void *b) {
     const union exe_ne_header_segment_relocation_entry *as =
         (const union exe_ne_header_segment_relocation_entry *)a;
@@ -321,13 +241,6 @@ int ne_segment_relocs_table_qsort(const void *a,const void *b) {
     return 0;
 }
 
-void dec_label_sort() {
-    if (dec_label == NULL || dec_label_count == 0)
-        return;
-
-    qsort(dec_label,dec_label_count,sizeof(*dec_label),dec_label_qsortcb);
-}
-
 const char *mod_symbols_list_lookup(
     const struct mod_symbols_list * const mod_syms,
     unsigned int mod_ref_idx,unsigned int mod_ordinal) {
@@ -725,6 +638,7 @@ int main(int argc,char **argv) {
     unsigned int reloci;
     unsigned int labeli;
     uint32_t file_size;
+    clock_t t_pass;
     int c;
 
     assert(sizeof(ne_header) == 0x40);
@@ -740,14 +654,10 @@ int main(int argc,char **argv) {
     if (parse_argv(argc,argv))
         return 1;
 
-    dec_label_alloc = 4096;
-    dec_label_count = 0;
-    dec_label = malloc(sizeof(*dec_label) * dec_label_alloc);
-    if (dec_label == NULL) {
+    if (!dec_label_init(4096)) {
         fprintf(stderr,"Failed to alloc label array\n");
         return 1;
     }
-    memset(dec_label,0,sizeof(*dec_label) * dec_label_alloc);
 
     src_fd = open(src_file,O_RDONLY|O_BINARY);
     if (src_fd < 0) {
@@ -1317,6 +1227,8 @@ int main(int argc,char **argv) {
         }
     }
 
+    t_pass = clock();
+
     /* first pass: decompilation */
     {
         unsigned int los = 0;
@@ -1436,7 +1348,7 @@ int main(int argc,char **argv) {
 
                             printf("Target: 0x%04lx @0x%08lx\n",(unsigned long)toffset,(unsigned long)noffset);
 
-                            label = dec_find_label(dec_cs,toffset);
+                            label = dec_find_label(dec_cs,(uint16_t)toffset);
                             if (label == NULL) {
                                 if ((label=dec_label_malloc()) != NULL) {
                                     if (dec_i.opcode == MXOP_JMP || dec_i.opcode == MXOP_JCXZ ||
@@ -1448,7 +1360,7 @@ int main(int argc,char **argv) {
                                     label->seg_v =
                                         dec_cs;
                                     label->ofs_v =
-                                        toffset;
+                                        (uint16_t)toffset;
                                 }
                             }
 
@@ -1476,7 +1388,7 @@ int main(int argc,char **argv) {
                                                     /* we can and should track internal references.
                                                      * do not track movable entry ordinal refs, because we already added those entry points to the label list */
                                                     if (relocent->intref.segment_index != 0xFF) {
-                                                        label = dec_find_label(relocent->intref.segment_index,dec_i.argv[0].value);
+                                                        label = dec_find_label(relocent->intref.segment_index,(uint16_t)dec_i.argv[0].value);
                                                         if (label == NULL) {
                                                             if ((label=dec_label_malloc()) != NULL) {
                                                                 if (dec_i.opcode == MXOP_JMP_FAR)
@@ -1487,7 +1399,7 @@ int main(int argc,char **argv) {
                                                                 label->seg_v =
                                                                     relocent->intref.segment_index;
                                                                 label->ofs_v =
-                                                                    dec_i.argv[0].value;
+                                                                    (uint16_t)dec_i.argv[0].value;
 
                                                                 printf("Target: 0x%04lx:0x%04lx internal ref, relocation by segment value\n",
                                                                     (unsigned long)label->seg_v,
@@ -1516,6 +1428,11 @@ int main(int argc,char **argv) {
         }
     }
 
+    if (show_timing) {
+        dec_label_print_timing("1st pass",clock() - t_pass);
+        t_pass = clock();
+    }
+
     /* sort labels */
     dec_label_sort();
 
@@ -2065,6 +1982,11 @@ int main(int argc,char **argv) {
         free(ne_segment_relocs);
     }
 
+    if (show_timing) {
+        dec_label_print_timing("2nd pass",clock() - t_pass);
+        dec_label_print_stats();
+    }
+
     mod_symbols_list_free(&mod_syms);
     exe_ne_header_imported_name_table_free(&ne_imported_name_table);
     exe_ne_header_entry_table_table_free(&ne_entry_table);
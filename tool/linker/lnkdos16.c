@@ -1972,6 +1972,32 @@ int segment_def_arrange(void) {
     return 0;
 }
 
+static struct omf_mem_image_t           in_image;           // current input file, if it could be loaded into memory
+static unsigned long                    in_image_offset = 0;
+
+// read from memory if the file is there, else from the file
+int read_record(struct omf_context_t * const ctx,int fd) {
+    int ret;
+
+    if (in_image.data == NULL)
+        return omf_context_read_fd(ctx,fd);
+
+    ret = omf_context_read_mem(ctx,in_image.data,in_image.length,&in_image_offset);
+    if (ret > 0 && omf_record_verify_checksum(&ctx->record) < 0) {
+        ctx->last_error = "Reading OMF record checksum failed";
+        return -1;
+    }
+
+    return ret;
+}
+
+int next_lib_module(struct omf_context_t * const ctx,int fd) {
+    if (in_image.data == NULL)
+        return omf_context_next_lib_module_fd(ctx,fd);
+
+    return omf_context_next_lib_module_mem(ctx,&in_image_offset);
+}
+
 int main(int argc,char **argv) {
     unsigned char diddump = 0;
     unsigned char pass;
@@ -2129,6 +2155,11 @@ int main(int argc,char **argv) {
             }
             current_in_file = inf;
 
+            /* if it fails, read the file instead */
+            in_image_offset = 0;
+            omf_mem_image_init(&in_image);
+            omf_mem_image_load(&in_image,in_file[inf]);
+
             // prepare parsing
             if ((omf_state=omf_context_create()) == NULL) {
                 fprintf(stderr,"Failed to init OMF parsing state\n");
@@ -2141,7 +2172,7 @@ int main(int argc,char **argv) {
             omf_context_begin_file(omf_state);
 
             do {
-                ret = omf_context_read_fd(omf_state,fd);
+                ret = read_record(omf_state,fd);
                 if (ret == 0) {
                     if (apply_FIXUPP(omf_state,0,inf,current_in_mod,pass))
                         return 1;
@@ -2156,7 +2187,7 @@ int main(int argc,char **argv) {
                         if (verbose)
                             printf("----- next module -----\n");
 
-                        ret = omf_context_next_lib_module_fd(omf_state,fd);
+                        ret = next_lib_module(omf_state,fd);
                         if (ret < 0) {
                             printf("Unable to advance to next .LIB module, %s\n",strerror(errno));
                             if (omf_state->last_error != NULL) fprintf(stderr,"Details: %s\n",omf_state->last_error);
@@ -2389,6 +2420,7 @@ int main(int argc,char **argv) {
 
             omf_context_clear(omf_state);
             omf_state = omf_context_destroy(omf_state);
+            omf_mem_image_free(&in_image);
 
             close(fd);
         }
@@ -0,0 +1,36 @@
+#!/bin/bash
+#
+# Link-time benchmark for lnkdos16 on a synthetic object set.
+#
+#   ./bench.sh [mods] [syms per module] [refs per module] [refs per library module]
+#
+# Default is 1000 modules x 50 symbols = 50,000 public symbols.
+#
+# The second run links module 0 against a library of the other modules,
+# which pulls in only the modules reachable from module 0 through the
+# library dictionary.
+mods=${1:-1000}
+syms=${2:-50}
+refs=${3:-16}
+librefs=${4:-1}
+
+LNKDOS16=../linux-host/lnkdos16
+if [ ! -x $LNKDOS16 ]; then
+    make -C .. || exit 1
+fi
+
+rm -Rf linux-host
+mkdir -p linux-host || exit 1
+python3 mkomf.py --mods $mods --syms $syms --refs $refs --out linux-host || exit 1
+
+args=""
+for i in linux-host/m*.obj; do args="$args -i $i"; done
+
+echo "Linking $mods modules, $((mods*syms)) symbols, $((mods*refs)) fixups"
+time $LNKDOS16 $args -of exe -o linux-host/bench.exe -map linux-host/bench.map || exit 1
+
+mkdir -p linux-host/lib || exit 1
+python3 mkomf.py --mods $mods --syms $syms --refs $librefs --lib bench.lib --out linux-host/lib || exit 1
+
+echo "Linking 1 module against a library of $((mods-1)) modules, $librefs refs per module"
+time $LNKDOS16 -i linux-host/lib/m00000.obj -i linux-host/lib/bench.lib -of exe -o linux-host/lib/bench.exe -map linux-host/lib/bench.map || exit 1
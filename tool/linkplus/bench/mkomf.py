@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+#
+# Generate a synthetic set of OMF object files for linker benchmarking.
+#
+# Each module defines <syms> public symbols in _TEXT, one local symbol, and
+# references <refs> random public symbols from the other modules through
+# EXTDEF + 16-bit offset FIXUPPs. Module 0 carries the entry point.
+#
+# With --lib, module 0 is written as an object file and the other modules
+# are packed into an OMF library with a dictionary, as wlib would.
+#
+# The output is deterministic for a given set of parameters.
+import argparse
+import random
+import struct
+
+def omf_record(rectype, body):
+    b = bytes([rectype]) + struct.pack('<H', len(body) + 1) + body
+    return b + bytes([(-sum(b)) & 0xFF])
+
+def omf_lenstr(s):
+    s = s.encode()
+    return bytes([len(s)]) + s
+
+def omf_index(i):
+    if i < 0x80:
+        return bytes([i])
+    return bytes([0x80 | (i >> 8), i & 0xFF])
+
+def sym_name(module, sym):
+    return "sym_%05u_%03u" % (module, sym)
+
+def omf_module(k, args):
+    r = random.Random(args.seed * 100003 + k)
+    tlen = max(args.refs * 2, 32)
+    out = b''
+
+    out += omf_record(0x80, omf_lenstr("mod%05u.c" % k))                     # THEADR
+    out += omf_record(0x96, omf_lenstr("") + omf_lenstr("_TEXT") + omf_lenstr("CODE") +
+                            omf_lenstr("_DATA") + omf_lenstr("DATA") + omf_lenstr("DGROUP")) # LNAMES
+    out += omf_record(0x98, bytes([(1 << 5) | (2 << 2)]) + struct.pack('<H', tlen) +
+                            omf_index(2) + omf_index(3) + omf_index(1))        # SEGDEF _TEXT byte public
+    out += omf_record(0x98, bytes([(3 << 5) | (2 << 2)]) + struct.pack('<H', 16) +
+                            omf_index(4) + omf_index(5) + omf_index(1))        # SEGDEF _DATA para public
+    out += omf_record(0x9A, omf_index(6) + bytes([0xFF]) + omf_index(2))      # GRPDEF DGROUP
+
+    refs = [sym_name(r.randrange(args.mods), r.randrange(args.syms)) for j in range(args.refs)]
+    if refs:
+        out += omf_record(0x8C, b''.join(omf_lenstr(n) + omf_index(0) for n in refs)) # EXTDEF
+
+    body = omf_index(0) + omf_index(1)
+    for s in range(args.syms):
+        body += omf_lenstr(sym_name(k, s)) + struct.pack('<H', s % tlen) + omf_index(0)
+        if len(body) > 900:
+            out += omf_record(0x90, body)                                       # PUBDEF
+            body = omf_index(0) + omf_index(1)
+    if len(body) > 2:
+        out += omf_record(0x90, body)
+    out += omf_record(0xB6, omf_index(0) + omf_index(1) + omf_lenstr("local_sym") +
+                            struct.pack('<H', 0) + omf_index(0))               # LPUBDEF
+
+    data = bytes(r.randrange(256) for _ in range(tlen))
+    out += omf_record(0xA0, omf_index(1) + struct.pack('<H', 0) + data)       # LEDATA _TEXT
+
+    # FIXUP: M=1 (segment relative), location 1 (16-bit offset), F5 (frame by target), T2 (EXTDEF), P=1 (no displacement)
+    body = b''
+    for j in range(len(refs)):
+        ofs = j * 2
+        body += bytes([0x80 | 0x40 | (1 << 2) | (ofs >> 8), ofs & 0xFF, 0x56]) + omf_index(j + 1)
+    if body:
+        out += omf_record(0x9C, body)                                           # FIXUPP
+
+    data = bytes(r.randrange(256) for _ in range(16))
+    out += omf_record(0xA0, omf_index(2) + struct.pack('<H', 0) + data)       # LEDATA _DATA
+
+    if k == 0:
+        out += omf_record(0x8A, bytes([0xC0, 0x00]) + omf_index(1) + omf_index(1) + struct.pack('<H', 0)) # MODEND, start
+    else:
+        out += omf_record(0x8A, bytes([0x00]))                                  # MODEND
+
+    return out
+
+# .LIB dictionary hash. see fmt/omf/omfldict.c
+def rol16(v, n):
+    return ((v << n) | (v >> (16 - n))) & 0xFFFF
+
+def ror16(v, n):
+    return ((v >> n) | (v << (16 - n))) & 0xFFFF
+
+def libhash(name, nblocks):
+    block_x = bucket_d = len(name) | 0x20
+    block_d = bucket_x = 0
+    front, back, n = 0, len(name), len(name)
+    while True:
+        back -= 1
+        c = name[back] | 0x20
+        bucket_x = ror16(bucket_x, 2) ^ c
+        block_d = rol16(block_d, 2) ^ c
+        n -= 1
+        if n == 0:
+            break
+        c = name[front] | 0x20
+        front += 1
+        block_x = rol16(block_x, 2) ^ c
+        bucket_d = ror16(bucket_d, 2) ^ c
+    block_x %= nblocks
+    block_d = (block_d % nblocks) or 1
+    bucket_x %= 37
+    bucket_d = (bucket_d % 37) or 1
+    return block_x, block_d, bucket_x, bucket_d
+
+# build a dictionary of nblocks 512-byte blocks, or None if the names do not fit
+def lib_dictionary(syms, nblocks):
+    blocks = [bytearray(512) for _ in range(nblocks)]
+    for b in blocks:
+        b[37] = 38 // 2                                                         # first free entry
+    for name, page in syms:
+        block_x, block_d, bucket_x, bucket_d = libhash(name, nblocks)
+        ent = bytes([len(name)]) + name + struct.pack('<H', page)
+        placed = False
+        for bt in range(nblocks):
+            blk = blocks[block_x]
+            bucket = bucket_x
+            if blk[37] != 0xFF:
+                for ut in range(37):
+                    if blk[bucket] == 0:
+                        free = blk[37] * 2
+                        if free + len(ent) <= 512:
+                            blk[bucket] = free // 2
+                            blk[free:free + len(ent)] = ent
+                            free += len(ent) + (len(ent) & 1)
+                            blk[37] = free // 2 if free < 512 else 0xFF
+                            placed = True
+                        else:
+                            blk[37] = 0xFF
+                        break
+                    bucket = (bucket + bucket_d) % 37
+            if placed:
+                break
+            block_x = (block_x + block_d) % nblocks
+        if not placed:
+            return None
+    return b''.join(bytes(b) for b in blocks)
+
+# dictionary sizes, in blocks, are prime
+def lib_dictionary_sizes(syms):
+    need = sum(len(n) + 4 for n, page in syms) // (512 - 38) + 1
+    for n in range(max(need, 2), 0x10000):
+        if all(n % d for d in range(2, int(n ** 0.5) + 1)):
+            yield n
+
+# modules is a list of (public names, module bytes)
+def omf_library(modules, pagesize=16):
+    out = bytearray(pagesize)                                                   # LIBHEAD, filled in last
+    syms = []
+    for names, data in modules:
+        page = len(out) // pagesize
+        if page > 0xFFFF:
+            raise ValueError("library too large for page size %u" % pagesize)
+        syms += [(n.encode(), page) for n in names]
+        out += data
+        out += bytes(-len(out) % pagesize)
+
+    # LIBEND, padded so the dictionary starts on a 512-byte boundary
+    pad = -(len(out) + 4) % 512
+    out += omf_record(0xF1, bytes(pad))
+    dictofs = len(out)
+
+    for nblocks in lib_dictionary_sizes(syms):
+        d = lib_dictionary(syms, nblocks)
+        if d is not None:
+            break
+    else:
+        raise ValueError("too many public symbols for the library dictionary")
+    out += d
+
+    hdr = struct.pack('<IHB', dictofs, nblocks, 0x01)                          # case sensitive
+    out[0:pagesize] = omf_record(0xF0, hdr + bytes(pagesize - 4 - len(hdr)))
+    return bytes(out)
+
+def main():
+    ap = argparse.ArgumentParser(description="Generate synthetic OMF objects for linker benchmarks")
+    ap.add_argument('--mods', type=int, default=1000, help="number of object files")
+    ap.add_argument('--syms', type=int, default=50, help="public symbols per object")
+    ap.add_argument('--refs', type=int, default=16, help="external references (fixups) per object")
+    ap.add_argument('--seed', type=int, default=1)
+    ap.add_argument('--out', default=".", help="output directory")
+    ap.add_argument('--lib', help="pack modules 1 and up into this library")
+    args = ap.parse_args()
+
+    if args.lib:
+        with open("%s/m%05u.obj" % (args.out, 0), "wb") as f:
+            f.write(omf_module(0, args))
+        mods = [([sym_name(k, s) for s in range(args.syms)], omf_module(k, args)) for k in range(1, args.mods)]
+        pagesize = 16
+        while len(mods) > 0 and sum(len(m[1]) + pagesize for m in mods) // pagesize > 0xFFFF:
+            pagesize *= 2
+        with open("%s/%s" % (args.out, args.lib), "wb") as f:
+            f.write(omf_library(mods, pagesize))
+        return
+
+    for k in range(args.mods):
+        with open("%s/m%05u.obj" % (args.out, k), "wb") as f:
+            f.write(omf_module(k, args))
+
+if __name__ == "__main__":
+    main()
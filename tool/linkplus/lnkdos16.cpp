@@ -12,6 +12,11 @@
 #include <fcntl.h>
 #include <stdio.h>
 
+#if defined(LINUX)
+# include <sys/mman.h>
+# include <sys/resource.h>
+#endif
+
 extern "C" {
 #include <fmt/omf/omf.h>
 #include <fmt/omf/omfcstr.h>
@@ -20,6 +25,14 @@ extern "C" {
 using namespace std;
 
 #include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <new>
+#include <map>
 #include <memory>
 #include <vector>
 #include <string>
@@ -89,8 +102,186 @@ static inline alignMask alignValueToAlignMask(const alignMask &v) {
 
 static FILE*                            map_fp = NULL;
 
+/* Heap allocation counters, reported by -stats */
+static atomic<unsigned long long>       heap_alloc_count(0);
+static atomic<unsigned long long>       heap_alloc_bytes(0);
+
+void *operator new(size_t sz) {
+    void *p;
+
+    heap_alloc_count.fetch_add(1,memory_order_relaxed);
+    heap_alloc_bytes.fetch_add(sz,memory_order_relaxed);
+
+    if (sz == 0) sz = 1;
+    while ((p=malloc(sz)) == NULL) {
+        new_handler h = get_new_handler();
+        if (h == NULL) throw bad_alloc();
+        h();
+    }
+
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+/* Arena for the many small objects of a link (fragments, symbols, relocations).
+ * Each thread carves allocations out of its own chunk, so objects parsed from one module sit together
+ * and there is no locking except when a chunk is used up. Nothing is freed individually. The chunks are
+ * freed all at once when the program exits, so nothing that grows or is freed early (fragment images)
+ * belongs here: every buffer a vector outgrows would stay behind in the arena. */
+struct link_arena {
+    static const size_t                 chunk_size = 1024u * 1024u;
+
+    mutex                               lock;
+    vector<unsigned char*>              chunks;
+    atomic<unsigned long long>          alloc_count;
+    atomic<unsigned long long>          alloc_bytes;
+    atomic<unsigned long long>          chunk_bytes;
+
+    link_arena() : alloc_count(0), alloc_bytes(0), chunk_bytes(0) { }
+    ~link_arena() {
+        for (auto i=chunks.begin();i!=chunks.end();i++) free(*i);
+        chunks.clear();
+    }
+
+    unsigned char *new_chunk(const size_t sz) {
+        unsigned char *p = (unsigned char*)malloc(sz);
+        if (p == NULL) throw bad_alloc();
+
+        lock_guard<mutex> guard(lock);
+        chunks.push_back(p);
+        chunk_bytes += sz;
+        return p;
+    }
+
+    void *alloc(size_t sz) {
+        static thread_local unsigned char *next = NULL;
+        static thread_local size_t left = 0;
+        const size_t align = alignof(max_align_t);
+        unsigned char *p;
+
+        sz = (sz + align - 1u) & (~(align - 1u));
+        alloc_count.fetch_add(1,memory_order_relaxed);
+        alloc_bytes.fetch_add(sz,memory_order_relaxed);
+
+        /* large requests get a chunk of their own, the current chunk continues to be used */
+        if (sz > (chunk_size / 4u))
+            return new_chunk(sz);
+
+        if (left < sz) {
+            next = new_chunk(chunk_size);
+            left = chunk_size;
+        }
+
+        p = next;
+        next += sz;
+        left -= sz;
+        return p;
+    }
+
+    static link_arena &get(void) {
+        static link_arena arena;
+        return arena;
+    }
+};
+
+template <class T> struct link_arena_allocator {
+    typedef T                           value_type;
+
+    link_arena_allocator() { }
+    template <class U> link_arena_allocator(const link_arena_allocator<U> &) { }
+
+    T *allocate(const size_t n) {
+        return (T*)link_arena::get().alloc(n * sizeof(T));
+    }
+    void deallocate(T *,const size_t) {
+    }
+};
+
+template <class T,class U> bool operator==(const link_arena_allocator<T> &,const link_arena_allocator<U> &) { return true; }
+template <class T,class U> bool operator!=(const link_arena_allocator<T> &,const link_arena_allocator<U> &) { return false; }
+
+/* Link profile, reported by -ptime: wall time per phase and what was processed */
+struct link_profile {
+    typedef chrono::steady_clock        clock;
+
+    bool                                enabled;
+    clock::time_point                   last;
+    vector< pair<string,double> >       phases;             /* seconds, in order of first use */
+    atomic<unsigned long>               records[256];       /* OMF records read, by record type (modules are parsed in parallel) */
+    unsigned long                       fixups[16];         /* fixups applied, by location */
+    unsigned long long                  bytes_written;      /* bytes written to the output file */
+
+    link_profile() : enabled(false), bytes_written(0) {
+        for (unsigned int i=0;i < 256;i++) records[i].store(0);
+        for (unsigned int i=0;i < 16;i++) fixups[i] = 0;
+    }
+
+    void begin(void) {
+        enabled = true;
+        last = clock::now();
+    }
+
+    /* the named phase ends now. time is added to it if already seen */
+    void phase(const char *name) {
+        if (!enabled) return;
+
+        const clock::time_point now = clock::now();
+        const double t = chrono::duration<double>(now - last).count();
+
+        last = now;
+        for (auto i=phases.begin();i!=phases.end();i++) {
+            if (i->first == name) {
+                i->second += t;
+                return;
+            }
+        }
+
+        phases.push_back(make_pair(string(name),t));
+    }
+
+    void record(const unsigned char rectype) {
+        if (enabled) records[rectype].fetch_add(1,memory_order_relaxed);
+    }
+
+    void fixup(const unsigned char location) {
+        if (enabled) fixups[location & 15u]++;
+    }
+
+    void written(const size_t bytes) {
+        bytes_written += bytes;
+    }
+};
+
+static link_profile                     link_prof;
+
 struct input_file;
 struct link_segdef;
+struct link_symbol;
+
+/* Symbol table. Symbols are kept in the order they were defined, and also indexed by name so that
+ * lookups (one per EXTDEF fixup, one per PUBDEF) do not have to walk the entire list. Local symbols
+ * go into the same index and are filtered by file/module scope at lookup time. */
+struct link_symbol_table {
+    typedef vector< shared_ptr<struct link_symbol> > list_t;
+
+    list_t                              symbols;            /* all symbols, in order of definition (until sorted for the map file) */
+    unordered_map<string,list_t>        by_name;            /* name -> all symbols of that name, in order of definition */
+
+    list_t::iterator begin(void) { return symbols.begin(); }
+    list_t::iterator end(void) { return symbols.end(); }
+    size_t size(void) const { return symbols.size(); }
+    bool empty(void) const { return symbols.empty(); }
+    shared_ptr<struct link_symbol> &operator[](const size_t i) { return symbols[i]; }
+
+    void push_back(const shared_ptr<struct link_symbol> &sym);
+    void clear(void) {
+        symbols.clear();
+        by_name.clear();
+    }
+};
 
 typedef shared_ptr<struct seg_fragment> fragmentRef;
 static const fragmentRef                fragmentRefUndef = shared_ptr<struct seg_fragment>(nullptr);
@@ -113,11 +304,12 @@ struct input_module {
     size_t                              index = ~((size_t)(0u));
     string                              name;
     weak_ptr<input_file>                file;
+    fileOffset                          offset = 0;         /* file offset of the module's first record */
 
     struct omf_context_t*               omf_state = NULL;
 
     vector< shared_ptr<struct link_segdef> > link_segments;
-    vector< shared_ptr<struct link_symbol> > link_symbols;
+    link_symbol_table                   link_symbols;
     entrypoint                          entry_point;
 
     ~input_module() {
@@ -130,11 +322,48 @@ struct input_module {
 
 typedef shared_ptr<input_module>        in_fileModuleRef;
 
+/* location of one OMF record within an input image */
+struct input_record {
+    fileOffset                          offset = 0;         /* file offset of the record header */
+    uint16_t                            reclen = 0;         /* record length from the header (includes checksum) */
+    uint8_t                             rectype = 0;        /* record type */
+};
+
+/* An input file, read into memory once (memory mapped if possible) along with an index of
+ * the OMF records within it. Parsing works from the index and the in-memory copy instead
+ * of issuing a read() for every record header and body, and an lseek() for every module
+ * of a .LIB file. */
+struct input_image {
+    const unsigned char*                data = NULL;        /* file contents */
+    size_t                              length = 0;         /* file size */
+    vector<input_record>                records;            /* OMF records, in file order */
+    unsigned short                      library_block_size = 0;/* is .LIB archive if nonzero */
+    vector<unsigned char>               buffer;             /* file contents, if not memory mapped */
+#if defined(LINUX)
+    void*                               mapped = NULL;      /* mmap() of file contents */
+#endif
+
+    input_image() { }
+    input_image(const input_image &) = delete;
+    input_image &operator=(const input_image &) = delete;
+    ~input_image() {
+#if defined(LINUX)
+        if (mapped != NULL) {
+            munmap(mapped,length);
+            mapped = NULL;
+        }
+#endif
+    }
+};
+
 static const in_fileModuleRef           in_fileModuleRefUndef = nullptr;
 
 struct input_file {
     string                              path;
     vector< shared_ptr<input_module> >  modules;
+    shared_ptr<input_image>             image;
+    struct omf_libdict_t                libdict;            /* .LIB dictionary, if any */
+    unordered_set<fileOffset>           libdict_loaded;     /* modules already pulled in through the dictionary */
     int                                 segment_group;
 
     enum special_t {
@@ -145,7 +374,10 @@ struct input_file {
 
     enum special_t                      special;
 
-    input_file() : segment_group(-1), special(SPEC_NONE) { }
+    input_file() : segment_group(-1), special(SPEC_NONE) { omf_libdict_init(&libdict); }
+    input_file(const input_file &) = delete;
+    input_file &operator=(const input_file &) = delete;
+    ~input_file() { omf_libdict_free(&libdict); }
 };
 
 typedef shared_ptr<input_file>          in_fileRef;             /* ref file */
@@ -164,12 +396,17 @@ struct cmdoptions {
     unsigned int                        verbose:1;
     unsigned int                        prefer_flat:1;
     unsigned int                        def_segsym:1;
+    unsigned int                        incremental:1;
+    unsigned int                        stats:1;
+    unsigned int                        ptime:1;
 
     unsigned int                        output_format;
     unsigned int                        output_format_variant;
 
     int                                 next_segment_group;
 
+    unsigned int                        parse_threads;                  /* threads to parse input modules with, 0 = one per CPU */
+
     segmentSize                         want_stack_size;
 
     segmentBase                         image_base_segment_reloc_adjust;/* segment value to add to relocation entries in order to work with relocation fixup code (COMREL) */
@@ -180,12 +417,13 @@ struct cmdoptions {
     string                              hex_output;
     string                              out_file;
     string                              map_file;
+    string                              ptime_json;                     /* -ptime-json file, "-" for stdout */
 
     vector< shared_ptr<input_file> >    in_file;
     vector<segment_group>               segment_groups;
 
-    cmdoptions() : do_dosseg(true), verbose(false), prefer_flat(false), def_segsym(false), output_format(OFMT_COM),
-                   output_format_variant(OFMTVAR_NONE), next_segment_group(-1), want_stack_size(4096),
+    cmdoptions() : do_dosseg(true), verbose(false), prefer_flat(false), def_segsym(false), incremental(false), stats(false), ptime(false), output_format(OFMT_COM),
+                   output_format_variant(OFMTVAR_NONE), next_segment_group(-1), parse_threads(0), want_stack_size(4096),
                    image_base_segment_reloc_adjust(segmentBaseUndef), image_base_segment(segmentBaseUndef),
                    image_base_offset(segmentOffsetUndef), dosdrv_header_symbol("_dosdrv_header") { }
 
@@ -205,7 +443,7 @@ struct cmdoptions {
 
 static cmdoptions                       cmdoptions;
 
-static int                              current_segment_group = -1;
+static thread_local int                 current_segment_group = -1; /* per thread, modules are parsed in parallel */
 
 const char *get_in_file(const in_fileRef idx) {
     if (idx != in_fileRefUndef) {
@@ -289,7 +527,7 @@ struct exe_relocation {
 };
 
 shared_ptr<struct exe_relocation> new_exe_relocation(vector< shared_ptr<struct exe_relocation> > &exe_relocation_table) {
-    shared_ptr<struct exe_relocation> r(new struct exe_relocation);
+    shared_ptr<struct exe_relocation> r = allocate_shared<struct exe_relocation>(link_arena_allocator<struct exe_relocation>());
     exe_relocation_table.push_back(r);
     return r;
 }
@@ -311,16 +549,27 @@ struct link_symbol {
     link_symbol() : offset(0), fragment(fragmentRefUndef), in_file(in_fileRefUndef), in_module(in_fileModuleRefUndef), is_local(0) { }
 };
 
-shared_ptr<struct link_symbol> new_link_symbol(vector< shared_ptr<struct link_symbol> > &link_symbols,const char *name) {
-    shared_ptr<struct link_symbol> sym(new struct link_symbol);
+void link_symbol_table::push_back(const shared_ptr<struct link_symbol> &sym) {
+    symbols.push_back(sym);
+    by_name[sym->name].push_back(sym);
+}
+
+shared_ptr<struct link_symbol> new_link_symbol(link_symbol_table &link_symbols,const char *name) {
+    shared_ptr<struct link_symbol> sym = allocate_shared<struct link_symbol>(link_arena_allocator<struct link_symbol>());
+    sym->name = name; /* NTS: name must be set before adding to the table, it is the index key */
     link_symbols.push_back( sym );
-    sym->name = name;
     return sym;
 }
 
-shared_ptr<struct link_symbol> find_link_symbol(vector< shared_ptr<struct link_symbol> > &link_symbols,const char *name,const in_fileRef in_file,const in_fileModuleRef in_module) {
-    for (size_t i=0;i < link_symbols.size();i++) {
-        shared_ptr<struct link_symbol> sym = link_symbols[i];
+shared_ptr<struct link_symbol> find_link_symbol(link_symbol_table &link_symbols,const char *name,const in_fileRef in_file,const in_fileModuleRef in_module) {
+    auto bucket = link_symbols.by_name.find(name);
+    if (bucket == link_symbols.by_name.end())
+        return NULL;
+
+    /* every symbol in the bucket has the same name, only the scope needs to be checked */
+    const link_symbol_table::list_t &candidates = bucket->second;
+    for (size_t i=0;i < candidates.size();i++) {
+        const shared_ptr<struct link_symbol> &sym = candidates[i];
 
         if (sym->is_local) {
             /* ignore local symbols unless file/module scope is given */
@@ -330,8 +579,7 @@ shared_ptr<struct link_symbol> find_link_symbol(vector< shared_ptr<struct link_s
                 continue;
         }
 
-        if (sym->name == name)
-            return link_symbols[i];
+        return sym;
     }
 
     return NULL;
@@ -353,6 +601,10 @@ struct seg_fragment {
                      offset(segmentOffsetUndef), fragment_length(segmentSizeUndef), fragment_alignment(byteAlignMask), attr({0,0,{0}}) { }
 };
 
+shared_ptr<struct seg_fragment> new_seg_fragment(void) {
+    return allocate_shared<struct seg_fragment>(link_arena_allocator<struct seg_fragment>());
+}
+
 struct link_segdef {
     struct omf_segdef_attr_t            attr;               /* segment attributes */
     string                              name;               /* name of segment */
@@ -610,13 +862,13 @@ void owlink_stack_bss_arrange(vector< shared_ptr<struct link_segdef> > &link_seg
 }
 
 shared_ptr<struct seg_fragment> alloc_link_segment_fragment(struct link_segdef *sg) {
-    shared_ptr<struct seg_fragment> frag(new struct seg_fragment);
+    shared_ptr<struct seg_fragment> frag = new_seg_fragment();
     sg->fragments.push_back(frag);
     return frag;
 }
 
 shared_ptr<struct seg_fragment> alloc_link_segment_fragment(struct link_segdef *sg,size_t &index) {
-    shared_ptr<struct seg_fragment> frag(new struct seg_fragment);
+    shared_ptr<struct seg_fragment> frag = new_seg_fragment();
     index = sg->fragments.size();
     sg->fragments.push_back(frag);
     return frag;
@@ -746,7 +998,7 @@ bool link_segments_qsort_by_fileofs(const shared_ptr<struct link_segdef> &sa,con
     return sa->file_offset < sb->file_offset;
 }
 
-void dump_link_symbols(vector< shared_ptr<struct link_symbol> > &link_symbols) {
+void dump_link_symbols(link_symbol_table &link_symbols) {
     unsigned int i,pass=0,passes=1;
 
     if (map_fp != NULL)
@@ -1165,7 +1417,7 @@ int ledata_add(vector< shared_ptr<struct link_segdef> > &link_segments,struct om
     return 0;
 }
 
-int fixupp_get(vector< shared_ptr<struct link_symbol> > &link_symbols,vector< shared_ptr<struct link_segdef> > &link_segments,struct omf_context_t *omf_state,unsigned long *fseg,unsigned long *fofs,shared_ptr<struct link_segdef> *sdef,const struct omf_fixupp_t *ent,unsigned int method,unsigned int index,in_fileRef in_file,in_fileModuleRef in_module) {
+int fixupp_get(link_symbol_table &link_symbols,vector< shared_ptr<struct link_segdef> > &link_segments,struct omf_context_t *omf_state,unsigned long *fseg,unsigned long *fofs,shared_ptr<struct link_segdef> *sdef,const struct omf_fixupp_t *ent,unsigned int method,unsigned int index,in_fileRef in_file,in_fileModuleRef in_module) {
     *fseg = *fofs = ~0UL;
     *sdef = NULL;
     (void)ent;
@@ -1236,7 +1488,7 @@ int fixupp_get(vector< shared_ptr<struct link_symbol> > &link_symbols,vector< sh
     return 0;
 }
 
-int apply_FIXUPP(vector< shared_ptr<struct exe_relocation> > &exe_relocation_table,vector< shared_ptr<struct link_symbol> > &link_symbols,vector< shared_ptr<struct link_segdef> > &link_segments,struct omf_context_t *omf_state,in_fileRef in_file,in_fileModuleRef in_module,unsigned int pass) {
+int apply_FIXUPP(vector< shared_ptr<struct exe_relocation> > &exe_relocation_table,link_symbol_table &link_symbols,vector< shared_ptr<struct link_segdef> > &link_segments,struct omf_context_t *omf_state,in_fileRef in_file,in_fileModuleRef in_module,unsigned int pass) {
     shared_ptr<struct link_segdef> frame_sdef;
     shared_ptr<struct link_segdef> targ_sdef;
     const struct omf_segdef_t *cur_segdef;
@@ -1358,6 +1610,9 @@ int apply_FIXUPP(vector< shared_ptr<struct exe_relocation> > &exe_relocation_tab
             continue;
         }
 
+        if (pass == PASS_BUILD)
+            link_prof.fixup(ent->location);
+
         switch (ent->location) {
             case OMF_FIXUPP_LOCATION_16BIT_OFFSET: /* 16-bit offset */
                 if (pass == PASS_BUILD) {
@@ -1538,7 +1793,7 @@ int grpdef_add(vector< shared_ptr<struct link_segdef> > &link_segments,struct om
     return 0;
 }
 
-int pubdef_add(vector< shared_ptr<struct link_symbol> > &link_symbols,vector< shared_ptr<struct link_segdef> > &link_segments,struct omf_context_t *omf_state,unsigned int tag,in_fileRef in_file,in_fileModuleRef in_module) {
+int pubdef_add(link_symbol_table &link_symbols,vector< shared_ptr<struct link_segdef> > &link_segments,struct omf_context_t *omf_state,unsigned int tag,in_fileRef in_file,in_fileModuleRef in_module) {
     const unsigned char is_local = (tag == OMF_RECTYPE_LPUBDEF) || (tag == OMF_RECTYPE_LPUBDEF32);
     unsigned int first = 0;
 
@@ -1667,9 +1922,182 @@ int segdef_add(vector< shared_ptr<struct link_segdef> > &link_segments,struct om
     return 0;
 }
 
+int input_image_load(struct input_image &img,const char *path) {
+    struct stat st;
+    int fd;
+
+    fd = open(path,O_RDONLY|O_BINARY);
+    if (fd < 0) {
+        fprintf(stderr,"Failed to open input file %s\n",strerror(errno));
+        return -1;
+    }
+
+    if (fstat(fd,&st) < 0 || st.st_size < 0 || (unsigned long long)st.st_size > 0xFFFFFFFFull) {
+        fprintf(stderr,"Failed to stat input file %s\n",path);
+        close(fd);
+        return -1;
+    }
+
+    img.length = (size_t)st.st_size;
+    img.data = NULL;
+
+#if defined(LINUX)
+    if (img.length != 0) {
+        void *p = mmap(NULL,img.length,PROT_READ,MAP_PRIVATE,fd,0);
+        if (p != MAP_FAILED) {
+            img.mapped = p;
+            img.data = (const unsigned char*)p;
+        }
+    }
+#endif
+
+    if (img.data == NULL && img.length != 0) {
+        size_t rd = 0;
+
+        img.buffer.resize(img.length);
+        while (rd < img.length) {
+            const ssize_t r = read(fd,&img.buffer[rd],img.length - rd);
+            if (r <= 0) {
+                fprintf(stderr,"Failed to read input file %s\n",path);
+                close(fd);
+                return -1;
+            }
+            rd += (size_t)r;
+        }
+
+        img.data = &img.buffer[0];
+    }
+
+    close(fd);
+    return 0;
+}
+
+/* locate the OMF records in the image starting at pos, following the same rules as omf_context_read_fd()
+ * and omf_context_next_lib_module_fd(), and add them to the index. If one_module is set, stop at the end
+ * of the module. Returns -1 if a bad record is encountered, in which case the records up to that point
+ * are still indexed. */
+int input_image_index_from(struct input_image &img,size_t pos,const bool one_module,const char **last_error) {
+    *last_error = NULL;
+
+    while ((pos+3) <= img.length) {
+        const unsigned char *hdr = img.data + pos;
+        struct input_record r;
+
+        r.offset = (fileOffset)pos;
+        r.rectype = hdr[0];
+        r.reclen = le16toh(*((uint16_t*)(hdr+1))); // length (including checksum)
+        if (r.rectype == 0 || r.reclen == 0)
+            break;
+
+        if ((pos+3+(size_t)r.reclen) > img.length) {
+            *last_error = "Reading OMF record contents failed";
+            return -1;
+        }
+
+        /* check checksum */
+        if (hdr[3+r.reclen-1] != 0/*optional*/) {
+            unsigned char sum = 0;
+
+            for (size_t i=0;i < (3+(size_t)r.reclen);i++)
+                sum += hdr[i];
+
+            if (sum != 0) {
+                *last_error = "Reading OMF record checksum failed";
+                return -1;
+            }
+        }
+
+        /* remember LIBHEAD block size */
+        if (r.rectype == 0xF0/*LIBHEAD*/) {
+            if (img.library_block_size == 0) {
+                // and the length of the record defines the block size that modules within are aligned by
+                img.library_block_size = r.reclen + 3;
+            }
+            else {
+                *last_error = "LIBHEAD defined again";
+                return -1;
+            }
+        }
+
+        img.records.push_back(r);
+        pos += 3 + (size_t)r.reclen;
+
+        // LIBEND, non-OMF junk usually follows (the .LIB dictionary)
+        if (r.rectype == 0xF1)
+            break;
+
+        // MODEND. if a .LIB, the next module starts on the next block boundary, else stop
+        if ((r.rectype&0xFE) == 0x8A) {
+            if (img.library_block_size == 0 || one_module)
+                break;
+
+            pos += img.library_block_size - 1u;
+            pos -= pos % img.library_block_size;
+        }
+    }
+
+    return 0;
+}
+
+/* index all OMF records in the image */
+int input_image_index(struct input_image &img,const char **last_error) {
+    img.records.clear();
+    img.library_block_size = 0;
+    return input_image_index_from(img,0,false,last_error);
+}
+
+/* in-memory counterpart of omf_context_read_fd(). *rec_i is the next record in the index */
+int input_image_read_record(struct omf_context_t * const ctx,const struct input_image &img,size_t *rec_i) {
+    // if the last record was a LIBEND or MODEND, then stop reading.
+    if (ctx->record.rectype == 0xF1 || omf_record_is_modend(&ctx->record))
+        return 0;
+    if (*rec_i >= img.records.size())
+        return 0;
+
+    const struct input_record &r = img.records[(*rec_i)++];
+    unsigned long ofs = r.offset;
+
+    // LIBHEAD sets the block size again, which the reader would otherwise take as a second LIBHEAD
+    if (r.rectype == 0xF0/*LIBHEAD*/)
+        ctx->library_block_size = 0;
+
+    // the record is not copied, it points into the image
+    if (omf_context_read_mem(ctx,img.data,img.length,&ofs) <= 0) {
+        if (ctx->last_error == NULL) ctx->last_error = "Reading OMF record failed";
+        errno = EIO;
+        return -1;
+    }
+
+    link_prof.record(r.rectype);
+    return 1;
+}
+
+/* in-memory counterpart of omf_context_next_lib_module_fd() */
+int input_image_next_lib_module(struct omf_context_t * const ctx,const struct input_image &img,size_t *rec_i) {
+    // if the last record was a LIBEND, then stop reading.
+    if (ctx->record.rectype == 0xF1)
+        return 0;
+
+    // if the last record was not a MODEND, then stop reading.
+    if (!omf_record_is_modend(&ctx->record)) {
+        errno = EIO;
+        return -1;
+    }
+
+    // if we don't have a block size, or no records follow, then we cannot advance
+    if (img.library_block_size == 0 || *rec_i >= img.records.size())
+        return 0;
+
+    ctx->record.rec_file_offset = img.records[*rec_i].offset;
+    ctx->record.rectype = 0;
+    ctx->record.reclen = 0;
+    return 1;
+}
+
 static void help(void) {
     fprintf(stderr,"lnkdos16 [options]\n");
-    fprintf(stderr,"  -i <file>    OMF file to link\n");
+    fprintf(stderr,"  -i <file>    OMF file to link. From a .LIB with a dictionary, only modules\n");
+    fprintf(stderr,"               that resolve external symbols are linked\n");
     fprintf(stderr,"  -o <file>    Output file\n");
     fprintf(stderr,"  -map <file>  Map/report file\n");
     fprintf(stderr,"  -of <fmt>    Output format (COM, EXE, COMREL)\n");
@@ -1680,6 +2108,11 @@ static void help(void) {
     fprintf(stderr,"                DOSDRVREL = flat MS-DOS driver (SYS), relocateable\n");
     fprintf(stderr,"                DOSDRVEXE = MS-DOS driver (EXE)\n");
     fprintf(stderr,"  -v           Verbose mode\n");
+    fprintf(stderr,"  -j <n>       Parse input modules on n threads (default one per CPU)\n");
+    fprintf(stderr,"  -inc         Incremental link, using a cache kept next to the output file\n");
+    fprintf(stderr,"  -stats       Report peak memory and allocation counts when done\n");
+    fprintf(stderr,"  -ptime       Report time per link phase, records read, fixups applied\n");
+    fprintf(stderr,"  -ptime-json <file>  Same as -ptime, as JSON to file (- for stdout)\n");
     fprintf(stderr,"  -d           Dump memory state after parsing\n");
     fprintf(stderr,"  -no-dosseg   No DOSSEG sort order\n");
     fprintf(stderr,"  -dosseg      DOSSEG sort order\n");
@@ -1904,7 +2337,7 @@ void linkseg_add_padding_fragments(struct link_segdef *sg) {
         }
         if (expect < frag->offset) {
             const segmentOffset gap = frag->offset - expect;
-            shared_ptr<seg_fragment> nf(new seg_fragment);
+            shared_ptr<seg_fragment> nf = new_seg_fragment();
 
             nf->in_file = in_fileRefPadding;
             nf->offset = expect;
@@ -2019,7 +2452,7 @@ int parse_MODEND(vector< shared_ptr<struct link_segdef> > &link_segments,struct
     return 0;
 }
 
-int apply_relocation_fixup(vector< shared_ptr<struct exe_relocation> > &exe_relocation_table,vector< shared_ptr<struct link_symbol> > &link_symbols,vector< shared_ptr<struct link_segdef> > &link_segments) {
+int apply_relocation_fixup(vector< shared_ptr<struct exe_relocation> > &exe_relocation_table,link_symbol_table &link_symbols,vector< shared_ptr<struct link_segdef> > &link_segments) {
     for (auto fi=cmdoptions.in_file.begin();fi!=cmdoptions.in_file.end();fi++) {
         auto in_file = *fi;
 
@@ -2036,7 +2469,7 @@ int apply_relocation_fixup(vector< shared_ptr<struct exe_relocation> > &exe_relo
     return 0;
 }
 
-int compute_exe_relocations(vector< shared_ptr<struct exe_relocation> > &exe_relocation_table,vector< shared_ptr<struct link_symbol> > &link_symbols,vector< shared_ptr<struct link_segdef> > &link_segments) {
+int compute_exe_relocations(vector< shared_ptr<struct exe_relocation> > &exe_relocation_table,link_symbol_table &link_symbols,vector< shared_ptr<struct link_segdef> > &link_segments) {
     for (auto fi=cmdoptions.in_file.begin();fi!=cmdoptions.in_file.end();fi++) {
         auto in_file = *fi;
 
@@ -2095,112 +2528,1166 @@ void ensure_minimum_stack(vector< shared_ptr<struct link_segdef> > &link_segment
     }
 }
 
-int main(int argc,char **argv) {
-    entrypoint entry_point;
-    vector< shared_ptr<struct link_segdef> > link_segments;
-    vector< shared_ptr<struct link_symbol> > link_symbols;
-    vector< shared_ptr<struct exe_relocation> > exe_relocation_table;
-    unsigned char diddump = 0;
-    int i,fd,ret;
-    char *a;
-
-    in_fileRefPadding.reset(new input_file);
-    in_fileRefPadding->path = "<padding>";
-    in_fileRefPadding->special = input_file::SPEC_PADDING;
-
-    in_fileRefInternal.reset(new input_file);
-    in_fileRefInternal->path = "<internal>";
-    in_fileRefInternal->special = input_file::SPEC_INTERNAL;
-
-    for (i=1;i < argc;) {
-        a = argv[i++];
-
-        if (*a == '-') {
-            do { a++; } while (*a == '-');
+/* read and parse one module from the image, starting at record *rec_i, into current_in_file_module.
+ * returns 0 when the module is done, 1 on a fatal error, -1 if the records could not be read. */
+int load_input_module(struct omf_context_t *omf_state,in_fileRef current_in_file,in_fileModuleRef current_in_file_module,size_t *rec_i) {
+    int ret;
+
+    do {
+        ret = input_image_read_record(omf_state,*(current_in_file->image),rec_i);
+        if (ret == 0) {
+            if (omf_state->THEADR != NULL) {
+                const char *s = omf_state->THEADR;
+                const char *scan = s;
+                while (scan[0] != 0 && scan[1] != 0) {
+                    if (*scan == '\\' || *scan == '/')
+                        s = scan+1;
+
+                    scan++;
+                }
 
-            if (!strcmp(a,"i")) {
-                char *s = argv[i++];
-                if (s == NULL) return 1;
+                current_in_file_module->name = s;
+            }
+            if (grpdef_add(current_in_file_module->link_segments, omf_state))
+                return 1;
+            if (pubdef_add(current_in_file_module->link_symbols, current_in_file_module->link_segments, omf_state, omf_state->record.rectype, current_in_file, current_in_file_module))
+                return 1;
 
-                shared_ptr<input_file> ent(new input_file);
+            assert(current_in_file_module->omf_state == NULL);
+            if ((current_in_file_module->omf_state=omf_context_create()) == NULL) {
+                fprintf(stderr,"Failed to init OMF parsing state\n");
+                return 1;
+            }
 
-                ent->path = s; /* constructs std::string from char* */
-                ent->segment_group = cmdoptions.next_segment_group;
+            /* transfer ownership to new OMF object by swapping valid pointers with NULL pointers in new struct */
+            swap(current_in_file_module->omf_state->LNAMEs,         omf_state->LNAMEs);
+            swap(current_in_file_module->omf_state->SEGDEFs,        omf_state->SEGDEFs);
+            swap(current_in_file_module->omf_state->GRPDEFs,        omf_state->GRPDEFs);
+            swap(current_in_file_module->omf_state->EXTDEFs,        omf_state->EXTDEFs);
+            swap(current_in_file_module->omf_state->PUBDEFs,        omf_state->PUBDEFs);
+            swap(current_in_file_module->omf_state->FIXUPPs,        omf_state->FIXUPPs);
 
-                cmdoptions.in_file.push_back(ent);
-            }
-            else if (!strcmp(a,"hsym")) {
-                a = argv[i++];
-                if (a == NULL) return 1;
-                cmdoptions.dosdrv_header_symbol = a;
-            }
-            else if (!strcmp(a,"segsym")) {
-                cmdoptions.def_segsym = 1;
-            }
-            else if (!strcmp(a,"pflat")) {
-                cmdoptions.prefer_flat = 1;
-            }
-            else if (!strncmp(a,"stack",5)) {
-                a += 5;
-                if (!isxdigit(*a)) return 1;
-                cmdoptions.want_stack_size = strtoul(a,NULL,16);
-            }
-            else if (!strncmp(a,"com",3)) {
-                a += 3;
-                if (!isxdigit(*a)) return 1;
-                cmdoptions.image_base_offset = strtoul(a,NULL,16);
-            }
-            else if (!strcmp(a,"hex")) {
-                a = argv[i++];
-                if (a == NULL) return 1;
-                cmdoptions.hex_output = a;
-            }
-            else if (!strcmp(a,"of")) {
-                a = argv[i++];
-                if (a == NULL) return 1;
+            omf_context_clear_for_module(omf_state);
+            return 0;
+        }
+        else if (ret < 0) {
+            fprintf(stderr,"Error: %s\n",strerror(errno));
+            if (omf_state->last_error != NULL) fprintf(stderr,"Details: %s\n",omf_state->last_error);
+            return -1;
+        }
 
-                if (!strcmp(a,"com"))
-                    cmdoptions.output_format = OFMT_COM;
-                else if (!strcmp(a,"comrel")) {
-                    cmdoptions.output_format = OFMT_COM;
-                    cmdoptions.output_format_variant = OFMTVAR_COMREL;
+        switch (omf_state->record.rectype) {
+            case OMF_RECTYPE_THEADR:/*0x80*/
+                if (omf_context_parse_THEADR(omf_state,&omf_state->record) < 0) {
+                    fprintf(stderr,"Error parsing THEADR\n");
+                    return 1;
                 }
-                else if (!strcmp(a,"exe"))
-                    cmdoptions.output_format = OFMT_EXE;
-                else if (!strcmp(a,"dosdrv"))
-                    cmdoptions.output_format = OFMT_DOSDRV;
-                else if (!strcmp(a,"dosdrvrel")) {
-                    cmdoptions.output_format = OFMT_DOSDRV;
-                    cmdoptions.output_format_variant = OFMTVAR_COMREL;
+                break;
+            case OMF_RECTYPE_EXTDEF:/*0x8C*/
+            case OMF_RECTYPE_LEXTDEF:/*0xB4*/
+            case OMF_RECTYPE_LEXTDEF32:/*0xB5*/
+                if (omf_context_parse_EXTDEF(omf_state,&omf_state->record) < 0) {
+                    fprintf(stderr,"Error parsing EXTDEF\n");
+                    return 1;
                 }
-                else if (!strcmp(a,"dosdrvexe"))
-                    cmdoptions.output_format = OFMT_DOSDRVEXE;
-                else {
-                    fprintf(stderr,"Unknown format\n");
+                break;
+            case OMF_RECTYPE_PUBDEF:/*0x90*/
+            case OMF_RECTYPE_PUBDEF32:/*0x91*/
+            case OMF_RECTYPE_LPUBDEF:/*0xB6*/
+            case OMF_RECTYPE_LPUBDEF32:/*0xB7*/
+                if (omf_context_parse_PUBDEF(omf_state,&omf_state->record) < 0) {
+                    fprintf(stderr,"Error parsing PUBDEF\n");
                     return 1;
                 }
-            }
-            else if (!strcmp(a,"map")) {
-                char *s = argv[i++];
-                if (s == NULL) return 1;
-                cmdoptions.map_file = s;
-            }
-            else if (!strcmp(a,"o")) {
-                char *s = argv[i++];
-                if (s == NULL) return 1;
-                cmdoptions.out_file = s;
-            }
-            else if (!strcmp(a,"v")) {
-                cmdoptions.verbose = true;
-            }
-            else if (!strcmp(a,"sgname")) {
-                char *s = argv[i++];
-                if (s == NULL) return 1;
-                if (cmdoptions.next_segment_group < 0) {
-                    fprintf(stderr,"-sgname must follow -seggroup\n");
+                break;
+            case OMF_RECTYPE_LNAMES:/*0x96*/
+                if (omf_context_parse_LNAMES(omf_state,&omf_state->record) < 0) {
+                    fprintf(stderr,"Error parsing LNAMES\n");
                     return 1;
                 }
-
+                break;
+            case OMF_RECTYPE_SEGDEF:/*0x98*/
+            case OMF_RECTYPE_SEGDEF32:/*0x99*/
+                {
+                    int p_count = omf_state->SEGDEFs.omf_SEGDEFS_count;
+                    int first_new_segdef;
+
+                    if ((first_new_segdef=omf_context_parse_SEGDEF(omf_state,&omf_state->record)) < 0) {
+                        fprintf(stderr,"Error parsing SEGDEF\n");
+                        return 1;
+                    }
+
+                    if (omf_state->flags.verbose)
+                        dump_SEGDEF(stdout,omf_state,(unsigned int)first_new_segdef);
+
+                    if (segdef_add(current_in_file_module->link_segments, omf_state, p_count, current_in_file, current_in_file_module))
+                        return 1;
+                } break;
+            case OMF_RECTYPE_GRPDEF:/*0x9A*/
+            case OMF_RECTYPE_GRPDEF32:/*0x9B*/
+                if (omf_context_parse_GRPDEF(omf_state,&omf_state->record) < 0) {
+                    fprintf(stderr,"Error parsing GRPDEF\n");
+                    return 1;
+                }
+                break;
+            case OMF_RECTYPE_FIXUPP:/*0x9C*/
+            case OMF_RECTYPE_FIXUPP32:/*0x9D*/
+                if (omf_context_parse_FIXUPP(omf_state,&omf_state->record) < 0) {
+                    fprintf(stderr,"Error parsing FIXUPP\n");
+                    return 1;
+                }
+                break;
+            case OMF_RECTYPE_LEDATA:/*0xA0*/
+            case OMF_RECTYPE_LEDATA32:/*0xA1*/
+                {
+                    struct omf_ledata_info_t info;
+
+                    if (omf_context_parse_LEDATA(omf_state,&info,&omf_state->record) < 0) {
+                        fprintf(stderr,"Error parsing LEDATA\n");
+                        return 1;
+                    }
+
+                    if (omf_state->flags.verbose)
+                        dump_LEDATA(stdout,omf_state,&info);
+
+                    if (ledata_add(current_in_file_module->link_segments, omf_state, &info))
+                        return 1;
+                } break;
+            case OMF_RECTYPE_MODEND:/*0x8A*/
+            case OMF_RECTYPE_MODEND32:/*0x8B*/
+                if (parse_MODEND(current_in_file_module->link_segments, omf_state, current_in_file, current_in_file_module, current_in_file_module->entry_point))
+                    return 1;
+                break;
+            default:
+                break;
+        }
+    } while (1);
+}
+
+in_fileModuleRef new_input_module(in_fileRef current_in_file,const fileOffset offset) {
+    in_fileModuleRef current_in_file_module(new input_module);
+
+    current_in_file_module->file = current_in_file;
+    current_in_file_module->offset = offset;
+    current_in_file_module->index = current_in_file->modules.size();
+    current_in_file->modules.push_back(current_in_file_module);
+    return current_in_file_module;
+}
+
+/* parse the module starting at record rec_i of the file into current_in_file_module, with its own
+ * OMF parsing state so that modules can be parsed on any thread. returns as load_input_module(). */
+int parse_input_module(in_fileRef current_in_file,in_fileModuleRef current_in_file_module,size_t rec_i) {
+    struct omf_context_t* omf_state = NULL;
+    int ret;
+
+    if ((omf_state=omf_context_create()) == NULL) {
+        fprintf(stderr,"Failed to init OMF parsing state\n");
+        return 1;
+    }
+    omf_state->flags.verbose = (cmdoptions.verbose > 0);
+    omf_context_begin_file(omf_state);
+    omf_state->library_block_size = current_in_file->image->library_block_size;
+    current_segment_group = current_in_file->segment_group;
+
+    ret = load_input_module(omf_state,current_in_file,current_in_file_module,&rec_i);
+
+    if (cmdoptions.verbose)
+        my_dumpstate(omf_state);
+
+    omf_context_clear(omf_state);
+    omf_state = omf_context_destroy(omf_state);
+
+    current_segment_group = -1;
+    return ret;
+}
+
+/* one input module to parse */
+struct input_module_job {
+    in_fileRef                          file;
+    in_fileModuleRef                    module;
+    size_t                              rec_i;              /* first record of the module */
+    int                                 result;             /* from parse_input_module() */
+};
+
+/* Parse the modules on a pool of worker threads. Modules do not depend on each other
+ * until the segments and symbols are gathered, which is done afterwards in file and
+ * module order, so the result is the same no matter how many threads are used. */
+int parse_input_modules(vector<input_module_job> &jobs) {
+    size_t threads = cmdoptions.parse_threads;
+
+    if (threads == 0)
+        threads = thread::hardware_concurrency();
+    if (cmdoptions.verbose || threads == 0)
+        threads = 1; /* verbose output would interleave */
+    if (threads > jobs.size())
+        threads = jobs.size();
+
+    if (threads <= 1) {
+        for (auto ji=jobs.begin();ji!=jobs.end();ji++) {
+            if (cmdoptions.verbose && ji->module->index != 0)
+                printf("----- next module -----\n");
+
+            ji->result = parse_input_module(ji->file,ji->module,ji->rec_i);
+            if (ji->result > 0)
+                return 1;
+        }
+    }
+    else {
+        atomic<size_t> next_job(0);
+        vector<thread> pool;
+
+        for (size_t t=0;t < threads;t++) {
+            pool.push_back(thread([&jobs,&next_job]() {
+                size_t i;
+
+                while ((i=next_job++) < jobs.size())
+                    jobs[i].result = parse_input_module(jobs[i].file,jobs[i].module,jobs[i].rec_i);
+            }));
+        }
+
+        for (auto ti=pool.begin();ti!=pool.end();ti++)
+            ti->join();
+
+        for (auto ji=jobs.begin();ji!=jobs.end();ji++) {
+            if (ji->result > 0)
+                return 1;
+        }
+    }
+
+    /* like reading a file start to end, stop at the first module that could not be read */
+    for (auto ji=jobs.begin();ji!=jobs.end();ji++) {
+        if (ji->result < 0) {
+            auto &modules = ji->file->modules;
+
+            if (modules.size() > (ji->module->index + 1u))
+                modules.resize(ji->module->index + 1u);
+        }
+    }
+
+    return 0;
+}
+
+/* pull in the module at file offset ofs of a .LIB file through the dictionary */
+int load_library_module(in_fileRef current_in_file,const fileOffset ofs,in_fileModuleRef &current_in_file_module) {
+    struct input_image &img = *(current_in_file->image);
+    const size_t rec_first = img.records.size();
+    const char *err = NULL;
+
+    current_in_file->libdict_loaded.insert(ofs);
+
+    if (input_image_index_from(img,(size_t)ofs,true,&err) < 0) {
+        fprintf(stderr,"Error: %s\n",current_in_file->path.c_str());
+        if (err != NULL) fprintf(stderr,"Details: %s\n",err);
+    }
+    if (img.records.size() == rec_first) {
+        fprintf(stderr,"Error: no module at offset 0x%lx in %s\n",(unsigned long)ofs,current_in_file->path.c_str());
+        return 1;
+    }
+
+    current_in_file_module = new_input_module(current_in_file,ofs);
+    return (parse_input_module(current_in_file,current_in_file_module,rec_first) > 0) ? 1 : 0;
+}
+
+/* note the public symbols a module defines, and the external symbols it needs */
+void note_module_symbols(const in_fileModuleRef &in_mod,unordered_set<string> &defined,vector<string> &needed) {
+    for (auto si=in_mod->link_symbols.begin();si!=in_mod->link_symbols.end();si++) {
+        if (!(*si)->is_local)
+            defined.insert((*si)->name);
+    }
+
+    if (in_mod->omf_state != NULL) {
+        const struct omf_extdefs_context_t &ext = in_mod->omf_state->EXTDEFs;
+
+        for (unsigned int i=0;i < ext.omf_EXTDEFS_count;i++) {
+            if (ext.omf_EXTDEFS[i].type == OMF_EXTDEF_TYPE_GLOBAL && ext.omf_EXTDEFS[i].name_string != NULL)
+                needed.push_back(ext.omf_EXTDEFS[i].name_string);
+        }
+    }
+}
+
+/* Pull in modules from .LIB files that have a dictionary, only those that define a symbol
+ * that is referenced by an EXTDEF and not defined by any module loaded so far. Modules
+ * pulled in may reference further symbols, which are resolved the same way. Libraries
+ * are searched in command line order. */
+int load_library_modules(void) {
+    vector<in_fileRef> libs;
+    unordered_set<string> defined;
+    vector<string> needed;
+
+    for (auto fi=cmdoptions.in_file.begin();fi!=cmdoptions.in_file.end();fi++) {
+        if ((*fi)->libdict.blocks != NULL)
+            libs.push_back(*fi);
+    }
+    if (libs.empty())
+        return 0;
+
+    for (auto fi=cmdoptions.in_file.begin();fi!=cmdoptions.in_file.end();fi++) {
+        for (auto mi=(*fi)->modules.begin();mi!=(*fi)->modules.end();mi++)
+            note_module_symbols(*mi,defined,needed);
+    }
+
+    /* NTS: needed[] grows as modules are pulled in */
+    for (size_t ni=0;ni < needed.size();ni++) {
+        if (defined.find(needed[ni]) != defined.end())
+            continue;
+
+        const string name = needed[ni];
+
+        for (auto li=libs.begin();li!=libs.end();li++) {
+            in_fileRef lib = *li;
+            const long page = omf_libdict_lookup(&lib->libdict,name.c_str(),name.length());
+            if (page < 0)
+                continue;
+
+            const fileOffset ofs = (fileOffset)omf_libdict_page_to_offset(&lib->libdict,(unsigned short)page);
+            if (lib->libdict_loaded.find(ofs) != lib->libdict_loaded.end())
+                break; /* already loaded, and didn't define it after all */
+
+            if (cmdoptions.verbose)
+                printf("Loading module at page %lu of %s for '%s'\n",(unsigned long)page,lib->path.c_str(),name.c_str());
+
+            in_fileModuleRef in_mod;
+            if (load_library_module(lib,ofs,in_mod))
+                return 1;
+
+            note_module_symbols(in_mod,defined,needed);
+            break;
+        }
+    }
+
+    /* keep modules in the order they appear in the library, as if it had been read from start to end */
+    for (auto li=libs.begin();li!=libs.end();li++) {
+        auto &modules = (*li)->modules;
+
+        stable_sort(modules.begin(),modules.end(),[](const in_fileModuleRef &a,const in_fileModuleRef &b) { return a->offset < b->offset; });
+        for (size_t i=0;i < modules.size();i++)
+            modules[i]->index = i;
+    }
+
+    return 0;
+}
+
+/* Incremental linking (-inc).
+ *
+ * After a full link, the layout is saved next to the output file in <output>.lnkcache: a hash of
+ * the command line and of the output file, for each input file a hash of its contents and of its
+ * "shape" (every record except the data bytes of LEDATA records), the modules linked from it, and
+ * the segments, fragments and symbols as they were when fixups were applied. If the command line
+ * is the same and the input files that changed differ only in LEDATA contents, then the layout
+ * cannot have changed. Only the modules of those files are parsed again, their fixups applied
+ * against the saved layout, and their fragments rewritten in place in the output file. Anything
+ * else is a full link. */
+static const char                       link_cache_magic[] = "lnkdos16-cache 1";
+
+static const long                       link_cache_file_none = -1;
+static const long                       link_cache_file_internal = -2;
+static const long                       link_cache_file_padding = -3;
+
+uint64_t fnv1a64(const void *p,const size_t len,uint64_t h=0xcbf29ce484222325ull) {
+    const unsigned char *s = (const unsigned char*)p;
+
+    for (size_t i=0;i < len;i++) {
+        h ^= s[i];
+        h *= 0x100000001b3ull;
+    }
+
+    return h;
+}
+
+/* names are stored to the end of the line */
+static bool link_cache_name_ok(const string &s) {
+    return s.find_first_of("\r\n") == string::npos;
+}
+
+string link_cache_path(void) {
+    return cmdoptions.out_file + ".lnkcache";
+}
+
+/* the command line, less the options that do not affect the output */
+uint64_t link_cache_args_hash(int argc,char **argv) {
+    uint64_t h = fnv1a64(NULL,0);
+
+    for (int i=1;i < argc;i++) {
+        const char *a = argv[i];
+        while (*a == '-') a++;
+
+        if (argv[i][0] == '-' && (!strcmp(a,"j") || !strcmp(a,"ptime-json"))) {
+            i++;
+            continue;
+        }
+        if (argv[i][0] == '-' && (!strcmp(a,"v") || !strcmp(a,"stats") || !strcmp(a,"ptime")))
+            continue;
+
+        h = fnv1a64(argv[i],strlen(argv[i])+1u,h);
+    }
+
+    return h;
+}
+
+/* hash of everything in the file except the data bytes of LEDATA records (and record checksums, which change with them) */
+uint64_t input_image_shape_hash(const struct input_image &img) {
+    uint64_t h = fnv1a64(NULL,0);
+    const char *err = NULL;
+    struct input_image tmp;
+    size_t end = 0;
+
+    tmp.data = img.data;
+    tmp.length = img.length;
+    input_image_index(tmp,&err);
+
+    for (auto ri=tmp.records.begin();ri!=tmp.records.end();ri++) {
+        const unsigned char *body = img.data + ri->offset + 3u;
+        size_t len = (size_t)ri->reclen - 1u;
+
+        h = fnv1a64(img.data + ri->offset,3,h);
+        if ((ri->rectype&0xFE) == OMF_RECTYPE_LEDATA) {
+            /* segment index, enumerated data offset */
+            const size_t hdr = ((len != 0 && (body[0]&0x80)) ? 2u : 1u) + ((ri->rectype&1) ? 4u : 2u);
+            if (len > hdr) len = hdr;
+        }
+        h = fnv1a64(body,len,h);
+
+        end = ri->offset + 3u + ri->reclen;
+    }
+
+    /* whatever follows, such as the .LIB dictionary */
+    if (img.length > end)
+        h = fnv1a64(img.data + end,img.length - end,h);
+
+    return h;
+}
+
+int link_cache_hash_file(const char *path,uint64_t *size,uint64_t *hash) {
+    struct input_image img;
+
+    if (input_image_load(img,path) < 0)
+        return -1;
+
+    *size = img.length;
+    *hash = fnv1a64(img.data,img.length);
+    return 0;
+}
+
+/* write the cache after a full link. segments and symbols are as they were when fixups were applied */
+int link_cache_write(const uint64_t args_hash,const vector< shared_ptr<struct link_segdef> > &segments,const link_symbol_table::list_t &symbols) {
+    unordered_map<const struct input_file*,long> file_index;
+    unordered_map<const struct input_module*,long> module_index;
+    unordered_map<const struct link_segdef*,long> segment_index;
+    unordered_map<const struct seg_fragment*,long> fragment_index;
+    const string path = link_cache_path();
+    const string tmp_path = path + ".tmp";
+    uint64_t out_size,out_hash;
+    FILE *fp;
+
+    file_index[NULL] = link_cache_file_none;
+    file_index[in_fileRefInternal.get()] = link_cache_file_internal;
+    file_index[in_fileRefPadding.get()] = link_cache_file_padding;
+    module_index[NULL] = -1;
+
+    if (link_cache_hash_file(cmdoptions.out_file.c_str(),&out_size,&out_hash) < 0)
+        return -1;
+
+    fp = fopen(tmp_path.c_str(),"w");
+    if (fp == NULL)
+        return -1;
+
+    fprintf(fp,"%s\n",link_cache_magic);
+    fprintf(fp,"args %016llx\n",(unsigned long long)args_hash);
+    fprintf(fp,"output %llu %016llx\n",(unsigned long long)out_size,(unsigned long long)out_hash);
+
+    for (size_t fi=0;fi < cmdoptions.in_file.size();fi++) {
+        const in_fileRef &in_file = cmdoptions.in_file[fi];
+        const struct input_image &img = *(in_file->image);
+
+        file_index[in_file.get()] = (long)fi;
+        if (!link_cache_name_ok(in_file->path)) goto fail;
+        fprintf(fp,"file %lu %016llx %016llx %s\n",(unsigned long)in_file->modules.size(),
+            (unsigned long long)fnv1a64(img.data,img.length),(unsigned long long)input_image_shape_hash(img),in_file->path.c_str());
+
+        for (size_t mi=0;mi < in_file->modules.size();mi++) {
+            const in_fileModuleRef &in_mod = in_file->modules[mi];
+
+            module_index[in_mod.get()] = (long)mi;
+            if (!link_cache_name_ok(in_mod->name)) goto fail;
+            fprintf(fp,"module %lx %lx %s\n",(unsigned long)in_mod->offset,(unsigned long)in_mod->index,in_mod->name.c_str());
+        }
+    }
+
+    for (size_t si=0;si < segments.size();si++) {
+        const struct link_segdef *sg = segments[si].get();
+
+        segment_index[sg] = (long)si;
+        if (!link_cache_name_ok(sg->name) || !link_cache_name_ok(sg->groupname)) goto fail;
+        fprintf(fp,"seg %d %lx %lx %lx %lx %lx %u %s\n",sg->segment_group,(unsigned long)sg->segment_relative,(unsigned long)sg->segment_offset,
+            (unsigned long)sg->segment_reloc_adj,(unsigned long)sg->file_offset,(unsigned long)sg->segment_length,sg->noemit?1u:0u,sg->name.c_str());
+        if (!sg->groupname.empty())
+            fprintf(fp,"group %s\n",sg->groupname.c_str());
+
+        for (size_t fri=0;fri < sg->fragments.size();fri++) {
+            const struct seg_fragment *frag = sg->fragments[fri].get();
+
+            if (file_index.find(frag->in_file.get()) == file_index.end() || module_index.find(frag->in_module.get()) == module_index.end())
+                goto fail;
+
+            fragment_index[frag] = (long)fri;
+            fprintf(fp,"frag %ld %ld %ld %lx %lx\n",file_index[frag->in_file.get()],module_index[frag->in_module.get()],
+                (frag->from_segment_index != segmentIndexUndef) ? (long)frag->from_segment_index : -1l,
+                (unsigned long)frag->offset,(unsigned long)frag->fragment_length);
+        }
+    }
+
+    for (auto si=symbols.begin();si!=symbols.end();si++) {
+        const struct link_symbol *sym = (*si).get();
+
+        if (segment_index.find(sym->segref.get()) == segment_index.end() || fragment_index.find(sym->fragment.get()) == fragment_index.end() ||
+            file_index.find(sym->in_file.get()) == file_index.end() || module_index.find(sym->in_module.get()) == module_index.end() ||
+            !link_cache_name_ok(sym->name))
+            goto fail;
+
+        fprintf(fp,"sym %ld %ld %lx %u %ld %ld %s\n",segment_index[sym->segref.get()],fragment_index[sym->fragment.get()],
+            (unsigned long)sym->offset,sym->is_local?1u:0u,file_index[sym->in_file.get()],module_index[sym->in_module.get()],sym->name.c_str());
+    }
+
+    fprintf(fp,"end\n");
+    if (ferror(fp)) goto fail;
+    fclose(fp);
+
+    if (rename(tmp_path.c_str(),path.c_str()) < 0) {
+        unlink(tmp_path.c_str());
+        return -1;
+    }
+
+    return 0;
+fail:
+    fclose(fp);
+    unlink(tmp_path.c_str());
+    return -1;
+}
+
+/* the rest of a cache line, after the fields already parsed */
+static string link_cache_line_rest(const char *line,int n) {
+    string s(line + n + ((line[n] == ' ') ? 1 : 0));
+
+    while (!s.empty() && (s.back() == '\n' || s.back() == '\r'))
+        s.pop_back();
+
+    return s;
+}
+
+/* undo whatever an incremental link attempt left behind, before a full link */
+void link_cache_discard_inputs(void) {
+    for (auto fi=cmdoptions.in_file.begin();fi!=cmdoptions.in_file.end();fi++) {
+        auto in_file = *fi;
+
+        for (auto mi=in_file->modules.begin();mi!=in_file->modules.end();mi++) {
+            (*mi)->link_symbols.clear();
+            (*mi)->link_segments.clear();
+            (*mi)->entry_point.clear();
+        }
+
+        in_file->modules.clear();
+        in_file->image.reset();
+        in_file->libdict_loaded.clear();
+        omf_libdict_free(&in_file->libdict);
+    }
+}
+
+/* Try to link incrementally against the cache.
+ * Returns 0 if the output is up to date, 1 if a full link is needed, -1 on error. */
+int link_cache_relink(const uint64_t args_hash) {
+    vector< shared_ptr<struct link_segdef> > link_segments;
+    link_symbol_table link_symbols;
+    vector< shared_ptr<struct exe_relocation> > exe_relocation_table;
+    map< pair<const struct input_module*,segmentIndex>,fragmentRef > fragment_by_source;
+    vector<uint64_t> content_hash,shape_hash;
+    vector<bool> changed;
+    shared_ptr<struct link_segdef> sg;
+    unsigned long long a,b;
+    size_t files_changed = 0;
+    size_t fragments_written = 0;
+    const char *why = NULL;
+    char line[1024];
+    FILE *fp;
+    int n,ret = 1;
+
+    /* DOSDRVREL patches the device header after fixups are applied. That is not replayed here. */
+    if (cmdoptions.output_format == OFMT_DOSDRV && cmdoptions.output_format_variant == OFMTVAR_COMREL)
+        return 1;
+
+    fp = fopen(link_cache_path().c_str(),"r");
+    if (fp == NULL) {
+        why = "no link cache";
+        goto full_link;
+    }
+
+    why = "link cache does not match";
+    if (fgets(line,sizeof(line),fp) == NULL || link_cache_line_rest(line,0) != link_cache_magic)
+        goto full_link;
+    if (fgets(line,sizeof(line),fp) == NULL || sscanf(line,"args %llx",&a) != 1 || a != args_hash) {
+        why = "command line changed";
+        goto full_link;
+    }
+    {
+        uint64_t sz,h;
+
+        if (fgets(line,sizeof(line),fp) == NULL || sscanf(line,"output %llu %llx",&a,&b) != 2)
+            goto full_link;
+        if (link_cache_hash_file(cmdoptions.out_file.c_str(),&sz,&h) < 0 || sz != a || h != b) {
+            why = "output file changed";
+            goto full_link;
+        }
+    }
+    if (!cmdoptions.map_file.empty() && access(cmdoptions.map_file.c_str(),F_OK) != 0) {
+        why = "map file missing";
+        goto full_link;
+    }
+
+    /* input files, and the modules that were linked from each */
+    content_hash.resize(cmdoptions.in_file.size());
+    shape_hash.resize(cmdoptions.in_file.size());
+    changed.resize(cmdoptions.in_file.size(),false);
+
+    for (size_t fi=0;fi < cmdoptions.in_file.size();fi++) {
+        in_fileRef in_file = cmdoptions.in_file[fi];
+        unsigned long modules;
+
+        if (fgets(line,sizeof(line),fp) == NULL || sscanf(line,"file %lu %llx %llx%n",&modules,&a,&b,&n) != 3)
+            goto full_link;
+        if (link_cache_line_rest(line,n) != in_file->path)
+            goto full_link;
+
+        in_file->image.reset(new input_image);
+        if (input_image_load(*(in_file->image),in_file->path.c_str()) < 0) {
+            ret = -1;
+            goto full_link;
+        }
+
+        const struct input_image &img = *(in_file->image);
+
+        content_hash[fi] = fnv1a64(img.data,img.length);
+        if (content_hash[fi] != a) {
+            shape_hash[fi] = input_image_shape_hash(img);
+            if (shape_hash[fi] != b) {
+                why = "input file changed beyond LEDATA contents";
+                goto full_link;
+            }
+
+            changed[fi] = true;
+            files_changed++;
+        }
+        else {
+            shape_hash[fi] = b;
+        }
+
+        for (unsigned long mi=0;mi < modules;mi++) {
+            unsigned long ofs,index;
+
+            if (fgets(line,sizeof(line),fp) == NULL || sscanf(line,"module %lx %lx%n",&ofs,&index,&n) != 2)
+                goto full_link;
+
+            in_fileModuleRef in_mod = new_input_module(in_file,(fileOffset)ofs);
+            in_mod->index = (size_t)index;
+            in_mod->name = link_cache_line_rest(line,n);
+        }
+    }
+
+    if (files_changed == 0) {
+        fclose(fp);
+        link_cache_discard_inputs();
+        if (cmdoptions.verbose)
+            printf("Incremental link: output is up to date\n");
+        return 0;
+    }
+
+    /* segments, fragments, and symbols, as they were when fixups were applied */
+    while (fgets(line,sizeof(line),fp) != NULL) {
+        if (!strncmp(line,"seg ",4)) {
+            unsigned long rel,ofs,adj,fofs,len;
+            unsigned int noemit;
+            int group;
+
+            if (sscanf(line,"seg %d %lx %lx %lx %lx %lx %u%n",&group,&rel,&ofs,&adj,&fofs,&len,&noemit,&n) != 7)
+                goto full_link;
+
+            sg = new_link_segment(link_segments,link_cache_line_rest(line,n).c_str());
+            sg->segment_group = group;
+            sg->segment_relative = (segmentRelative)rel;
+            sg->segment_offset = (segmentOffset)ofs;
+            sg->segment_reloc_adj = (segmentRelative)adj;
+            sg->file_offset = (fileOffset)fofs;
+            sg->segment_length = (segmentSize)len;
+            sg->noemit = noemit ? 1 : 0;
+        }
+        else if (!strncmp(line,"group ",6)) {
+            if (sg == nullptr)
+                goto full_link;
+
+            sg->groupname = link_cache_line_rest(line,5);
+        }
+        else if (!strncmp(line,"frag ",5)) {
+            long file,module,segidx;
+            unsigned long ofs,len;
+
+            if (sg == nullptr || sscanf(line,"frag %ld %ld %ld %lx %lx",&file,&module,&segidx,&ofs,&len) != 5)
+                goto full_link;
+
+            shared_ptr<struct seg_fragment> frag = new_seg_fragment();
+            frag->offset = (segmentOffset)ofs;
+            frag->fragment_length = (segmentSize)len;
+            frag->from_segment_index = (segidx >= 0) ? (segmentIndex)segidx : segmentIndexUndef;
+
+            if (file >= 0 && (size_t)file < cmdoptions.in_file.size()) {
+                frag->in_file = cmdoptions.in_file[(size_t)file];
+                if (module >= 0 && (size_t)module < frag->in_file->modules.size())
+                    frag->in_module = frag->in_file->modules[(size_t)module];
+            }
+            else if (file == link_cache_file_internal) {
+                frag->in_file = in_fileRefInternal;
+            }
+            else if (file == link_cache_file_padding) {
+                frag->in_file = in_fileRefPadding;
+            }
+
+            sg->fragments.push_back(frag);
+            if (frag->in_module != nullptr)
+                fragment_by_source.insert(make_pair(make_pair((const struct input_module*)frag->in_module.get(),frag->from_segment_index),frag));
+        }
+        else if (!strncmp(line,"sym ",4)) {
+            long segidx,fragidx,file,module;
+            unsigned long ofs;
+            unsigned int is_local;
+
+            if (sscanf(line,"sym %ld %ld %lx %u %ld %ld%n",&segidx,&fragidx,&ofs,&is_local,&file,&module,&n) != 6)
+                goto full_link;
+            if (segidx < 0 || (size_t)segidx >= link_segments.size())
+                goto full_link;
+
+            shared_ptr<struct link_segdef> ssg = link_segments[(size_t)segidx];
+            if (fragidx < 0 || (size_t)fragidx >= ssg->fragments.size())
+                goto full_link;
+
+            shared_ptr<struct link_symbol> sym = new_link_symbol(link_symbols,link_cache_line_rest(line,n).c_str());
+            sym->segref = ssg;
+            sym->fragment = ssg->fragments[(size_t)fragidx];
+            sym->offset = (segmentOffset)ofs;
+            sym->is_local = is_local ? 1 : 0;
+
+            if (file >= 0 && (size_t)file < cmdoptions.in_file.size()) {
+                sym->in_file = cmdoptions.in_file[(size_t)file];
+                if (module >= 0 && (size_t)module < sym->in_file->modules.size())
+                    sym->in_module = sym->in_file->modules[(size_t)module];
+            }
+            else if (file == link_cache_file_internal) {
+                sym->in_file = in_fileRefInternal;
+            }
+            else if (file == link_cache_file_padding) {
+                sym->in_file = in_fileRefPadding;
+            }
+        }
+        else if (!strcmp(line,"end\n")) {
+            break;
+        }
+        else {
+            goto full_link;
+        }
+    }
+    if (strcmp(line,"end\n"))
+        goto full_link;
+
+    fclose(fp);
+    fp = NULL;
+
+    /* parse the modules of the files that changed, and put their LEDATA into the saved layout */
+    for (size_t fi=0;fi < cmdoptions.in_file.size();fi++) {
+        if (!changed[fi]) continue;
+
+        in_fileRef in_file = cmdoptions.in_file[fi];
+        struct input_image &img = *(in_file->image);
+        const char *err = NULL;
+
+        if (input_image_index(img,&err) < 0) {
+            why = "input file cannot be read";
+            goto full_link;
+        }
+
+        for (auto mi=in_file->modules.begin();mi!=in_file->modules.end();mi++) {
+            in_fileModuleRef in_mod = *mi;
+            size_t rec_i = 0;
+
+            while (rec_i < img.records.size() && img.records[rec_i].offset != in_mod->offset)
+                rec_i++;
+            if (rec_i == img.records.size() && !img.records.empty()) {
+                why = "module moved";
+                goto full_link;
+            }
+
+            if (parse_input_module(in_file,in_mod,rec_i) != 0) {
+                why = "module cannot be parsed";
+                goto full_link;
+            }
+
+            for (auto si=in_mod->link_segments.begin();si!=in_mod->link_segments.end();si++) {
+                for (auto fri=(*si)->fragments.begin();fri!=(*si)->fragments.end();fri++) {
+                    shared_ptr<struct seg_fragment> frag = *fri,target;
+                    auto tfi = fragment_by_source.find(make_pair((const struct input_module*)in_mod.get(),frag->from_segment_index));
+
+                    if (tfi != fragment_by_source.end())
+                        target = tfi->second;
+
+                    if (target == nullptr || target->fragment_length != frag->fragment_length || frag->image.size() != frag->fragment_length) {
+                        why = "fragment layout changed";
+                        goto full_link;
+                    }
+
+                    target->image.swap(frag->image);
+                }
+            }
+        }
+    }
+
+    /* apply their fixups */
+    for (size_t fi=0;fi < cmdoptions.in_file.size();fi++) {
+        if (!changed[fi]) continue;
+
+        in_fileRef in_file = cmdoptions.in_file[fi];
+
+        current_segment_group = in_file->segment_group;
+        for (auto mi=in_file->modules.begin();mi!=in_file->modules.end();mi++) {
+            if ((*mi)->omf_state == NULL) continue;
+
+            if (apply_FIXUPP(exe_relocation_table,link_symbols,link_segments,(*mi)->omf_state,in_file,*mi,PASS_BUILD)) {
+                current_segment_group = -1;
+                ret = -1;
+                goto full_link;
+            }
+        }
+        current_segment_group = -1;
+    }
+
+    /* and rewrite them in the output */
+    {
+        int fd = open(cmdoptions.out_file.c_str(),O_RDWR|O_BINARY);
+        if (fd < 0) {
+            fprintf(stderr,"Unable to open output file\n");
+            ret = -1;
+            goto full_link;
+        }
+
+        for (auto lsi=link_segments.begin();lsi!=link_segments.end();lsi++) {
+            shared_ptr<struct link_segdef> lsg = *lsi;
+
+            if (lsg->noemit || lsg->segment_length == 0 || lsg->file_offset == fileOffsetUndef) continue;
+
+            for (auto lfi=lsg->fragments.begin();lfi!=lsg->fragments.end();lfi++) {
+                shared_ptr<struct seg_fragment> frag = *lfi;
+
+                if (frag->in_module == nullptr || frag->image.empty()) continue;
+                assert(frag->image.size() == frag->fragment_length);
+
+                const off_t file_ofs = (off_t)lsg->file_offset + (off_t)frag->offset;
+                if (lseek(fd,file_ofs,SEEK_SET) != file_ofs || (unsigned long)write(fd,&frag->image[0],frag->fragment_length) != frag->fragment_length) {
+                    fprintf(stderr,"Write error\n");
+                    close(fd);
+                    ret = -1;
+                    goto full_link;
+                }
+
+                fragments_written++;
+                link_prof.written(frag->fragment_length);
+            }
+        }
+
+        close(fd);
+    }
+
+    if (cmdoptions.verbose)
+        printf("Incremental link: %lu of %lu input files changed, %lu fragments rewritten\n",
+            (unsigned long)files_changed,(unsigned long)cmdoptions.in_file.size(),(unsigned long)fragments_written);
+
+    /* update the cache for the new input and output contents */
+    {
+        string cache(link_cache_path()),tmp(cache + ".tmp");
+        FILE *ifp = fopen(cache.c_str(),"r");
+        FILE *ofp = (ifp != NULL) ? fopen(tmp.c_str(),"w") : NULL;
+        uint64_t out_size = 0,out_hash = 0;
+        size_t fi = 0;
+
+        if (link_cache_hash_file(cmdoptions.out_file.c_str(),&out_size,&out_hash) < 0) {
+            if (ifp) fclose(ifp);
+            if (ofp) fclose(ofp);
+            ofp = ifp = NULL;
+        }
+
+        if (ifp != NULL && ofp != NULL) {
+            while (fgets(line,sizeof(line),ifp) != NULL) {
+                if (!strncmp(line,"output ",7)) {
+                    fprintf(ofp,"output %llu %016llx\n",(unsigned long long)out_size,(unsigned long long)out_hash);
+                }
+                else if (!strncmp(line,"file ",5) && fi < cmdoptions.in_file.size()) {
+                    unsigned long modules;
+
+                    sscanf(line,"file %lu %llx %llx%n",&modules,&a,&b,&n);
+                    fprintf(ofp,"file %lu %016llx %016llx %s\n",modules,(unsigned long long)content_hash[fi],(unsigned long long)shape_hash[fi],
+                        cmdoptions.in_file[fi]->path.c_str());
+                    fi++;
+                }
+                else {
+                    fputs(line,ofp);
+                }
+            }
+
+            const bool ok = !ferror(ofp) && !ferror(ifp);
+            fclose(ifp);
+            fclose(ofp);
+            if (!ok || rename(tmp.c_str(),cache.c_str()) < 0) {
+                unlink(tmp.c_str());
+                unlink(cache.c_str());
+            }
+        }
+        else {
+            if (ifp) fclose(ifp);
+            unlink(cache.c_str());
+        }
+    }
+
+    for (auto lsi=link_segments.begin();lsi!=link_segments.end();lsi++)
+        (*lsi)->fragments.clear();
+    link_symbols.clear();
+    link_cache_discard_inputs();
+    return 0;
+
+full_link:
+    if (fp != NULL) fclose(fp);
+    for (auto lsi=link_segments.begin();lsi!=link_segments.end();lsi++)
+        (*lsi)->fragments.clear();
+    link_symbols.clear();
+    link_cache_discard_inputs();
+
+    if (ret > 0 && cmdoptions.verbose && why != NULL)
+        printf("Incremental link not possible (%s), doing a full link\n",why);
+
+    return ret;
+}
+
+void dump_link_profile(void) {
+    double total = 0;
+
+    for (auto i=link_prof.phases.begin();i!=link_prof.phases.end();i++)
+        total += i->second;
+
+    if (cmdoptions.ptime) {
+        fprintf(stderr,"Link profile:\n");
+        fprintf(stderr,"  Phase (wall time):\n");
+        for (auto i=link_prof.phases.begin();i!=link_prof.phases.end();i++)
+            fprintf(stderr,"    %-20s %10.6fs\n",i->first.c_str(),i->second);
+        fprintf(stderr,"    %-20s %10.6fs\n","total",total);
+
+        fprintf(stderr,"  OMF records read:\n");
+        for (unsigned int i=0;i < 256;i++) {
+            const unsigned long c = link_prof.records[i].load();
+            if (c != 0ul) fprintf(stderr,"    %-12s 0x%02X   %10lu\n",omf_rectype_to_str((unsigned char)i),i,c);
+        }
+
+        fprintf(stderr,"  Fixups applied:\n");
+        for (unsigned int i=0;i < 16;i++) {
+            if (link_prof.fixups[i] != 0ul) fprintf(stderr,"    %-20s %10lu\n",omf_fixupp_location_to_str((unsigned char)i),link_prof.fixups[i]);
+        }
+
+        fprintf(stderr,"  Bytes written:         %10llu\n",link_prof.bytes_written);
+    }
+
+    if (!cmdoptions.ptime_json.empty()) {
+        FILE *fp = (cmdoptions.ptime_json == "-") ? stdout : fopen(cmdoptions.ptime_json.c_str(),"w");
+        bool first;
+
+        if (fp == NULL) {
+            fprintf(stderr,"Unable to write link profile to %s\n",cmdoptions.ptime_json.c_str());
+            return;
+        }
+
+        /* names are fixed strings from this program and the OMF library, no escaping needed */
+        fprintf(fp,"{\n  \"phases\": {");
+        first = true;
+        for (auto i=link_prof.phases.begin();i!=link_prof.phases.end();i++) {
+            fprintf(fp,"%s\n    \"%s\": %.6f",first?"":",",i->first.c_str(),i->second);
+            first = false;
+        }
+        fprintf(fp,"%s\n    \"total\": %.6f\n  },\n",first?"":",",total);
+
+        fprintf(fp,"  \"records\": {");
+        first = true;
+        for (unsigned int i=0;i < 256;i++) {
+            const unsigned long c = link_prof.records[i].load();
+            if (c == 0ul) continue;
+
+            fprintf(fp,"%s\n    \"0x%02X\": { \"name\": \"%s\", \"count\": %lu }",first?"":",",i,omf_rectype_to_str((unsigned char)i),c);
+            first = false;
+        }
+        fprintf(fp,"\n  },\n");
+
+        fprintf(fp,"  \"fixups\": {");
+        first = true;
+        for (unsigned int i=0;i < 16;i++) {
+            if (link_prof.fixups[i] == 0ul) continue;
+
+            fprintf(fp,"%s\n    \"%s\": %lu",first?"":",",omf_fixupp_location_to_str((unsigned char)i),link_prof.fixups[i]);
+            first = false;
+        }
+        fprintf(fp,"\n  },\n");
+
+        fprintf(fp,"  \"bytes_written\": %llu\n}\n",link_prof.bytes_written);
+
+        if (fp != stdout) fclose(fp);
+    }
+}
+
+void dump_link_stats(void) {
+    link_arena &arena = link_arena::get();
+
+    fprintf(stderr,"Link statistics:\n");
+#if defined(LINUX)
+    {
+        struct rusage ru;
+
+        if (getrusage(RUSAGE_SELF,&ru) == 0)
+            fprintf(stderr,"  Peak memory (RSS):   %lu KB\n",(unsigned long)ru.ru_maxrss);
+    }
+#endif
+    fprintf(stderr,"  Heap allocations:    %llu (%llu bytes)\n",
+        (unsigned long long)heap_alloc_count.load(),(unsigned long long)heap_alloc_bytes.load());
+    fprintf(stderr,"  Arena allocations:   %llu (%llu bytes)\n",
+        (unsigned long long)arena.alloc_count.load(),(unsigned long long)arena.alloc_bytes.load());
+    fprintf(stderr,"  Arena chunks:        %lu (%llu bytes)\n",
+        (unsigned long)arena.chunks.size(),(unsigned long long)arena.chunk_bytes.load());
+}
+
+int main(int argc,char **argv) {
+    entrypoint entry_point;
+    vector< shared_ptr<struct link_segdef> > link_segments;
+    link_symbol_table link_symbols;
+    vector< shared_ptr<struct exe_relocation> > exe_relocation_table;
+    vector< shared_ptr<struct link_segdef> > cache_segments;
+    link_symbol_table::list_t cache_symbols;
+    uint64_t cache_args_hash = 0;
+    int i,ret;
+    char *a;
+
+    in_fileRefPadding.reset(new input_file);
+    in_fileRefPadding->path = "<padding>";
+    in_fileRefPadding->special = input_file::SPEC_PADDING;
+
+    in_fileRefInternal.reset(new input_file);
+    in_fileRefInternal->path = "<internal>";
+    in_fileRefInternal->special = input_file::SPEC_INTERNAL;
+
+    for (i=1;i < argc;) {
+        a = argv[i++];
+
+        if (*a == '-') {
+            do { a++; } while (*a == '-');
+
+            if (!strcmp(a,"i")) {
+                char *s = argv[i++];
+                if (s == NULL) return 1;
+
+                shared_ptr<input_file> ent(new input_file);
+
+                ent->path = s; /* constructs std::string from char* */
+                ent->segment_group = cmdoptions.next_segment_group;
+
+                cmdoptions.in_file.push_back(ent);
+            }
+            else if (!strcmp(a,"hsym")) {
+                a = argv[i++];
+                if (a == NULL) return 1;
+                cmdoptions.dosdrv_header_symbol = a;
+            }
+            else if (!strcmp(a,"segsym")) {
+                cmdoptions.def_segsym = 1;
+            }
+            else if (!strcmp(a,"pflat")) {
+                cmdoptions.prefer_flat = 1;
+            }
+            else if (!strncmp(a,"stack",5)) {
+                a += 5;
+                if (!isxdigit(*a)) return 1;
+                cmdoptions.want_stack_size = strtoul(a,NULL,16);
+            }
+            else if (!strncmp(a,"com",3)) {
+                a += 3;
+                if (!isxdigit(*a)) return 1;
+                cmdoptions.image_base_offset = strtoul(a,NULL,16);
+            }
+            else if (!strcmp(a,"hex")) {
+                a = argv[i++];
+                if (a == NULL) return 1;
+                cmdoptions.hex_output = a;
+            }
+            else if (!strcmp(a,"of")) {
+                a = argv[i++];
+                if (a == NULL) return 1;
+
+                if (!strcmp(a,"com"))
+                    cmdoptions.output_format = OFMT_COM;
+                else if (!strcmp(a,"comrel")) {
+                    cmdoptions.output_format = OFMT_COM;
+                    cmdoptions.output_format_variant = OFMTVAR_COMREL;
+                }
+                else if (!strcmp(a,"exe"))
+                    cmdoptions.output_format = OFMT_EXE;
+                else if (!strcmp(a,"dosdrv"))
+                    cmdoptions.output_format = OFMT_DOSDRV;
+                else if (!strcmp(a,"dosdrvrel")) {
+                    cmdoptions.output_format = OFMT_DOSDRV;
+                    cmdoptions.output_format_variant = OFMTVAR_COMREL;
+                }
+                else if (!strcmp(a,"dosdrvexe"))
+                    cmdoptions.output_format = OFMT_DOSDRVEXE;
+                else {
+                    fprintf(stderr,"Unknown format\n");
+                    return 1;
+                }
+            }
+            else if (!strcmp(a,"map")) {
+                char *s = argv[i++];
+                if (s == NULL) return 1;
+                cmdoptions.map_file = s;
+            }
+            else if (!strcmp(a,"o")) {
+                char *s = argv[i++];
+                if (s == NULL) return 1;
+                cmdoptions.out_file = s;
+            }
+            else if (!strcmp(a,"v")) {
+                cmdoptions.verbose = true;
+            }
+            else if (!strcmp(a,"j")) {
+                a = argv[i++];
+                if (a == NULL || !isdigit(*a)) return 1;
+                cmdoptions.parse_threads = strtoul(a,NULL,10);
+            }
+            else if (!strcmp(a,"inc")) {
+                cmdoptions.incremental = true;
+            }
+            else if (!strcmp(a,"stats")) {
+                cmdoptions.stats = true;
+            }
+            else if (!strcmp(a,"ptime")) {
+                cmdoptions.ptime = true;
+            }
+            else if (!strcmp(a,"ptime-json")) {
+                char *s = argv[i++];
+                if (s == NULL) return 1;
+                cmdoptions.ptime_json = s;
+            }
+            else if (!strcmp(a,"sgname")) {
+                char *s = argv[i++];
+                if (s == NULL) return 1;
+                if (cmdoptions.next_segment_group < 0) {
+                    fprintf(stderr,"-sgname must follow -seggroup\n");
+                    return 1;
+                }
+
                 auto &sgrp = cmdoptions.get_segment_group(cmdoptions.next_segment_group);
                 sgrp.name = s;
             }
@@ -2228,6 +3715,9 @@ int main(int argc,char **argv) {
         }
     }
 
+    if (cmdoptions.ptime || !cmdoptions.ptime_json.empty())
+        link_prof.begin();
+
     if (cmdoptions.image_base_offset == segmentOffsetUndef) {
         if (cmdoptions.output_format == OFMT_COM) {
             cmdoptions.image_base_offset = 0x100;
@@ -2263,6 +3753,26 @@ int main(int argc,char **argv) {
         }
     }
 
+    /* if only LEDATA contents changed since the last link, patch the output in place */
+    if (cmdoptions.incremental && !cmdoptions.in_file.empty() && !cmdoptions.out_file.empty()) {
+        cache_args_hash = link_cache_args_hash(argc,argv);
+
+        ret = link_cache_relink(cache_args_hash);
+        link_prof.phase("incremental");
+        if (ret == 0) {
+            cmdoptions.in_file.clear();
+            if (link_prof.enabled)
+                dump_link_profile();
+            if (cmdoptions.stats)
+                dump_link_stats();
+
+            return 0;
+        }
+        else if (ret < 0) {
+            return 1;
+        }
+    }
+
     if (!cmdoptions.map_file.empty()) {
         map_fp = fopen(cmdoptions.map_file.c_str(),"w");
         if (map_fp == NULL) return 1;
@@ -2281,210 +3791,80 @@ int main(int argc,char **argv) {
 
     /* loads the OBJ files into memory */
     {
-        struct omf_context_t* omf_state = NULL;
+        vector<input_module_job> jobs;
 
         for (size_t in_file=0;in_file < cmdoptions.in_file.size();in_file++) {
             in_fileRef current_in_file = cmdoptions.in_file[in_file];
-            in_fileModuleRef current_in_file_module;
 
             assert(current_in_file != nullptr);
             assert(!current_in_file->path.empty());
             assert(current_in_file->special == input_file::SPEC_NONE);
 
-            fd = open(current_in_file->path.c_str(),O_RDONLY|O_BINARY);
-            if (fd < 0) {
-                fprintf(stderr,"Failed to open input file %s\n",strerror(errno));
+            current_in_file->image.reset(new input_image);
+            if (input_image_load(*(current_in_file->image),current_in_file->path.c_str()) < 0)
                 return 1;
-            }
 
-            // prepare parsing
-            if ((omf_state=omf_context_create()) == NULL) {
-                fprintf(stderr,"Failed to init OMF parsing state\n");
-                return 1;
+            /* .LIB files with a dictionary are not read here. Modules are pulled in from them
+             * later by load_library_modules(), only those that resolve an EXTDEF. */
+            ret = omf_libdict_read_mem(&current_in_file->libdict,current_in_file->image->data,current_in_file->image->length);
+            if (ret > 0) {
+                current_in_file->image->library_block_size = current_in_file->libdict.library_block_size;
+                continue;
+            }
+            else if (ret < 0) {
+                fprintf(stderr,"Warning: unable to read .LIB dictionary of %s, loading all modules\n",current_in_file->path.c_str());
+                omf_libdict_free(&current_in_file->libdict);
             }
-            omf_state->flags.verbose = (cmdoptions.verbose > 0);
-
-            diddump = 0;
-            omf_context_begin_file(omf_state);
-            current_segment_group = current_in_file->segment_group;
-
-            /* start a new module */
-            current_in_file_module.reset(new input_module);
-            current_in_file_module->file = current_in_file;
-            current_in_file_module->index = current_in_file->modules.size();
-            current_in_file->modules.push_back(current_in_file_module);
-
-            do {
-                ret = omf_context_read_fd(omf_state,fd);
-                if (ret == 0) {
-                    if (omf_state->THEADR != NULL) {
-                        const char *s = omf_state->THEADR;
-                        const char *scan = s;
-                        while (scan[0] != 0 && scan[1] != 0) {
-                            if (*scan == '\\' || *scan == '/')
-                                s = scan+1;
-
-                            scan++;
-                        }
-
-                        current_in_file_module->name = s;
-                    }
-                    if (grpdef_add(current_in_file_module->link_segments, omf_state))
-                        return 1;
-                    if (pubdef_add(current_in_file_module->link_symbols, current_in_file_module->link_segments, omf_state, omf_state->record.rectype, current_in_file, current_in_file_module))
-                        return 1;
 
-                    assert(current_in_file_module->omf_state == NULL);
-                    if ((current_in_file_module->omf_state=omf_context_create()) == NULL) {
-                        fprintf(stderr,"Failed to init OMF parsing state\n");
-                        return 1;
-                    }
+            {
+                const char *err = NULL;
 
-                    /* transfer ownership to new OMF object by swapping valid pointers with NULL pointers in new struct */
-                    swap(current_in_file_module->omf_state->LNAMEs,         omf_state->LNAMEs);
-                    swap(current_in_file_module->omf_state->SEGDEFs,        omf_state->SEGDEFs);
-                    swap(current_in_file_module->omf_state->GRPDEFs,        omf_state->GRPDEFs);
-                    swap(current_in_file_module->omf_state->EXTDEFs,        omf_state->EXTDEFs);
-                    swap(current_in_file_module->omf_state->PUBDEFs,        omf_state->PUBDEFs);
-                    swap(current_in_file_module->omf_state->FIXUPPs,        omf_state->FIXUPPs);
+                if (input_image_index(*(current_in_file->image),&err) < 0) {
+                    fprintf(stderr,"Error: %s\n",current_in_file->path.c_str());
+                    if (err != NULL) fprintf(stderr,"Details: %s\n",err);
+                }
+            }
 
-                    omf_context_clear_for_module(omf_state);
+            /* one module per object file. in a .LIB, the next module follows each MODEND */
+            const struct input_image &img = *(current_in_file->image);
+            size_t rec_i = 0;
 
-                    if (omf_record_is_modend(&omf_state->record)) {
-                        if (!diddump && cmdoptions.verbose) {
-                            my_dumpstate(omf_state);
-                            diddump = 1;
-                        }
+            do {
+                input_module_job job;
 
-                        if (cmdoptions.verbose)
-                            printf("----- next module -----\n");
+                job.file = current_in_file;
+                job.module = new_input_module(current_in_file,(rec_i < img.records.size()) ? img.records[rec_i].offset : 0);
+                job.rec_i = rec_i;
+                job.result = 0;
+                jobs.push_back(job);
 
-                        ret = omf_context_next_lib_module_fd(omf_state,fd);
-                        if (ret < 0) {
-                            printf("Unable to advance to next .LIB module, %s\n",strerror(errno));
-                            if (omf_state->last_error != NULL) fprintf(stderr,"Details: %s\n",omf_state->last_error);
-                        }
-                        else if (ret > 0) {
-                            /* start a new module */
-                            current_in_file_module.reset(new input_module);
-                            current_in_file_module->file = current_in_file;
-                            current_in_file_module->index = current_in_file->modules.size();
-                            current_in_file->modules.push_back(current_in_file_module);
-
-                            omf_context_begin_module(omf_state);
-                            diddump = 0;
-                            continue;
-                        }
-                    }
+                while (rec_i < img.records.size()) {
+                    const uint8_t rectype = img.records[rec_i++].rectype;
 
-                    break;
+                    if (rectype == 0xF1/*LIBEND*/ || (rectype&0xFE) == 0x8A/*MODEND*/)
+                        break;
                 }
-                else if (ret < 0) {
-                    fprintf(stderr,"Error: %s\n",strerror(errno));
-                    if (omf_state->last_error != NULL) fprintf(stderr,"Details: %s\n",omf_state->last_error);
+                if (rec_i == 0 || (img.records[rec_i-1].rectype&0xFE) != 0x8A/*MODEND*/)
                     break;
-                }
-
-                switch (omf_state->record.rectype) {
-                    case OMF_RECTYPE_THEADR:/*0x80*/
-                        if (omf_context_parse_THEADR(omf_state,&omf_state->record) < 0) {
-                            fprintf(stderr,"Error parsing THEADR\n");
-                            return 1;
-                        }
-                        break;
-                    case OMF_RECTYPE_EXTDEF:/*0x8C*/
-                    case OMF_RECTYPE_LEXTDEF:/*0xB4*/
-                    case OMF_RECTYPE_LEXTDEF32:/*0xB5*/
-                        if (omf_context_parse_EXTDEF(omf_state,&omf_state->record) < 0) {
-                            fprintf(stderr,"Error parsing EXTDEF\n");
-                            return 1;
-                        }
-                        break;
-                    case OMF_RECTYPE_PUBDEF:/*0x90*/
-                    case OMF_RECTYPE_PUBDEF32:/*0x91*/
-                    case OMF_RECTYPE_LPUBDEF:/*0xB6*/
-                    case OMF_RECTYPE_LPUBDEF32:/*0xB7*/
-                        if (omf_context_parse_PUBDEF(omf_state,&omf_state->record) < 0) {
-                            fprintf(stderr,"Error parsing PUBDEF\n");
-                            return 1;
-                        }
-                        break;
-                    case OMF_RECTYPE_LNAMES:/*0x96*/
-                        if (omf_context_parse_LNAMES(omf_state,&omf_state->record) < 0) {
-                            fprintf(stderr,"Error parsing LNAMES\n");
-                            return 1;
-                        }
-                        break;
-                    case OMF_RECTYPE_SEGDEF:/*0x98*/
-                    case OMF_RECTYPE_SEGDEF32:/*0x99*/
-                        {
-                            int p_count = omf_state->SEGDEFs.omf_SEGDEFS_count;
-                            int first_new_segdef;
-
-                            if ((first_new_segdef=omf_context_parse_SEGDEF(omf_state,&omf_state->record)) < 0) {
-                                fprintf(stderr,"Error parsing SEGDEF\n");
-                                return 1;
-                            }
-
-                            if (omf_state->flags.verbose)
-                                dump_SEGDEF(stdout,omf_state,(unsigned int)first_new_segdef);
-
-                            if (segdef_add(current_in_file_module->link_segments, omf_state, p_count, current_in_file, current_in_file_module))
-                                return 1;
-                        } break;
-                    case OMF_RECTYPE_GRPDEF:/*0x9A*/
-                    case OMF_RECTYPE_GRPDEF32:/*0x9B*/
-                        if (omf_context_parse_GRPDEF(omf_state,&omf_state->record) < 0) {
-                            fprintf(stderr,"Error parsing GRPDEF\n");
-                            return 1;
-                        }
-                        break;
-                    case OMF_RECTYPE_FIXUPP:/*0x9C*/
-                    case OMF_RECTYPE_FIXUPP32:/*0x9D*/
-                        if (omf_context_parse_FIXUPP(omf_state,&omf_state->record) < 0) {
-                            fprintf(stderr,"Error parsing FIXUPP\n");
-                            return 1;
-                        }
-                        break;
-                    case OMF_RECTYPE_LEDATA:/*0xA0*/
-                    case OMF_RECTYPE_LEDATA32:/*0xA1*/
-                        {
-                            struct omf_ledata_info_t info;
-
-                            if (omf_context_parse_LEDATA(omf_state,&info,&omf_state->record) < 0) {
-                                fprintf(stderr,"Error parsing LEDATA\n");
-                                return 1;
-                            }
+            } while (img.library_block_size != 0 && rec_i < img.records.size());
+        }
 
-                            if (omf_state->flags.verbose)
-                                dump_LEDATA(stdout,omf_state,&info);
+        if (parse_input_modules(jobs))
+            return 1;
 
-                            if (ledata_add(current_in_file_module->link_segments, omf_state, &info))
-                                return 1;
-                        } break;
-                    case OMF_RECTYPE_MODEND:/*0x8A*/
-                    case OMF_RECTYPE_MODEND32:/*0x8B*/
-                        if (parse_MODEND(current_in_file_module->link_segments, omf_state, current_in_file, current_in_file_module, current_in_file_module->entry_point))
-                            return 1;
-                        break;
-                    default:
-                        break;
-                }
-            } while (1);
+        link_prof.phase("parse");
 
-            if (!diddump && cmdoptions.verbose) {
-                my_dumpstate(omf_state);
-                diddump = 1;
-            }
+        /* pull in what is needed from .LIB files */
+        if (load_library_modules())
+            return 1;
 
-            omf_context_clear(omf_state);
-            omf_state = omf_context_destroy(omf_state);
+        link_prof.phase("libraries");
 
-            close(fd);
-            current_segment_group = -1;
+        for (auto fi=cmdoptions.in_file.begin();fi!=cmdoptions.in_file.end();fi++) {
+            auto in_file = *fi;
 
-            if (current_in_file->modules.size() == 1) {
-                for (auto mi=current_in_file->modules.begin();mi!=current_in_file->modules.end();mi++)
+            if (in_file->modules.size() == 1) {
+                for (auto mi=in_file->modules.begin();mi!=in_file->modules.end();mi++)
                     (*mi)->index = ~((size_t)(0u));
             }
         }
@@ -2586,10 +3966,14 @@ int main(int argc,char **argv) {
     }
     current_segment_group = -1;
 
+    link_prof.phase("gather");
+
     /* compute relocations (first symbol pass) */
     if (compute_exe_relocations(exe_relocation_table,link_symbols,link_segments))
         return 1;
 
+    link_prof.phase("relocations");
+
     owlink_default_sort_seg(link_segments);
     mark_typical_noemit(link_segments);
 
@@ -3177,10 +4561,20 @@ int main(int argc,char **argv) {
         }
     }
 
+    link_prof.phase("arrange");
+
+    /* the layout fixups are applied against, for the incremental link cache */
+    if (cmdoptions.incremental) {
+        cache_segments = link_segments;
+        cache_symbols = link_symbols.symbols;
+    }
+
     /* apply relocations (second symbol pass) */
     if (apply_relocation_fixup(exe_relocation_table,link_symbols,link_segments))
         return 1;
 
+    link_prof.phase("fixups");
+
     sort(link_segments.begin(), link_segments.end(), link_segments_qsort_by_linofs);
 
     dump_link_relocations(exe_relocation_table);
@@ -3189,6 +4583,8 @@ int main(int argc,char **argv) {
 
     sort(link_symbols.begin(), link_symbols.end(), link_symbol_qsort_cmp);
 
+    link_prof.phase("map");
+
     /* decide file offsets */
     {
         unsigned int linkseg;
@@ -3593,6 +4989,8 @@ int main(int argc,char **argv) {
         }
     }
 
+    link_prof.phase("image");
+
     /* write output */
     sort(link_segments.begin(), link_segments.end(), link_segments_qsort_by_fileofs);
     dump_link_segments(link_segments,DUMPLS_FILEOFFSET);
@@ -3663,11 +5061,15 @@ int main(int argc,char **argv) {
                     cur_offset += frag->fragment_length;
                 }
             }
+
+            link_prof.written(cur_offset);
         }
 
         close(fd);
     }
 
+    link_prof.phase("write");
+
     if (map_fp != NULL) {
         fprintf(map_fp,"\n");
         fprintf(map_fp,"Entry point:\n");
@@ -3752,6 +5154,19 @@ int main(int argc,char **argv) {
         map_fp = NULL;
     }
 
+    if (cmdoptions.incremental) {
+        if (cmdoptions.output_format == OFMT_DOSDRV && cmdoptions.output_format_variant == OFMTVAR_COMREL) {
+            unlink(link_cache_path().c_str());
+        }
+        else if (link_cache_write(cache_args_hash,cache_segments,cache_symbols) < 0) {
+            fprintf(stderr,"Warning: unable to write incremental link cache\n");
+            unlink(link_cache_path().c_str());
+        }
+
+        cache_segments.clear();
+        cache_symbols.clear();
+    }
+
     /* avoid shared_ptr cyclic reference leaks, clear out state now */
     for (auto fi=cmdoptions.in_file.begin();fi!=cmdoptions.in_file.end();fi++) {
         auto in_file = *fi;
@@ -3764,6 +5179,13 @@ int main(int argc,char **argv) {
         in_file->modules.clear();
     }
     cmdoptions.in_file.clear();
+
+    link_prof.phase("finish");
+    if (link_prof.enabled)
+        dump_link_profile();
+    if (cmdoptions.stats)
+        dump_link_stats();
+
     return 0;
 }
 
@@ -20,7 +20,7 @@ os232=1 # OS/2 32-bit 386
 if [ "$1" == "clean" ]; then
     do_clean
     rm -fv test.dsk
-    rm -Rfv linux-host
+    rm -Rfv linux-host bench/linux-host
     exit 0
 fi
 